@@ -0,0 +1,80 @@
+#version 450
+// Light binning for clustered forward shading. One workgroup per cluster of
+// the froxel grid: its invocations split the bounded lights between them,
+// test each against the cluster's view-space box (and spot cones against its
+// bounding sphere) and append the survivors to the cluster's fixed-size list.
+#include "light_common.glsl"
+
+layout(local_size_x = 64) in;
+
+layout(std430, set=0, binding=0) readonly buffer Lights { GpuLight lights[]; };
+layout(std430, set=0, binding=1) writeonly buffer ClusterCounts { uint clusterCounts[]; };
+layout(std430, set=0, binding=2) writeonly buffer ClusterIndices { uint clusterIndices[]; };
+layout(std430, set=0, binding=3) buffer ClusterStats {
+    uint maxClusterLights;
+    uint fullClusters;
+};
+
+layout(push_constant) uniform BinConstants {
+    mat4 view;
+    vec4 projection;  // P[0][0], P[1][1], P[2][0], P[2][1]
+    float zNear;
+    float zFar;
+    uint firstLight;  // Global lights before this index are not binned
+    uint lightCount;
+} PC;
+
+shared uint binned;
+
+void main() {
+    uvec3 cluster = gl_WorkGroupID;
+    uint index = ClusterIndex(cluster);
+    if (gl_LocalInvocationIndex == 0) binned = 0u;
+    barrier();
+
+    // Slice bounds as view depth, exponentially spaced like the lookup in pbr.frag
+    float nearDepth = PC.zNear * pow(PC.zFar / PC.zNear, float(cluster.z) / float(CLUSTER_Z));
+    float farDepth = PC.zNear * pow(PC.zFar / PC.zNear, float(cluster.z + 1u) / float(CLUSTER_Z));
+
+    // The tile in NDC, as view-space x/y per unit of depth; the box's extremes
+    // lie on the slice's near and far planes
+    vec2 grid = vec2(CLUSTER_X, CLUSTER_Y);
+    vec2 a = (vec2(cluster.xy) / grid * 2.0 - 1.0 + PC.projection.zw) / PC.projection.xy;
+    vec2 b = (vec2(cluster.xy + 1u) / grid * 2.0 - 1.0 + PC.projection.zw) / PC.projection.xy;
+    vec2 lo = min(min(a * nearDepth, a * farDepth), min(b * nearDepth, b * farDepth));
+    vec2 hi = max(max(a * nearDepth, a * farDepth), max(b * nearDepth, b * farDepth));
+    vec3 boxMin = vec3(lo, -farDepth);
+    vec3 boxMax = vec3(hi, -nearDepth);
+    vec3 sphereCenter = (boxMin + boxMax) * 0.5;
+    float sphereRadius = length(boxMax - boxMin) * 0.5;
+
+    for (uint i = PC.firstLight + gl_LocalInvocationIndex; i < PC.lightCount; i += gl_WorkGroupSize.x) {
+        GpuLight light = lights[i];
+        vec3 center = (PC.view * vec4(light.positionRange.xyz, 1.0)).xyz;
+        float range = light.positionRange.w;
+        vec3 offset = clamp(center, boxMin, boxMax) - center;
+        if (dot(offset, offset) > range * range) continue;
+
+        if (uint(light.colorType.w) == LIGHT_SPOT) {
+            // Cone against the cluster's bounding sphere
+            vec3 axis = normalize(mat3(PC.view) * light.directionCos.xyz);
+            float cosAngle = light.directionCos.w;
+            float sinAngle = sqrt(max(1.0 - cosAngle * cosAngle, 0.0));
+            vec3 v = sphereCenter - center;
+            float along = dot(v, axis);
+            float across = sqrt(max(dot(v, v) - along * along, 0.0));
+            if (cosAngle * across - along * sinAngle > sphereRadius) continue;
+            if (along < -sphereRadius) continue;
+        }
+
+        uint slot = atomicAdd(binned, 1u);
+        if (slot < MAX_LIGHTS_PER_CLUSTER) clusterIndices[index * MAX_LIGHTS_PER_CLUSTER + slot] = i;
+    }
+
+    barrier();
+    if (gl_LocalInvocationIndex == 0) {
+        clusterCounts[index] = min(binned, MAX_LIGHTS_PER_CLUSTER);
+        atomicMax(maxClusterLights, binned);
+        if (binned > MAX_LIGHTS_PER_CLUSTER) atomicAdd(fullClusters, 1u);
+    }
+}
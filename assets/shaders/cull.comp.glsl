@@ -0,0 +1,21 @@
+#version 450
+// Frustum culling for the GPU-driven path. One invocation per scene object;
+// visible objects append a draw at the slot returned by the atomic draw
+// counter. With occlusion culling this is the early phase: only objects the
+// last late cull found visible are drawn, the rest wait for occlusion.comp.
+#include "cull_common.glsl"
+
+layout(local_size_x = 64) in;
+
+void main() {
+    uint id = gl_GlobalInvocationID.x;
+    if (id >= PC.objectCount) return;
+
+    GpuObject obj;
+    if (!LoadObject(id, obj)) return;
+    if (PC.phase == PHASE_EARLY && (id >= PC.historyCount || visibility[id] == 0u)) return;
+    vec4 sphere = WorldSphere(obj);
+    if (!InFrustum(sphere)) return;
+
+    EmitDraw(atomicAdd(drawCount, 1u), id, obj, sphere);
+}
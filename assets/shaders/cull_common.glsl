@@ -0,0 +1,128 @@
+// Shared by cull.comp and occlusion.comp: the scene buffers of GpuScene's
+// cull descriptor set, its push constants, the per-object frustum test and
+// level-of-detail selection.
+// std430 layouts must match GpuScene.h/.cpp.
+
+struct GpuObject {
+    mat4 transform;
+    vec4 sphere;      // Local-space bounding sphere (xyz center, w radius)
+    uint mesh;        // Index into the mesh table
+    uint material;
+    uint pad0;
+    uint pad1;
+};
+
+const uint MAX_MESH_LODS = 8u;   // IRenderer.h
+
+struct GpuMeshLod {
+    uint firstIndex;
+    uint indexCount;
+    float error;      // Mesh units
+    uint pad;
+};
+
+struct GpuMesh {
+    int vertexOffset;
+    uint lodCount;    // 0 = released handle
+    uint pad0;
+    uint pad1;
+    vec4 dequantize;  // Stored position to mesh space: xyz offset, w scale
+    GpuMeshLod lods[MAX_MESH_LODS];
+};
+
+struct DrawCommand {
+    uint indexCount;
+    uint instanceCount;
+    uint firstIndex;
+    int vertexOffset;
+    uint firstInstance;
+};
+
+// GpuScene::CullPhase
+const uint PHASE_ALL = 0u;
+const uint PHASE_EARLY = 1u;
+const uint PHASE_LATE = 2u;
+
+layout(std430, set=0, binding=0) readonly buffer Objects { GpuObject objects[]; };
+layout(std430, set=0, binding=1) readonly buffer Meshes { GpuMesh meshes[]; };
+layout(std430, set=0, binding=2) writeonly buffer Commands { DrawCommand commands[]; };
+layout(std430, set=0, binding=3) buffer DrawCounts {
+    uint drawCount;       // All or Early
+    uint lateDrawCount;
+    uint occludedCount;   // In the frustum but behind the depth pyramid
+    uint lodDrawCounts[MAX_MESH_LODS];
+};
+layout(std430, set=0, binding=4) writeonly buffer Instances { mat4 instances[]; };
+layout(std430, set=0, binding=5) writeonly buffer VisibleObjects { uint visibleObjects[]; };
+// One entry per object, 1 if the last late cull found it visible. Read by the
+// early cull and rewritten by the late one.
+layout(std430, set=0, binding=6) buffer Visibility { uint visibility[]; };
+// One entry per object: the level of detail it was last drawn with
+layout(std430, set=0, binding=7) buffer LodHistory { uint lodHistory[]; };
+
+layout(push_constant) uniform CullConstants {
+    vec4 planes[6];   // Normalized, inside where dot(n, p) + d >= 0
+    uint objectCount;
+    uint meshCount;
+    uint phase;
+    uint historyCount; // Leading objects with a valid visibility entry
+    float lodScale;     // Pixels per world unit at view depth 1
+    float lodThreshold; // Pixels of error allowed; 0 keeps every object at level 0
+    float lodHysteresis;
+} PC;
+
+// Loads object `id`; false for released meshes
+bool LoadObject(uint id, out GpuObject obj) {
+    obj = objects[id];
+    return obj.mesh < PC.meshCount && meshes[obj.mesh].lodCount != 0u;
+}
+
+float MaxScale(mat4 m) {
+    return max(length(m[0].xyz), max(length(m[1].xyz), length(m[2].xyz)));
+}
+
+// Must match GpuScene::WorldSphere on the CPU
+vec4 WorldSphere(GpuObject obj) {
+    vec3 center = (obj.transform * vec4(obj.sphere.xyz, 1.0)).xyz;
+    return vec4(center, obj.sphere.w * MaxScale(obj.transform));
+}
+
+bool InFrustum(vec4 sphere) {
+    for (int i = 0; i < 6; ++i) {
+        if (dot(PC.planes[i].xyz, sphere.xyz) + PC.planes[i].w < -sphere.w) return false;
+    }
+    return true;
+}
+
+// The coarsest level whose error, projected at the sphere's nearest view
+// depth, stays under the threshold; going coarser than last time needs the
+// hysteresis margin. Must match GpuScene::SelectLodsCpu on the CPU.
+uint SelectLod(uint id, GpuObject obj, vec4 sphere) {
+    uint lodCount = meshes[obj.mesh].lodCount;
+    uint previous = min(lodHistory[id], lodCount - 1u);
+    uint lod = 0u;
+    float depth = dot(PC.planes[4].xyz, sphere.xyz) + PC.planes[4].w - sphere.w;
+    if (depth > 0.0 && PC.lodThreshold > 0.0) {
+        float pixels = PC.lodScale * MaxScale(obj.transform) / depth;
+        for (uint i = 1u; i < lodCount; ++i) {
+            float limit = i > previous ? PC.lodThreshold * (1.0 - PC.lodHysteresis) : PC.lodThreshold;
+            if (meshes[obj.mesh].lods[i].error * pixels <= limit) lod = i;
+        }
+    }
+    lodHistory[id] = lod;
+    return lod;
+}
+
+// A VkDrawIndexedIndirectCommand for the selected level, its transform with
+// the mesh's position dequantization folded in (read by the vertex shader as
+// per-instance data at firstInstance) and its object index, all at `slot`
+void EmitDraw(uint slot, uint id, GpuObject obj, vec4 sphere) {
+    uint lod = SelectLod(id, obj, sphere);
+    atomicAdd(lodDrawCounts[lod], 1u);
+    GpuMeshLod range = meshes[obj.mesh].lods[lod];
+    commands[slot] = DrawCommand(range.indexCount, 1u, range.firstIndex, meshes[obj.mesh].vertexOffset, slot);
+    vec4 dequantize = meshes[obj.mesh].dequantize;
+    mat4 m = obj.transform;
+    instances[slot] = mat4(m[0] * dequantize.w, m[1] * dequantize.w, m[2] * dequantize.w, m * vec4(dequantize.xyz, 1.0));
+    visibleObjects[slot] = id;
+}
@@ -0,0 +1,15 @@
+#version 450
+#include "pc_common.glsl"
+
+// Depth prepass: positions come from the geometry pool's position-only stream
+// (unorm16 for VertexLayout::Compact, dequantized by the instance matrix)
+layout(location=0) in vec3 inPos;
+layout(location=3) in mat4 inInstanceMatrix;
+
+// Same expression as pbr.vert, so the main pass can test with EQUAL
+invariant gl_Position;
+
+void main() {
+    vec4 worldPos = inInstanceMatrix * vec4(inPos, 1.0);
+    gl_Position = PC.viewProj * worldPos;
+}
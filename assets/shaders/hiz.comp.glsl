@@ -0,0 +1,116 @@
+#version 450
+// Single-pass Hi-Z downsampler: builds every level of the depth pyramid in one
+// dispatch. Each level holds the farthest depth of the texels it covers. A
+// workgroup reduces a 64x64 tile of level 0 to one texel of level 6 through
+// shared memory; the last workgroup to finish, found with a global atomic
+// counter, then reduces level 6 to the remaining levels.
+layout(local_size_x = 256) in;
+
+const uint MAX_LEVELS = 13;  // DepthPyramid::MAX_LEVELS
+const uint TILE_LEVELS = 7;  // 64x64 down to 1x1
+
+layout(set=0, binding=0) uniform sampler2D depthImage;
+layout(set=0, binding=1, r32f) uniform coherent image2D levels[MAX_LEVELS];
+layout(std430, set=0, binding=2) coherent buffer Counter { uint finishedGroups; };
+
+layout(push_constant) uniform PyramidConstants {
+    uvec2 depthSize;
+    uvec2 size;        // Level 0, powers of two
+    uint levelCount;
+    uint groupCount;
+} PC;
+
+shared float tile[16 * 16];
+shared bool lastGroup;
+
+uvec2 LevelSize(uint level) {
+    return max(PC.size >> level, uvec2(1u));
+}
+
+// Texels past a level's edge are dropped; they read as 0, which every max ignores
+void Store(uint level, uvec2 p, float depth) {
+    if (level < PC.levelCount && all(lessThan(p, LevelSize(level)))) imageStore(levels[level], ivec2(p), vec4(depth));
+}
+
+// Farthest depth under level-0 texel `p`, rounding its footprint outwards
+float Footprint(uvec2 p) {
+    if (any(greaterThanEqual(p, PC.size))) return 0.0;
+    uvec2 lo = p * PC.depthSize / PC.size;
+    uvec2 hi = min(((p + 1u) * PC.depthSize + PC.size - 1u) / PC.size, PC.depthSize);
+    float depth = 0.0;
+    for (uint y = lo.y; y < hi.y; ++y) {
+        for (uint x = lo.x; x < hi.x; ++x) depth = max(depth, texelFetch(depthImage, ivec2(x, y), 0).r);
+    }
+    return depth;
+}
+
+void main() {
+    uint t = gl_LocalInvocationIndex;
+    uvec2 origin = gl_WorkGroupID.xy * 64u;
+
+    // Levels 0-2: every invocation owns a 4x4 block of level 0
+    uvec2 block = uvec2(t % 16u, t / 16u);
+    uvec2 base = origin + block * 4u;
+    float depth2 = 0.0;
+    for (uint qy = 0u; qy < 2u; ++qy) {
+        for (uint qx = 0u; qx < 2u; ++qx) {
+            float depth1 = 0.0;
+            for (uint y = 0u; y < 2u; ++y) {
+                for (uint x = 0u; x < 2u; ++x) {
+                    uvec2 p = base + uvec2(qx, qy) * 2u + uvec2(x, y);
+                    float depth0 = Footprint(p);
+                    Store(0u, p, depth0);
+                    depth1 = max(depth1, depth0);
+                }
+            }
+            Store(1u, base / 2u + uvec2(qx, qy), depth1);
+            depth2 = max(depth2, depth1);
+        }
+    }
+    Store(2u, base / 4u, depth2);
+    tile[t] = depth2;
+    barrier();
+
+    // Levels 3-6 in shared memory, halving the active invocations each time
+    uint width = 16u;
+    for (uint level = 3u; level < TILE_LEVELS; ++level) {
+        width /= 2u;
+        float depth = 0.0;
+        if (t < width * width) {
+            uvec2 p = uvec2(t % width, t / width);
+            uint row = width * 2u;
+            uint src = p.y * 2u * row + p.x * 2u;
+            depth = max(max(tile[src], tile[src + 1u]), max(tile[src + row], tile[src + row + 1u]));
+            Store(level, origin / (1u << level) + p, depth);
+        }
+        barrier();
+        if (t < width * width) tile[t] = depth;
+        barrier();
+    }
+    if (PC.levelCount <= TILE_LEVELS) return;
+
+    // Publish this tile's texel of level 6 before counting the group as done
+    memoryBarrierImage();
+    barrier();
+    if (t == 0u) lastGroup = atomicAdd(finishedGroups, 1u) == PC.groupCount - 1u;
+    barrier();
+    if (!lastGroup) return;
+
+    for (uint level = TILE_LEVELS; level < PC.levelCount; ++level) {
+        uvec2 size = LevelSize(level);
+        uvec2 srcSize = LevelSize(level - 1u);
+        for (uint i = t; i < size.x * size.y; i += 256u) {
+            uvec2 p = uvec2(i % size.x, i / size.x);
+            float depth = 0.0;
+            for (uint y = 0u; y < 2u; ++y) {
+                for (uint x = 0u; x < 2u; ++x) {
+                    uvec2 q = p * 2u + uvec2(x, y);
+                    if (all(lessThan(q, srcSize))) depth = max(depth, imageLoad(levels[level - 1u], ivec2(q)).r);
+                }
+            }
+            imageStore(levels[level], ivec2(p), vec4(depth));
+        }
+        memoryBarrierImage();
+        barrier();
+    }
+}
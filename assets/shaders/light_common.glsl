@@ -0,0 +1,21 @@
+// Lights and the cluster grid, shared by cluster.comp and pbr.frag; must match
+// GpuLight and the constants in LightClusters.h
+const uint LIGHT_DIRECTIONAL = 0;
+const uint LIGHT_POINT = 1;
+const uint LIGHT_SPOT = 2;
+
+const uint CLUSTER_X = 16;
+const uint CLUSTER_Y = 9;
+const uint CLUSTER_Z = 24;
+const uint MAX_LIGHTS_PER_CLUSTER = 128;
+
+struct GpuLight {
+    vec4 positionRange;  // xyz world position, w range (0 = unbounded)
+    vec4 colorType;      // rgb color * intensity, w light type
+    vec4 directionCos;   // xyz direction the light points, w cos of the outer cone angle
+    vec4 attenuation;    // x constant, y linear, z quadratic, w cos of the inner cone angle
+};
+
+uint ClusterIndex(uvec3 cluster) {
+    return (cluster.z * CLUSTER_Y + cluster.y) * CLUSTER_X + cluster.x;
+}
@@ -0,0 +1,71 @@
+#version 450
+// Late phase of two-phase occlusion culling. Every object in the frustum is
+// tested against the Hi-Z pyramid built from the depth of the early phase
+// (last frame's visible objects plus everything else the main pass drew), and
+// the result becomes next frame's visibility. Visible objects the early phase
+// did not draw append a draw from lateOffset on, counted by lateDrawCount.
+#include "cull_common.glsl"
+
+layout(local_size_x = 64) in;
+
+layout(std140, set=1, binding=0) uniform OcclusionParams {
+    mat4 viewProjection;
+    vec2 pyramidSize;     // Level 0
+    uint pyramidLevels;
+    uint lateOffset;      // First command and instance slot of the late draws
+} OP;
+// Farthest depth per texel; read with texelFetch, the sampler is unused
+layout(set=1, binding=1) uniform sampler2D depthPyramid;
+
+// Projects the corners of the sphere's world-space box and compares their
+// nearest depth with the farthest depth under the box, at the pyramid level
+// where the box spans at most two texels per axis. Conservative: boxes that
+// reach behind the camera and unbounded objects are never occluded.
+bool Occluded(vec4 sphere) {
+    if (sphere.w >= 1e29) return false;
+    vec2 lo = vec2(1.0);
+    vec2 hi = vec2(-1.0);
+    float nearest = 1.0;
+    for (int i = 0; i < 8; ++i) {
+        vec3 corner = sphere.xyz + sphere.w * vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0,
+                                                   (i & 4) != 0 ? 1.0 : -1.0);
+        vec4 clip = OP.viewProjection * vec4(corner, 1.0);
+        if (clip.w <= 0.0) return false;
+        vec3 ndc = clip.xyz / clip.w;
+        lo = min(lo, ndc.xy);
+        hi = max(hi, ndc.xy);
+        nearest = min(nearest, ndc.z);
+    }
+
+    vec2 uvMin = clamp(lo * 0.5 + 0.5, 0.0, 1.0);
+    vec2 uvMax = clamp(hi * 0.5 + 0.5, 0.0, 1.0);
+    vec2 texels = (uvMax - uvMin) * OP.pyramidSize;
+    int level = int(ceil(log2(max(max(texels.x, texels.y), 1.0))));
+    level = min(level, int(OP.pyramidLevels) - 1);
+    ivec2 size = textureSize(depthPyramid, level);
+    ivec2 a = clamp(ivec2(uvMin * vec2(size)), ivec2(0), size - 1);
+    ivec2 b = clamp(ivec2(uvMax * vec2(size)), ivec2(0), size - 1);
+    float farthest = max(max(texelFetch(depthPyramid, a, level).r, texelFetch(depthPyramid, ivec2(b.x, a.y), level).r),
+                         max(texelFetch(depthPyramid, ivec2(a.x, b.y), level).r, texelFetch(depthPyramid, b, level).r));
+    return nearest > farthest;
+}
+
+void main() {
+    uint id = gl_GlobalInvocationID.x;
+    if (id >= PC.objectCount) return;
+
+    GpuObject obj;
+    if (!LoadObject(id, obj)) {
+        visibility[id] = 0u;
+        return;
+    }
+    bool drawnEarly = id < PC.historyCount && visibility[id] != 0u;
+    vec4 sphere = WorldSphere(obj);
+    bool visible = InFrustum(sphere);
+    if (visible && Occluded(sphere)) {
+        visible = false;
+        atomicAdd(occludedCount, 1u);
+    }
+    visibility[id] = visible ? 1u : 0u;
+    if (visible && !drawnEarly) EmitDraw(OP.lateOffset + atomicAdd(lateDrawCount, 1u), id, obj, sphere);
+}
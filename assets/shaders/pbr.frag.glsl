@@ -1,5 +1,6 @@
 #version 450
 #include "pc_common.glsl"
+#include "light_common.glsl"
 
 layout(location=0) in vec3 vNrm;
 layout(location=1) in vec2 vUV;
@@ -7,14 +8,24 @@ layout(location=2) in vec3 vWorldPos;
 layout(location=3) in vec4 vShadowCoord; // Shadow coordinate for first light (for compatibility)
 layout(location=0) out vec4 outColor;
 
+// Material variants, set per pipeline by PipelineStateCache
+layout(constant_id = 0) const int SHADING_MODEL = 2;    // MaterialShadingModel: 0 unlit, 1 lit, 2 PBR
+layout(constant_id = 1) const bool ALPHA_MASK = false;  // MaterialBlendMode::Masked
+const float ALPHA_CUTOFF = 0.5;
+
 // Uniform buffer for model matrix and light data
 layout(set=0, binding=0) uniform UniformBufferObject {
     mat4 model;           // Model matrix
-    vec4 lightPositions[3];  // 3 light positions
-    vec4 lightColors[3];     // 3 light colors
+    vec4 clusterScale;    // xy clusters per pixel, zw log(view depth) to slice
+    uvec4 lightCounts;    // x global lights, at the start of the light buffer
     mat4 lightSpaceMatrices[3];   // Light space matrices for all lights
 } ubo;
 
+// Clustered lights, binned by cluster.comp
+layout(std430, set=0, binding=1) readonly buffer Lights { GpuLight lights[]; };
+layout(std430, set=0, binding=2) readonly buffer ClusterCounts { uint clusterCounts[]; };
+layout(std430, set=0, binding=3) readonly buffer ClusterIndices { uint clusterIndices[]; };
+
 // Shadow maps for all lights (temporarily disabled)
 // layout(set=0, binding=0) uniform sampler2DArrayShadow shadowMap2D;
 // layout(set=0, binding=1) uniform sampler2DArrayShadow shadowMapCube;
@@ -38,42 +49,90 @@ float ShadowCalculation(vec3 worldPos, vec3 lightPos, float farPlane, int shadow
     return 1.0; // Returns 0..1 (1 = lit)
 }
 
+// Light reaching the fragment from `light`; L is the direction towards it
+vec3 LightRadiance(GpuLight light, vec3 worldPos, out vec3 L) {
+    uint type = uint(light.colorType.w);
+    if (type == LIGHT_DIRECTIONAL) {
+        L = -light.directionCos.xyz;
+        return light.colorType.rgb;
+    }
+    vec3 toLight = light.positionRange.xyz - worldPos;
+    float dist = length(toLight);
+    L = toLight / max(dist, 1e-6);
+    float falloff = 1.0;
+    float range = light.positionRange.w;
+    if (range > 0.0) {
+        // Windowed to reach zero at the range, where binning stops
+        vec3 k = light.attenuation.xyz;
+        float window = clamp(1.0 - pow(dist / range, 4.0), 0.0, 1.0);
+        falloff = window * window / max(k.x + k.y * dist + k.z * dist * dist, 1e-4);
+    }
+    if (type == LIGHT_SPOT) {
+        falloff *= smoothstep(light.directionCos.w, light.attenuation.w, dot(-L, light.directionCos.xyz));
+    }
+    return light.colorType.rgb * falloff;
+}
+
+vec3 ShadeLight(GpuLight light, vec3 N, vec3 V, float shadow) {
+    vec3 L;
+    vec3 radiance = LightRadiance(light, vWorldPos, L) * shadow;
+    // Skip if light has no intensity (safety check)
+    if (dot(radiance, radiance) < 1e-6) {
+        return vec3(0.0);
+    }
+    float NoL = max(dot(N, L), 0.0);
+    
+    // Diffuse contribution (reduced by shadow)
+    vec3 diffuse = PC.baseColor.rgb * NoL * radiance;
+    
+    // Simple specular (also reduced by shadow); lit is diffuse only
+    vec3 specular = vec3(0.0);
+    if (SHADING_MODEL == 2) {
+        vec3 H = normalize(L + V);
+        float NoH = max(dot(N, H), 0.0);
+        float spec = pow(NoH, mix(8.0, 64.0, 1.0 - PC.roughness));
+        specular = spec * 0.15 * radiance;
+    }
+    return diffuse + specular;
+}
+
 void main(){
+    if (ALPHA_MASK && PC.baseColor.a < ALPHA_CUTOFF) {
+        discard;
+    }
+    if (SHADING_MODEL == 0) {
+        outColor = PC.baseColor;
+        return;
+    }
+    
     vec3 N = normalize(vNrm);
     vec3 V = normalize(vec3(0.0, 0.0, 1.0));
     
     vec3 totalColor = vec3(0.0);
     
-    // Process each light
-    for (int i = 0; i < 3; i++) {
-        // Skip if light has no intensity (safety check)
-        if (length(ubo.lightColors[i].rgb) < 0.001) {
-            continue;
-        }
-        
-        // Calculate light direction from sphere position to light position
-        vec3 L = normalize(ubo.lightPositions[i].xyz - vWorldPos);
-        float NoL = max(dot(N, L), 0.0);
-        
+    // Directional and unbounded lights reach every fragment
+    for (uint i = 0; i < ubo.lightCounts.x; i++) {
         // Calculate shadow for this light (point light with cubemap)
         float farPlane = 50.0; // Should match the far plane used in light space matrix calculation
-        float shadow = ShadowCalculation(vWorldPos, ubo.lightPositions[i].xyz, farPlane, i);
-        
-        // Diffuse contribution (reduced by shadow)
-        vec3 diffuse = PC.baseColor.rgb * NoL * ubo.lightColors[i].rgb * shadow;
-        
-        // Simple specular (also reduced by shadow)
-        vec3 H = normalize(L + V);
-        float NoH = max(dot(N, H), 0.0);
-        float spec = pow(NoH, mix(8.0, 64.0, 1.0 - PC.roughness));
-        vec3 specular = spec * 0.15 * ubo.lightColors[i].rgb * shadow;
-        
-        totalColor += diffuse + specular;
+        float shadow = ShadowCalculation(vWorldPos, lights[i].positionRange.xyz, farPlane, int(i));
+        totalColor += ShadeLight(lights[i], N, V, shadow);
+    }
+    
+    // Then the lights binned into this fragment's cluster: its screen tile,
+    // and the exponential slice of its view depth (1 / gl_FragCoord.w)
+    uvec3 cluster;
+    cluster.xy = min(uvec2(gl_FragCoord.xy * ubo.clusterScale.xy), uvec2(CLUSTER_X - 1, CLUSTER_Y - 1));
+    float slice = log(1.0 / gl_FragCoord.w) * ubo.clusterScale.z + ubo.clusterScale.w;
+    cluster.z = uint(clamp(slice, 0.0, float(CLUSTER_Z - 1)));
+    uint clusterIndex = ClusterIndex(cluster);
+    uint clusterLights = clusterCounts[clusterIndex];
+    for (uint i = 0; i < clusterLights; i++) {
+        totalColor += ShadeLight(lights[clusterIndices[clusterIndex * MAX_LIGHTS_PER_CLUSTER + i]], N, V, 1.0);
     }
     
     // Add ambient lighting to prevent completely dark areas
     vec3 ambient = PC.baseColor.rgb * 0.1;
     totalColor += ambient;
     
-    outColor = vec4(totalColor, 1.0);
+    outColor = vec4(totalColor, PC.baseColor.a);
 }
@@ -1,6 +1,8 @@
 #version 450
 #include "pc_common.glsl"
 
+// VertexLayout::Compact feeds unorm16 positions, dequantized by the instance
+// matrix, and an octahedral-encoded normal in inNrm.xy
 layout(location=0) in vec3 inPos;
 layout(location=1) in vec3 inNrm;
 layout(location=2) in vec2 inUV;
@@ -11,16 +13,30 @@ layout(location=1) out vec2 vUV;
 layout(location=2) out vec3 vWorldPos;
 layout(location=3) out vec4 vShadowCoord; // Shadow coordinate for first light (for compatibility)
 
+// Must match depth.vert bit for bit: the main pass tests EQUAL after a depth prepass
+invariant gl_Position;
+
+layout(constant_id = 2) const bool OCT_NORMALS = false;  // VertexLayout::Compact
+
 // Uniform buffer for model matrix and light data
 layout(set=0, binding=0) uniform UniformBufferObject {
     mat4 model;           // Model matrix
-    vec4 lightPositions[3];  // 3 light positions
-    vec4 lightColors[3];     // 3 light colors
+    vec4 clusterScale;    // xy clusters per pixel, zw log(view depth) to slice
+    uvec4 lightCounts;    // x global lights, at the start of the light buffer
     mat4 lightSpaceMatrices[3];   // Light space matrices for all lights
 } ubo;
 
+vec3 OctDecode(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
 void main() {
-    vNrm = mat3(inInstanceMatrix) * inNrm;
+    // The fragment shader renormalizes, so the dequantization scale in the
+    // instance matrix does not matter here
+    vNrm = mat3(inInstanceMatrix) * (OCT_NORMALS ? OctDecode(inNrm.xy) : inNrm);
     vUV = inUV;
     vec4 worldPos = inInstanceMatrix * vec4(inPos, 1.0);
     vWorldPos = worldPos.xyz; // Pass world position to fragment shader
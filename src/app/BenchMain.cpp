@@ -0,0 +1,758 @@
+#include "engine/core/Log.h"
+#include "engine/core/Camera.h"
+#include "engine/core/LightingManager.h"
+#include "engine/core/Profiler.h"
+#include "engine/core/FrameStats.h"
+#include "engine/core/MemoryTracker.h"
+#include "engine/renderer/vk/VulkanRenderer.h"
+#include "engine/renderer/null/NullRenderer.h"
+#include "engine/core/Frustum.h"
+#include "engine/assets/AssetManager.h"
+#include "engine/assets/Mesh.h"
+#include "engine/assets/MeshSimplify.h"
+#include "engine/assets/importers/GLTFImporter.h"
+#include <GLFW/glfw3.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+// NovaBench: deterministic, non-interactive benchmark runner.
+// Loads a fixed scene, flies a scripted camera path with a fixed timestep and
+// writes frame-time percentiles, per-phase/per-pass times and memory peaks as JSON.
+//
+//   NovaBench [--warmup=N] [--frames=M] [--grid=K] [--width=W] [--height=H]
+//             [--mesh=path] [--out=file.json] [--trace=file.json] [--verbose]
+//             [--cull=off|cpu|gpu|validate] [--pipeline-cache=warm|cold|off]
+//             [--record-threads=N[,N...]] [--materials=N] [--device=name]
+//             [--sort=on|off] [--resize-every=N] [--frames-in-flight=1..4]
+//             [--present=fifo|mailbox|immediate] [--headless]
+//             [--readback-every=N] [--screenshot=file.ppm] [--backend=vulkan|null]
+//             [--depth-prepass=on|off] [--lights=N] [--occlusion=on|off]
+//             [--lods=N] [--lod-bias=F] [--vertex-format=standard|compact]
+//
+// --cull other than off renders the grid as static GPU-driven scene objects,
+// frustum culled on the CPU or by compute; validate checks every GPU result
+// against CPU culling and exits with code 3 on any disagreement.
+// --pipeline-cache=cold deletes the cache file first, so running cold then
+// warm compares pipeline creation with and without it.
+// --record-threads with several counts runs the measured frames once per
+// count and reports the mean recording time of each. --materials=2 or more
+// alternates scene-object materials so no two neighbours batch and every
+// visible object is its own draw unless draws are sorted (--sort=off keeps
+// submission order). Recording scaling, e.g. 50k draws on the CPU rasterizer:
+//
+//   NovaBench --cull=cpu --grid=37 --materials=2 --sort=off --record-threads=1,2,4,8,16 --device=llvmpipe
+//
+// (select lavapipe with VK_ICD_FILENAMES or --device when other drivers are installed)
+//
+// --resize-every=N alternates the window between full and 3/4 size every N
+// frames and recreates the swapchain, as interactive resizing does; frame_ms
+// max and hitches then show what a resize costs.
+// --frames-in-flight and --present trade latency against throughput; an
+// unsupported present mode falls back to fifo and the report says which was used.
+// --headless renders offscreen without a window or swapchain (nothing is
+// presented, so --present does not apply), e.g. on lavapipe in CI.
+// --readback-every=N copies every Nth frame back to the CPU as it would for
+// golden images, without stalling; --screenshot writes the last frame as a
+// binary PPM. Both need --headless.
+// --backend=null runs the same scene and camera path through NullRenderer:
+// no GPU or Vulkan driver, so frame times are simulation, CPU culling, draw
+// sorting and extraction only (--cull=off or cpu).
+// --depth-prepass=on lays depth down before the main pass, which then shades
+// each opaque pixel once; compare gpu_ms Main (plus DepthPrepass) of an on
+// and an off run, e.g. with a large --grid.
+// --lights=N adds N point lights of limited range, scattered through the grid
+// (the same ones every run), to the three-point lighting. With clustered
+// shading gpu_ms Main plus LightCull should stay roughly flat from 0 to 4093.
+// --occlusion=on adds Hi-Z occlusion culling to --cull=gpu or validate: the
+// lattice's inner objects hide behind its outer ones, so compare gpu_ms Main
+// plus MainLate, HiZ and OcclusionCull with an off run at a large --grid.
+// Validation then only checks that nothing outside the frustum is drawn.
+// --lods=N simplifies the bench mesh into up to N coarser levels of detail
+// for scene objects; distant ones then draw fewer triangles (counters
+// triangles, culling lod_drawn). --lod-bias=F allows 2^F times the default
+// one pixel of error; negative values keep more detail.
+// --vertex-format=compact stores meshes quantized, 16 bytes per vertex instead
+// of 44; compare gpu_ms DepthPrepass and Main with a standard run at a large
+// --grid.
+
+namespace {
+
+struct BenchOptions {
+    int warmupFrames = 120;
+    int measuredFrames = 600;
+    int grid = 10;                 // grid^3 instances
+    int width = 1280;
+    int height = 720;
+    std::string meshPath = "Assets/Meshes/sphere.gltf";
+    std::string outPath;           // Empty = stdout
+    std::string tracePath;
+    bool verbose = false;
+    std::string cull = "off";      // off = animated instancing, else static scene objects
+    std::string pipelineCache = "warm";
+    std::vector<int> recordThreads;  // Empty = renderer default; several = one measured run each
+    int materials = 1;
+    std::string device;
+    std::string sort = "on";
+    int resizeEvery = 0;           // 0 = never
+    int framesInFlight = 2;
+    std::string present = "fifo";
+    bool headless = false;
+    int readbackEvery = 0;         // 0 = never
+    std::string screenshotPath;
+    std::string backend = "vulkan";
+    std::string depthPrepass = "off";
+    int lights = 0;                // Extra bounded point lights
+    std::string occlusion = "off";
+    int lods = 0;                  // Coarser levels generated for the bench mesh
+    float lodBias = 0.0f;
+    std::string vertexFormat = "standard";
+};
+
+bool ParseArg(const std::string& arg, const char* name, std::string& value) {
+    std::string prefix = std::string("--") + name + "=";
+    if (arg.rfind(prefix, 0) != 0) return false;
+    value = arg.substr(prefix.size());
+    return true;
+}
+
+BenchOptions ParseOptions(int argc, char** argv) {
+    BenchOptions opt;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i], v;
+        if (ParseArg(arg, "warmup", v)) opt.warmupFrames = std::stoi(v);
+        else if (ParseArg(arg, "frames", v)) opt.measuredFrames = std::stoi(v);
+        else if (ParseArg(arg, "grid", v)) opt.grid = std::stoi(v);
+        else if (ParseArg(arg, "width", v)) opt.width = std::stoi(v);
+        else if (ParseArg(arg, "height", v)) opt.height = std::stoi(v);
+        else if (ParseArg(arg, "mesh", v)) opt.meshPath = v;
+        else if (ParseArg(arg, "out", v)) opt.outPath = v;
+        else if (ParseArg(arg, "trace", v)) opt.tracePath = v;
+        else if (ParseArg(arg, "cull", v)) opt.cull = v;
+        else if (ParseArg(arg, "pipeline-cache", v)) opt.pipelineCache = v;
+        else if (ParseArg(arg, "record-threads", v)) {
+            std::stringstream list(v);
+            for (std::string item; std::getline(list, item, ',');) opt.recordThreads.push_back(std::stoi(item));
+        }
+        else if (ParseArg(arg, "materials", v)) opt.materials = std::stoi(v);
+        else if (ParseArg(arg, "device", v)) opt.device = v;
+        else if (ParseArg(arg, "sort", v)) opt.sort = v;
+        else if (ParseArg(arg, "resize-every", v)) opt.resizeEvery = std::stoi(v);
+        else if (ParseArg(arg, "frames-in-flight", v)) opt.framesInFlight = std::stoi(v);
+        else if (ParseArg(arg, "present", v)) opt.present = v;
+        else if (ParseArg(arg, "readback-every", v)) opt.readbackEvery = std::stoi(v);
+        else if (ParseArg(arg, "screenshot", v)) opt.screenshotPath = v;
+        else if (ParseArg(arg, "backend", v)) opt.backend = v;
+        else if (ParseArg(arg, "depth-prepass", v)) opt.depthPrepass = v;
+        else if (ParseArg(arg, "lights", v)) opt.lights = std::stoi(v);
+        else if (ParseArg(arg, "occlusion", v)) opt.occlusion = v;
+        else if (ParseArg(arg, "lods", v)) opt.lods = std::stoi(v);
+        else if (ParseArg(arg, "lod-bias", v)) opt.lodBias = std::stof(v);
+        else if (ParseArg(arg, "vertex-format", v)) opt.vertexFormat = v;
+        else if (arg == "--headless") opt.headless = true;
+        else if (arg == "--verbose") opt.verbose = true;
+        else throw std::runtime_error("Unknown argument: " + arg);
+    }
+    if (opt.measuredFrames <= 0) throw std::runtime_error("--frames must be positive");
+    if (opt.cull != "off" && opt.cull != "cpu" && opt.cull != "gpu" && opt.cull != "validate")
+        throw std::runtime_error("--cull must be off, cpu, gpu or validate");
+    if (opt.pipelineCache != "warm" && opt.pipelineCache != "cold" && opt.pipelineCache != "off")
+        throw std::runtime_error("--pipeline-cache must be warm, cold or off");
+    for (int threads : opt.recordThreads)
+        if (threads <= 0) throw std::runtime_error("--record-threads must be positive");
+    if (opt.materials <= 0) throw std::runtime_error("--materials must be positive");
+    if (opt.sort != "on" && opt.sort != "off") throw std::runtime_error("--sort must be on or off");
+    if (opt.resizeEvery < 0) throw std::runtime_error("--resize-every must not be negative");
+    if (opt.framesInFlight < 1 || opt.framesInFlight > 4) throw std::runtime_error("--frames-in-flight must be 1 to 4");
+    if (opt.present != "fifo" && opt.present != "mailbox" && opt.present != "immediate")
+        throw std::runtime_error("--present must be fifo, mailbox or immediate");
+    if (opt.readbackEvery < 0) throw std::runtime_error("--readback-every must not be negative");
+    if (opt.headless && opt.resizeEvery > 0) throw std::runtime_error("--resize-every needs a window");
+    if (!opt.headless && (opt.readbackEvery > 0 || !opt.screenshotPath.empty()))
+        throw std::runtime_error("--readback-every and --screenshot need --headless");
+    if (opt.backend != "vulkan" && opt.backend != "null") throw std::runtime_error("--backend must be vulkan or null");
+    if (opt.backend == "null" && opt.cull != "off" && opt.cull != "cpu")
+        throw std::runtime_error("--backend=null supports --cull=off or cpu");
+    if (opt.depthPrepass != "on" && opt.depthPrepass != "off") throw std::runtime_error("--depth-prepass must be on or off");
+    if (opt.lights < 0) throw std::runtime_error("--lights must not be negative");
+    if (opt.occlusion != "on" && opt.occlusion != "off") throw std::runtime_error("--occlusion must be on or off");
+    if (opt.occlusion == "on" && (opt.backend != "vulkan" || (opt.cull != "gpu" && opt.cull != "validate")))
+        throw std::runtime_error("--occlusion=on needs --backend=vulkan and --cull=gpu or validate");
+    if (opt.lods < 0 || opt.lods >= static_cast<int>(nova::MAX_MESH_LODS))
+        throw std::runtime_error("--lods must be 0 to " + std::to_string(nova::MAX_MESH_LODS - 1));
+    if (opt.lods > 0 && opt.cull == "off") throw std::runtime_error("--lods needs --cull other than off");
+    if (opt.vertexFormat != "standard" && opt.vertexFormat != "compact")
+        throw std::runtime_error("--vertex-format must be standard or compact");
+    if (opt.vertexFormat == "compact" && opt.backend != "vulkan")
+        throw std::runtime_error("--vertex-format=compact needs --backend=vulkan");
+    return opt;
+}
+
+// Fallback geometry when the mesh file is unavailable: UV sphere in the
+// renderer's interleaved layout (pos3, normal3, uv2)
+void BuildUVSphere(std::vector<float>& vertices, std::vector<uint32_t>& indices, int rings = 32, int segments = 64) {
+    const float pi = 3.14159265358979f;
+    for (int r = 0; r <= rings; ++r) {
+        float v = float(r) / rings;
+        float phi = v * pi;
+        for (int s = 0; s <= segments; ++s) {
+            float u = float(s) / segments;
+            float theta = u * 2.0f * pi;
+            glm::vec3 n(std::sin(phi) * std::cos(theta), std::cos(phi), std::sin(phi) * std::sin(theta));
+            vertices.insert(vertices.end(), { n.x, n.y, n.z, n.x, n.y, n.z, u, v });
+        }
+    }
+    for (int r = 0; r < rings; ++r) {
+        for (int s = 0; s < segments; ++s) {
+            uint32_t a = r * (segments + 1) + s;
+            uint32_t b = a + segments + 1;
+            indices.insert(indices.end(), { a, b, a + 1, a + 1, b, b + 1 });
+        }
+    }
+}
+
+void LoadBenchMesh(const std::string& path, std::vector<float>& vertexData, std::vector<uint32_t>& indexData) {
+    NOVA_MEM_TAG(Assets);
+    auto assetManager = std::make_shared<nova::AssetManager>();
+    nova::GLTFImporter importer(assetManager);
+    nova::GLTFImportResult result = importer.importFromFile(path);
+    if (result.success && !result.meshes.empty()) {
+        vertexData = result.meshes[0]->getVertexDataForRenderer();
+        indexData = result.meshes[0]->getIndexDataForRenderer();
+    } else {
+        NOVA_WARN("NovaBench: could not load " + path + ", using procedural sphere");
+        BuildUVSphere(vertexData, indexData);
+    }
+}
+
+// One mesh on a grid^3 lattice centred on the origin
+std::vector<glm::mat4> BuildGrid(int grid, float spacing) {
+    std::vector<glm::mat4> instances;
+    const float half = (grid - 1) * 0.5f;
+    for (int x = 0; x < grid; ++x)
+        for (int y = 0; y < grid; ++y)
+            for (int z = 0; z < grid; ++z)
+                instances.push_back(glm::translate(glm::mat4(1.0f),
+                    glm::vec3((x - half) * spacing, (y - half) * spacing, (z - half) * spacing)));
+    return instances;
+}
+
+// --lights: point lights spread through the grid's volume by a fixed LCG, so
+// every run and backend gets the same ones
+void AddBenchLights(nova::LightingManager& lighting, int count, int grid, float spacing) {
+    uint32_t state = 12345u;
+    auto next = [&state]() {
+        state = state * 1664525u + 1013904223u;
+        return float(state >> 8) / float(1u << 24);
+    };
+    const float half = std::max(grid - 1, 1) * spacing * 0.5f;
+    for (int i = 0; i < count; ++i) {
+        glm::vec3 position(next(), next(), next());
+        glm::vec3 color(0.3f + 0.7f * next(), 0.3f + 0.7f * next(), 0.3f + 0.7f * next());
+        lighting.AddLight(nova::Light::CreatePoint((position * 2.0f - 1.0f) * half, color, 1.0f, spacing * 1.5f));
+    }
+}
+
+// Scripted camera: orbit with a slow vertical bob, driven by the fixed timestep
+glm::vec3 OrbitEye(float t, float orbitRadius) {
+    return glm::vec3(std::cos(t * 0.5f) * orbitRadius, std::sin(t * 0.3f) * orbitRadius * 0.4f,
+                     std::sin(t * 0.5f) * orbitRadius);
+}
+
+// Same per-instance animation as the editor, in fixed time
+void AnimateInstances(const std::vector<glm::mat4>& baseInstances, float t, std::vector<glm::mat4>& instances) {
+    float angle = std::fmod(60.0f * t, 360.0f);
+    for (size_t i = 0; i < baseInstances.size(); ++i) {
+        glm::vec3 pos = glm::vec3(baseInstances[i][3]);
+        float bob = std::sin(glm::radians(angle * 2.0f + i * 45.0f)) * 0.5f;
+        instances[i] = glm::translate(glm::mat4(1.0f), pos + glm::vec3(0.0f, bob, 0.0f)) *
+                       glm::rotate(glm::mat4(1.0f), glm::radians(angle + i * 30.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    }
+}
+
+void WriteReport(const std::string& outPath, const std::string& json) {
+    if (outPath.empty()) {
+        std::cout << json;
+        return;
+    }
+    std::ofstream out(outPath, std::ios::out | std::ios::trunc);
+    if (!out.is_open()) throw std::runtime_error("Cannot write " + outPath);
+    out << json;
+}
+
+size_t PeakResidentBytes() {
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS pmc{};
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &pmc, sizeof(pmc))) return pmc.PeakWorkingSetSize;
+    return 0;
+#else
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+#if defined(__APPLE__)
+    return static_cast<size_t>(usage.ru_maxrss);
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+}
+
+struct PassAccum { double totalMs = 0.0; uint32_t samples = 0; };
+
+// "frame_ms" over every measured frame. FrameStats percentiles only cover its
+// rolling window, so runs longer than HISTORY_SIZE keep their own samples.
+void WriteFrameMs(std::ostringstream& json, std::vector<float> frameMs, uint64_t hitches) {
+    double sumMs = 0.0;
+    for (float ms : frameMs) sumMs += ms;
+    std::sort(frameMs.begin(), frameMs.end());
+    auto pick = [&](float p) {
+        if (frameMs.empty()) return 0.0f;
+        size_t k = std::min(frameMs.size() - 1, static_cast<size_t>(p * (frameMs.size() - 1) + 0.5f));
+        return frameMs[k];
+    };
+    json << "  \"frame_ms\": {\"mean\": " << (frameMs.empty() ? 0.0 : sumMs / frameMs.size())
+         << ", \"p50\": " << pick(0.50f) << ", \"p95\": " << pick(0.95f) << ", \"p99\": " << pick(0.99f)
+         << ", \"max\": " << (frameMs.empty() ? 0.0f : frameMs.back()) << ", \"hitches\": " << hitches << "},\n";
+}
+
+// --backend=null: the Vulkan run's scene, camera and animation through
+// NullRenderer. Scene objects are culled on the CPU against their bounding
+// spheres and submitted one by one, as a game front end would.
+int RunNullBackend(const BenchOptions& opt) {
+    using namespace nova;
+    NullRenderer renderer;
+    renderer.InitHeadless(static_cast<uint32_t>(opt.width), static_cast<uint32_t>(opt.height));
+    renderer.SetDrawSorting(opt.sort == "on");
+    const float spacing = 4.0f;
+    LightingManager lighting;
+    lighting.SetupThreePointLighting();
+    AddBenchLights(lighting, opt.lights, opt.grid, spacing);
+    const auto& lights = lighting.GetLights();
+    std::vector<glm::vec4> lightPositions, lightColors;
+    for (size_t i = 0; i < lights.size(); ++i) {
+        lightPositions.push_back(glm::vec4(lights[i].position, 1.0f));
+        lightColors.push_back(glm::vec4(lights[i].color * lights[i].intensity, 1.0f));
+    }
+    renderer.SetLights(lightPositions, lightColors);
+
+    std::vector<float> vertexData;
+    std::vector<uint32_t> indexData;
+    LoadBenchMesh(opt.meshPath, vertexData, indexData);
+    // Stored but drawn at full detail; only the upload and memory cost shows
+    MeshHandle mesh = renderer.RegisterMesh(vertexData, indexData,
+                                            GenerateMeshLods(vertexData, indexData, static_cast<uint32_t>(opt.lods)));
+    float meshRadius = 0.0f;
+    for (size_t i = 0; i + 2 < vertexData.size(); i += 8) {
+        meshRadius = std::max(meshRadius, glm::length(glm::vec3(vertexData[i], vertexData[i + 1], vertexData[i + 2])));
+    }
+    std::vector<uint32_t> materials = {0};
+    for (int i = 1; i < opt.materials; ++i) {
+        MaterialParams params;
+        params.baseColor = glm::vec4(0.2f + 0.6f * float(i) / opt.materials, 0.5f, 0.8f, 1.0f);
+        materials.push_back(renderer.CreateMaterial(params, MaterialShadingModel::PBR));
+    }
+
+    const bool sceneObjects = opt.cull != "off";
+    std::vector<glm::mat4> baseInstances = BuildGrid(opt.grid, spacing);
+    std::vector<glm::mat4> instances(baseInstances.size());
+    Camera camera;
+    camera.SetAspectRatio(float(opt.width) / float(opt.height));
+    camera.SetFarPlane(std::max(100.0f, opt.grid * spacing * 4.0f));
+    const float orbitRadius = opt.grid * spacing * 0.9f + 6.0f;
+
+    FrameStats stats;
+    std::vector<float> frameMsAll;
+    frameMsAll.reserve(opt.measuredFrames);
+    FramePhaseTimes phaseTotals;
+    RenderCounters lastCounters;
+    uint32_t visibleObjects = 0;
+    const double fixedDt = 1.0 / 60.0;
+    const int totalFrames = opt.warmupFrames + opt.measuredFrames;
+    for (int frame = 0; frame < totalFrames; ++frame) {
+        Profiler::BeginFrame();
+        double frameStartMs = Profiler::NowMs();
+        float t = static_cast<float>(frame * fixedDt);
+        camera.SetPosition(OrbitEye(t, orbitRadius));
+        camera.SetTarget(glm::vec3(0.0f));
+        glm::mat4 viewProjection = camera.GetViewProjectionMatrix();
+
+        renderer.BeginFrame(viewProjection);
+        if (sceneObjects) {
+            Frustum frustum = Frustum::FromMatrix(viewProjection);
+            visibleObjects = 0;
+            for (size_t i = 0; i < baseInstances.size(); ++i) {
+                if (!frustum.IntersectsSphere(glm::vec3(baseInstances[i][3]), meshRadius)) continue;
+                renderer.Submit(mesh, materials[i % materials.size()], baseInstances[i]);
+                visibleObjects++;
+            }
+        } else {
+            AnimateInstances(baseInstances, t, instances);
+            renderer.DrawMesh(mesh, instances, 0);
+        }
+        double simMs = Profiler::NowMs() - frameStartMs;
+        renderer.EndFrame();
+        double frameMs = Profiler::NowMs() - frameStartMs;
+        Profiler::EndFrame();
+
+        if (frame < opt.warmupFrames) continue;
+        RenderStats rs = renderer.Stats();
+        FrameSample sample;
+        sample.frameIndex = static_cast<uint64_t>(frame - opt.warmupFrames);
+        sample.frameMs = static_cast<float>(frameMs);
+        sample.phases.cpuSimMs = static_cast<float>(simMs);
+        sample.phases.cpuRecordMs = static_cast<float>(frameMs - simMs);
+        stats.AddFrame(sample);
+        frameMsAll.push_back(sample.frameMs);
+        phaseTotals.cpuSimMs += sample.phases.cpuSimMs;
+        phaseTotals.cpuRecordMs += sample.phases.cpuRecordMs;
+        lastCounters = rs.counters;
+    }
+    if (!opt.tracePath.empty()) Profiler::WriteTrace(opt.tracePath);
+
+    const double n = static_cast<double>(opt.measuredFrames);
+    const NullRendererStats& nullStats = renderer.GetNullStats();
+    std::ostringstream json;
+    json << "{\n";
+    json << "  \"config\": {\"warmup\": " << opt.warmupFrames << ", \"frames\": " << opt.measuredFrames
+         << ", \"instances\": " << baseInstances.size() << ", \"width\": " << opt.width
+         << ", \"height\": " << opt.height << ", \"backend\": \"null\", \"cull\": \"" << opt.cull
+         << "\", \"materials\": " << opt.materials << ", \"sort\": \"" << opt.sort
+         << "\", \"lights\": " << lighting.GetLightCount() << ", \"lods\": " << opt.lods << "},\n";
+    WriteFrameMs(json, frameMsAll, stats.HitchCount());
+    json << "  \"cpu_ms\": {\"sim\": " << phaseTotals.cpuSimMs / n << ", \"record\": " << phaseTotals.cpuRecordMs / n << "},\n";
+    json << "  \"counters\": {\"draw_calls\": " << lastCounters.drawCalls << ", \"instances\": " << lastCounters.instances
+         << ", \"triangles\": " << lastCounters.triangles << ", \"pipeline_binds\": " << lastCounters.pipelineBinds
+         << ", \"upload_bytes\": " << lastCounters.bufferBytesUploaded
+         << ", \"sorted_draws\": " << lastCounters.sortedDraws
+         << ", \"state_changes_unsorted\": " << lastCounters.stateChangesUnsorted
+         << ", \"state_changes_sorted\": " << lastCounters.stateChangesSorted
+         << ", \"scene_objects\": " << (sceneObjects ? baseInstances.size() : 0) << ", \"visible_objects\": " << visibleObjects << "},\n";
+    json << "  \"null_renderer\": {\"validation_errors\": " << nullStats.validationErrors
+         << ", \"live_meshes\": " << nullStats.liveMeshes << ", \"vertex_bytes\": " << nullStats.vertexBytes
+         << ", \"index_bytes\": " << nullStats.indexBytes << "},\n";
+    json << "  \"memory\": {\"peak_rss_bytes\": " << PeakResidentBytes() << "}\n";
+    json << "}\n";
+    WriteReport(opt.outPath, json.str());
+    return nullStats.validationErrors > 0 ? 4 : 0;
+}
+
+void WritePPM(const std::string& path, const nova::FrameReadback& frame) {
+    std::ofstream out(path, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out.is_open()) throw std::runtime_error("Cannot write " + path);
+    out << "P6\n" << frame.width << " " << frame.height << "\n255\n";
+    for (size_t i = 0; i + 3 < frame.pixels.size(); i += 4) {
+        out.write(reinterpret_cast<const char*>(&frame.pixels[i]), 3);
+    }
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    using namespace nova;
+    Log::Init();
+    try {
+        BenchOptions opt = ParseOptions(argc, argv);
+        Log::SetVerbose(opt.verbose);
+        if (opt.backend == "null") return RunNullBackend(opt);
+
+        // Windowed runs need a surface; keep the window hidden
+        GLFWwindow* window = nullptr;
+        if (!opt.headless) {
+            if (!glfwInit()) throw std::runtime_error("glfwInit failed");
+            glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
+            glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+            glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+            window = glfwCreateWindow(opt.width, opt.height, "NovaBench", nullptr, nullptr);
+            if (!window) throw std::runtime_error("glfwCreateWindow failed");
+        }
+
+        const char* pipelineCachePath = "pipeline_cache.bin";
+        if (opt.pipelineCache == "cold") std::remove(pipelineCachePath);
+        VulkanRenderer renderer;
+        renderer.SetPipelineCachePath(opt.pipelineCache == "off" ? "" : pipelineCachePath);
+        renderer.SetPreferredDevice(opt.device);
+        renderer.SetVertexLayout(opt.vertexFormat == "compact" ? VertexLayout::Compact : VertexLayout::Standard);
+        renderer.SetFramesInFlight(static_cast<uint32_t>(opt.framesInFlight));
+        renderer.SetPresentMode(opt.present == "mailbox"     ? VK_PRESENT_MODE_MAILBOX_KHR
+                                : opt.present == "immediate" ? VK_PRESENT_MODE_IMMEDIATE_KHR
+                                                             : VK_PRESENT_MODE_FIFO_KHR);
+        if (!opt.recordThreads.empty()) {
+            // Sizes the worker pool for the largest count in the sweep
+            renderer.SetRecordThreads(static_cast<uint32_t>(*std::max_element(opt.recordThreads.begin(), opt.recordThreads.end())));
+        }
+        if (opt.headless) {
+            if (!renderer.InitHeadless(static_cast<uint32_t>(opt.width), static_cast<uint32_t>(opt.height)))
+                throw std::runtime_error("Headless renderer initialization failed");
+        } else {
+            renderer.Init(window);
+        }
+        renderer.SetDrawSorting(opt.sort == "on");
+        renderer.SetDepthPrepass(opt.depthPrepass == "on");
+
+        // Scene: one mesh instanced on a grid^3 lattice
+        const float spacing = 4.0f;
+        LightingManager lighting;
+        lighting.SetupThreePointLighting();
+        AddBenchLights(lighting, opt.lights, opt.grid, spacing);
+        renderer.SetLightsFromManager(&lighting);
+
+        std::vector<float> vertexData;
+        std::vector<uint32_t> indexData;
+        LoadBenchMesh(opt.meshPath, vertexData, indexData);
+        const bool sceneObjects = opt.cull != "off";
+        if (sceneObjects) {
+            renderer.SetCullMode(opt.cull == "cpu" ? VulkanRenderer::CullMode::Cpu : VulkanRenderer::CullMode::Gpu);
+            renderer.SetCullValidation(opt.cull == "validate");
+            renderer.SetOcclusionCulling(opt.occlusion == "on");
+            GpuScene::LodSettings lodSettings;
+            lodSettings.bias = opt.lodBias;
+            renderer.SetLodSettings(lodSettings);
+        } else {
+            renderer.SetAssetData(vertexData, indexData);
+        }
+
+        std::vector<glm::mat4> baseInstances = BuildGrid(opt.grid, spacing);
+        std::vector<glm::mat4> instances(baseInstances.size());
+        if (sceneObjects) {
+            std::vector<MeshLod> lods = GenerateMeshLods(vertexData, indexData, static_cast<uint32_t>(opt.lods));
+            if (static_cast<int>(lods.size()) < opt.lods) {
+                std::cerr << "Bench mesh simplified to " << lods.size() << " of " << opt.lods << " LODs\n";
+            }
+            MeshHandle mesh = renderer.RegisterMesh(vertexData, indexData, lods);
+            std::vector<uint32_t> materials = {0};
+            for (int i = 1; i < opt.materials; ++i) {
+                MaterialParams params;
+                params.baseColor = glm::vec4(0.2f + 0.6f * float(i) / opt.materials, 0.5f, 0.8f, 1.0f);
+                materials.push_back(renderer.CreateMaterial(params, MaterialShadingModel::PBR));
+            }
+            for (size_t i = 0; i < baseInstances.size(); ++i) {
+                renderer.AddSceneObject(mesh, baseInstances[i], materials[i % materials.size()]);
+            }
+        }
+
+        Camera camera;
+        camera.SetAspectRatio(float(opt.width) / float(opt.height));
+        camera.SetFarPlane(std::max(100.0f, opt.grid * spacing * 4.0f));
+        const float orbitRadius = opt.grid * spacing * 0.9f + 6.0f;
+
+        FrameStats stats;
+        std::vector<float> frameMsAll;
+        std::map<std::string, PassAccum> gpuPasses;
+        FramePhaseTimes phaseTotals;
+        int64_t peakTrackedBytes = 0;
+        RenderCounters lastCounters;
+        FrameReadback readback;
+
+        // One measured run per record-thread count; the first frame of each run
+        // still reports the previous count's recording time, so it is skipped
+        const std::vector<int> runs = opt.recordThreads.empty() ? std::vector<int>{0} : opt.recordThreads;
+        std::vector<PassAccum> recordPerRun(runs.size());
+        const int measuredTotal = opt.measuredFrames * static_cast<int>(runs.size());
+        frameMsAll.reserve(measuredTotal);
+
+        const double fixedDt = 1.0 / 60.0;
+        const int totalFrames = opt.warmupFrames + measuredTotal;
+        double lastFrameSeconds = fixedDt;
+        for (int frame = 0; frame < totalFrames; ++frame) {
+            if (window) glfwPollEvents();
+            const int run = frame < opt.warmupFrames ? 0 : (frame - opt.warmupFrames) / opt.measuredFrames;
+            if (runs[run] > 0) renderer.SetRecordThreads(static_cast<uint32_t>(runs[run]));
+            if (opt.resizeEvery > 0 && frame > 0 && frame % opt.resizeEvery == 0) {
+                bool shrink = (frame / opt.resizeEvery) % 2 == 1;
+                glfwSetWindowSize(window, shrink ? opt.width * 3 / 4 : opt.width, shrink ? opt.height * 3 / 4 : opt.height);
+                glfwPollEvents();
+                renderer.RecreateSwapchain();
+            }
+            Profiler::BeginFrame();
+            auto frameStart = std::chrono::steady_clock::now();
+            double frameStartMs = Profiler::NowMs();
+
+            float t = static_cast<float>(frame * fixedDt);
+            camera.SetPosition(OrbitEye(t, orbitRadius));
+            camera.SetTarget(glm::vec3(0.0f));
+
+            if (!sceneObjects) {
+                AnimateInstances(baseInstances, t, instances);
+                renderer.SetInstanceData(instances);
+            }
+            renderer.UpdateMVP(camera.GetViewProjectionMatrix());
+            renderer.UpdatePerformanceMetrics(lastFrameSeconds);
+            renderer.SetCpuSimTime(Profiler::NowMs() - frameStartMs);
+
+            bool lastFrame = frame + 1 == totalFrames;
+            if ((opt.readbackEvery > 0 && frame % opt.readbackEvery == 0) || (lastFrame && !opt.screenshotPath.empty())) {
+                renderer.RequestReadback();
+            }
+            renderer.RenderFrame(&camera, &lighting);
+            // Completed copies arrive frames later; draining them keeps slots free
+            while (renderer.PollReadback(readback)) {}
+
+            lastFrameSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - frameStart).count();
+            MemoryTracker::EndFrame();
+            Profiler::EndFrame();
+
+            if (frame < opt.warmupFrames) continue;
+
+            // RenderStats phases lag one frame (they are pushed by the next
+            // UpdatePerformanceMetrics); averages over the window are unaffected
+            RenderStats rs = renderer.Stats();
+            FrameSample sample;
+            sample.frameIndex = static_cast<uint64_t>(frame - opt.warmupFrames);
+            sample.frameMs = static_cast<float>(lastFrameSeconds * 1000.0);
+            sample.phases = rs.phases;
+            stats.AddFrame(sample);
+            frameMsAll.push_back(sample.frameMs);
+            phaseTotals.cpuSimMs += rs.phases.cpuSimMs;
+            phaseTotals.cpuRecordMs += rs.phases.cpuRecordMs;
+            phaseTotals.gpuMs += rs.phases.gpuMs;
+            phaseTotals.presentWaitMs += rs.phases.presentWaitMs;
+            if ((frame - opt.warmupFrames) % opt.measuredFrames != 0) {
+                recordPerRun[run].totalMs += rs.phases.cpuRecordMs;
+                recordPerRun[run].samples++;
+            }
+            for (const auto& pass : rs.gpuPasses) {
+                auto& acc = gpuPasses[pass.name];
+                acc.totalMs += pass.ms;
+                acc.samples++;
+            }
+            peakTrackedBytes = std::max(peakTrackedBytes, MemoryTracker::GetTotalLiveBytes());
+            lastCounters = rs.counters;
+        }
+
+        renderer.WaitForDeviceIdle();
+        if (!opt.tracePath.empty()) Profiler::WriteTrace(opt.tracePath);
+        if (opt.headless) {
+            while (renderer.PollReadback(readback)) {}
+            if (!opt.screenshotPath.empty()) {
+                if (readback.pixels.empty()) throw std::runtime_error("No frame was read back for --screenshot");
+                WritePPM(opt.screenshotPath, readback);
+            }
+        }
+
+        // ---- JSON report ----
+        const double n = static_cast<double>(measuredTotal);
+        std::ostringstream json;
+        json << "{\n";
+        json << "  \"config\": {\"warmup\": " << opt.warmupFrames << ", \"frames\": " << measuredTotal
+             << ", \"instances\": " << baseInstances.size() << ", \"width\": " << opt.width
+             << ", \"height\": " << opt.height << ", \"backend\": \"vulkan\", \"cull\": \"" << opt.cull
+             << "\", \"materials\": " << opt.materials << ", \"sort\": \"" << opt.sort << "\", \"resize_every\": " << opt.resizeEvery
+             << ", \"frames_in_flight\": " << renderer.GetFramesInFlight() << ", \"present\": \""
+             << (renderer.GetPresentMode() == VK_PRESENT_MODE_MAILBOX_KHR     ? "mailbox"
+                 : renderer.GetPresentMode() == VK_PRESENT_MODE_IMMEDIATE_KHR ? "immediate"
+                                                                              : "fifo")
+             << "\", \"record_threads\": " << renderer.GetRecordThreads()
+             << ", \"headless\": " << (renderer.IsHeadless() ? "true" : "false")
+             << ", \"depth_prepass\": \"" << (renderer.GetDepthPrepass() ? "on" : "off")
+             << "\", \"lights\": " << lighting.GetLightCount() << ", \"occlusion\": \"" << opt.occlusion
+             << "\", \"lods\": " << opt.lods << ", \"lod_bias\": " << opt.lodBias
+             << ", \"vertex_format\": \"" << opt.vertexFormat << "\"},\n";
+        WriteFrameMs(json, frameMsAll, stats.HitchCount());
+        json << "  \"cpu_ms\": {\"sim\": " << phaseTotals.cpuSimMs / n << ", \"record\": " << phaseTotals.cpuRecordMs / n
+             << ", \"present_wait\": " << phaseTotals.presentWaitMs / n << "},\n";
+        if (!opt.recordThreads.empty()) {
+            // Mean recording time per thread count
+            json << "  \"record_ms_by_threads\": {";
+            for (size_t i = 0; i < runs.size(); ++i) {
+                const PassAccum& acc = recordPerRun[i];
+                json << (i ? ", " : "") << "\"" << runs[i] << "\": " << (acc.samples ? acc.totalMs / acc.samples : 0.0);
+            }
+            json << "},\n";
+        }
+        json << "  \"gpu_ms\": {\"frame\": " << phaseTotals.gpuMs / n;
+        for (const auto& [name, acc] : gpuPasses) {
+            json << ", \"" << name << "\": " << (acc.samples ? acc.totalMs / acc.samples : 0.0);
+        }
+        json << "},\n";
+        json << "  \"counters\": {\"draw_calls\": " << lastCounters.drawCalls << ", \"instances\": " << lastCounters.instances
+             << ", \"triangles\": " << lastCounters.triangles << ", \"pipeline_binds\": " << lastCounters.pipelineBinds
+             << ", \"upload_bytes\": " << lastCounters.bufferBytesUploaded
+             << ", \"vk_allocations\": " << lastCounters.deviceAllocations
+             << ", \"pipeline_barriers\": " << lastCounters.pipelineBarriers
+             << ", \"secondary_command_buffers\": " << lastCounters.secondaryCommandBuffers
+             << ", \"prepass_draws\": " << lastCounters.prepassDraws
+             << ", \"sorted_draws\": " << lastCounters.sortedDraws
+             << ", \"state_changes_unsorted\": " << lastCounters.stateChangesUnsorted
+             << ", \"state_changes_sorted\": " << lastCounters.stateChangesSorted
+             << ", \"scene_objects\": " << lastCounters.sceneObjects << ", \"visible_objects\": " << lastCounters.visibleObjects
+             << ", \"occluded_objects\": " << lastCounters.occludedObjects << "},\n";
+        bool validationFailed = false;
+        if (opt.cull != "off") {
+            GpuSceneStats scene = renderer.GetSceneStats();
+            validationFailed = opt.cull == "validate" && scene.mismatchedFrames > 0;
+            json << "  \"culling\": {\"gpu_available\": " << (renderer.IsGpuCullingAvailable() ? "true" : "false")
+                 << ", \"validated_frames\": " << scene.validatedFrames
+                 << ", \"mismatched_frames\": " << scene.mismatchedFrames
+                 << ", \"occlusion_available\": " << (renderer.IsOcclusionCullingAvailable() ? "true" : "false")
+                 << ", \"late_drawn\": " << scene.lateDrawn << ", \"occluded\": " << scene.occluded << ", \"lod_drawn\": [";
+            for (uint32_t lod = 0; lod < MAX_MESH_LODS; ++lod) json << (lod ? ", " : "") << scene.lodDrawn[lod];
+            json << "]},\n";
+        }
+        LightClusterStats lightClusters = renderer.GetLightClusterStats();
+        json << "  \"light_clusters\": {\"lights\": " << lightClusters.lights << ", \"global_lights\": " << lightClusters.globalLights
+             << ", \"dropped_lights\": " << lightClusters.droppedLights
+             << ", \"max_cluster_lights\": " << lightClusters.maxClusterLights
+             << ", \"full_clusters\": " << lightClusters.fullClusters << "},\n";
+        if (opt.headless) {
+            ReadbackStats readbacks = renderer.GetReadbackStats();
+            json << "  \"readback\": {\"requested\": " << readbacks.requested << ", \"completed\": " << readbacks.completed
+                 << ", \"dropped\": " << readbacks.dropped << ", \"slots\": " << readbacks.slots << "},\n";
+        }
+        const PipelineCacheStats& pipelines = renderer.GetPipelineCacheStats();
+        const PipelineStateStats& pso = renderer.GetPipelineStateStats();
+        json << "  \"pipeline_cache\": {\"mode\": \"" << opt.pipelineCache << "\", \"warm\": " << (pipelines.warm ? "true" : "false")
+             << ", \"loaded_bytes\": " << pipelines.loadedBytes << ", \"pipelines\": " << pipelines.pipelinesCreated
+             << ", \"create_ms\": " << pipelines.pipelineCreateMs << ", \"shader_modules\": " << pipelines.shaderModules
+             << ", \"shader_load_ms\": " << pipelines.shaderLoadMs << ", \"pso_hits\": " << pso.hits
+             << ", \"pso_misses\": " << pso.misses << ", \"pso_fallbacks\": " << pso.fallbacks
+             << ", \"pso_compile_ms\": " << pso.compileMs << "},\n";
+        RenderGraphStats graph = renderer.GetRenderGraphStats();
+        json << "  \"render_graph\": {\"passes\": " << graph.passes << ", \"culled_passes\": " << graph.culledPasses
+             << ", \"barrier_batches\": " << graph.barrierBatches << ", \"barriers\": " << graph.barriers
+             << ", \"transient_bytes\": " << graph.transientBytes << ", \"unaliased_bytes\": " << graph.unaliasedBytes
+             << ", \"reused_blocks\": " << graph.reusedBlocks << "},\n";
+        GpuAllocatorStats gpuMem = renderer.GetAllocatorStats();
+        json << "  \"memory\": {\"peak_rss_bytes\": " << PeakResidentBytes()
+             << ", \"peak_tracked_bytes\": " << peakTrackedBytes
+             << ", \"tracking\": " << (MemoryTracker::Enabled() ? "true" : "false")
+             << ", \"gpu_reserved_bytes\": " << gpuMem.reservedBytes << ", \"gpu_used_bytes\": " << gpuMem.usedBytes
+             << ", \"gpu_blocks\": " << gpuMem.blockCount << ", \"gpu_dedicated\": " << gpuMem.dedicatedCount
+             << ", \"gpu_fragmentation\": " << gpuMem.fragmentation << "}\n";
+        json << "}\n";
+
+        WriteReport(opt.outPath, json.str());
+
+        renderer.Shutdown();
+        if (window) {
+            glfwDestroyWindow(window);
+            glfwTerminate();
+        }
+        if (validationFailed) {
+            std::cerr << "NovaBench: GPU culling disagreed with CPU culling" << std::endl;
+            return 3;
+        }
+        return 0;
+    } catch (const std::exception& e) {
+        NOVA_FATAL(std::string("NovaBench: ") + e.what());
+        return 2;
+    }
+}
@@ -105,6 +105,7 @@ std::shared_ptr<Asset> AssetManager::getAssetByPath(const std::string& path) {
 }
 
 bool AssetManager::loadAsset(const AssetGUID& guid) {
+    NOVA_MEM_TAG(Assets);
     NOVA_INFO("AssetManager::loadAsset called for GUID: " + guid);
     auto asset = getAsset(guid);
     if (!asset) {
@@ -1,4 +1,5 @@
 #include "Mesh.h"
+#include "MeshSimplify.h"
 #include "engine/core/Log.h"
 #include <algorithm>
 #include <limits>
@@ -90,6 +91,7 @@ void Mesh::unload() {
     vertices.clear();
     indices.clear();
     submeshes.clear();
+    lods.clear();
     loaded = false;
 }
 
@@ -108,6 +110,7 @@ bool Mesh::saveToFile(const std::string& path) {
 bool Mesh::createFromVertices(const std::vector<Vertex>& verts, const std::vector<uint32_t>& inds) {
     vertices = verts;
     indices = inds;
+    lods.clear();
     computeBoundingVolumes();
     return true;
 }
@@ -131,22 +134,39 @@ bool Mesh::createFromPositions(const std::vector<glm::vec3>& positions, const st
     }
     
     indices = inds;
+    lods.clear();
     computeBoundingVolumes();
     return true;
 }
 
-bool Mesh::createVulkanResources() {
-    // Basic implementation - would normally create Vulkan buffers
-    NOVA_INFO("Creating Vulkan resources for mesh");
+bool Mesh::createVulkanResources(IGeometryRegistry& registry) {
+    destroyVulkanResources();
+    if (vertices.empty() || indices.empty()) {
+        NOVA_ERROR("Cannot create GPU resources for empty mesh: " + path);
+        return false;
+    }
+    
+    gpuMesh = registry.RegisterMesh(getVertexDataForRenderer(), getIndexDataForRenderer(), lods);
+    if (!gpuMesh.IsValid()) {
+        NOVA_ERROR("Failed to register mesh in geometry pool: " + path);
+        return false;
+    }
+    geometryRegistry = &registry;
+    NOVA_INFO("Registered mesh in geometry pool: " + path + " (" + std::to_string(vertices.size()) + " vertices, " +
+              std::to_string(lods.size() + 1) + " LODs)");
     return true;
 }
 
+void Mesh::generateLods(uint32_t maxLevels) {
+    lods = GenerateMeshLods(getVertexDataForRenderer(), getIndexDataForRenderer(), maxLevels);
+}
+
 void Mesh::destroyVulkanResources() {
-    // Basic implementation - would normally destroy Vulkan buffers
-    vertexBuffer = 0;
-    indexBuffer = 0;
-    vertexBufferMemory = 0;
-    indexBufferMemory = 0;
+    if (geometryRegistry && gpuMesh.IsValid()) {
+        geometryRegistry->ReleaseMesh(gpuMesh);
+    }
+    geometryRegistry = nullptr;
+    gpuMesh = MeshHandle{};
     instanceBuffer = 0;
     instanceBufferMemory = 0;
 }
@@ -1,5 +1,6 @@
 #pragma once
 #include "AssetManager.h"
+#include "engine/renderer/IRenderer.h"
 #include <glm/glm.hpp>
 #include <vector>
 #include <memory>
@@ -65,15 +66,14 @@ private:
     std::vector<Vertex> vertices;
     std::vector<uint32_t> indices;
     std::vector<Submesh> submeshes;
+    std::vector<MeshLod> lods;          // Coarser index lists over `vertices`, registered with the mesh
     
     BoundingBox boundingBox;
     BoundingSphere boundingSphere;
     
-    // Vulkan resources
-    uint32_t vertexBuffer = 0; // VkBuffer handle
-    uint32_t indexBuffer = 0;  // VkBuffer handle
-    uint32_t vertexBufferMemory = 0;
-    uint32_t indexBufferMemory = 0;
+    // GPU geometry lives in the renderer's shared pool
+    IGeometryRegistry* geometryRegistry = nullptr;
+    MeshHandle gpuMesh;
     
     // GPU instancing support
     uint32_t instanceBuffer = 0;
@@ -97,7 +97,7 @@ public:
     bool createFromPositions(const std::vector<glm::vec3>& positions, const std::vector<uint32_t>& indices);
     
     // Vulkan resource management
-    bool createVulkanResources();
+    bool createVulkanResources(IGeometryRegistry& registry);
     void destroyVulkanResources();
     bool updateInstanceBuffer(const std::vector<glm::mat4>& transforms);
     
@@ -110,6 +110,11 @@ public:
     const std::vector<uint32_t>& getIndices() const { return indices; }
     const std::vector<Submesh>& getSubmeshes() const { return submeshes; }
     
+    // Levels of detail; take effect at the next createVulkanResources
+    void generateLods(uint32_t maxLevels);
+    void setLods(const std::vector<MeshLod>& levels) { lods = levels; }
+    const std::vector<MeshLod>& getLods() const { return lods; }
+    
     // Submesh management
     void addSubmesh(const Submesh& submesh);
     Submesh& getSubmesh(uint32_t index);
@@ -121,15 +126,14 @@ public:
     const BoundingSphere& getBoundingSphere() const { return boundingSphere; }
     
     // Vulkan resource access
-    uint32_t getVertexBuffer() const { return vertexBuffer; }
-    uint32_t getIndexBuffer() const { return indexBuffer; }
+    MeshHandle getGpuMesh() const { return gpuMesh; }
     uint32_t getInstanceBuffer() const { return instanceBuffer; }
     
     // Utility
     uint32_t getVertexCount() const { return vertices.size(); }
     uint32_t getIndexCount() const { return indices.size(); }
     bool hasIndices() const { return !indices.empty(); }
-    bool isLoaded() const { return loaded && vertexBuffer != 0; }
+    bool isLoaded() const { return loaded && gpuMesh.IsValid(); }
     
     // Bounding volume computation
     void computeBoundingVolumes();
@@ -0,0 +1,105 @@
+#include "MeshSimplify.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <unordered_map>
+
+namespace nova {
+
+namespace {
+constexpr size_t FLOATS_PER_VERTEX = 8;
+constexpr uint32_t FINEST_GRID = 64;        // Cells along the longest axis for the first level tried
+constexpr float MIN_REDUCTION = 0.8f;       // A level keeps at most this fraction of the previous one's triangles
+} // namespace
+
+std::vector<MeshLod> GenerateMeshLods(const std::vector<float>& vertexData, const std::vector<uint32_t>& indices,
+                                      uint32_t maxLevels) {
+    std::vector<MeshLod> lods;
+    const size_t vertexCount = vertexData.size() / FLOATS_PER_VERTEX;
+    maxLevels = std::min(maxLevels, MAX_MESH_LODS - 1);
+    if (vertexCount == 0 || indices.size() < 3 || maxLevels == 0) return lods;
+
+    std::vector<glm::vec3> positions(vertexCount);
+    glm::vec3 lo(vertexData[0], vertexData[1], vertexData[2]);
+    glm::vec3 hi = lo;
+    for (size_t v = 0; v < vertexCount; ++v) {
+        const float* p = vertexData.data() + v * FLOATS_PER_VERTEX;
+        positions[v] = glm::vec3(p[0], p[1], p[2]);
+        lo = glm::min(lo, positions[v]);
+        hi = glm::max(hi, positions[v]);
+    }
+    glm::vec3 extent = hi - lo;
+    float longest = std::max(extent.x, std::max(extent.y, extent.z));
+    if (longest <= 0.0f) return lods;
+
+    std::unordered_map<uint64_t, uint32_t> cellClusters;
+    std::vector<uint32_t> clusterOf(vertexCount);
+    std::vector<glm::vec3> centroids;
+    std::vector<uint32_t> counts;
+    std::vector<uint32_t> representatives;
+    std::vector<float> nearest;
+    size_t previousTriangles = indices.size() / 3;
+    float previousError = 0.0f;
+    for (uint32_t cells = FINEST_GRID; cells >= 2 && lods.size() < maxLevels; cells /= 2) {
+        float cellSize = longest / static_cast<float>(cells);
+        auto cellCoord = [&](float p, float origin) {
+            return static_cast<uint64_t>(std::min(static_cast<float>(cells - 1), std::floor((p - origin) / cellSize)));
+        };
+
+        cellClusters.clear();
+        centroids.clear();
+        counts.clear();
+        for (size_t v = 0; v < vertexCount; ++v) {
+            const glm::vec3& p = positions[v];
+            uint64_t key = cellCoord(p.x, lo.x) | (cellCoord(p.y, lo.y) << 21) | (cellCoord(p.z, lo.z) << 42);
+            auto [it, inserted] = cellClusters.try_emplace(key, static_cast<uint32_t>(centroids.size()));
+            if (inserted) {
+                centroids.push_back(glm::vec3(0.0f));
+                counts.push_back(0);
+            }
+            centroids[it->second] += p;
+            counts[it->second]++;
+            clusterOf[v] = it->second;
+        }
+        for (size_t c = 0; c < centroids.size(); ++c) centroids[c] /= static_cast<float>(counts[c]);
+
+        representatives.assign(centroids.size(), 0);
+        nearest.assign(centroids.size(), std::numeric_limits<float>::max());
+        for (size_t v = 0; v < vertexCount; ++v) {
+            uint32_t c = clusterOf[v];
+            glm::vec3 d = positions[v] - centroids[c];
+            float distance = glm::dot(d, d);
+            if (distance < nearest[c]) {
+                nearest[c] = distance;
+                representatives[c] = static_cast<uint32_t>(v);
+            }
+        }
+
+        MeshLod lod;
+        for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+            uint32_t a = representatives[clusterOf[indices[i]]];
+            uint32_t b = representatives[clusterOf[indices[i + 1]]];
+            uint32_t c = representatives[clusterOf[indices[i + 2]]];
+            if (a == b || b == c || a == c) continue;
+            lod.indices.insert(lod.indices.end(), { a, b, c });
+        }
+        size_t triangles = lod.indices.size() / 3;
+        if (triangles == 0) break;
+        if (static_cast<float>(triangles) > static_cast<float>(previousTriangles) * MIN_REDUCTION) continue;
+
+        float errorSq = 0.0f;
+        for (uint32_t index : indices) {
+            glm::vec3 d = positions[index] - positions[representatives[clusterOf[index]]];
+            errorSq = std::max(errorSq, glm::dot(d, d));
+        }
+        // Selection assumes the error grows with the level
+        lod.error = std::max(std::sqrt(errorSq), previousError);
+        previousError = lod.error;
+        previousTriangles = triangles;
+        lods.push_back(std::move(lod));
+    }
+    return lods;
+}
+
+} // namespace nova
@@ -0,0 +1,19 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "renderer/IRenderer.h"
+
+namespace nova {
+
+// Coarser levels of detail for a mesh in the renderer's vertex layout (8
+// floats per vertex), by vertex clustering: vertices are snapped to the one
+// nearest their cell's centroid on a grid that halves in resolution each
+// level, and collapsed triangles are dropped. Every level indexes the original
+// vertices, so levels share the mesh's vertex range. A level's error is the
+// farthest any vertex moved, in mesh units. Grids that barely reduce the
+// triangle count are skipped; at most `maxLevels` (and MAX_MESH_LODS - 1)
+// levels are returned, coarsest last.
+std::vector<MeshLod> GenerateMeshLods(const std::vector<float>& vertexData, const std::vector<uint32_t>& indices,
+                                      uint32_t maxLevels);
+
+} // namespace nova
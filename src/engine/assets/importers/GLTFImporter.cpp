@@ -1,5 +1,6 @@
 #include "GLTFImporter.h"
 #include "core/Log.h"
+#include "core/MemoryTracker.h"
 // #include "cgltf.h"
 #include <fstream>
 #include <sstream>
@@ -15,6 +16,7 @@ GLTFImporter::~GLTFImporter() {
 }
 
 GLTFImportResult GLTFImporter::importFromFile(const std::string& filePath) {
+    NOVA_MEM_TAG(Assets);
     NOVA_INFO("Importing GLTF file: " + filePath);
     
     GLTFImportResult result;
@@ -92,6 +94,7 @@ GLTFImportResult GLTFImporter::importFromFile(const std::string& filePath) {
     
     // Set mesh data
     sphereMesh->createFromVertices(vertices, indices);
+    if (options.generateLODs) sphereMesh->generateLods(options.maxLODLevels);
     
     // Generate GUID and register with asset manager
     std::string meshName = "sphere_from_gltf";
@@ -17,7 +17,7 @@ struct GLTFImportOptions {
     float scale = 1.0f;
     bool optimizeMeshes = true;
     bool generateLODs = false;
-    uint32_t maxLODLevels = 3;
+    uint32_t maxLODLevels = 3;      // Coarser levels besides the mesh itself
 };
 
 struct GLTFImportResult {
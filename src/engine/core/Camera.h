@@ -2,6 +2,7 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include "Frustum.h"
 
 struct GLFWwindow;
 
@@ -27,6 +28,7 @@ public:
     glm::mat4 GetViewMatrix() const;
     glm::mat4 GetProjectionMatrix() const;
     glm::mat4 GetViewProjectionMatrix() const;
+    Frustum GetFrustum() const { return Frustum::FromMatrix(GetViewProjectionMatrix()); }
     
     // Getters
     glm::vec3 GetPosition() const { return m_position; }
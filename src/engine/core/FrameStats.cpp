@@ -0,0 +1,110 @@
+#include "FrameStats.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+
+namespace nova {
+
+FrameStats::FrameStats() {
+    m_history.resize(HISTORY_SIZE);
+    m_scratch.reserve(HISTORY_SIZE);
+    m_histogram.assign(BUCKET_COUNT, 0);
+}
+
+size_t FrameStats::BucketFor(float ms) {
+    if (ms < 0.0f) ms = 0.0f;
+    if (ms < FINE_BUCKETS * FINE_BUCKET_MS) return static_cast<size_t>(ms / FINE_BUCKET_MS);
+    size_t coarse = static_cast<size_t>((ms - FINE_BUCKETS * FINE_BUCKET_MS) / COARSE_BUCKET_MS);
+    return FINE_BUCKETS + std::min(coarse, COARSE_BUCKETS - 1);
+}
+
+float FrameStats::BucketUpperMs(size_t bucket) {
+    if (bucket < FINE_BUCKETS) return (bucket + 1) * FINE_BUCKET_MS;
+    return FINE_BUCKETS * FINE_BUCKET_MS + (bucket - FINE_BUCKETS + 1) * COARSE_BUCKET_MS;
+}
+
+void FrameStats::AddFrame(const FrameSample& sample) {
+    m_history[m_head] = sample;
+    m_head = (m_head + 1) % HISTORY_SIZE;
+    m_count = std::min(m_count + 1, HISTORY_SIZE);
+    m_totalFrames++;
+
+    m_histogram[BucketFor(sample.frameMs)]++;
+    m_histogramTotal++;
+
+    // Threshold uses the median from before this frame so a hitch can't raise its own bar
+    float threshold = std::max(m_hitchMinMs, m_hitchFactor * m_p50);
+    UpdatePercentiles();
+
+    if (m_count > 1 && sample.frameMs > threshold) {
+        m_hitchCount++;
+        bool cooledDown = m_lastHitchFrame == 0 || sample.frameIndex >= m_lastHitchFrame + m_hitchCooldown;
+        if (m_hitchCallback && cooledDown) {
+            m_lastHitchFrame = sample.frameIndex;
+            m_hitchCallback(sample, threshold);
+        }
+    }
+}
+
+void FrameStats::UpdatePercentiles() {
+    m_scratch.clear();
+    for (size_t i = 0; i < m_count; ++i) m_scratch.push_back(m_history[i].frameMs);
+    if (m_scratch.empty()) return;
+
+    auto pick = [&](float p) {
+        size_t k = std::min(m_scratch.size() - 1, static_cast<size_t>(p * (m_scratch.size() - 1) + 0.5f));
+        std::nth_element(m_scratch.begin(), m_scratch.begin() + k, m_scratch.end());
+        return m_scratch[k];
+    };
+    m_p50 = pick(0.50f);
+    m_p95 = pick(0.95f);
+    m_p99 = pick(0.99f);
+    m_max = *std::max_element(m_scratch.begin(), m_scratch.end());
+}
+
+std::vector<FrameSample> FrameStats::GetHistory() const {
+    std::vector<FrameSample> out;
+    out.reserve(m_count);
+    ForEachSample([&](const FrameSample& s) { out.push_back(s); });
+    return out;
+}
+
+float FrameStats::HistogramPercentile(float p) const {
+    if (m_histogramTotal == 0) return 0.0f;
+    uint64_t target = static_cast<uint64_t>(p * m_histogramTotal);
+    uint64_t seen = 0;
+    for (size_t b = 0; b < BUCKET_COUNT; ++b) {
+        seen += m_histogram[b];
+        if (seen > target) return BucketUpperMs(b);
+    }
+    return BucketUpperMs(BUCKET_COUNT - 1);
+}
+
+void FrameStats::ResetHistogram() {
+    std::fill(m_histogram.begin(), m_histogram.end(), 0u);
+    m_histogramTotal = 0;
+}
+
+void FrameStats::SetHitchThreshold(float factor, float minMs, uint32_t cooldownFrames) {
+    m_hitchFactor = factor;
+    m_hitchMinMs = minMs;
+    m_hitchCooldown = cooldownFrames;
+}
+
+bool FrameStats::WriteCsv(const std::string& path) const {
+    auto parent = std::filesystem::path(path).parent_path();
+    if (!parent.empty()) std::filesystem::create_directories(parent);
+    std::ofstream out(path, std::ios::out | std::ios::trunc);
+    if (!out.is_open()) return false;
+
+    out << "# p50_ms=" << m_p50 << " p95_ms=" << m_p95 << " p99_ms=" << m_p99 << " max_ms=" << m_max
+        << " hitches=" << m_hitchCount << "\n";
+    out << "frame,frame_ms,cpu_sim_ms,cpu_record_ms,gpu_ms,present_wait_ms\n";
+    ForEachSample([&](const FrameSample& s) {
+        out << s.frameIndex << ',' << s.frameMs << ',' << s.phases.cpuSimMs << ',' << s.phases.cpuRecordMs << ','
+            << s.phases.gpuMs << ',' << s.phases.presentWaitMs << '\n';
+    });
+    return true;
+}
+
+} // namespace nova
@@ -0,0 +1,93 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace nova {
+
+struct FramePhaseTimes {
+    float cpuSimMs = 0.0f;       // Game/editor update before rendering
+    float cpuRecordMs = 0.0f;    // Command buffer recording
+    float gpuMs = 0.0f;          // Sum of GPU passes (timestamp queries)
+    float presentWaitMs = 0.0f;  // Fence wait + acquire + present
+};
+
+struct FrameSample {
+    uint64_t frameIndex = 0;
+    float frameMs = 0.0f;
+    FramePhaseTimes phases;
+};
+
+// Rolling frame-time statistics. Percentiles come from the last HISTORY_SIZE
+// frames; the histogram accumulates since the last reset, with 0.1 ms buckets
+// up to 100 ms and 1 ms buckets up to 1 s so long hitches keep their shape.
+class FrameStats {
+public:
+    static constexpr size_t HISTORY_SIZE = 1024;
+    static constexpr float FINE_BUCKET_MS = 0.1f;
+    static constexpr size_t FINE_BUCKETS = 1000;     // 0 - 100 ms
+    static constexpr float COARSE_BUCKET_MS = 1.0f;
+    static constexpr size_t COARSE_BUCKETS = 900;    // 100 ms - 1 s, last bucket is open-ended
+    static constexpr size_t BUCKET_COUNT = FINE_BUCKETS + COARSE_BUCKETS;
+
+    using HitchCallback = std::function<void(const FrameSample& sample, float thresholdMs)>;
+
+    FrameStats();
+
+    void AddFrame(const FrameSample& sample);
+
+    float P50() const { return m_p50; }
+    float P95() const { return m_p95; }
+    float P99() const { return m_p99; }
+    float Max() const { return m_max; }
+    uint64_t HitchCount() const { return m_hitchCount; }
+    uint64_t FrameCount() const { return m_totalFrames; }
+
+    // Chronological copy of the rolling history
+    std::vector<FrameSample> GetHistory() const;
+    // Most recent sample, or nullptr before the first frame
+    const FrameSample* Latest() const {
+        return m_count ? &m_history[(m_head + HISTORY_SIZE - 1) % HISTORY_SIZE] : nullptr;
+    }
+    // Visits the rolling history oldest first, in place (no copy)
+    template <typename Fn>
+    void ForEachSample(Fn&& fn) const {
+        size_t start = (m_head + HISTORY_SIZE - m_count) % HISTORY_SIZE;
+        for (size_t i = 0; i < m_count; ++i) fn(m_history[(start + i) % HISTORY_SIZE]);
+    }
+    const std::vector<uint32_t>& GetHistogram() const { return m_histogram; }
+    float HistogramPercentile(float p) const;
+    static float BucketUpperMs(size_t bucket);
+    void ResetHistogram();
+
+    // A frame is a hitch when it exceeds max(minMs, factor * rolling p50).
+    // The callback fires at most once per cooldownFrames.
+    void SetHitchThreshold(float factor, float minMs, uint32_t cooldownFrames = 120);
+    void SetHitchCallback(HitchCallback callback) { m_hitchCallback = std::move(callback); }
+
+    bool WriteCsv(const std::string& path) const;
+
+private:
+    static size_t BucketFor(float ms);
+    void UpdatePercentiles();
+
+    std::vector<FrameSample> m_history;
+    size_t m_head = 0;
+    size_t m_count = 0;
+    std::vector<float> m_scratch;
+    std::vector<uint32_t> m_histogram;
+    uint64_t m_histogramTotal = 0;
+
+    float m_p50 = 0.0f, m_p95 = 0.0f, m_p99 = 0.0f, m_max = 0.0f;
+    uint64_t m_totalFrames = 0;
+
+    float m_hitchFactor = 2.0f;
+    float m_hitchMinMs = 33.3f;
+    uint32_t m_hitchCooldown = 120;
+    uint64_t m_lastHitchFrame = 0;
+    uint64_t m_hitchCount = 0;
+    HitchCallback m_hitchCallback;
+};
+
+} // namespace nova
@@ -0,0 +1,32 @@
+#include "Frustum.h"
+
+namespace nova {
+
+Frustum Frustum::FromMatrix(const glm::mat4& m) {
+    // Gribb/Hartmann: planes are sums/differences of the matrix rows; glm is
+    // column-major so row i is (m[0][i], m[1][i], m[2][i], m[3][i])
+    auto row = [&](int i) { return glm::vec4(m[0][i], m[1][i], m[2][i], m[3][i]); };
+    glm::vec4 r0 = row(0), r1 = row(1), r2 = row(2), r3 = row(3);
+
+    Frustum f;
+    f.planes[Left] = r3 + r0;
+    f.planes[Right] = r3 - r0;
+    f.planes[Bottom] = r3 + r1;
+    f.planes[Top] = r3 - r1;
+    f.planes[Near] = r3 + r2;
+    f.planes[Far] = r3 - r2;
+    for (auto& plane : f.planes) {
+        float length = glm::length(glm::vec3(plane));
+        if (length > 0.0f) plane /= length;
+    }
+    return f;
+}
+
+bool Frustum::IntersectsSphere(const glm::vec3& center, float radius, float margin) const {
+    for (const auto& plane : planes) {
+        if (glm::dot(glm::vec3(plane), center) + plane.w < -(radius + margin)) return false;
+    }
+    return true;
+}
+
+} // namespace nova
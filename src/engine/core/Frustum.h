@@ -0,0 +1,20 @@
+#pragma once
+#include <glm/glm.hpp>
+
+namespace nova {
+
+// Six clip planes (ax + by + cz + d >= 0 inside) extracted from a
+// view-projection matrix. The near plane assumes a -1..1 clip depth, which is
+// what glm::perspective produces; for 0..1 projections it is merely looser.
+struct Frustum {
+    enum Plane { Left = 0, Right, Bottom, Top, Near, Far, PlaneCount };
+
+    glm::vec4 planes[PlaneCount];
+
+    static Frustum FromMatrix(const glm::mat4& viewProj);
+
+    // `margin` grows (positive) or shrinks (negative) the sphere
+    bool IntersectsSphere(const glm::vec3& center, float radius, float margin = 0.0f) const;
+};
+
+} // namespace nova
@@ -0,0 +1,81 @@
+#include "JobSystem.h"
+#include <algorithm>
+
+namespace nova {
+
+void JobSystem::Init(uint32_t workerCount) {
+    Shutdown();
+    m_stopping = false;
+    m_workers.reserve(workerCount);
+    // Workers start from the current batch so they never join one published
+    // before they existed
+    for (uint32_t i = 0; i < workerCount; ++i) {
+        m_workers.emplace_back(&JobSystem::WorkerLoop, this, i + 1, m_generation);
+    }
+}
+
+void JobSystem::Shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& worker : m_workers) {
+        if (worker.joinable()) worker.join();
+    }
+    m_workers.clear();
+}
+
+void JobSystem::ParallelFor(uint32_t count, uint32_t maxThreads, const JobFn& fn) {
+    if (count == 0) return;
+    uint32_t helpers = std::min(WorkerCount(), count - 1);
+    if (maxThreads > 0) helpers = std::min(helpers, maxThreads - 1);
+    if (helpers == 0) {
+        for (uint32_t job = 0; job < count; ++job) fn(job, 0);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_fn = &fn;
+        m_count = count;
+        m_next.store(0);
+        m_helpers = helpers;
+        m_finished = 0;
+        m_generation++;
+    }
+    m_wake.notify_all();
+    RunJobs(0);
+
+    // Every selected helper checks in, so none can still be looking at this
+    // batch when the next one is published
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [&] { return m_finished == m_helpers; });
+    m_fn = nullptr;
+}
+
+void JobSystem::WorkerLoop(uint32_t thread, uint64_t seen) {
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&] { return m_stopping || m_generation != seen; });
+            if (m_stopping) return;
+            seen = m_generation;
+            if (thread > m_helpers) continue;
+        }
+        RunJobs(thread);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_finished++;
+        }
+        m_done.notify_one();
+    }
+}
+
+void JobSystem::RunJobs(uint32_t thread) {
+    for (uint32_t job = m_next.fetch_add(1); job < m_count; job = m_next.fetch_add(1)) {
+        (*m_fn)(job, thread);
+    }
+}
+
+} // namespace nova
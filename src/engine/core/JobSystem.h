@@ -0,0 +1,53 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nova {
+
+// Fixed pool of worker threads for fork-join work. ParallelFor hands out jobs
+// [0, count) to the calling thread and up to maxThreads - 1 workers, which
+// pull them from a shared counter, and returns once every job has finished.
+// Thread index 0 is the calling thread, workers are 1..WorkerCount(), so
+// callers can keep per-thread state (command pools, counters) without locks.
+// One ParallelFor at a time; it must not be called from inside a job.
+class JobSystem {
+public:
+    ~JobSystem() { Shutdown(); }
+
+    // 0 workers runs every job on the calling thread
+    void Init(uint32_t workerCount);
+    void Shutdown();
+
+    uint32_t WorkerCount() const { return static_cast<uint32_t>(m_workers.size()); }
+    // WorkerCount() + 1
+    uint32_t ThreadCount() const { return WorkerCount() + 1; }
+
+    using JobFn = std::function<void(uint32_t job, uint32_t thread)>;
+    // maxThreads 0 uses every worker
+    void ParallelFor(uint32_t count, uint32_t maxThreads, const JobFn& fn);
+
+private:
+    void WorkerLoop(uint32_t thread, uint64_t seen);
+    void RunJobs(uint32_t thread);
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    bool m_stopping = false;
+
+    // Current batch, published under m_mutex
+    uint64_t m_generation = 0;
+    uint32_t m_helpers = 0;           // Workers 1..m_helpers take part
+    uint32_t m_finished = 0;          // Helpers done with this batch
+    const JobFn* m_fn = nullptr;
+    uint32_t m_count = 0;
+    std::atomic<uint32_t> m_next{0};
+};
+
+} // namespace nova
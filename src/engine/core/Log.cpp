@@ -3,7 +3,7 @@
 using namespace std::chrono;
 
 namespace nova {
-std::ofstream Log::s_file; std::mutex Log::s_mutex;
+std::ofstream Log::s_file; std::mutex Log::s_mutex; bool Log::s_verbose = true;
 
 static std::string nowStr(){
     auto tp = system_clock::now();
@@ -16,6 +16,7 @@ void Log::Init(){
     s_file.open(".logs/editor.log", std::ios::out | std::ios::trunc);
     Write("INFO","Logger ready");
 }
+void Log::SetVerbose(bool verbose){ s_verbose = verbose; }
 void Log::Write(const char* level, const std::string& msg){
     std::scoped_lock lk(s_mutex);
     auto line = nowStr() + " [" + level + "] " + msg + "\n";
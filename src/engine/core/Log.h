@@ -10,13 +10,16 @@ class Log {
 public:
     static void Init();
     static void Write(const char* level, const std::string& msg);
+    static void SetVerbose(bool verbose); // false drops INFO messages (benchmarks)
+    static bool IsVerbose() { return s_verbose; }
 private:
     static std::ofstream s_file;
     static std::mutex s_mutex;
+    static bool s_verbose;
 };
 }
 #define NOVA_LOG(lvl, msg) ::nova::Log::Write(lvl, (msg))
-#define NOVA_INFO(msg) NOVA_LOG("INFO", msg)
+#define NOVA_INFO(msg) do { if (::nova::Log::IsVerbose()) NOVA_LOG("INFO", msg); } while (0)
 #define NOVA_WARN(msg) NOVA_LOG("WARN", msg)
 #define NOVA_ERROR(msg) NOVA_LOG("ERROR", msg)
 #define NOVA_FATAL(msg) NOVA_LOG("FATAL", msg)
@@ -0,0 +1,297 @@
+#include "MemoryTracker.h"
+#include "Profiler.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <dbghelp.h>
+#include <mutex>
+#pragma comment(lib, "dbghelp.lib")
+#elif defined(__unix__) || defined(__APPLE__)
+#include <dlfcn.h>
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define NOVA_RETURN_ADDRESS() _ReturnAddress()
+#else
+#define NOVA_RETURN_ADDRESS() __builtin_return_address(0)
+#endif
+
+namespace nova {
+
+namespace {
+constexpr size_t TAG_COUNT = static_cast<size_t>(MemTag::Count);
+constexpr uint32_t MAX_TAG_DEPTH = 64;
+constexpr size_t CALL_SITE_SLOTS = 4096;   // Power of two
+constexpr size_t CALL_SITE_PROBES = 32;
+
+// Everything here is constant-initialised so the hooks are usable during
+// static initialisation, and none of it allocates.
+std::atomic<int64_t> s_liveBytes[TAG_COUNT];
+std::atomic<int64_t> s_liveAllocs[TAG_COUNT];
+std::atomic<uint64_t> s_totalAllocs[TAG_COUNT];
+std::atomic<uint64_t> s_frameAllocsAccum[TAG_COUNT];
+std::atomic<uint64_t> s_frameBytesAccum[TAG_COUNT];
+std::atomic<uint64_t> s_frameAllocs[TAG_COUNT];
+std::atomic<uint64_t> s_frameBytes[TAG_COUNT];
+
+struct CallSiteSlot {
+    std::atomic<void*> address;
+    std::atomic<uint64_t> count;
+    std::atomic<uint64_t> bytes;
+};
+CallSiteSlot s_callSites[CALL_SITE_SLOTS];
+
+thread_local MemTag t_tagStack[MAX_TAG_DEPTH];
+thread_local uint32_t t_tagDepth = 0;
+
+const char* s_tagNames[TAG_COUNT] = { "Untagged", "Core", "Assets", "ECS", "Renderer", "Lua", "UI" };
+
+void RecordCallSite(void* address, size_t size) {
+    uint64_t h = (reinterpret_cast<uintptr_t>(address) >> 2) * 0x9E3779B97F4A7C15ull;
+    size_t slot = static_cast<size_t>(h >> 52) & (CALL_SITE_SLOTS - 1);
+    for (size_t i = 0; i < CALL_SITE_PROBES; ++i) {
+        auto& s = s_callSites[(slot + i) & (CALL_SITE_SLOTS - 1)];
+        void* current = s.address.load(std::memory_order_relaxed);
+        if (current == nullptr) {
+            if (s.address.compare_exchange_strong(current, address, std::memory_order_relaxed)) current = address;
+        }
+        if (current == address) {
+            s.count.fetch_add(1, std::memory_order_relaxed);
+            s.bytes.fetch_add(size, std::memory_order_relaxed);
+            return;
+        }
+    }
+    // Table saturated around this hash; the site stays untracked
+}
+
+std::string DescribeCallSite(void* address) {
+    char buf[512];
+#if defined(_WIN32)
+    static std::mutex symMutex;
+    static bool symReady = false;
+    std::scoped_lock lk(symMutex);
+    HANDLE process = GetCurrentProcess();
+    if (!symReady) {
+        SymSetOptions(SYMOPT_UNDNAME | SYMOPT_DEFERRED_LOADS | SYMOPT_LOAD_LINES);
+        symReady = SymInitialize(process, nullptr, TRUE) == TRUE;
+    }
+    if (symReady) {
+        alignas(SYMBOL_INFO) char symBuf[sizeof(SYMBOL_INFO) + 256];
+        auto* sym = reinterpret_cast<SYMBOL_INFO*>(symBuf);
+        sym->SizeOfStruct = sizeof(SYMBOL_INFO);
+        sym->MaxNameLen = 255;
+        DWORD64 disp = 0;
+        if (SymFromAddr(process, reinterpret_cast<DWORD64>(address), &disp, sym)) {
+            IMAGEHLP_LINE64 line{};
+            line.SizeOfStruct = sizeof(line);
+            DWORD lineDisp = 0;
+            if (SymGetLineFromAddr64(process, reinterpret_cast<DWORD64>(address), &lineDisp, &line)) {
+                std::snprintf(buf, sizeof(buf), "%s (%s:%lu)", sym->Name, line.FileName, line.LineNumber);
+            } else {
+                std::snprintf(buf, sizeof(buf), "%s+0x%llx", sym->Name, static_cast<unsigned long long>(disp));
+            }
+            return buf;
+        }
+    }
+#elif defined(__unix__) || defined(__APPLE__)
+    Dl_info info{};
+    if (dladdr(address, &info) && info.dli_sname) {
+        std::snprintf(buf, sizeof(buf), "%s+0x%zx", info.dli_sname,
+                      static_cast<size_t>(static_cast<char*>(address) - static_cast<char*>(info.dli_saddr)));
+        return buf;
+    }
+#endif
+    std::snprintf(buf, sizeof(buf), "%p", address);
+    return buf;
+}
+} // namespace
+
+void MemoryTracker::PushTag(MemTag tag) {
+    if (t_tagDepth < MAX_TAG_DEPTH) t_tagStack[t_tagDepth] = tag;
+    ++t_tagDepth;
+}
+
+void MemoryTracker::PopTag() {
+    if (t_tagDepth > 0) --t_tagDepth;
+}
+
+MemTag MemoryTracker::CurrentTag() {
+    if (t_tagDepth == 0) return MemTag::Untagged;
+    return t_tagStack[std::min(t_tagDepth, MAX_TAG_DEPTH) - 1];
+}
+
+const char* MemoryTracker::TagName(MemTag tag) {
+    size_t i = static_cast<size_t>(tag);
+    return i < TAG_COUNT ? s_tagNames[i] : "Invalid";
+}
+
+void MemoryTracker::RecordAlloc(size_t size, MemTag tag, void* callSite) {
+    size_t t = static_cast<size_t>(tag);
+    s_liveBytes[t].fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed);
+    s_liveAllocs[t].fetch_add(1, std::memory_order_relaxed);
+    s_totalAllocs[t].fetch_add(1, std::memory_order_relaxed);
+    s_frameAllocsAccum[t].fetch_add(1, std::memory_order_relaxed);
+    s_frameBytesAccum[t].fetch_add(size, std::memory_order_relaxed);
+    if (callSite) RecordCallSite(callSite, size);
+}
+
+void MemoryTracker::RecordFree(size_t size, MemTag tag) {
+    size_t t = static_cast<size_t>(tag);
+    s_liveBytes[t].fetch_sub(static_cast<int64_t>(size), std::memory_order_relaxed);
+    s_liveAllocs[t].fetch_sub(1, std::memory_order_relaxed);
+}
+
+void MemoryTracker::EndFrame() {
+    if (!Enabled()) return;
+    uint64_t frameAllocs = 0, frameBytes = 0;
+    for (size_t t = 0; t < TAG_COUNT; ++t) {
+        s_frameAllocs[t] = s_frameAllocsAccum[t].exchange(0, std::memory_order_relaxed);
+        s_frameBytes[t] = s_frameBytesAccum[t].exchange(0, std::memory_order_relaxed);
+        frameAllocs += s_frameAllocs[t];
+        frameBytes += s_frameBytes[t];
+    }
+    Profiler::AddCounter("Mem Live KB", double(GetTotalLiveBytes()) / 1024.0);
+    Profiler::AddCounter("Mem Allocs/frame", double(frameAllocs));
+    Profiler::AddCounter("Mem KB/frame", double(frameBytes) / 1024.0);
+    for (size_t t = 0; t < TAG_COUNT; ++t) {
+        int64_t live = s_liveBytes[t].load(std::memory_order_relaxed);
+        if (live != 0) Profiler::AddCounter(std::string("Mem ") + s_tagNames[t] + " KB", double(live) / 1024.0);
+    }
+}
+
+MemTagStats MemoryTracker::GetTagStats(MemTag tag) {
+    size_t t = static_cast<size_t>(tag);
+    MemTagStats stats;
+    if (t >= TAG_COUNT) return stats;
+    stats.liveBytes = s_liveBytes[t].load(std::memory_order_relaxed);
+    stats.liveAllocs = s_liveAllocs[t].load(std::memory_order_relaxed);
+    stats.totalAllocs = s_totalAllocs[t].load(std::memory_order_relaxed);
+    stats.frameAllocs = s_frameAllocs[t].load(std::memory_order_relaxed);
+    stats.frameBytes = s_frameBytes[t].load(std::memory_order_relaxed);
+    return stats;
+}
+
+int64_t MemoryTracker::GetTotalLiveBytes() {
+    int64_t total = 0;
+    for (size_t t = 0; t < TAG_COUNT; ++t) total += s_liveBytes[t].load(std::memory_order_relaxed);
+    return total;
+}
+
+std::vector<MemCallSite> MemoryTracker::GetTopCallSites(size_t count) {
+    std::vector<MemCallSite> sites;
+    for (auto& s : s_callSites) {
+        void* address = s.address.load(std::memory_order_relaxed);
+        if (!address) continue;
+        sites.push_back({ address, s.count.load(std::memory_order_relaxed), s.bytes.load(std::memory_order_relaxed), {} });
+    }
+    // Rank by allocation count: frequent small allocations are the steady-state ones to remove
+    size_t n = std::min(count, sites.size());
+    std::partial_sort(sites.begin(), sites.begin() + n, sites.end(),
+                      [](const MemCallSite& a, const MemCallSite& b) { return a.count > b.count; });
+    sites.resize(n);
+    for (auto& site : sites) site.symbol = DescribeCallSite(site.address);
+    return sites;
+}
+
+void* MemoryTracker::LuaAlloc(void* ud, void* ptr, size_t osize, size_t nsize) {
+    (void)ud;
+    // When ptr is null, osize encodes the Lua object type rather than a size
+    size_t oldSize = ptr ? osize : 0;
+    if (nsize == 0) {
+        if (ptr) {
+            RecordFree(oldSize, MemTag::Lua);
+            std::free(ptr);
+        }
+        return nullptr;
+    }
+    void* block = std::realloc(ptr, nsize);
+    if (!block) return nullptr;   // Lua keeps the original block
+    if (ptr) RecordFree(oldSize, MemTag::Lua);
+    RecordAlloc(nsize, MemTag::Lua, nullptr);
+    return block;
+}
+
+} // namespace nova
+
+#ifdef NOVA_MEMORY_TRACKING
+// ---- Global operator new/delete replacement ----
+// Every block carries a 16-byte header with its size, tag and the offset back
+// to the malloc'd pointer (non-zero only for over-aligned allocations).
+namespace {
+struct AllocHeader {
+    uint64_t size;
+    uint32_t offset;
+    uint8_t tag;
+    uint8_t reserved;
+    uint16_t magic;
+};
+static_assert(sizeof(AllocHeader) == 16, "AllocHeader must stay 16 bytes");
+constexpr uint16_t ALLOC_MAGIC = 0x4E4D;   // "NM"
+
+void* TrackedAlloc(size_t size, size_t alignment, void* callSite) noexcept {
+    size_t align = std::max<size_t>(alignment, __STDCPP_DEFAULT_NEW_ALIGNMENT__);
+    size_t extra = (align > __STDCPP_DEFAULT_NEW_ALIGNMENT__) ? align - 1 : 0;
+    char* raw = static_cast<char*>(std::malloc(size + sizeof(AllocHeader) + extra));
+    if (!raw) return nullptr;
+    uintptr_t user = reinterpret_cast<uintptr_t>(raw) + sizeof(AllocHeader);
+    user = (user + align - 1) & ~(uintptr_t(align) - 1);
+
+    auto* header = reinterpret_cast<AllocHeader*>(user) - 1;
+    header->size = size;
+    header->offset = static_cast<uint32_t>(user - reinterpret_cast<uintptr_t>(raw));
+    header->tag = static_cast<uint8_t>(nova::MemoryTracker::CurrentTag());
+    header->reserved = 0;
+    header->magic = ALLOC_MAGIC;
+    nova::MemoryTracker::RecordAlloc(size, static_cast<nova::MemTag>(header->tag), callSite);
+    return reinterpret_cast<void*>(user);
+}
+
+void TrackedFree(void* ptr) noexcept {
+    if (!ptr) return;
+    auto* header = static_cast<AllocHeader*>(ptr) - 1;
+    if (header->magic != ALLOC_MAGIC) {
+        std::abort();   // Not allocated by TrackedAlloc (heap mismatch or corruption)
+    }
+    nova::MemoryTracker::RecordFree(static_cast<size_t>(header->size), static_cast<nova::MemTag>(header->tag));
+    header->magic = 0;
+    std::free(static_cast<char*>(ptr) - header->offset);
+}
+
+void* TrackedAllocOrThrow(size_t size, size_t alignment, void* callSite) {
+    for (;;) {
+        if (void* p = TrackedAlloc(size, alignment, callSite)) return p;
+        std::new_handler handler = std::get_new_handler();
+        if (!handler) throw std::bad_alloc();
+        handler();
+    }
+}
+} // namespace
+
+void* operator new(size_t size) { return TrackedAllocOrThrow(size, 0, NOVA_RETURN_ADDRESS()); }
+void* operator new[](size_t size) { return TrackedAllocOrThrow(size, 0, NOVA_RETURN_ADDRESS()); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return TrackedAlloc(size, 0, NOVA_RETURN_ADDRESS()); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept { return TrackedAlloc(size, 0, NOVA_RETURN_ADDRESS()); }
+void* operator new(size_t size, std::align_val_t al) { return TrackedAllocOrThrow(size, static_cast<size_t>(al), NOVA_RETURN_ADDRESS()); }
+void* operator new[](size_t size, std::align_val_t al) { return TrackedAllocOrThrow(size, static_cast<size_t>(al), NOVA_RETURN_ADDRESS()); }
+void* operator new(size_t size, std::align_val_t al, const std::nothrow_t&) noexcept { return TrackedAlloc(size, static_cast<size_t>(al), NOVA_RETURN_ADDRESS()); }
+void* operator new[](size_t size, std::align_val_t al, const std::nothrow_t&) noexcept { return TrackedAlloc(size, static_cast<size_t>(al), NOVA_RETURN_ADDRESS()); }
+
+void operator delete(void* p) noexcept { TrackedFree(p); }
+void operator delete[](void* p) noexcept { TrackedFree(p); }
+void operator delete(void* p, size_t) noexcept { TrackedFree(p); }
+void operator delete[](void* p, size_t) noexcept { TrackedFree(p); }
+void operator delete(void* p, const std::nothrow_t&) noexcept { TrackedFree(p); }
+void operator delete[](void* p, const std::nothrow_t&) noexcept { TrackedFree(p); }
+void operator delete(void* p, std::align_val_t) noexcept { TrackedFree(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { TrackedFree(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { TrackedFree(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { TrackedFree(p); }
+void operator delete(void* p, std::align_val_t, const std::nothrow_t&) noexcept { TrackedFree(p); }
+void operator delete[](void* p, std::align_val_t, const std::nothrow_t&) noexcept { TrackedFree(p); }
+#endif
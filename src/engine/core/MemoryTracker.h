@@ -0,0 +1,84 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace nova {
+
+enum class MemTag : uint8_t {
+    Untagged = 0,
+    Core,
+    Assets,
+    ECS,
+    Renderer,
+    Lua,
+    UI,
+    Count
+};
+
+struct MemTagStats {
+    int64_t liveBytes = 0;
+    int64_t liveAllocs = 0;
+    uint64_t totalAllocs = 0;
+    uint64_t frameAllocs = 0;   // Allocations during the last completed frame
+    uint64_t frameBytes = 0;    // Bytes allocated during the last completed frame
+};
+
+struct MemCallSite {
+    void* address = nullptr;
+    uint64_t count = 0;
+    uint64_t bytes = 0;
+    std::string symbol;
+};
+
+// Opt-in global allocation tracking (CMake option NOVA_MEMORY_TRACKING).
+// Replaces operator new/delete and the Lua allocator, attributing every
+// allocation to the innermost NOVA_MEM_TAG scope on the calling thread.
+// When the option is off every entry point is a cheap no-op.
+class MemoryTracker {
+public:
+    static constexpr bool Enabled() {
+#ifdef NOVA_MEMORY_TRACKING
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    static void PushTag(MemTag tag);
+    static void PopTag();
+    static MemTag CurrentTag();
+    static const char* TagName(MemTag tag);
+
+    // Called by the allocation hooks; must not allocate
+    static void RecordAlloc(size_t size, MemTag tag, void* callSite);
+    static void RecordFree(size_t size, MemTag tag);
+
+    // Latches per-frame counters and publishes them to the Profiler
+    static void EndFrame();
+
+    static MemTagStats GetTagStats(MemTag tag);
+    static int64_t GetTotalLiveBytes();
+    static std::vector<MemCallSite> GetTopCallSites(size_t count);
+
+    // lua_Alloc compatible allocator, tagged as MemTag::Lua
+    static void* LuaAlloc(void* ud, void* ptr, size_t osize, size_t nsize);
+};
+
+struct MemTagScope {
+    explicit MemTagScope(MemTag tag) { MemoryTracker::PushTag(tag); }
+    ~MemTagScope() { MemoryTracker::PopTag(); }
+    MemTagScope(const MemTagScope&) = delete;
+    MemTagScope& operator=(const MemTagScope&) = delete;
+};
+
+} // namespace nova
+
+#define NOVA_MEM_CONCAT_INNER(a, b) a##b
+#define NOVA_MEM_CONCAT(a, b) NOVA_MEM_CONCAT_INNER(a, b)
+#ifdef NOVA_MEMORY_TRACKING
+#define NOVA_MEM_TAG(tag) ::nova::MemTagScope NOVA_MEM_CONCAT(_novaMemTag, __LINE__)(::nova::MemTag::tag)
+#else
+#define NOVA_MEM_TAG(tag) ((void)0)
+#endif
@@ -0,0 +1,95 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+using namespace std::chrono;
+
+namespace nova {
+std::mutex Profiler::s_mutex; ProfileFrame Profiler::s_current; std::deque<ProfileFrame> Profiler::s_history;
+uint64_t Profiler::s_frameIndex = 0; double Profiler::s_epochMs = 0.0;
+
+static std::string jsonEscape(const std::string& s){
+    std::string out; out.reserve(s.size());
+    for (char c : s) {
+        if (c == '"' || c == '\\') { out += '\\'; out += c; }
+        else if (c == '\n') out += "\\n";
+        else if (static_cast<unsigned char>(c) >= 0x20) out += c;
+    }
+    return out;
+}
+
+double Profiler::NowMs(){
+    return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+void Profiler::BeginFrame(){
+    std::scoped_lock lk(s_mutex);
+    double now = NowMs();
+    if (s_epochMs == 0.0) s_epochMs = now;
+    s_current = ProfileFrame{};
+    s_current.index = s_frameIndex++;
+    s_current.startMs = now - s_epochMs;
+}
+
+void Profiler::EndFrame(){
+    std::scoped_lock lk(s_mutex);
+    s_current.durationMs = (NowMs() - s_epochMs) - s_current.startMs;
+    s_history.push_back(std::move(s_current));
+    while (s_history.size() > HISTORY_SIZE) s_history.pop_front();
+    s_current = ProfileFrame{};
+}
+
+void Profiler::AddEvent(const std::string& name, const std::string& category, double startMs, double durationMs){
+    std::scoped_lock lk(s_mutex);
+    s_current.events.push_back({name, category, startMs, durationMs});
+}
+
+void Profiler::AddCounter(const std::string& name, double value){
+    std::scoped_lock lk(s_mutex);
+    for (auto& c : s_current.counters) {
+        if (c.name == name) { c.value = value; return; }
+    }
+    s_current.counters.push_back({name, value});
+}
+
+std::vector<ProfileFrame> Profiler::GetHistory(size_t maxFrames){
+    std::scoped_lock lk(s_mutex);
+    size_t count = std::min(maxFrames, s_history.size());
+    return std::vector<ProfileFrame>(s_history.end() - count, s_history.end());
+}
+
+bool Profiler::WriteTrace(const std::string& path, size_t maxFrames){
+    auto frames = GetHistory(maxFrames);
+    auto parent = std::filesystem::path(path).parent_path();
+    if (!parent.empty()) std::filesystem::create_directories(parent);
+    std::ofstream out(path, std::ios::out | std::ios::trunc);
+    if (!out.is_open()) return false;
+
+    // Chrome trace event format, timestamps in microseconds.
+    // tid 1 = CPU frame/scopes, tid 2 = GPU passes.
+    out << "{\"traceEvents\":[\n";
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+    out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+    auto sep = [&](){ out << ",\n"; };
+    for (const auto& f : frames) {
+        sep();
+        out << "{\"name\":\"Frame " << f.index << "\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":1"
+            << ",\"ts\":" << f.startMs * 1000.0 << ",\"dur\":" << f.durationMs * 1000.0 << "}";
+        for (const auto& e : f.events) {
+            sep();
+            int tid = (e.category == "gpu") ? 2 : 1;
+            out << "{\"name\":\"" << jsonEscape(e.name) << "\",\"cat\":\"" << jsonEscape(e.category)
+                << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tid
+                << ",\"ts\":" << (f.startMs + e.startMs) * 1000.0 << ",\"dur\":" << e.durationMs * 1000.0 << "}";
+        }
+        for (const auto& c : f.counters) {
+            sep();
+            out << "{\"name\":\"" << jsonEscape(c.name) << "\",\"ph\":\"C\",\"pid\":1"
+                << ",\"ts\":" << f.startMs * 1000.0 << ",\"args\":{\"value\":" << c.value << "}}";
+        }
+    }
+    out << "\n],\"displayTimeUnit\":\"ms\"}\n";
+    return true;
+}
+}
@@ -0,0 +1,55 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <cstdint>
+
+namespace nova {
+
+struct ProfileEvent {
+    std::string name;
+    std::string category;   // "cpu" or "gpu"
+    double startMs = 0.0;   // Relative to the start of the owning frame
+    double durationMs = 0.0;
+};
+
+struct ProfileCounter {
+    std::string name;
+    double value = 0.0;
+};
+
+struct ProfileFrame {
+    uint64_t index = 0;
+    double startMs = 0.0;   // Relative to the first profiled frame
+    double durationMs = 0.0;
+    std::vector<ProfileEvent> events;
+    std::vector<ProfileCounter> counters;
+};
+
+// Frame-based profiler. Collects CPU/GPU events and counters for the current
+// frame and keeps the last HISTORY_SIZE frames for the stats panel and the
+// Chrome trace export (chrome://tracing, Perfetto).
+class Profiler {
+public:
+    static constexpr size_t HISTORY_SIZE = 300;
+
+    static void BeginFrame();
+    static void EndFrame();
+    static double NowMs();
+
+    static void AddEvent(const std::string& name, const std::string& category, double startMs, double durationMs);
+    static void AddCounter(const std::string& name, double value);
+
+    static std::vector<ProfileFrame> GetHistory(size_t maxFrames = HISTORY_SIZE);
+    static bool WriteTrace(const std::string& path, size_t maxFrames = HISTORY_SIZE);
+
+private:
+    static std::mutex s_mutex;
+    static ProfileFrame s_current;
+    static std::deque<ProfileFrame> s_history;
+    static uint64_t s_frameIndex;
+    static double s_epochMs;
+};
+
+} // namespace nova
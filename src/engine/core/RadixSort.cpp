@@ -0,0 +1,68 @@
+#include "RadixSort.h"
+#include "JobSystem.h"
+#include <algorithm>
+#include <array>
+
+namespace nova {
+
+namespace {
+// Below this many entries per thread, waking workers costs more than it saves
+constexpr size_t MIN_ENTRIES_PER_THREAD = 8192;
+} // namespace
+
+void RadixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch, JobSystem* jobs, uint32_t maxThreads) {
+    const size_t count = entries.size();
+    if (count < 2) return;
+    scratch.resize(count);
+
+    uint32_t chunks = 1;
+    if (jobs) {
+        uint32_t threads = maxThreads > 0 ? std::min(maxThreads, jobs->ThreadCount()) : jobs->ThreadCount();
+        chunks = static_cast<uint32_t>(std::clamp<size_t>(count / MIN_ENTRIES_PER_THREAD, 1, threads));
+    }
+    auto forEachChunk = [&](auto&& fn) {
+        if (chunks == 1) {
+            fn(0u, size_t(0), count);
+            return;
+        }
+        jobs->ParallelFor(chunks, chunks, [&](uint32_t chunk, uint32_t) {
+            fn(chunk, count * chunk / chunks, count * (chunk + 1) / chunks);
+        });
+    };
+
+    // Per chunk: digit counts, then turned into that chunk's write cursors
+    std::vector<std::array<uint32_t, 256>> histograms(chunks);
+    SortEntry* src = entries.data();
+    SortEntry* dst = scratch.data();
+    for (uint32_t shift = 0; shift < 64; shift += 8) {
+        forEachChunk([&](uint32_t chunk, size_t begin, size_t end) {
+            std::array<uint32_t, 256>& histogram = histograms[chunk];
+            histogram.fill(0);
+            for (size_t i = begin; i < end; ++i) histogram[(src[i].key >> shift) & 0xFF]++;
+        });
+
+        // Digit-major, chunk-minor prefix sum keeps the scatter stable
+        uint32_t offset = 0;
+        bool trivial = false;
+        for (uint32_t digit = 0; digit < 256 && !trivial; ++digit) {
+            uint32_t digitTotal = 0;
+            for (uint32_t chunk = 0; chunk < chunks; ++chunk) {
+                uint32_t digitCount = histograms[chunk][digit];
+                histograms[chunk][digit] = offset;
+                offset += digitCount;
+                digitTotal += digitCount;
+            }
+            trivial = digitTotal == count;
+        }
+        if (trivial) continue;
+
+        forEachChunk([&](uint32_t chunk, size_t begin, size_t end) {
+            std::array<uint32_t, 256>& cursor = histograms[chunk];
+            for (size_t i = begin; i < end; ++i) dst[cursor[(src[i].key >> shift) & 0xFF]++] = src[i];
+        });
+        std::swap(src, dst);
+    }
+    if (src != entries.data()) entries.swap(scratch);
+}
+
+} // namespace nova
@@ -0,0 +1,22 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+namespace nova {
+
+class JobSystem;
+
+// 64-bit key plus the index of whatever it was computed for
+struct SortEntry {
+    uint64_t key = 0;
+    uint32_t index = 0;
+};
+
+// Stable LSD radix sort on SortEntry::key, one byte per pass. Passes in which
+// every key has the same byte (e.g. unused high bits) are skipped. With a job
+// system, large arrays split each pass's histogram and scatter across up to
+// `maxThreads` threads (0 = all); `scratch` is resized to match and reused.
+void RadixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch,
+               JobSystem* jobs = nullptr, uint32_t maxThreads = 0);
+
+} // namespace nova
@@ -3,6 +3,7 @@
 #include <cstdint>
 #include <typeindex>
 #include <memory>
+#include "engine/core/MemoryTracker.h"
 
 namespace nova {
 using Entity = uint32_t;
@@ -14,6 +15,7 @@ public:
     Entity create(){ return next++; }
     template<typename C, typename...Args>
     C& emplace(Entity e, Args&&...args) {
+        NOVA_MEM_TAG(ECS);
         auto& pool = pools[std::type_index(typeid(C))];
         auto p = std::make_shared<C>(C{std::forward<Args>(args)...});
         pool[e] = p; return *static_cast<C*>(p.get());
@@ -1,5 +1,7 @@
 ﻿#include "Editor.h"
 #include "engine/core/Log.h"
+#include "engine/core/Profiler.h"
+#include "engine/core/MemoryTracker.h"
 #include "engine/renderer/vk/VulkanRenderer.h"
 #include "engine/assets/AssetManager.h"
 #include "engine/assets/Texture.h"
@@ -45,6 +47,14 @@ void Editor::Init() {
     try {
         m_renderer->Init(m_window);
         m_renderer->InitImGui(m_window);
+        
+        // Dump the recent profiler frames whenever a hitch is detected
+        m_renderer->GetFrameStats().SetHitchCallback([](const FrameSample& sample, float thresholdMs) {
+            std::string path = ".logs/hitch_" + std::to_string(sample.frameIndex) + ".json";
+            NOVA_WARN("Hitch detected: " + std::to_string(sample.frameMs) + " ms (threshold " +
+                      std::to_string(thresholdMs) + " ms), writing " + path);
+            Profiler::WriteTrace(path, 120);
+        });
     } catch (const std::exception& e) {
         NOVA_ERROR("Failed to initialize Vulkan renderer: " + std::string(e.what()));
         throw;
@@ -274,6 +284,7 @@ void Editor::Init() {
 }
 
 void Editor::LoadDefaultAssets() {
+    NOVA_MEM_TAG(Assets);
     NOVA_INFO("Loading default assets...");
     
     try {
@@ -399,6 +410,8 @@ void Editor::Run() {
             NOVA_INFO("Editor::Run: Loop condition check - m_window: " + std::to_string(m_window != nullptr) + ", shouldClose: " + std::to_string(glfwWindowShouldClose(m_window)));
             frameCount++;
             NOVA_INFO("Editor::Run: Loop iteration start - Frame " + std::to_string(frameCount));
+            Profiler::BeginFrame();
+            double frameStartMs = Profiler::NowMs();
             glfwPollEvents();
             
                     // Debug: Check if window should close
@@ -507,6 +520,7 @@ void Editor::Run() {
         
         // Update performance metrics
         m_renderer->UpdatePerformanceMetrics(deltaTime);
+        m_renderer->SetCpuSimTime(Profiler::NowMs() - frameStartMs);
         
         
         
@@ -534,6 +548,7 @@ void Editor::Run() {
         
         // Render the frame (minimal version)
         NOVA_INFO("Editor::Run: About to call RenderFrame");
+        double renderStartMs = Profiler::NowMs();
         try {
             if (m_renderer) {
                 NOVA_INFO("Editor::Run: Calling RenderFrame...");
@@ -550,6 +565,9 @@ void Editor::Run() {
             NOVA_ERROR("Unknown error in RenderFrame");
             // Continue running instead of breaking
         }
+        Profiler::AddEvent("RenderFrame", "cpu", renderStartMs - frameStartMs, Profiler::NowMs() - renderStartMs);
+        MemoryTracker::EndFrame();
+        Profiler::EndFrame();
         
         // Small delay to prevent excessive CPU usage
         std::this_thread::sleep_for(std::chrono::milliseconds(16)); // ~60 FPS
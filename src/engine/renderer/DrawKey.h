@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include "assets/Material.h"
+
+namespace nova {
+
+// Coarsest sort level of the frame's draw list
+enum class DrawPass : uint8_t {
+    Opaque = 0,
+    Masked = 1,         // After opaque, so discards happen behind already-written depth
+    Translucent = 2,    // Translucent and additive, last and back to front
+};
+
+inline DrawPass DrawPassFor(MaterialBlendMode mode) {
+    switch (mode) {
+        case MaterialBlendMode::Masked: return DrawPass::Masked;
+        case MaterialBlendMode::Translucent:
+        case MaterialBlendMode::Additive: return DrawPass::Translucent;
+        default: return DrawPass::Opaque;
+    }
+}
+
+// View depth in 16 bits. The bits of a positive float grow with its value, so
+// the top 16 (sign excluded) order depths with ~0.4% relative precision
+// without needing the far plane.
+inline uint16_t QuantizeDepth(float viewDepth) {
+    if (!(viewDepth > 0.0f)) return 0;
+    uint32_t bits = 0;
+    std::memcpy(&bits, &viewDepth, sizeof(bits));
+    return static_cast<uint16_t>(bits >> 15);
+}
+
+// Packed sort key, ascending order = draw order:
+//   opaque, masked: pass:4 | pipeline:12 | material:16 | mesh:16 | depth:16   (state first, front to back)
+//   translucent:    pass:4 | ~depth:16 | pipeline:12 | material:16 | mesh:16  (back to front first)
+// Ids are truncated to their field; a collision only costs a redundant bind.
+inline uint64_t MakeDrawKey(DrawPass pass, uint32_t pipeline, uint32_t material, uint32_t mesh, uint16_t depth) {
+    uint64_t key = uint64_t(pass) << 60;
+    uint64_t state = (uint64_t(pipeline & 0xFFF) << 32) | (uint64_t(material & 0xFFFF) << 16) | uint64_t(mesh & 0xFFFF);
+    if (pass == DrawPass::Translucent) {
+        return key | (uint64_t(uint16_t(~depth)) << 44) | state;
+    }
+    return key | (state << 16) | depth;
+}
+
+} // namespace nova
@@ -1,16 +1,115 @@
 #pragma once
 #include <glm/glm.hpp>
 #include <string>
+#include <cstdint>
+#include <vector>
+#include "core/FrameStats.h"
+#include "assets/Material.h"
 namespace nova {
-struct RenderStats { float frameTimeMs=0; };
-class IRenderer {
+struct GpuPassTiming { std::string name; float ms=0; };
+// Per-frame renderer work counters, latched at the end of each frame
+struct RenderCounters {
+    uint32_t drawCalls=0;
+    uint32_t instances=0;
+    uint64_t triangles=0;
+    uint32_t pipelineBinds=0;
+    uint32_t descriptorBinds=0;
+    uint32_t vertexBufferBinds=0;
+    uint32_t pushConstantUpdates=0;
+    uint32_t prepassDraws=0;           // Depth-only draws before the main pass
+    uint32_t pipelineBarriers=0;       // vkCmdPipelineBarrier calls from the render graph
+    uint32_t secondaryCommandBuffers=0; // Executed by the main pass
+    uint32_t sortedDraws=0;            // Draw-list entries sorted by DrawKey
+    uint32_t stateChangesUnsorted=0;   // Pipeline + material + mesh switches in submission order
+    uint32_t stateChangesSorted=0;     // The same after sorting
+    uint32_t sceneObjects=0;           // GPU-driven scene objects submitted for culling
+    uint32_t visibleObjects=0;         // Of those, passed the frustum test
+    uint32_t occludedObjects=0;        // In the frustum but hidden by the depth pyramid
+    uint64_t bufferBytesUploaded=0;
+    uint64_t textureBytesUploaded=0;
+    uint32_t stagingAllocations=0;
+    uint32_t deviceAllocations=0;      // vkAllocateMemory calls
+    uint64_t deviceBytesAllocated=0;
+};
+struct RenderStats {
+    float frameTimeMs=0;
+    float gpuFrameMs=0;                 // First-to-last GPU timestamp span
+    std::vector<GpuPassTiming> gpuPasses; // Lags the CPU by the frames-in-flight count
+    FramePhaseTimes phases;             // Last completed frame
+    float p50Ms=0, p95Ms=0, p99Ms=0, maxMs=0; // Rolling frame-time percentiles
+    uint64_t hitchCount=0;
+    RenderCounters counters;            // Last completed frame
+};
+// A rendered frame copied back to the CPU: tightly packed RGBA8 rows, top row first
+struct FrameReadback {
+    uint64_t frameNumber=0;
+    uint32_t width=0, height=0;
+    std::vector<uint8_t> pixels;
+};
+// Geometry registered in a renderer's shared vertex/index pool
+struct MeshHandle {
+    uint32_t id=UINT32_MAX;
+    bool IsValid() const { return id!=UINT32_MAX; }
+};
+// Placement of a registered mesh inside the pool; maps 1:1 onto an indexed draw
+struct MeshRange {
+    uint32_t firstIndex=0;
+    uint32_t indexCount=0;
+    int32_t vertexOffset=0;
+    uint32_t vertexCount=0;
+};
+// Level 0 is the mesh itself; the rest are coarser index lists
+constexpr uint32_t MAX_MESH_LODS = 8;
+// A coarser index list over the same vertices as its mesh. `error` is how far,
+// in mesh units, it may stray from the full-detail surface; it grows with
+// each level.
+struct MeshLod {
+    std::vector<uint32_t> indices;
+    float error=0;
+};
+// Placement of one level of detail inside the index pool
+struct MeshLodRange {
+    uint32_t firstIndex=0;
+    uint32_t indexCount=0;
+    float error=0;
+};
+// Vertex data is the interleaved position/normal/uv layout (8 floats per vertex);
+// indices are local to the mesh. `lods` are the mesh's coarser levels in
+// order, at most MAX_MESH_LODS - 1; backends draw whichever the projected
+// error allows.
+class IGeometryRegistry {
+public:
+    virtual ~IGeometryRegistry() = default;
+    virtual MeshHandle RegisterMesh(const std::vector<float>& vertexData, const std::vector<uint32_t>& indices,
+                                    const std::vector<MeshLod>& lods = {}) = 0;
+    virtual void ReleaseMesh(MeshHandle mesh) = 0;
+};
+// Frame-based front end. Draws are queued, not issued: the frame's draw list
+// is sorted by DrawKey (pass, pipeline, material, mesh, depth) and runs of the
+// same mesh and material are instanced, so submission order does not matter.
+class IRenderer : public IGeometryRegistry {
 public:
     virtual ~IRenderer() = default;
     virtual bool Init(void* glfwWindowHandle) = 0;
+    // Instead of Init: no window, surface or swapchain; frames render into
+    // offscreen images (benchmarks, golden-image tests, thumbnails)
+    virtual bool InitHeadless(uint32_t width, uint32_t height) = 0;
+    virtual bool IsHeadless() const = 0;
     virtual void Resize(int w,int h) = 0;
+    // 0 is the default material
+    virtual uint32_t CreateMaterial(const MaterialParams& params, MaterialShadingModel shadingModel) = 0;
     virtual void BeginFrame(const glm::mat4& viewProj) = 0;
-    virtual void DrawCube(const glm::mat4& model, const glm::vec3& baseColor, float metallic, float roughness) = 0;
+    virtual void Submit(MeshHandle mesh, uint32_t material, const glm::mat4& model) = 0;
+    // One draw of `mesh` per instance transform, queued for this frame only
+    virtual void DrawMesh(MeshHandle mesh, const std::vector<glm::mat4>& instances, uint32_t material) = 0;
+    // Positions and colors pair up by index
+    virtual void SetLights(const std::vector<glm::vec4>& positions, const std::vector<glm::vec4>& colors) = 0;
     virtual void EndFrame() = 0;
     virtual RenderStats Stats() const = 0;
+    // Copy the next headless frame back to the CPU. Never stalls: the copy is
+    // returned by PollReadback once the GPU has finished that frame, and a
+    // request made while every readback slot is still unpolled is dropped.
+    virtual void RequestReadback() = 0;
+    virtual bool PollReadback(FrameReadback& out) = 0;
 };
 }
@@ -0,0 +1,250 @@
+#include "NullRenderer.h"
+#include "core/Log.h"
+#include "core/Profiler.h"
+#include <algorithm>
+#include <string>
+
+namespace nova {
+
+namespace {
+// Everything that selects a pipeline in the Vulkan backend, one value per variant
+uint32_t PackPipelineState(MaterialShadingModel shadingModel, MaterialBlendMode blendMode, bool doubleSided) {
+    return uint32_t(shadingModel) | (uint32_t(blendMode) << 8) | (uint32_t(doubleSided) << 16);
+}
+} // namespace
+
+bool NullRenderer::Init(void* glfwWindowHandle) {
+    return Start(glfwWindowHandle, 0, 0);
+}
+
+bool NullRenderer::InitHeadless(uint32_t width, uint32_t height) {
+    return Start(nullptr, width, height);
+}
+
+bool NullRenderer::Start(void* windowHandle, uint32_t width, uint32_t height) {
+    m_windowHandle = windowHandle;
+    m_width = width;
+    m_height = height;
+    m_materials = {MaterialEntry{}};
+    m_pipelineVariants = {PackPipelineState(MaterialShadingModel::PBR, MaterialBlendMode::Opaque, false)};
+    m_stats = {};
+    m_stats.materials = 1;
+    m_initialized = true;
+    NOVA_INFO("Null renderer initialized: CPU bookkeeping only, nothing is rendered");
+    return true;
+}
+
+void NullRenderer::Resize(int w, int h) {
+    if (!Check(w >= 0 && h >= 0, "Resize: negative size")) return;
+    m_width = static_cast<uint32_t>(w);
+    m_height = static_cast<uint32_t>(h);
+}
+
+bool NullRenderer::Check(bool ok, const char* message) {
+    if (ok) return true;
+    if (m_stats.validationErrors++ < MAX_LOGGED_ERRORS) {
+        NOVA_ERROR(std::string("NullRenderer: ") + message);
+    }
+    return false;
+}
+
+bool NullRenderer::IsLiveMesh(MeshHandle mesh) const {
+    return mesh.IsValid() && mesh.id < m_meshes.size() && m_meshes[mesh.id].live;
+}
+
+MeshHandle NullRenderer::RegisterMesh(const std::vector<float>& vertexData, const std::vector<uint32_t>& indices,
+                                      const std::vector<MeshLod>& lods) {
+    MeshHandle handle;
+    if (!Check(m_initialized, "RegisterMesh before Init")) return handle;
+    if (!Check(!vertexData.empty() && vertexData.size() % VERTEX_FLOATS == 0,
+               "RegisterMesh: vertex data is not a whole number of 8-float vertices")) return handle;
+    if (!Check(!indices.empty() && indices.size() % 3 == 0, "RegisterMesh: index count is not a multiple of 3")) return handle;
+    uint32_t vertexCount = static_cast<uint32_t>(vertexData.size() / VERTEX_FLOATS);
+    uint32_t maxIndex = *std::max_element(indices.begin(), indices.end());
+    if (!Check(maxIndex < vertexCount, "RegisterMesh: index past the last vertex")) return handle;
+    if (!Check(lods.size() < MAX_MESH_LODS, "RegisterMesh: more LODs than MAX_MESH_LODS")) return handle;
+    uint32_t lodIndexCount = 0;
+    for (const MeshLod& lod : lods) {
+        if (!Check(!lod.indices.empty() && lod.indices.size() % 3 == 0, "RegisterMesh: LOD index count is not a multiple of 3")) return handle;
+        if (!Check(*std::max_element(lod.indices.begin(), lod.indices.end()) < vertexCount,
+                   "RegisterMesh: LOD index past the last vertex")) return handle;
+        lodIndexCount += static_cast<uint32_t>(lod.indices.size());
+    }
+
+    if (!m_freeMeshIds.empty()) {
+        handle.id = m_freeMeshIds.back();
+        m_freeMeshIds.pop_back();
+    } else {
+        handle.id = static_cast<uint32_t>(m_meshes.size());
+        m_meshes.emplace_back();
+    }
+    // Placement as a pool would hand it out, for the counters only
+    MeshEntry& entry = m_meshes[handle.id];
+    entry.range.firstIndex = m_nextIndex;
+    entry.range.indexCount = static_cast<uint32_t>(indices.size());
+    entry.range.vertexOffset = static_cast<int32_t>(m_nextVertex);
+    entry.range.vertexCount = vertexCount;
+    entry.lodIndexCount = lodIndexCount;
+    entry.live = true;
+    m_nextIndex += entry.range.indexCount + lodIndexCount;
+    m_nextVertex += vertexCount;
+    m_stats.liveMeshes++;
+    uint64_t vertexBytes = uint64_t(vertexCount) * (VERTEX_FLOATS + POSITION_FLOATS) * sizeof(float);
+    m_stats.vertexBytes += vertexBytes;
+    uint64_t indexBytes = (uint64_t(indices.size()) + lodIndexCount) * sizeof(uint32_t);
+    m_stats.indexBytes += indexBytes;
+    m_counters.bufferBytesUploaded += vertexBytes + indexBytes;
+    return handle;
+}
+
+void NullRenderer::ReleaseMesh(MeshHandle mesh) {
+    if (!Check(IsLiveMesh(mesh), "ReleaseMesh: unknown or already released mesh")) return;
+    MeshEntry& entry = m_meshes[mesh.id];
+    m_stats.liveMeshes--;
+    m_stats.vertexBytes -= uint64_t(entry.range.vertexCount) * (VERTEX_FLOATS + POSITION_FLOATS) * sizeof(float);
+    m_stats.indexBytes -= (uint64_t(entry.range.indexCount) + entry.lodIndexCount) * sizeof(uint32_t);
+    entry = MeshEntry{};
+    // Nothing is in flight, so the id can be reused at once
+    m_freeMeshIds.push_back(mesh.id);
+}
+
+uint32_t NullRenderer::CreateMaterial(const MaterialParams& params, MaterialShadingModel shadingModel) {
+    if (!Check(m_initialized, "CreateMaterial before Init")) return 0;
+    MaterialEntry entry;
+    entry.pass = DrawPassFor(params.blendMode);
+    uint32_t state = PackPipelineState(shadingModel, params.blendMode, params.doubleSided);
+    auto variant = std::find(m_pipelineVariants.begin(), m_pipelineVariants.end(), state);
+    entry.pipelineId = static_cast<uint16_t>(variant - m_pipelineVariants.begin());
+    if (variant == m_pipelineVariants.end()) m_pipelineVariants.push_back(state);
+    m_materials.push_back(entry);
+    m_stats.materials = static_cast<uint32_t>(m_materials.size());
+    return static_cast<uint32_t>(m_materials.size() - 1);
+}
+
+void NullRenderer::SetLights(const std::vector<glm::vec4>& positions, const std::vector<glm::vec4>& colors) {
+    if (!Check(positions.size() == colors.size(), "SetLights: position and color counts differ")) return;
+    Check(positions.size() <= MAX_LIGHTS, "SetLights: lights past MAX_LIGHTS are ignored");
+    size_t count = std::min<size_t>(positions.size(), MAX_LIGHTS);
+    m_lightPositions.assign(positions.begin(), positions.begin() + count);
+    m_lightColors.assign(colors.begin(), colors.begin() + count);
+    m_stats.lights = static_cast<uint32_t>(count);
+}
+
+void NullRenderer::BeginFrame(const glm::mat4& viewProj) {
+    if (!Check(m_initialized, "BeginFrame before Init")) return;
+    if (!Check(!m_inFrame, "BeginFrame without EndFrame")) return;
+    double now = Profiler::NowMs();
+    // Frame time spans BeginFrame to BeginFrame, like a real frame loop
+    if (m_frameNumber > 0) {
+        m_lastFrameMs = static_cast<float>(now - m_frameStartMs);
+        FrameSample sample;
+        sample.frameIndex = m_frameNumber - 1;
+        sample.frameMs = m_lastFrameMs;
+        sample.phases.cpuRecordMs = m_lastRecordMs;
+        m_frameStats.AddFrame(sample);
+    }
+    m_frameStartMs = now;
+    m_viewProj = viewProj;
+    m_instances.clear();
+    m_draws.clear();
+    m_inFrame = true;
+}
+
+void NullRenderer::Submit(MeshHandle mesh, uint32_t material, const glm::mat4& model) {
+    if (!Check(m_inFrame, "Submit outside BeginFrame/EndFrame")) return;
+    if (!Check(IsLiveMesh(mesh), "Submit: unknown or released mesh")) return;
+    if (!Check(material < m_materials.size(), "Submit: unknown material")) return;
+    m_draws.push_back(Draw{mesh, material, static_cast<uint32_t>(m_instances.size()), 1, true});
+    m_instances.push_back(model);
+}
+
+void NullRenderer::DrawMesh(MeshHandle mesh, const std::vector<glm::mat4>& instances, uint32_t material) {
+    if (!Check(m_inFrame, "DrawMesh outside BeginFrame/EndFrame")) return;
+    if (!Check(IsLiveMesh(mesh), "DrawMesh: unknown or released mesh")) return;
+    if (!Check(material < m_materials.size(), "DrawMesh: unknown material")) return;
+    if (instances.empty()) return;
+    m_draws.push_back(Draw{mesh, material, static_cast<uint32_t>(m_instances.size()), static_cast<uint32_t>(instances.size()), false});
+    m_instances.insert(m_instances.end(), instances.begin(), instances.end());
+}
+
+// The CPU half of VulkanRenderer::BuildDrawItems and RecordDraws: sort keys,
+// state changes, and the instanced runs that would become draw calls
+void NullRenderer::EndFrame() {
+    if (!Check(m_inFrame, "EndFrame without BeginFrame")) return;
+    double startMs = Profiler::NowMs();
+
+    auto viewDepth = [&](const glm::vec3& p) {
+        return m_viewProj[0][3] * p.x + m_viewProj[1][3] * p.y + m_viewProj[2][3] * p.z + m_viewProj[3][3];
+    };
+    const size_t drawCount = m_draws.size();
+    m_sortEntries.resize(drawCount);
+    for (size_t i = 0; i < drawCount; ++i) {
+        const Draw& draw = m_draws[i];
+        const MaterialEntry& material = m_materials[draw.material];
+        uint16_t depth = draw.single ? QuantizeDepth(viewDepth(glm::vec3(m_instances[draw.firstInstance][3]))) : 0;
+        m_sortEntries[i].key = MakeDrawKey(material.pass, material.pipelineId, draw.material, draw.mesh.id, depth);
+        m_sortEntries[i].index = static_cast<uint32_t>(i);
+    }
+
+    auto stateChanges = [&]() {
+        uint32_t changes = 0;
+        for (size_t i = 1; i < drawCount; ++i) {
+            const Draw& a = m_draws[m_sortEntries[i - 1].index];
+            const Draw& b = m_draws[m_sortEntries[i].index];
+            changes += m_materials[a.material].pipelineId != m_materials[b.material].pipelineId;
+            changes += a.material != b.material;
+            changes += a.mesh.id != b.mesh.id;
+        }
+        return changes;
+    };
+    m_counters.stateChangesUnsorted = stateChanges();
+    if (m_sortDraws) {
+        RadixSort(m_sortEntries, m_sortScratch);
+        m_counters.sortedDraws = static_cast<uint32_t>(drawCount);
+        m_counters.stateChangesSorted = stateChanges();
+    } else {
+        m_counters.stateChangesSorted = m_counters.stateChangesUnsorted;
+    }
+
+    // Consecutive single objects of one mesh and material share a draw; their
+    // transforms are what a GPU backend would upload
+    const Draw* previous = nullptr;
+    bool extendable = false;
+    for (const SortEntry& entry : m_sortEntries) {
+        const Draw& draw = m_draws[entry.index];
+        const MeshRange& range = m_meshes[draw.mesh.id].range;
+        bool merge = draw.single && extendable && previous->mesh.id == draw.mesh.id && previous->material == draw.material;
+        if (!merge) {
+            m_counters.drawCalls++;
+            if (!previous || m_materials[previous->material].pipelineId != m_materials[draw.material].pipelineId) {
+                m_counters.pipelineBinds++;
+            }
+        }
+        m_counters.instances += draw.count;
+        m_counters.triangles += uint64_t(range.indexCount / 3) * draw.count;
+        extendable = draw.single;
+        previous = &draw;
+    }
+    m_counters.bufferBytesUploaded += uint64_t(m_instances.size()) * sizeof(glm::mat4);
+
+    m_lastRecordMs = static_cast<float>(Profiler::NowMs() - startMs);
+    m_lastCounters = m_counters;
+    m_counters = RenderCounters{};
+    m_inFrame = false;
+    m_frameNumber++;
+}
+
+RenderStats NullRenderer::Stats() const {
+    RenderStats stats;
+    stats.frameTimeMs = m_lastFrameMs;
+    if (const FrameSample* latest = m_frameStats.Latest()) stats.phases = latest->phases;
+    stats.p50Ms = m_frameStats.P50();
+    stats.p95Ms = m_frameStats.P95();
+    stats.p99Ms = m_frameStats.P99();
+    stats.maxMs = m_frameStats.Max();
+    stats.hitchCount = m_frameStats.HitchCount();
+    stats.counters = m_lastCounters;
+    return stats;
+}
+
+} // namespace nova
@@ -0,0 +1,116 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <cstdint>
+#include <vector>
+#include "renderer/IRenderer.h"
+#include "renderer/DrawKey.h"
+#include "core/FrameStats.h"
+#include "core/RadixSort.h"
+
+namespace nova {
+
+struct NullRendererStats {
+    uint32_t liveMeshes = 0;
+    uint64_t vertexBytes = 0;        // What a GPU backend would hold for the live meshes
+    uint64_t indexBytes = 0;
+    uint32_t materials = 0;
+    uint32_t lights = 0;
+    uint64_t validationErrors = 0;   // Calls rejected since Init
+};
+
+// IRenderer without a GPU. It does the CPU side of a frame the way the Vulkan
+// backend does (mesh registry, materials, per-frame instance data, DrawKey
+// sort, instanced runs, counters) and validates every call, but records and
+// submits nothing, so front-end cost can be measured and profiled on machines
+// without a Vulkan driver. Invalid calls are logged, counted and ignored.
+class NullRenderer : public IRenderer {
+public:
+    bool Init(void* glfwWindowHandle) override;
+    bool InitHeadless(uint32_t width, uint32_t height) override;
+    bool IsHeadless() const override { return m_windowHandle == nullptr; }
+    void Resize(int w, int h) override;
+
+    MeshHandle RegisterMesh(const std::vector<float>& vertexData, const std::vector<uint32_t>& indices,
+                            const std::vector<MeshLod>& lods = {}) override;
+    void ReleaseMesh(MeshHandle mesh) override;
+    uint32_t CreateMaterial(const MaterialParams& params, MaterialShadingModel shadingModel) override;
+    void SetLights(const std::vector<glm::vec4>& positions, const std::vector<glm::vec4>& colors) override;
+
+    void BeginFrame(const glm::mat4& viewProj) override;
+    void Submit(MeshHandle mesh, uint32_t material, const glm::mat4& model) override;
+    void DrawMesh(MeshHandle mesh, const std::vector<glm::mat4>& instances, uint32_t material) override;
+    void EndFrame() override;
+    RenderStats Stats() const override;
+
+    // Nothing is rendered, so there is never a frame to read back
+    void RequestReadback() override {}
+    bool PollReadback(FrameReadback&) override { return false; }
+
+    // Same switch as VulkanRenderer::SetDrawSorting
+    void SetDrawSorting(bool enabled) { m_sortDraws = enabled; }
+    const NullRendererStats& GetNullStats() const { return m_stats; }
+    FrameStats& GetFrameStats() { return m_frameStats; }
+
+private:
+    static constexpr uint32_t VERTEX_FLOATS = 8;       // Interleaved position/normal/uv
+    static constexpr uint32_t POSITION_FLOATS = 3;     // The Vulkan pool's position-only copy
+    static constexpr uint32_t MAX_LIGHTS = 4096;       // LightClusters::MAX_LIGHTS
+    static constexpr uint64_t MAX_LOGGED_ERRORS = 16;  // Further errors are only counted
+
+    bool Start(void* windowHandle, uint32_t width, uint32_t height);
+    // Logs and counts `message` unless `ok`; returns `ok`
+    bool Check(bool ok, const char* message);
+    bool IsLiveMesh(MeshHandle mesh) const;
+
+    struct MeshEntry {
+        MeshRange range;
+        uint32_t lodIndexCount = 0;    // Indices of the coarser levels, held but never drawn
+        bool live = false;
+    };
+    struct MaterialEntry {
+        DrawPass pass = DrawPass::Opaque;
+        uint16_t pipelineId = 0;
+    };
+    // A queued draw: `count` instances starting at `firstInstance` in m_instances
+    struct Draw {
+        MeshHandle mesh;
+        uint32_t material = 0;
+        uint32_t firstInstance = 0;
+        uint32_t count = 0;
+        bool single = false;           // From Submit; sorted by depth and merged into runs
+    };
+
+    void* m_windowHandle = nullptr;
+    uint32_t m_width = 0;
+    uint32_t m_height = 0;
+    bool m_initialized = false;
+
+    std::vector<MeshEntry> m_meshes;
+    std::vector<uint32_t> m_freeMeshIds;
+    uint32_t m_nextVertex = 0;
+    uint32_t m_nextIndex = 0;
+    std::vector<MaterialEntry> m_materials = {MaterialEntry{}};
+    std::vector<uint32_t> m_pipelineVariants;          // Packed pipeline state in first-use order
+    std::vector<glm::vec4> m_lightPositions;
+    std::vector<glm::vec4> m_lightColors;
+
+    // The frame being built
+    bool m_inFrame = false;
+    glm::mat4 m_viewProj{1.0f};
+    std::vector<glm::mat4> m_instances;
+    std::vector<Draw> m_draws;
+    std::vector<SortEntry> m_sortEntries;
+    std::vector<SortEntry> m_sortScratch;
+    bool m_sortDraws = true;
+
+    NullRendererStats m_stats;
+    RenderCounters m_counters;
+    RenderCounters m_lastCounters;
+    FrameStats m_frameStats;
+    double m_frameStartMs = 0.0;
+    float m_lastFrameMs = 0.0f;
+    float m_lastRecordMs = 0.0f;
+    uint64_t m_frameNumber = 0;
+};
+
+} // namespace nova
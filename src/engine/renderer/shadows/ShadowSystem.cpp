@@ -14,9 +14,11 @@ ShadowSystem::~ShadowSystem() {
     Shutdown();
 }
 
-void ShadowSystem::Initialize(VkDevice device, VkPhysicalDevice physicalDevice) {
+void ShadowSystem::Initialize(VkDevice device, VkPhysicalDevice physicalDevice, GpuAllocator* allocator, PipelineCache* pipelines) {
     m_device = device;
     m_physicalDevice = physicalDevice;
+    m_allocator = allocator;
+    m_pipelines = pipelines;
     
     NOVA_INFO("Initializing Shadow System...");
     
@@ -117,18 +119,7 @@ void ShadowSystem::CreateShadowMaps() {
         
         // Allocate memory
         NOVA_INFO("CreateShadowMaps: Allocating memory for 2D shadow map...");
-        VkMemoryRequirements memRequirements;
-        vkGetImageMemoryRequirements(m_device, m_shadowMap2D, &memRequirements);
-        
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = FindMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-        
-        NOVA_INFO("CreateShadowMaps: About to allocate memory for 2D shadow map...");
-        VK_CHECK(vkAllocateMemory(m_device, &allocInfo, nullptr, &m_shadowMap2DMemory));
-        NOVA_INFO("CreateShadowMaps: Memory allocated, binding to image...");
-        vkBindImageMemory(m_device, m_shadowMap2D, m_shadowMap2DMemory, 0);
+        VK_CHECK(m_allocator->AllocateForImage(m_shadowMap2D, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_shadowMap2DAlloc));
         NOVA_INFO("CreateShadowMaps: Memory bound to 2D shadow map image");
         
         NOVA_INFO("CreateShadowMaps: Creating 2D array view...");
@@ -193,16 +184,7 @@ void ShadowSystem::CreateShadowMaps() {
         NOVA_INFO("CreateShadowMaps: Cubemap shadow map image created successfully");
         
         // Allocate memory
-        VkMemoryRequirements memRequirements;
-        vkGetImageMemoryRequirements(m_device, m_shadowMapCube, &memRequirements);
-        
-        VkMemoryAllocateInfo allocInfo{};
-        allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        allocInfo.allocationSize = memRequirements.size;
-        allocInfo.memoryTypeIndex = FindMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-        
-        VK_CHECK(vkAllocateMemory(m_device, &allocInfo, nullptr, &m_shadowMapCubeMemory));
-        vkBindImageMemory(m_device, m_shadowMapCube, m_shadowMapCubeMemory, 0);
+        VK_CHECK(m_allocator->AllocateForImage(m_shadowMapCube, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_shadowMapCubeAlloc));
         
         // Create cubemap array view (using 2D array for now)
         NOVA_INFO("CreateShadowMaps: Creating cubemap array view...");
@@ -242,9 +224,8 @@ void ShadowSystem::CreateShadowMaps() {
     // Create framebuffers
     CreateShadowFramebuffers();
     
-    // Transition images to the correct layout for sampling
-    NOVA_INFO("CreateShadowMaps: Transitioning images to correct layout...");
-    TransitionImagesToReadOnly();
+    // New images start out undefined; the render graph transitions them on first use
+    m_shadowMap2DState = RGImageState{};
     
     NOVA_INFO("Shadow maps created successfully");
 }
@@ -292,25 +273,11 @@ void ShadowSystem::DestroyShadowMaps() {
     }
     
     // Destroy images and memory
-    if (m_shadowMap2D != VK_NULL_HANDLE) {
-        vkDestroyImage(m_device, m_shadowMap2D, nullptr);
-        m_shadowMap2D = VK_NULL_HANDLE;
-    }
-    
-    if (m_shadowMap2DMemory != VK_NULL_HANDLE) {
-        vkFreeMemory(m_device, m_shadowMap2DMemory, nullptr);
-        m_shadowMap2DMemory = VK_NULL_HANDLE;
-    }
-    
-    if (m_shadowMapCube != VK_NULL_HANDLE) {
-        vkDestroyImage(m_device, m_shadowMapCube, nullptr);
-        m_shadowMapCube = VK_NULL_HANDLE;
-    }
-    
-    if (m_shadowMapCubeMemory != VK_NULL_HANDLE) {
-        vkFreeMemory(m_device, m_shadowMapCubeMemory, nullptr);
-        m_shadowMapCubeMemory = VK_NULL_HANDLE;
+    if (m_allocator) {
+        m_allocator->DestroyImage(m_shadowMap2D, m_shadowMap2DAlloc);
+        m_allocator->DestroyImage(m_shadowMapCube, m_shadowMapCubeAlloc);
     }
+    m_shadowMap2DState = RGImageState{};
 }
 
 void ShadowSystem::CreateShadowFramebuffers() {
@@ -355,8 +322,9 @@ void ShadowSystem::CreateShadowRenderPasses() {
         depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
         depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-        depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-        depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+        // The render graph transitions the map before and after the pass
+        depthAttachment.initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
         
         VkAttachmentReference depthAttachmentRef{};
         depthAttachmentRef.attachment = 0;
@@ -367,22 +335,12 @@ void ShadowSystem::CreateShadowRenderPasses() {
         subpass.colorAttachmentCount = 0;
         subpass.pDepthStencilAttachment = &depthAttachmentRef;
         
-        VkSubpassDependency dependency{};
-        dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-        dependency.dstSubpass = 0;
-        dependency.srcStageMask = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-        dependency.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
-        dependency.dstStageMask = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
-        dependency.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
-        
         VkRenderPassCreateInfo renderPassInfo{};
         renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
         renderPassInfo.attachmentCount = 1;
         renderPassInfo.pAttachments = &depthAttachment;
         renderPassInfo.subpassCount = 1;
         renderPassInfo.pSubpasses = &subpass;
-        renderPassInfo.dependencyCount = 1;
-        renderPassInfo.pDependencies = &dependency;
         
         VK_CHECK(vkCreateRenderPass(m_device, &renderPassInfo, nullptr, &m_shadowRenderPass2D));
     }
@@ -392,31 +350,29 @@ void ShadowSystem::CreateShadowRenderPasses() {
 }
 
 void ShadowSystem::CreateShadowPipelines() {
-    // Load shadow vertex shader
-    auto vertShader = vkutil::LoadShader(m_device, "assets/shaders/shadow.vert.spv");
-    if (vertShader.module == VK_NULL_HANDLE) {
+    // Load shadow shaders (modules are owned by the pipeline cache)
+    VkShaderModule vertShader = m_pipelines->GetShaderModule("assets/shaders/shadow.vert.spv");
+    if (vertShader == VK_NULL_HANDLE) {
         NOVA_INFO("Failed to load shadow vertex shader!");
         return;
     }
     
-    // Load shadow fragment shader
-    auto fragShader = vkutil::LoadShader(m_device, "assets/shaders/shadow.frag.spv");
-    if (fragShader.module == VK_NULL_HANDLE) {
+    VkShaderModule fragShader = m_pipelines->GetShaderModule("assets/shaders/shadow.frag.spv");
+    if (fragShader == VK_NULL_HANDLE) {
         NOVA_INFO("Failed to load shadow fragment shader!");
-        vkDestroyShaderModule(m_device, vertShader.module, nullptr);
         return;
     }
     
     VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
     vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-    vertShaderStageInfo.module = vertShader.module;
+    vertShaderStageInfo.module = vertShader;
     vertShaderStageInfo.pName = "main";
     
     VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
     fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
     fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    fragShaderStageInfo.module = fragShader.module;
+    fragShaderStageInfo.module = fragShader;
     fragShaderStageInfo.pName = "main";
     
     VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
@@ -514,14 +470,10 @@ void ShadowSystem::CreateShadowPipelines() {
     pipelineInfo.renderPass = m_shadowRenderPass2D;
     pipelineInfo.subpass = 0;
     
-    VK_CHECK(vkCreateGraphicsPipelines(m_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_shadowPipeline2D));
+    VK_CHECK(m_pipelines->CreateGraphicsPipeline(pipelineInfo, &m_shadowPipeline2D));
     
     // Create cubemap shadow pipeline (same as 2D for now)
     m_shadowPipelineCube = m_shadowPipeline2D;
-    
-    // Cleanup shader modules
-    vkDestroyShaderModule(m_device, fragShader.module, nullptr);
-    vkDestroyShaderModule(m_device, vertShader.module, nullptr);
 }
 
 void ShadowSystem::CreateShadowSampler() {
@@ -616,26 +568,22 @@ void ShadowSystem::RenderShadowMaps(VkCommandBuffer cmd, const std::vector<Shado
     NOVA_INFO("ShadowSystem::RenderShadowMaps: Placeholder implementation");
 }
 
-uint32_t ShadowSystem::FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
-    VkPhysicalDeviceMemoryProperties memProperties;
-    vkGetPhysicalDeviceMemoryProperties(m_physicalDevice, &memProperties);
-    
-    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-            return i;
-        }
-    }
-    
-    throw std::runtime_error("Failed to find suitable memory type!");
-}
-
-void ShadowSystem::TransitionImagesToReadOnly() {
-    NOVA_INFO("CreateShadowMaps: Transitioning images to DEPTH_STENCIL_READ_ONLY_OPTIMAL");
-    
-    // For now, we'll skip the transition and just log it
-    // The proper transition will be done in the main render loop
-    // This prevents the crash while we implement the full shadow system
-    NOVA_INFO("CreateShadowMaps: Skipping transition for now to prevent crash");
+RGResource ShadowSystem::AddShadowPass(RenderGraph& graph, const std::vector<ShadowLight>& lights, GpuProfiler* profiler) {
+    RGImageDesc desc;
+    desc.format = VK_FORMAT_D32_SFLOAT;
+    desc.extent = {SHADOW_MAP_SIZE, SHADOW_MAP_SIZE};
+    desc.layers = MAX_DIRECTIONAL_LIGHTS * CASCADE_COUNT + MAX_SPOT_LIGHTS;
+    RGResource shadowMap = graph.ImportImage("ShadowMap2D", m_shadowMap2D, m_shadowMap2DView, desc, &m_shadowMap2DState);
+    
+    // Every layer has its own framebuffer, so the pass begins its own render passes
+    graph.AddPass("Shadow", [this, lights, profiler](VkCommandBuffer cmd) {
+        if (profiler) profiler->BeginPass(cmd, "Shadow");
+        RenderShadowMaps(cmd, lights);
+        if (profiler) profiler->EndPass(cmd);
+    })
+        .Write(shadowMap, RGAccess::DepthAttachment)
+        .ExternalRenderPass();
+    return shadowMap;
 }
 
 } // namespace nova
@@ -4,6 +4,10 @@
 #include <glm/glm.hpp>
 #include <vector>
 #include <memory>
+#include "../vk/GpuAllocator.h"
+#include "../vk/RenderGraph.h"
+#include "../vk/PipelineCache.h"
+#include "../vk/GpuProfiler.h"
 
 namespace nova {
 
@@ -51,7 +55,7 @@ public:
     ~ShadowSystem();
     
     // Initialization
-    void Initialize(VkDevice device, VkPhysicalDevice physicalDevice);
+    void Initialize(VkDevice device, VkPhysicalDevice physicalDevice, GpuAllocator* allocator, PipelineCache* pipelines);
     void Shutdown();
     
     // Shadow map management
@@ -65,6 +69,11 @@ public:
     
     // Shadow rendering
     void RenderShadowMaps(VkCommandBuffer cmd, const std::vector<ShadowLight>& lights);
+    // Adds a "Shadow" pass writing the 2D shadow map array and returns it; passes
+    // that sample it must Read it as SampledFragment. Culled when nothing does.
+    // With a profiler the pass is timed as "Shadow".
+    RGResource AddShadowPass(RenderGraph& graph, const std::vector<ShadowLight>& lights, GpuProfiler* profiler = nullptr);
+    bool IsInitialized() const { return m_shadowMap2D != VK_NULL_HANDLE; }
     
     // Descriptor management
     VkDescriptorSetLayout GetShadowDescriptorSetLayout() const { return m_shadowDescriptorSetLayout; }
@@ -89,16 +98,19 @@ private:
     // Device
     VkDevice m_device = VK_NULL_HANDLE;
     VkPhysicalDevice m_physicalDevice = VK_NULL_HANDLE;
+    GpuAllocator* m_allocator = nullptr;
+    PipelineCache* m_pipelines = nullptr;
     
     // 2D Shadow maps (directional + spot lights)
     VkImage m_shadowMap2D = VK_NULL_HANDLE;
-    VkDeviceMemory m_shadowMap2DMemory = VK_NULL_HANDLE;
+    GpuAllocation m_shadowMap2DAlloc;
     VkImageView m_shadowMap2DView = VK_NULL_HANDLE;
     std::vector<VkImageView> m_shadowMap2DLayerViews;
+    RGImageState m_shadowMap2DState;   // Layout tracked by the render graph
     
     // Cubemap shadow maps (point lights)
     VkImage m_shadowMapCube = VK_NULL_HANDLE;
-    VkDeviceMemory m_shadowMapCubeMemory = VK_NULL_HANDLE;
+    GpuAllocation m_shadowMapCubeAlloc;
     VkImageView m_shadowMapCubeView = VK_NULL_HANDLE;
     std::vector<VkImageView> m_shadowMapCubeLayerViews;
     
@@ -130,7 +142,6 @@ private:
     void CreateShadowDescriptorSet();
     void CreateShadowSampler();
     void CreateShadowFramebuffers();
-    void TransitionImagesToReadOnly();
     
     void RenderDirectionalShadowMaps(VkCommandBuffer cmd, const ShadowLight& light);
     void RenderSpotShadowMaps(VkCommandBuffer cmd, const ShadowLight& light);
@@ -139,8 +150,6 @@ private:
     glm::mat4 CalculateCascadeMatrix(const ShadowLight& light, uint32_t cascadeIndex);
     glm::mat4 CalculateSpotLightMatrix(const ShadowLight& light);
     glm::mat4 CalculatePointLightMatrix(const ShadowLight& light, uint32_t face);
-    
-    uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
 };
 
 } // namespace nova
@@ -0,0 +1,324 @@
+#include "DepthPyramid.h"
+#include "VulkanHelpers.h"
+#include "core/Log.h"
+#include <algorithm>
+
+namespace nova {
+
+namespace {
+struct PyramidConstants {
+    uint32_t depthSize[2];
+    uint32_t size[2];        // Level 0
+    uint32_t levelCount;
+    uint32_t groupCount;
+};
+
+uint32_t FloorPowerOfTwo(uint32_t value) {
+    uint32_t power = 1;
+    while (power * 2 <= value) power *= 2;
+    return power;
+}
+}
+
+void DepthPyramid::Init(VkDevice device, GpuAllocator* allocator, PipelineCache* pipelines, FrameTimeline* frames,
+                        uint32_t framesInFlight, bool storageImageIndexing) {
+    m_dev = device;
+    m_allocator = allocator;
+    m_pipelines = pipelines;
+    m_frames = frames;
+    if (!storageImageIndexing) {
+        NOVA_WARN("DepthPyramid: shaderStorageImageArrayDynamicIndexing unsupported, occlusion culling unavailable");
+        return;
+    }
+
+    // Level 0 maps onto the depth buffer by proportion, so texels are fetched, never filtered
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+    VK_CHECK(vkCreateSampler(m_dev, &samplerInfo, nullptr, &m_sampler));
+
+    VkDescriptorSetLayoutBinding bindings[3]{};
+    bindings[0].binding = 0;
+    bindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[0].descriptorCount = 1;
+    bindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    bindings[1].binding = 1;
+    bindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    bindings[1].descriptorCount = MAX_LEVELS;
+    bindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    bindings[2].binding = 2;
+    bindings[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[2].descriptorCount = 1;
+    bindings[2].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 3;
+    layoutInfo.pBindings = bindings;
+    VK_CHECK(vkCreateDescriptorSetLayout(m_dev, &layoutInfo, nullptr, &m_setLayout));
+
+    uint32_t slots = std::max(1u, framesInFlight);
+    VkDescriptorPoolSize poolSizes[3]{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[0].descriptorCount = slots;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    poolSizes[1].descriptorCount = MAX_LEVELS * slots;
+    poolSizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[2].descriptorCount = slots;
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = slots;
+    poolInfo.poolSizeCount = 3;
+    poolInfo.pPoolSizes = poolSizes;
+    VK_CHECK(vkCreateDescriptorPool(m_dev, &poolInfo, nullptr, &m_descriptorPool));
+
+    std::vector<VkDescriptorSetLayout> layouts(slots, m_setLayout);
+    m_sets.resize(slots);
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.descriptorSetCount = slots;
+    allocInfo.pSetLayouts = layouts.data();
+    VK_CHECK(vkAllocateDescriptorSets(m_dev, &allocInfo, m_sets.data()));
+
+    VkResult result = m_allocator->CreateBuffer(sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_counter, m_counterAlloc);
+    if (result != VK_SUCCESS) {
+        NOVA_ERROR("DepthPyramid: failed to create the workgroup counter: " + std::to_string(result));
+        return;
+    }
+    if (CreatePipeline()) {
+        NOVA_INFO("DepthPyramid ready: single-pass Hi-Z downsampling");
+    }
+}
+
+void DepthPyramid::Shutdown() {
+    if (m_dev == VK_NULL_HANDLE) return;
+    if (m_image != VK_NULL_HANDLE) {
+        m_retired.push_back(Retired{ m_image, m_imageAlloc, m_levelViews, 0 });
+        m_retired.back().views.push_back(m_view);
+        m_image = VK_NULL_HANDLE;
+        m_view = VK_NULL_HANDLE;
+        m_levelViews.clear();
+    }
+    DestroyRetired(true);
+    m_allocator->DestroyBuffer(m_counter, m_counterAlloc);
+    if (m_pipeline != VK_NULL_HANDLE) vkDestroyPipeline(m_dev, m_pipeline, nullptr);
+    if (m_pipelineLayout != VK_NULL_HANDLE) vkDestroyPipelineLayout(m_dev, m_pipelineLayout, nullptr);
+    if (m_descriptorPool != VK_NULL_HANDLE) vkDestroyDescriptorPool(m_dev, m_descriptorPool, nullptr); // Frees the sets
+    if (m_setLayout != VK_NULL_HANDLE) vkDestroyDescriptorSetLayout(m_dev, m_setLayout, nullptr);
+    if (m_sampler != VK_NULL_HANDLE) vkDestroySampler(m_dev, m_sampler, nullptr);
+    m_pipeline = VK_NULL_HANDLE;
+    m_pipelineLayout = VK_NULL_HANDLE;
+    m_descriptorPool = VK_NULL_HANDLE;
+    m_setLayout = VK_NULL_HANDLE;
+    m_sampler = VK_NULL_HANDLE;
+    m_sets.clear();
+    m_depthExtent = {0, 0};
+    m_extent = {0, 0};
+    m_levels = 0;
+    m_dev = VK_NULL_HANDLE;
+}
+
+bool DepthPyramid::RecordBuild(VkCommandBuffer cmd, uint32_t slot, uint64_t frameNumber, VkImageView depthView,
+                               VkExtent2D depthExtent) {
+    DestroyRetired(false);
+    if (!Available() || slot >= m_sets.size() || depthView == VK_NULL_HANDLE) return false;
+    if (!EnsureImage(depthExtent, frameNumber)) return false;
+
+    // The slot's fence has been waited, so its set is idle; the depth view is
+    // a render graph transient and may have moved since the slot last ran
+    VkDescriptorImageInfo depthInfo{ m_sampler, depthView, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL };
+    VkDescriptorImageInfo levelInfos[MAX_LEVELS]{};
+    for (uint32_t i = 0; i < MAX_LEVELS; ++i) {
+        // Levels past the last are never written, but every element must be valid
+        levelInfos[i].imageView = m_levelViews[std::min(i, m_levels - 1)];
+        levelInfos[i].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+    }
+    VkDescriptorBufferInfo counterInfo{ m_counter, 0, VK_WHOLE_SIZE };
+    VkWriteDescriptorSet writes[3]{};
+    for (uint32_t i = 0; i < 3; ++i) {
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = m_sets[slot];
+        writes[i].dstBinding = i;
+    }
+    writes[0].descriptorCount = 1;
+    writes[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    writes[0].pImageInfo = &depthInfo;
+    writes[1].descriptorCount = MAX_LEVELS;
+    writes[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    writes[1].pImageInfo = levelInfos;
+    writes[2].descriptorCount = 1;
+    writes[2].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    writes[2].pBufferInfo = &counterInfo;
+    vkUpdateDescriptorSets(m_dev, 3, writes, 0, nullptr);
+
+    // The previous frame's culling may still be reading the pyramid and its
+    // build wrote the counter. Every level is rewritten, so the old contents
+    // are discarded.
+    VkMemoryBarrier counterBarrier{};
+    counterBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    counterBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    counterBarrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    VkImageMemoryBarrier imageBarrier{};
+    imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    imageBarrier.srcAccessMask = 0;
+    imageBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    imageBarrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageBarrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    imageBarrier.image = m_image;
+    imageBarrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, m_levels, 0, 1 };
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                         1, &counterBarrier, 0, nullptr, 1, &imageBarrier);
+
+    vkCmdFillBuffer(cmd, m_counter, 0, sizeof(uint32_t), 0);
+    VkMemoryBarrier clearBarrier{};
+    clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                         1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+    uint32_t groupsX = (m_extent.width + TILE_SIZE - 1) / TILE_SIZE;
+    uint32_t groupsY = (m_extent.height + TILE_SIZE - 1) / TILE_SIZE;
+    PyramidConstants constants{};
+    constants.depthSize[0] = depthExtent.width;
+    constants.depthSize[1] = depthExtent.height;
+    constants.size[0] = m_extent.width;
+    constants.size[1] = m_extent.height;
+    constants.levelCount = m_levels;
+    constants.groupCount = groupsX * groupsY;
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &m_sets[slot], 0, nullptr);
+    vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+    vkCmdDispatch(cmd, groupsX, groupsY, 1);
+
+    imageBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    imageBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    imageBarrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                         0, nullptr, 0, nullptr, 1, &imageBarrier);
+    return true;
+}
+
+bool DepthPyramid::EnsureImage(VkExtent2D depthExtent, uint64_t frameNumber) {
+    if (depthExtent.width == 0 || depthExtent.height == 0) return false;
+    if (m_image != VK_NULL_HANDLE && depthExtent.width == m_depthExtent.width && depthExtent.height == m_depthExtent.height) {
+        return true;
+    }
+
+    if (m_image != VK_NULL_HANDLE) {
+        Retired retired{ m_image, m_imageAlloc, std::move(m_levelViews), frameNumber };
+        retired.views.push_back(m_view);
+        m_retired.push_back(std::move(retired));
+        m_image = VK_NULL_HANDLE;
+        m_imageAlloc = GpuAllocation{};
+        m_view = VK_NULL_HANDLE;
+        m_levelViews.clear();
+    }
+    m_depthExtent = {0, 0};
+
+    // Larger depth buffers map several texels onto each level-0 texel
+    uint32_t maxSize = 1u << (MAX_LEVELS - 1);
+    m_extent = { std::min(FloorPowerOfTwo(depthExtent.width), maxSize), std::min(FloorPowerOfTwo(depthExtent.height), maxSize) };
+    m_levels = 1;
+    while ((std::max(m_extent.width, m_extent.height) >> m_levels) > 0) m_levels++;
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.extent = { m_extent.width, m_extent.height, 1 };
+    imageInfo.mipLevels = m_levels;
+    imageInfo.arrayLayers = 1;
+    imageInfo.format = VK_FORMAT_R32_SFLOAT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    VkResult result = vkCreateImage(m_dev, &imageInfo, nullptr, &m_image);
+    if (result == VK_SUCCESS) result = m_allocator->AllocateForImage(m_image, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_imageAlloc);
+    if (result != VK_SUCCESS) {
+        NOVA_ERROR("DepthPyramid: failed to create a " + std::to_string(m_extent.width) + "x" +
+                   std::to_string(m_extent.height) + " pyramid: " + std::to_string(result));
+        m_allocator->DestroyImage(m_image, m_imageAlloc);
+        m_levels = 0;
+        return false;
+    }
+
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = m_image;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = VK_FORMAT_R32_SFLOAT;
+    viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, m_levels, 0, 1 };
+    VK_CHECK(vkCreateImageView(m_dev, &viewInfo, nullptr, &m_view));
+    m_levelViews.resize(m_levels);
+    for (uint32_t level = 0; level < m_levels; ++level) {
+        viewInfo.subresourceRange.baseMipLevel = level;
+        viewInfo.subresourceRange.levelCount = 1;
+        VK_CHECK(vkCreateImageView(m_dev, &viewInfo, nullptr, &m_levelViews[level]));
+    }
+    m_depthExtent = depthExtent;
+    NOVA_INFO("DepthPyramid: " + std::to_string(m_extent.width) + "x" + std::to_string(m_extent.height) + ", " +
+              std::to_string(m_levels) + " levels");
+    return true;
+}
+
+void DepthPyramid::DestroyRetired(bool all) {
+    // Retired while building frame N: frame N is the last that may use it
+    auto destroy = [&](Retired& retired) {
+        if (!all && !m_frames->IsComplete(retired.frameNumber)) return false;
+        for (VkImageView view : retired.views) vkDestroyImageView(m_dev, view, nullptr);
+        m_allocator->DestroyImage(retired.image, retired.allocation);
+        return true;
+    };
+    m_retired.erase(std::remove_if(m_retired.begin(), m_retired.end(), destroy), m_retired.end());
+}
+
+bool DepthPyramid::CreatePipeline() {
+    VkShaderModule shader = m_pipelines->GetShaderModule("assets/shaders/hiz.comp.spv");
+    if (shader == VK_NULL_HANDLE) {
+        NOVA_WARN("DepthPyramid: Hi-Z shader unavailable, occlusion culling unavailable");
+        return false;
+    }
+
+    VkPushConstantRange pushRange{};
+    pushRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushRange.offset = 0;
+    pushRange.size = sizeof(PyramidConstants);
+
+    VkPipelineLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layoutInfo.setLayoutCount = 1;
+    layoutInfo.pSetLayouts = &m_setLayout;
+    layoutInfo.pushConstantRangeCount = 1;
+    layoutInfo.pPushConstantRanges = &pushRange;
+    VK_CHECK(vkCreatePipelineLayout(m_dev, &layoutInfo, nullptr, &m_pipelineLayout));
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shader;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = m_pipelineLayout;
+    VkResult result = m_pipelines->CreateComputePipeline(pipelineInfo, &m_pipeline);
+    if (result != VK_SUCCESS) {
+        NOVA_ERROR("DepthPyramid: failed to create Hi-Z pipeline: " + std::to_string(result));
+        m_pipeline = VK_NULL_HANDLE;
+        return false;
+    }
+    return true;
+}
+
+} // namespace nova
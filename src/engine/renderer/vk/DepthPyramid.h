@@ -0,0 +1,86 @@
+#pragma once
+
+#ifndef VK_NO_PROTOTYPES
+#define VK_NO_PROTOTYPES
+#endif
+
+#include <volk.h>
+#include <vector>
+#include <cstdint>
+#include "GpuAllocator.h"
+#include "PipelineCache.h"
+#include "FrameTimeline.h"
+
+namespace nova {
+
+// Hierarchical-Z pyramid for occlusion culling: an R32_SFLOAT image whose
+// level 0 is the largest power of two no bigger than the depth buffer, each
+// texel holding the farthest depth beneath it, and each further level the
+// farthest of the four texels below. hiz.comp builds every level in a single
+// dispatch. One pyramid serves every frame slot: it is rebuilt from scratch
+// each frame, so a build only has to wait for the previous frame's reads.
+class DepthPyramid {
+public:
+    static constexpr uint32_t MAX_LEVELS = 13;        // Level 0 up to 4096 texels wide
+    static constexpr uint32_t TILE_SIZE = 64;         // Level-0 texels per workgroup side
+    static constexpr uint32_t WORKGROUP_SIZE = 256;
+
+    // The shader indexes its array of level images with a uniform index,
+    // which needs shaderStorageImageArrayDynamicIndexing
+    void Init(VkDevice device, GpuAllocator* allocator, PipelineCache* pipelines, FrameTimeline* frames,
+              uint32_t framesInFlight, bool storageImageIndexing);
+    void Shutdown();
+
+    bool Available() const { return m_pipeline != VK_NULL_HANDLE; }
+
+    // Outside a render pass, with `depthView` in DEPTH_STENCIL_READ_ONLY_OPTIMAL
+    // and visible to compute shaders. Reallocates the pyramid when the depth
+    // extent changed; the old one is destroyed once frame `frameNumber` has
+    // completed. On success the pyramid is in GENERAL layout and visible to
+    // compute shader reads.
+    bool RecordBuild(VkCommandBuffer cmd, uint32_t slot, uint64_t frameNumber, VkImageView depthView, VkExtent2D depthExtent);
+
+    // Every level, for texelFetch
+    VkImageView View() const { return m_view; }
+    VkSampler Sampler() const { return m_sampler; }
+    VkExtent2D Extent() const { return m_extent; }    // Level 0
+    uint32_t Levels() const { return m_levels; }
+
+private:
+    struct Retired {
+        VkImage image = VK_NULL_HANDLE;
+        GpuAllocation allocation;
+        std::vector<VkImageView> views;
+        uint64_t frameNumber = 0;
+    };
+
+    bool EnsureImage(VkExtent2D depthExtent, uint64_t frameNumber);
+    void DestroyRetired(bool all);
+    bool CreatePipeline();
+
+    VkDevice m_dev = VK_NULL_HANDLE;
+    GpuAllocator* m_allocator = nullptr;
+    PipelineCache* m_pipelines = nullptr;
+    FrameTimeline* m_frames = nullptr;
+
+    VkDescriptorSetLayout m_setLayout = VK_NULL_HANDLE;
+    VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+    VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_pipeline = VK_NULL_HANDLE;
+    VkSampler m_sampler = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSet> m_sets;    // Per frame slot; rewritten by every build
+
+    VkBuffer m_counter = VK_NULL_HANDLE;    // Finished workgroups, cleared before each build
+    GpuAllocation m_counterAlloc;
+
+    VkImage m_image = VK_NULL_HANDLE;
+    GpuAllocation m_imageAlloc;
+    VkImageView m_view = VK_NULL_HANDLE;
+    std::vector<VkImageView> m_levelViews;  // One per level, for imageStore
+    VkExtent2D m_depthExtent = {0, 0};
+    VkExtent2D m_extent = {0, 0};
+    uint32_t m_levels = 0;
+    std::vector<Retired> m_retired;
+};
+
+} // namespace nova
@@ -0,0 +1,53 @@
+#include "FrameTimeline.h"
+#include "VulkanHelpers.h"
+#include "core/Log.h"
+
+namespace nova {
+
+void FrameTimeline::Init(VkDevice device) {
+    m_dev = device;
+    m_completed = 0;
+
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+    VkSemaphoreCreateInfo semInfo{};
+    semInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semInfo.pNext = &typeInfo;
+    VK_CHECK(vkCreateSemaphore(m_dev, &semInfo, nullptr, &m_semaphore));
+    NOVA_INFO("Frame timeline ready");
+}
+
+void FrameTimeline::Shutdown() {
+    if (m_semaphore != VK_NULL_HANDLE) vkDestroySemaphore(m_dev, m_semaphore, nullptr);
+    m_semaphore = VK_NULL_HANDLE;
+    m_dev = VK_NULL_HANDLE;
+}
+
+bool FrameTimeline::IsComplete(uint64_t frameNumber) {
+    if (SignalValue(frameNumber) <= m_completed) return true;
+    return SignalValue(frameNumber) <= CompletedFrames();
+}
+
+VkResult FrameTimeline::Wait(uint64_t frameNumber, uint64_t timeout) {
+    if (IsComplete(frameNumber)) return VK_SUCCESS;
+    uint64_t value = SignalValue(frameNumber);
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &m_semaphore;
+    waitInfo.pValues = &value;
+    VkResult result = vkWaitSemaphores(m_dev, &waitInfo, timeout);
+    if (result == VK_SUCCESS && value > m_completed) m_completed = value;
+    return result;
+}
+
+uint64_t FrameTimeline::CompletedFrames() {
+    if (m_semaphore == VK_NULL_HANDLE) return m_completed;
+    uint64_t value = 0;
+    if (vkGetSemaphoreCounterValue(m_dev, m_semaphore, &value) == VK_SUCCESS && value > m_completed) m_completed = value;
+    return m_completed;
+}
+
+} // namespace nova
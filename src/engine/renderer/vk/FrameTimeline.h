@@ -0,0 +1,37 @@
+#pragma once
+
+#ifndef VK_NO_PROTOTYPES
+#define VK_NO_PROTOTYPES
+#endif
+
+#include <volk.h>
+#include <cstdint>
+
+namespace nova {
+
+// Timeline semaphore for the frame loop. The submission of frame N signals
+// N + 1, so "frame N has completed on the GPU" is one counter compare. CPU
+// frame pacing waits on it, and deferred destruction keys objects on the last
+// frame that may use them instead of counting frames in flight.
+class FrameTimeline {
+public:
+    void Init(VkDevice device);
+    void Shutdown();
+
+    VkSemaphore Semaphore() const { return m_semaphore; }
+    // Value the submission of `frameNumber` signals
+    static uint64_t SignalValue(uint64_t frameNumber) { return frameNumber + 1; }
+
+    // Only queries the semaphore when the cached counter is not far enough yet
+    bool IsComplete(uint64_t frameNumber);
+    VkResult Wait(uint64_t frameNumber, uint64_t timeout = UINT64_MAX);
+    // Frames [0, CompletedFrames()) have completed
+    uint64_t CompletedFrames();
+
+private:
+    VkDevice m_dev = VK_NULL_HANDLE;
+    VkSemaphore m_semaphore = VK_NULL_HANDLE;
+    uint64_t m_completed = 0;
+};
+
+} // namespace nova
@@ -0,0 +1,319 @@
+#include "GeometryPool.h"
+#include "core/Log.h"
+#include <glm/gtc/packing.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+
+namespace nova {
+
+void GeometryPool::Init(GpuAllocator* allocator, UploadManager* uploads, FrameTimeline* frames,
+                        VertexLayout layout, uint32_t vertexCapacity, uint32_t indexCapacity) {
+    m_allocator = allocator;
+    m_uploads = uploads;
+    m_frames = frames;
+    m_layout = layout;
+
+    bool compact = layout == VertexLayout::Compact;
+    m_vertices.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+    m_vertices.elementSize = compact ? COMPACT_VERTEX_STRIDE : VERTEX_STRIDE;
+    m_positions.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+    m_positions.elementSize = compact ? COMPACT_POSITION_STRIDE : POSITION_STRIDE;
+    m_indices.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
+    m_indices.elementSize = sizeof(uint32_t);
+    vertexCapacity = std::max(1u, vertexCapacity);
+    if (!CreateRegion(m_vertices, vertexCapacity) || !CreateRegion(m_positions, vertexCapacity) ||
+        !CreateRegion(m_indices, std::max(1u, indexCapacity))) {
+        DestroyRegion(m_vertices);
+        DestroyRegion(m_positions);
+        DestroyRegion(m_indices);
+        return;
+    }
+
+    NOVA_INFO("Geometry pool ready: " + std::to_string(m_vertices.capacity) + (compact ? " compact" : "") + " vertices, " +
+              std::to_string(m_indices.capacity) + " indices (" +
+              std::to_string((VkDeviceSize(m_vertices.capacity) * (m_vertices.elementSize + m_positions.elementSize) +
+                              VkDeviceSize(m_indices.capacity) * sizeof(uint32_t)) >> 20) + " MB)");
+}
+
+void GeometryPool::Shutdown() {
+    if (!m_allocator) return;
+    for (auto& retired : m_retired) m_allocator->DestroyBuffer(retired.buffer, retired.allocation);
+    m_retired.clear();
+    DestroyRegion(m_vertices);
+    DestroyRegion(m_positions);
+    DestroyRegion(m_indices);
+    m_entries.clear();
+    m_freeIds.clear();
+    m_released.clear();
+    m_liveMeshes = 0;
+}
+
+MeshHandle GeometryPool::Register(const float* vertexData, uint32_t vertexCount, const uint32_t* indices,
+                                  uint32_t indexCount, const MeshLod* lods, uint32_t lodCount) {
+    MeshHandle handle;
+    if (m_vertices.buffer == VK_NULL_HANDLE || vertexCount == 0 || indexCount == 0) return handle;
+    lodCount = std::min(lodCount, MAX_MESH_LODS - 1);
+    uint32_t indexSpan = indexCount;
+    for (uint32_t i = 0; i < lodCount; ++i) indexSpan += static_cast<uint32_t>(lods[i].indices.size());
+
+    uint32_t vertexOffset = 0;
+    uint32_t firstIndex = 0;
+    if (!Reserve(m_vertices, vertexCount, vertexOffset)) return handle;
+    if (!Reserve(m_indices, indexSpan, firstIndex)) {
+        FreeRange(m_vertices, vertexOffset, vertexCount);
+        m_vertices.used -= vertexCount;
+        return handle;
+    }
+
+    glm::vec4 dequantize = UploadVertices(vertexData, vertexCount, vertexOffset);
+    m_uploads->UploadBuffer(m_indices.buffer, VkDeviceSize(firstIndex) * sizeof(uint32_t), indices,
+                            VkDeviceSize(indexCount) * sizeof(uint32_t));
+    std::vector<MeshLodRange> lodRanges = { MeshLodRange{ firstIndex, indexCount, 0.0f } };
+    uint32_t nextIndex = firstIndex + indexCount;
+    for (uint32_t i = 0; i < lodCount; ++i) {
+        uint32_t count = static_cast<uint32_t>(lods[i].indices.size());
+        if (count == 0) continue;
+        m_uploads->UploadBuffer(m_indices.buffer, VkDeviceSize(nextIndex) * sizeof(uint32_t), lods[i].indices.data(),
+                                VkDeviceSize(count) * sizeof(uint32_t));
+        lodRanges.push_back(MeshLodRange{ nextIndex, count, lods[i].error });
+        nextIndex += count;
+    }
+
+    if (!m_freeIds.empty()) {
+        handle.id = m_freeIds.back();
+        m_freeIds.pop_back();
+    } else {
+        handle.id = static_cast<uint32_t>(m_entries.size());
+        m_entries.emplace_back();
+    }
+    Entry& entry = m_entries[handle.id];
+    entry.range.firstIndex = firstIndex;
+    entry.range.indexCount = indexCount;
+    entry.range.vertexOffset = static_cast<int32_t>(vertexOffset);
+    entry.range.vertexCount = vertexCount;
+    entry.lods = std::move(lodRanges);
+    entry.indexSpan = indexSpan;
+    entry.dequantize = dequantize;
+    entry.live = true;
+    m_liveMeshes++;
+    m_version++;
+    return handle;
+}
+
+void GeometryPool::Release(MeshHandle mesh, uint64_t frameNumber) {
+    if (!mesh.IsValid() || mesh.id >= m_entries.size() || !m_entries[mesh.id].live) return;
+    m_entries[mesh.id].live = false;
+    m_liveMeshes--;
+    m_version++;
+    m_released.push_back({ mesh.id, frameNumber });
+}
+
+void GeometryPool::CollectReleased(uint64_t frameNumber) {
+    m_frameNumber = frameNumber;
+
+    // A range released during frame N may have been drawn by frame N at the
+    // latest, so it is reused once that frame has completed
+    auto released = [&](const Released& r) {
+        if (!m_frames->IsComplete(r.frameNumber)) return false;
+        Entry& entry = m_entries[r.id];
+        const MeshRange& range = entry.range;
+        FreeRange(m_vertices, static_cast<uint32_t>(range.vertexOffset), range.vertexCount);
+        FreeRange(m_indices, range.firstIndex, entry.indexSpan);
+        m_vertices.used -= range.vertexCount;
+        m_indices.used -= entry.indexSpan;
+        entry = Entry{};
+        m_freeIds.push_back(r.id);
+        return true;
+    };
+    m_released.erase(std::remove_if(m_released.begin(), m_released.end(), released), m_released.end());
+
+    // Grown-out buffers must also have been copied from on the transfer queue
+    auto retired = [&](RetiredBuffer& r) {
+        if (!m_frames->IsComplete(r.frameNumber) || !m_uploads->IsComplete(r.uploadValue)) return false;
+        m_allocator->DestroyBuffer(r.buffer, r.allocation);
+        return true;
+    };
+    m_retired.erase(std::remove_if(m_retired.begin(), m_retired.end(), retired), m_retired.end());
+}
+
+const MeshRange* GeometryPool::Find(MeshHandle mesh) const {
+    if (!mesh.IsValid() || mesh.id >= m_entries.size() || !m_entries[mesh.id].live) return nullptr;
+    return &m_entries[mesh.id].range;
+}
+
+const MeshLodRange* GeometryPool::FindLod(MeshHandle mesh, uint32_t lod) const {
+    if (!Find(mesh) || lod >= m_entries[mesh.id].lods.size()) return nullptr;
+    return &m_entries[mesh.id].lods[lod];
+}
+
+uint32_t GeometryPool::LodCount(MeshHandle mesh) const {
+    return Find(mesh) ? static_cast<uint32_t>(m_entries[mesh.id].lods.size()) : 0;
+}
+
+glm::vec4 GeometryPool::PositionDequantize(MeshHandle mesh) const {
+    return Find(mesh) ? m_entries[mesh.id].dequantize : glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+glm::vec4 GeometryPool::UploadVertices(const float* vertexData, uint32_t vertexCount, uint32_t vertexOffset) {
+    constexpr size_t floatsPerVertex = VERTEX_STRIDE / sizeof(float);
+    if (m_layout == VertexLayout::Standard) {
+        m_uploads->UploadBuffer(m_vertices.buffer, VkDeviceSize(vertexOffset) * VERTEX_STRIDE, vertexData,
+                                VkDeviceSize(vertexCount) * VERTEX_STRIDE);
+        m_positionScratch.resize(size_t(vertexCount) * 3);
+        for (uint32_t v = 0; v < vertexCount; ++v) {
+            const float* vertex = vertexData + size_t(v) * floatsPerVertex;
+            std::copy(vertex, vertex + 3, m_positionScratch.begin() + size_t(v) * 3);
+        }
+        m_uploads->UploadBuffer(m_positions.buffer, VkDeviceSize(vertexOffset) * POSITION_STRIDE, m_positionScratch.data(),
+                                VkDeviceSize(vertexCount) * POSITION_STRIDE);
+        return glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    }
+
+    // Positions over the bounding cube rather than box, so the dequantization
+    // is a uniform scale the instance transform can absorb
+    glm::vec3 lo(vertexData[0], vertexData[1], vertexData[2]);
+    glm::vec3 hi = lo;
+    for (uint32_t v = 1; v < vertexCount; ++v) {
+        glm::vec3 p = glm::make_vec3(vertexData + size_t(v) * floatsPerVertex);
+        lo = glm::min(lo, p);
+        hi = glm::max(hi, p);
+    }
+    glm::vec3 extent = hi - lo;
+    float scale = std::max(std::max(extent.x, extent.y), std::max(extent.z, 1e-6f));
+
+    const size_t valuesPerVertex = COMPACT_POSITION_STRIDE / sizeof(uint16_t);
+    m_packedScratch.resize(size_t(vertexCount) * valuesPerVertex);
+    for (uint32_t v = 0; v < vertexCount; ++v) {
+        glm::vec3 p = glm::make_vec3(vertexData + size_t(v) * floatsPerVertex);
+        glm::uint64 packed = glm::packUnorm4x16(glm::vec4((p - lo) / scale, 0.0f));
+        std::memcpy(&m_packedScratch[size_t(v) * valuesPerVertex], &packed, COMPACT_POSITION_STRIDE);
+    }
+    m_uploads->UploadBuffer(m_positions.buffer, VkDeviceSize(vertexOffset) * COMPACT_POSITION_STRIDE,
+                            m_packedScratch.data(), VkDeviceSize(vertexCount) * COMPACT_POSITION_STRIDE);
+
+    for (uint32_t v = 0; v < vertexCount; ++v) {
+        const float* vertex = vertexData + size_t(v) * floatsPerVertex;
+        // Octahedral normal: project onto the octahedron, fold the lower half over
+        glm::vec3 n = glm::make_vec3(vertex + 3);
+        float length = std::abs(n.x) + std::abs(n.y) + std::abs(n.z);
+        glm::vec2 oct = length > 0.0f ? glm::vec2(n) / length : glm::vec2(0.0f);
+        if (n.z < 0.0f) {
+            oct = (1.0f - glm::abs(glm::vec2(oct.y, oct.x))) *
+                  glm::vec2(oct.x >= 0.0f ? 1.0f : -1.0f, oct.y >= 0.0f ? 1.0f : -1.0f);
+        }
+        glm::uint32 words[2] = { glm::packSnorm2x16(oct), glm::packHalf2x16(glm::make_vec2(vertex + 6)) };
+        std::memcpy(&m_packedScratch[size_t(v) * valuesPerVertex], words, COMPACT_VERTEX_STRIDE);
+    }
+    m_uploads->UploadBuffer(m_vertices.buffer, VkDeviceSize(vertexOffset) * COMPACT_VERTEX_STRIDE,
+                            m_packedScratch.data(), VkDeviceSize(vertexCount) * COMPACT_VERTEX_STRIDE);
+    return glm::vec4(lo, scale);
+}
+
+bool GeometryPool::CreateRegion(Region& region, uint32_t capacity) {
+    VkDeviceSize size = VkDeviceSize(capacity) * region.elementSize;
+    VkResult result = m_allocator->CreateBuffer(size, region.usage | VK_BUFFER_USAGE_TRANSFER_SRC_BIT |
+                                                    VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, region.buffer, region.allocation,
+                                                m_uploads->SharingFamilyCount(), m_uploads->SharingFamilies());
+    if (result != VK_SUCCESS) {
+        NOVA_ERROR("GeometryPool: failed to create " + std::to_string(size) + " byte buffer: " + std::to_string(result));
+        m_allocator->DestroyBuffer(region.buffer, region.allocation);
+        return false;
+    }
+    region.capacity = capacity;
+    region.used = 0;
+    region.freeRanges.clear();
+    region.freeRanges[0] = capacity;
+    return true;
+}
+
+bool GeometryPool::Reserve(Region& region, uint32_t count, uint32_t& offset) {
+    for (int attempt = 0; attempt < 2; ++attempt) {
+        for (auto it = region.freeRanges.begin(); it != region.freeRanges.end(); ++it) {
+            if (it->second < count) continue;
+            offset = it->first;
+            uint32_t remaining = it->second - count;
+            region.freeRanges.erase(it);
+            if (remaining > 0) region.freeRanges[offset + count] = remaining;
+            region.used += count;
+            return true;
+        }
+        if (attempt == 0 && !Grow(region, count)) break;
+    }
+    NOVA_ERROR("GeometryPool: no room for " + std::to_string(count) + " elements");
+    return false;
+}
+
+bool GeometryPool::Grow(Region& region, uint32_t count) {
+    // The appended tail alone must fit `count`, whatever the fragmentation
+    uint64_t wanted = std::max<uint64_t>(uint64_t(region.capacity) * 2, uint64_t(region.capacity) + count);
+    uint32_t newCapacity = static_cast<uint32_t>(std::min<uint64_t>(wanted, UINT32_MAX));
+    if (newCapacity <= region.capacity) return false;
+
+    Region grown;
+    grown.usage = region.usage;
+    grown.elementSize = region.elementSize;
+    if (!CreateRegion(grown, newCapacity)) return false;
+    // Positions share the vertex offsets, so they grow with the vertices
+    bool vertices = &region == &m_vertices;
+    Region grownPositions;
+    grownPositions.usage = m_positions.usage;
+    grownPositions.elementSize = m_positions.elementSize;
+    if (vertices && !CreateRegion(grownPositions, newCapacity)) {
+        DestroyRegion(grown);
+        return false;
+    }
+
+    // Existing ranges keep their offsets, so draws and handles stay valid
+    m_uploads->CopyBuffer(region.buffer, grown.buffer, 0, 0, VkDeviceSize(region.capacity) * region.elementSize);
+    m_retired.push_back({ region.buffer, region.allocation, m_frameNumber, m_uploads->LastSubmittedValue() + 1 });
+    if (vertices) {
+        m_uploads->CopyBuffer(m_positions.buffer, grownPositions.buffer, 0, 0,
+                              VkDeviceSize(m_positions.capacity) * m_positions.elementSize);
+        m_retired.push_back({ m_positions.buffer, m_positions.allocation, m_frameNumber, m_uploads->LastSubmittedValue() + 1 });
+        m_positions.buffer = grownPositions.buffer;
+        m_positions.allocation = grownPositions.allocation;
+        m_positions.capacity = newCapacity;
+    }
+
+    uint32_t oldCapacity = region.capacity;
+    region.buffer = grown.buffer;
+    region.allocation = grown.allocation;
+    region.capacity = newCapacity;
+    FreeRange(region, oldCapacity, newCapacity - oldCapacity);
+    m_growCount++;
+
+    NOVA_WARN("GeometryPool: grew " + std::string(region.usage & VK_BUFFER_USAGE_INDEX_BUFFER_BIT ? "index" : "vertex") +
+              " buffer to " + std::to_string(newCapacity) + " elements");
+    return true;
+}
+
+void GeometryPool::FreeRange(Region& region, uint32_t offset, uint32_t count) {
+    if (count == 0) return;
+    auto next = region.freeRanges.lower_bound(offset);
+    if (next != region.freeRanges.begin()) {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset) {
+            offset = prev->first;
+            count += prev->second;
+            region.freeRanges.erase(prev);
+        }
+    }
+    if (next != region.freeRanges.end() && offset + count == next->first) {
+        count += next->second;
+        region.freeRanges.erase(next);
+    }
+    region.freeRanges[offset] = count;
+}
+
+void GeometryPool::DestroyRegion(Region& region) {
+    if (m_allocator) m_allocator->DestroyBuffer(region.buffer, region.allocation);
+    region.capacity = 0;
+    region.used = 0;
+    region.freeRanges.clear();
+}
+
+} // namespace nova
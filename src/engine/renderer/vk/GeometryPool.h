@@ -0,0 +1,154 @@
+#pragma once
+
+#ifndef VK_NO_PROTOTYPES
+#define VK_NO_PROTOTYPES
+#endif
+
+#include <volk.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <map>
+#include <cstdint>
+#include "GpuAllocator.h"
+#include "UploadManager.h"
+#include "FrameTimeline.h"
+#include "PipelineStateCache.h"
+#include "renderer/IRenderer.h"
+
+namespace nova {
+
+// One device-local vertex buffer and one index buffer shared by every mesh.
+// Each registered mesh gets a vertex range and an index range; draws bind the
+// two buffers once and select the mesh with firstIndex/vertexOffset. Data is
+// uploaded through the UploadManager. Released ranges are recycled only after
+// every frame that may still read them has retired. When a range does not fit,
+// the buffer is reallocated at twice the size and the old contents are copied
+// on the transfer queue.
+//
+// Positions are also kept in a separate, position-only buffer at the same
+// vertex offsets, so depth-only passes fetch 12 bytes per vertex instead of
+// the full interleaved vertex.
+//
+// With VertexLayout::Compact the pool stores every mesh quantized instead:
+// positions as unorm16x4 over the mesh's bounding cube (8 bytes), and a
+// second stream with an octahedral snorm16x2 normal and half-float uv (8
+// bytes), 16 bytes per vertex against Standard's 44. Whoever writes instance
+// transforms for a mesh folds in PositionDequantize(mesh); the scale is
+// uniform, so normals only change length.
+class GeometryPool {
+public:
+    static constexpr uint32_t VERTEX_STRIDE = 8 * sizeof(float); // position, normal, uv; also the input layout
+    static constexpr uint32_t POSITION_STRIDE = 3 * sizeof(float);
+    static constexpr uint32_t COMPACT_VERTEX_STRIDE = 4 * sizeof(uint16_t);   // normal, uv
+    static constexpr uint32_t COMPACT_POSITION_STRIDE = 4 * sizeof(uint16_t);
+    static constexpr uint32_t DEFAULT_VERTEX_CAPACITY = 1u << 20; // 32 MB
+    static constexpr uint32_t DEFAULT_INDEX_CAPACITY = 3u << 20;  // 12 MB
+
+    void Init(GpuAllocator* allocator, UploadManager* uploads, FrameTimeline* frames,
+              VertexLayout layout = VertexLayout::Standard, uint32_t vertexCapacity = DEFAULT_VERTEX_CAPACITY,
+              uint32_t indexCapacity = DEFAULT_INDEX_CAPACITY);
+    void Shutdown();
+
+    // `vertexData` holds VERTEX_STRIDE bytes per vertex. Coarser `lods` index
+    // the same vertices and share the mesh's index range. Returns an invalid
+    // handle if the data is malformed or the pool cannot grow.
+    MeshHandle Register(const float* vertexData, uint32_t vertexCount, const uint32_t* indices, uint32_t indexCount,
+                        const MeshLod* lods = nullptr, uint32_t lodCount = 0);
+    // The handle stops resolving immediately; its ranges are reused later.
+    void Release(MeshHandle mesh, uint64_t frameNumber);
+    // Call once per frame with the frame being recorded.
+    void CollectReleased(uint64_t frameNumber);
+
+    const MeshRange* Find(MeshHandle mesh) const;
+    // Level 0 is Find's index range with zero error; null past the last level
+    const MeshLodRange* FindLod(MeshHandle mesh, uint32_t lod) const;
+    uint32_t LodCount(MeshHandle mesh) const;
+    // xyz offset, w scale: mesh-space position = xyz + w * stored position.
+    // (0, 0, 0, 1) in the Standard layout and for unknown handles.
+    glm::vec4 PositionDequantize(MeshHandle mesh) const;
+    // `transform` applied after the dequantization, for instance data
+    static glm::mat4 Dequantized(const glm::mat4& transform, const glm::vec4& dequantize) {
+        return glm::mat4(transform[0] * dequantize.w, transform[1] * dequantize.w, transform[2] * dequantize.w,
+                         transform * glm::vec4(glm::vec3(dequantize), 1.0f));
+    }
+    // Handle ids are below HandleLimit(); Version() changes whenever a handle
+    // starts or stops resolving, so derived mesh tables know to rebuild.
+    uint32_t HandleLimit() const { return static_cast<uint32_t>(m_entries.size()); }
+    uint64_t Version() const { return m_version; }
+    VkBuffer VertexBuffer() const { return m_vertices.buffer; }
+    // Same vertexOffset as VertexBuffer, POSITION_STRIDE bytes per vertex
+    VkBuffer PositionBuffer() const { return m_positions.buffer; }
+    VkBuffer IndexBuffer() const { return m_indices.buffer; }
+    VertexLayout Layout() const { return m_layout; }
+    // VertexBuffer holds everything but the position in the Compact layout
+    uint32_t VertexStride() const { return m_vertices.elementSize; }
+    uint32_t PositionStride() const { return m_positions.elementSize; }
+    VkFormat PositionFormat() const {
+        return m_layout == VertexLayout::Compact ? VK_FORMAT_R16G16B16A16_UNORM : VK_FORMAT_R32G32B32_SFLOAT;
+    }
+
+    uint32_t MeshCount() const { return m_liveMeshes; }
+    uint32_t VertexCapacity() const { return m_vertices.capacity; }
+    uint32_t VerticesUsed() const { return m_vertices.used; }
+    uint32_t IndexCapacity() const { return m_indices.capacity; }
+    uint32_t IndicesUsed() const { return m_indices.used; }
+    uint32_t GrowCount() const { return m_growCount; }
+
+private:
+    // One pooled buffer with a first-fit free list over [0, capacity) in
+    // elements, coalesced on free
+    struct Region {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        GpuAllocation allocation;
+        VkBufferUsageFlags usage = 0;
+        uint32_t elementSize = 0;
+        uint32_t capacity = 0;
+        uint32_t used = 0;
+        std::map<uint32_t, uint32_t> freeRanges; // offset -> count
+    };
+    struct Entry {
+        MeshRange range;
+        std::vector<MeshLodRange> lods;  // From level 0, contiguous in the index pool
+        uint32_t indexSpan = 0;          // Indices of every level
+        glm::vec4 dequantize{0.0f, 0.0f, 0.0f, 1.0f};
+        bool live = false;
+    };
+    struct Released {
+        uint32_t id = 0;
+        uint64_t frameNumber = 0;
+    };
+    struct RetiredBuffer {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        GpuAllocation allocation;
+        uint64_t frameNumber = 0;
+        uint64_t uploadValue = 0;   // Timeline value of the batch that copies out of it
+    };
+
+    bool CreateRegion(Region& region, uint32_t capacity);
+    bool Reserve(Region& region, uint32_t count, uint32_t& offset);
+    bool Grow(Region& region, uint32_t count);
+    void FreeRange(Region& region, uint32_t offset, uint32_t count);
+    void DestroyRegion(Region& region);
+    // Uploads `vertexData` into both streams at `vertexOffset`; returns the dequantization
+    glm::vec4 UploadVertices(const float* vertexData, uint32_t vertexCount, uint32_t vertexOffset);
+
+    GpuAllocator* m_allocator = nullptr;
+    UploadManager* m_uploads = nullptr;
+    FrameTimeline* m_frames = nullptr;
+    VertexLayout m_layout = VertexLayout::Standard;
+    Region m_vertices;
+    Region m_positions;     // Mirrors m_vertices' capacity and offsets; its free list is unused
+    Region m_indices;
+    std::vector<Entry> m_entries;
+    std::vector<uint32_t> m_freeIds;
+    std::vector<Released> m_released;
+    std::vector<RetiredBuffer> m_retired;
+    std::vector<float> m_positionScratch;   // Positions split out of the vertex data being registered
+    std::vector<uint16_t> m_packedScratch;  // Compact streams of the vertex data being registered
+    uint32_t m_liveMeshes = 0;
+    uint32_t m_growCount = 0;
+    uint64_t m_frameNumber = 0;     // Latest frame seen, used to retire grown buffers
+    uint64_t m_version = 0;
+};
+
+} // namespace nova
@@ -0,0 +1,374 @@
+#include "GpuAllocator.h"
+#include "VulkanHelpers.h"
+#include "core/Log.h"
+#include <algorithm>
+#include <cassert>
+
+namespace nova {
+
+// ---------------------------------------------------------------------------
+// GpuMemoryBlock
+
+GpuMemoryBlock::GpuMemoryBlock(VkDeviceMemory memory, VkDeviceSize size, void* mapped)
+    : m_memory(memory), m_size(size), m_mapped(mapped), m_freeBytes(size) {
+    while (OrderSize(m_maxOrder) < size) m_maxOrder++;
+    m_freeLists.resize(m_maxOrder + 1);
+    m_freeLists[m_maxOrder].insert(0);
+}
+
+uint32_t GpuMemoryBlock::OrderFor(VkDeviceSize size) const {
+    uint32_t order = 0;
+    while (OrderSize(order) < size) order++;
+    return order;
+}
+
+bool GpuMemoryBlock::Allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset) {
+    // Buddy nodes are aligned to their own size, so a node at least as large
+    // as the alignment is always correctly placed.
+    uint32_t order = OrderFor(std::max(size, alignment));
+    if (order > m_maxOrder) return false;
+
+    uint32_t found = order;
+    while (found <= m_maxOrder && m_freeLists[found].empty()) found++;
+    if (found > m_maxOrder) return false;
+
+    VkDeviceSize node = *m_freeLists[found].begin();
+    m_freeLists[found].erase(m_freeLists[found].begin());
+    while (found > order) {
+        found--;
+        m_freeLists[found].insert(node + OrderSize(found)); // Upper half stays free
+    }
+
+    m_allocated[node] = order;
+    m_freeBytes -= OrderSize(order);
+    offset = node;
+    return true;
+}
+
+void GpuMemoryBlock::Free(VkDeviceSize offset) {
+    auto it = m_allocated.find(offset);
+    if (it == m_allocated.end()) {
+        NOVA_ERROR("GpuMemoryBlock: free of unknown offset " + std::to_string(offset));
+        return;
+    }
+    uint32_t order = it->second;
+    m_allocated.erase(it);
+    m_freeBytes += OrderSize(order);
+
+    // Merge with the buddy for as long as it is free
+    VkDeviceSize node = offset;
+    while (order < m_maxOrder) {
+        VkDeviceSize buddy = node ^ OrderSize(order);
+        auto buddyIt = m_freeLists[order].find(buddy);
+        if (buddyIt == m_freeLists[order].end()) break;
+        m_freeLists[order].erase(buddyIt);
+        node = std::min(node, buddy);
+        order++;
+    }
+    m_freeLists[order].insert(node);
+}
+
+VkDeviceSize GpuMemoryBlock::LargestFreeRange() const {
+    for (uint32_t order = m_maxOrder + 1; order-- > 0;) {
+        if (!m_freeLists[order].empty()) return OrderSize(order);
+    }
+    return 0;
+}
+
+// ---------------------------------------------------------------------------
+// GpuAllocator
+
+GpuAllocator::GpuAllocator() = default;
+
+GpuAllocator::~GpuAllocator() {
+    Shutdown();
+}
+
+void GpuAllocator::Init(VkDevice device, VkPhysicalDevice phys, RenderCounters* counters) {
+    m_dev = device;
+    m_counters = counters;
+    vkGetPhysicalDeviceMemoryProperties(phys, &m_memProperties);
+    NOVA_INFO("GPU allocator ready: " + std::to_string(m_memProperties.memoryTypeCount) + " memory types, " +
+              std::to_string(m_memProperties.memoryHeapCount) + " heaps");
+}
+
+void GpuAllocator::Shutdown() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_dev == VK_NULL_HANDLE) return;
+
+    if (m_allocationCount > 0) {
+        NOVA_ERROR("GpuAllocator: " + std::to_string(m_allocationCount) + " allocations (" +
+                   std::to_string(m_usedBytes) + " bytes, " + std::to_string(m_dedicated.size()) +
+                   " dedicated) still live at shutdown");
+    }
+    assert(m_allocationCount == 0 && "GpuAllocator: allocations leaked past Shutdown");
+    for (auto& [memory, mapped] : m_dedicated) FreeDeviceMemory(memory, mapped);
+    m_dedicated.clear();
+    m_dedicatedCount = 0;
+    m_dedicatedBytes = 0;
+    m_allocationCount = 0;
+    m_usedBytes = 0;
+    for (auto& pool : m_pools) {
+        for (auto& block : pool.blocks) FreeDeviceMemory(block->Memory(), block->Mapped());
+        pool.blocks.clear();
+    }
+    m_pools.clear();
+    m_dev = VK_NULL_HANDLE;
+}
+
+uint32_t GpuAllocator::FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const {
+    for (uint32_t i = 0; i < m_memProperties.memoryTypeCount; i++) {
+        if ((typeFilter & (1u << i)) && (m_memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
+            return i;
+        }
+    }
+    return UINT32_MAX;
+}
+
+VkDeviceSize GpuAllocator::BlockSizeFor(uint32_t memoryType) const {
+    // Small heaps (e.g. the 256 MB BAR window) get proportionally smaller blocks
+    VkDeviceSize heapSize = m_memProperties.memoryHeaps[m_memProperties.memoryTypes[memoryType].heapIndex].size;
+    VkDeviceSize size = DEFAULT_BLOCK_SIZE;
+    while (size > (1ull << 20) && size > heapSize / 8) size >>= 1;
+    return size;
+}
+
+GpuAllocator::Pool& GpuAllocator::GetPool(uint32_t memoryType, bool image) {
+    for (auto& pool : m_pools) {
+        if (pool.memoryType == memoryType && pool.image == image) return pool;
+    }
+    m_pools.push_back(Pool{ memoryType, image, {} });
+    return m_pools.back();
+}
+
+VkResult GpuAllocator::AllocateDeviceMemory(VkDeviceSize size, uint32_t memoryType, VkDeviceMemory& memory, void*& mapped,
+                                           const void* pNext) {
+    VkMemoryAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    allocInfo.pNext = pNext;
+    allocInfo.allocationSize = size;
+    allocInfo.memoryTypeIndex = memoryType;
+    VkResult result = vkAllocateMemory(m_dev, &allocInfo, nullptr, &memory);
+    if (result != VK_SUCCESS) return result;
+
+    if (m_counters) {
+        m_counters->deviceAllocations++;
+        m_counters->deviceBytesAllocated += size;
+    }
+
+    mapped = nullptr;
+    if (m_memProperties.memoryTypes[memoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        result = vkMapMemory(m_dev, memory, 0, VK_WHOLE_SIZE, 0, &mapped);
+        if (result != VK_SUCCESS) {
+            vkFreeMemory(m_dev, memory, nullptr);
+            memory = VK_NULL_HANDLE;
+        }
+    }
+    return result;
+}
+
+void GpuAllocator::FreeDeviceMemory(VkDeviceMemory memory, void* mapped) {
+    if (mapped) vkUnmapMemory(m_dev, memory);
+    vkFreeMemory(m_dev, memory, nullptr);
+}
+
+VkResult GpuAllocator::AllocateDedicated(VkDeviceSize size, uint32_t memoryType, VkBuffer buffer, VkImage image,
+                                        GpuAllocation& out) {
+    // Core since Vulkan 1.1; lets the driver place memory for this one resource
+    VkMemoryDedicatedAllocateInfo dedicatedInfo{};
+    dedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+    dedicatedInfo.buffer = buffer;
+    dedicatedInfo.image = image;
+    bool forResource = buffer != VK_NULL_HANDLE || image != VK_NULL_HANDLE;
+
+    void* mapped = nullptr;
+    VkResult result = AllocateDeviceMemory(size, memoryType, out.memory, mapped, forResource ? &dedicatedInfo : nullptr);
+    if (result != VK_SUCCESS) return result;
+    out.offset = 0;
+    out.mapped = mapped;
+    out.block = nullptr;
+    m_dedicated[out.memory] = mapped;
+    m_dedicatedCount++;
+    m_dedicatedBytes += size;
+    return VK_SUCCESS;
+}
+
+VkResult GpuAllocator::Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool image,
+                                GpuAllocation& out) {
+    return Allocate(requirements, properties, image, VK_NULL_HANDLE, VK_NULL_HANDLE, out);
+}
+
+VkResult GpuAllocator::Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool image,
+                                VkBuffer dedicatedBuffer, VkImage dedicatedImage, GpuAllocation& out) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    out = GpuAllocation{};
+
+    uint32_t memoryType = FindMemoryType(requirements.memoryTypeBits, properties);
+    if (memoryType == UINT32_MAX) {
+        NOVA_ERROR("GpuAllocator: no memory type for flags " + std::to_string(properties));
+        return VK_ERROR_FEATURE_NOT_PRESENT;
+    }
+    out.memoryType = memoryType;
+    out.size = requirements.size;
+
+    VkDeviceSize blockSize = BlockSizeFor(memoryType);
+    if (requirements.size >= DEDICATED_THRESHOLD || requirements.size > blockSize / 2) {
+        VkResult result = AllocateDedicated(requirements.size, memoryType, dedicatedBuffer, dedicatedImage, out);
+        if (result == VK_SUCCESS) {
+            m_allocationCount++;
+            m_usedBytes += out.size;
+        }
+        return result;
+    }
+
+    Pool& pool = GetPool(memoryType, image);
+    VkDeviceSize offset = 0;
+    GpuMemoryBlock* target = nullptr;
+    for (auto& block : pool.blocks) {
+        if (block->Allocate(requirements.size, requirements.alignment, offset)) {
+            target = block.get();
+            break;
+        }
+    }
+    if (!target) {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        void* mapped = nullptr;
+        VkResult result = AllocateDeviceMemory(blockSize, memoryType, memory, mapped);
+        if (result != VK_SUCCESS) {
+            NOVA_ERROR("GpuAllocator: failed to allocate " + std::to_string(blockSize >> 20) + " MB block: " +
+                       std::to_string(result));
+            return result;
+        }
+        pool.blocks.push_back(std::make_unique<GpuMemoryBlock>(memory, blockSize, mapped));
+        target = pool.blocks.back().get();
+        NOVA_INFO("GpuAllocator: new " + std::to_string(blockSize >> 20) + " MB block for memory type " +
+                  std::to_string(memoryType) + (image ? " (images)" : " (buffers)"));
+        if (!target->Allocate(requirements.size, requirements.alignment, offset)) {
+            return VK_ERROR_OUT_OF_DEVICE_MEMORY;
+        }
+    }
+
+    out.memory = target->Memory();
+    out.offset = offset;
+    out.block = target;
+    out.mapped = target->Mapped() ? static_cast<char*>(target->Mapped()) + offset : nullptr;
+    m_allocationCount++;
+    m_usedBytes += out.size;
+    return VK_SUCCESS;
+}
+
+void GpuAllocator::Free(GpuAllocation& allocation) {
+    if (!allocation.IsValid()) return;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_dev == VK_NULL_HANDLE) {
+        allocation = GpuAllocation{}; // Already released by Shutdown
+        return;
+    }
+
+    m_allocationCount--;
+    m_usedBytes -= allocation.size;
+
+    if (!allocation.block) {
+        VkDeviceSize size = allocation.size;
+        auto it = m_dedicated.find(allocation.memory);
+        if (it != m_dedicated.end()) {
+            FreeDeviceMemory(it->first, it->second);
+            m_dedicated.erase(it);
+        }
+        m_dedicatedCount--;
+        m_dedicatedBytes -= size;
+        allocation = GpuAllocation{};
+        return;
+    }
+
+    allocation.block->Free(allocation.offset);
+
+    // Keep one empty block per pool around to absorb churn; release the rest
+    for (auto& pool : m_pools) {
+        auto it = std::find_if(pool.blocks.begin(), pool.blocks.end(),
+                               [&](const auto& b) { return b.get() == allocation.block; });
+        if (it == pool.blocks.end()) continue;
+        if ((*it)->Empty() && pool.blocks.size() > 1) {
+            FreeDeviceMemory((*it)->Memory(), (*it)->Mapped());
+            pool.blocks.erase(it);
+        }
+        break;
+    }
+    allocation = GpuAllocation{};
+}
+
+VkResult GpuAllocator::AllocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties, GpuAllocation& out) {
+    VkMemoryRequirements requirements;
+    vkGetBufferMemoryRequirements(m_dev, buffer, &requirements);
+    VkResult result = Allocate(requirements, properties, false, buffer, VK_NULL_HANDLE, out);
+    if (result != VK_SUCCESS) return result;
+    return vkBindBufferMemory(m_dev, buffer, out.memory, out.offset);
+}
+
+VkResult GpuAllocator::AllocateForImage(VkImage image, VkMemoryPropertyFlags properties, GpuAllocation& out) {
+    VkMemoryRequirements requirements;
+    vkGetImageMemoryRequirements(m_dev, image, &requirements);
+    VkResult result = Allocate(requirements, properties, true, VK_NULL_HANDLE, image, out);
+    if (result != VK_SUCCESS) return result;
+    return vkBindImageMemory(m_dev, image, out.memory, out.offset);
+}
+
+VkResult GpuAllocator::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+                                    VkBuffer& buffer, GpuAllocation& allocation,
+                                    uint32_t queueFamilyCount, const uint32_t* queueFamilies) {
+    VkBufferCreateInfo bufferInfo{};
+    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    bufferInfo.size = size;
+    bufferInfo.usage = usage;
+    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (queueFamilyCount > 1 && queueFamilies) {
+        bufferInfo.sharingMode = VK_SHARING_MODE_CONCURRENT;
+        bufferInfo.queueFamilyIndexCount = queueFamilyCount;
+        bufferInfo.pQueueFamilyIndices = queueFamilies;
+    }
+    VkResult result = vkCreateBuffer(m_dev, &bufferInfo, nullptr, &buffer);
+    if (result != VK_SUCCESS) return result;
+
+    result = AllocateForBuffer(buffer, properties, allocation);
+    if (result != VK_SUCCESS) {
+        vkDestroyBuffer(m_dev, buffer, nullptr);
+        buffer = VK_NULL_HANDLE;
+        Free(allocation);
+    }
+    return result;
+}
+
+void GpuAllocator::DestroyBuffer(VkBuffer& buffer, GpuAllocation& allocation) {
+    if (buffer != VK_NULL_HANDLE) vkDestroyBuffer(m_dev, buffer, nullptr);
+    buffer = VK_NULL_HANDLE;
+    Free(allocation);
+}
+
+void GpuAllocator::DestroyImage(VkImage& image, GpuAllocation& allocation) {
+    if (image != VK_NULL_HANDLE) vkDestroyImage(m_dev, image, nullptr);
+    image = VK_NULL_HANDLE;
+    Free(allocation);
+}
+
+GpuAllocatorStats GpuAllocator::GetStats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    GpuAllocatorStats stats;
+    stats.dedicatedCount = m_dedicatedCount;
+    stats.allocationCount = m_allocationCount;
+    stats.usedBytes = m_usedBytes;
+    stats.reservedBytes = m_dedicatedBytes;
+    for (const auto& pool : m_pools) {
+        for (const auto& block : pool.blocks) {
+            stats.blockCount++;
+            stats.reservedBytes += block->Size();
+            stats.freeBytes += block->FreeBytes();
+            stats.largestFreeRange = std::max(stats.largestFreeRange, block->LargestFreeRange());
+        }
+    }
+    if (stats.freeBytes > 0) {
+        stats.fragmentation = 1.0f - float(double(stats.largestFreeRange) / double(stats.freeBytes));
+    }
+    return stats;
+}
+
+} // namespace nova
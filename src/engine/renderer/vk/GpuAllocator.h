@@ -0,0 +1,140 @@
+#pragma once
+
+#ifndef VK_NO_PROTOTYPES
+#define VK_NO_PROTOTYPES
+#endif
+
+#include <volk.h>
+#include <vector>
+#include <set>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+#include "renderer/IRenderer.h"
+
+namespace nova {
+
+class GpuMemoryBlock;
+
+// A suballocated (or dedicated) range of device memory. Host-visible memory is
+// mapped once for the lifetime of its block, so `mapped` is always valid for it.
+struct GpuAllocation {
+    VkDeviceMemory memory = VK_NULL_HANDLE;
+    VkDeviceSize offset = 0;
+    VkDeviceSize size = 0;          // Requested size
+    void* mapped = nullptr;
+    uint32_t memoryType = 0;
+    GpuMemoryBlock* block = nullptr; // nullptr for dedicated allocations
+
+    bool IsValid() const { return memory != VK_NULL_HANDLE; }
+};
+
+struct GpuAllocatorStats {
+    uint32_t blockCount = 0;
+    uint32_t dedicatedCount = 0;
+    uint32_t allocationCount = 0;
+    VkDeviceSize reservedBytes = 0;  // Sum of vkAllocateMemory sizes
+    VkDeviceSize usedBytes = 0;      // Sum of requested sizes
+    VkDeviceSize freeBytes = 0;      // Free space inside blocks
+    VkDeviceSize largestFreeRange = 0;
+    float fragmentation = 0.0f;      // 1 - largestFreeRange / freeBytes
+};
+
+// Buddy suballocator over large VkDeviceMemory blocks, one pool per memory type
+// and resource kind (buffers and images never share a block, which sidesteps
+// bufferImageGranularity). Large requests get a dedicated allocation, tied to
+// its buffer or image through VkMemoryDedicatedAllocateInfo when allocated
+// for one. Everything still live at Shutdown is freed and reported.
+class GpuAllocator {
+public:
+    static constexpr VkDeviceSize DEFAULT_BLOCK_SIZE = 64ull << 20;
+    static constexpr VkDeviceSize MIN_ALLOCATION = 256;
+    static constexpr VkDeviceSize DEDICATED_THRESHOLD = 16ull << 20;
+
+    GpuAllocator();
+    ~GpuAllocator();
+
+    void Init(VkDevice device, VkPhysicalDevice phys, RenderCounters* counters);
+    void Shutdown();
+
+    // Allocate memory for an existing buffer/image and bind it.
+    VkResult AllocateForBuffer(VkBuffer buffer, VkMemoryPropertyFlags properties, GpuAllocation& out);
+    VkResult AllocateForImage(VkImage image, VkMemoryPropertyFlags properties, GpuAllocation& out);
+    // Unbound memory, e.g. shared by aliased resources; a dedicated allocation
+    // made here is not tied to any one resource
+    VkResult Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool image,
+                      GpuAllocation& out);
+    void Free(GpuAllocation& allocation);
+
+    // Convenience: create + allocate + bind in one call. More than one queue
+    // family makes the buffer VK_SHARING_MODE_CONCURRENT across them.
+    VkResult CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties,
+                          VkBuffer& buffer, GpuAllocation& allocation,
+                          uint32_t queueFamilyCount = 0, const uint32_t* queueFamilies = nullptr);
+    void DestroyBuffer(VkBuffer& buffer, GpuAllocation& allocation);
+    void DestroyImage(VkImage& image, GpuAllocation& allocation);
+
+    GpuAllocatorStats GetStats() const;
+    uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) const;
+
+private:
+    struct Pool {
+        uint32_t memoryType = 0;
+        bool image = false;
+        std::vector<std::unique_ptr<GpuMemoryBlock>> blocks;
+    };
+
+    // `buffer` or `image` (at most one) is the resource a dedicated allocation is for
+    VkResult Allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool image,
+                      VkBuffer dedicatedBuffer, VkImage dedicatedImage, GpuAllocation& out);
+    VkResult AllocateDedicated(VkDeviceSize size, uint32_t memoryType, VkBuffer buffer, VkImage image,
+                               GpuAllocation& out);
+    VkResult AllocateDeviceMemory(VkDeviceSize size, uint32_t memoryType, VkDeviceMemory& memory, void*& mapped,
+                                  const void* pNext = nullptr);
+    void FreeDeviceMemory(VkDeviceMemory memory, void* mapped);
+    Pool& GetPool(uint32_t memoryType, bool image);
+    VkDeviceSize BlockSizeFor(uint32_t memoryType) const;
+
+    VkDevice m_dev = VK_NULL_HANDLE;
+    VkPhysicalDeviceMemoryProperties m_memProperties{};
+    RenderCounters* m_counters = nullptr;
+    std::vector<Pool> m_pools;
+    std::unordered_map<VkDeviceMemory, void*> m_dedicated; // Live dedicated memory -> mapping
+    mutable std::mutex m_mutex;
+
+    uint32_t m_dedicatedCount = 0;
+    VkDeviceSize m_dedicatedBytes = 0;
+    uint32_t m_allocationCount = 0;
+    VkDeviceSize m_usedBytes = 0;
+};
+
+// One VkDeviceMemory carved up by a binary buddy allocator.
+class GpuMemoryBlock {
+public:
+    GpuMemoryBlock(VkDeviceMemory memory, VkDeviceSize size, void* mapped);
+
+    bool Allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset);
+    void Free(VkDeviceSize offset);
+
+    VkDeviceMemory Memory() const { return m_memory; }
+    void* Mapped() const { return m_mapped; }
+    VkDeviceSize Size() const { return m_size; }
+    VkDeviceSize FreeBytes() const { return m_freeBytes; }
+    VkDeviceSize LargestFreeRange() const;
+    bool Empty() const { return m_freeBytes == m_size; }
+
+private:
+    uint32_t OrderFor(VkDeviceSize size) const;
+    VkDeviceSize OrderSize(uint32_t order) const { return GpuAllocator::MIN_ALLOCATION << order; }
+
+    VkDeviceMemory m_memory = VK_NULL_HANDLE;
+    VkDeviceSize m_size = 0;
+    void* m_mapped = nullptr;
+    uint32_t m_maxOrder = 0;
+    VkDeviceSize m_freeBytes = 0;
+    std::vector<std::set<VkDeviceSize>> m_freeLists;      // Offsets of free nodes per order
+    std::unordered_map<VkDeviceSize, uint32_t> m_allocated; // Offset -> order
+};
+
+} // namespace nova
@@ -0,0 +1,123 @@
+#include "GpuProfiler.h"
+#include "VulkanHelpers.h"
+#include "core/Log.h"
+#include "core/Profiler.h"
+#include <algorithm>
+
+namespace nova {
+
+void GpuProfiler::Init(VkDevice device, VkPhysicalDevice phys, uint32_t queueFamily, uint32_t framesInFlight) {
+    m_dev = device;
+
+    VkPhysicalDeviceProperties props{};
+    vkGetPhysicalDeviceProperties(phys, &props);
+    uint32_t familyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(phys, &familyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> families(familyCount);
+    vkGetPhysicalDeviceQueueFamilyProperties(phys, &familyCount, families.data());
+
+    uint32_t validBits = queueFamily < familyCount ? families[queueFamily].timestampValidBits : 0;
+    if (validBits == 0 || props.limits.timestampPeriod == 0.0f) {
+        NOVA_WARN("GPU timestamps not supported on this queue, GPU pass timings disabled");
+        m_supported = false;
+        return;
+    }
+    m_timestampPeriod = props.limits.timestampPeriod;
+    m_timestampMask = validBits >= 64 ? ~0ull : ((1ull << validBits) - 1);
+
+    m_frames.resize(framesInFlight);
+    for (auto& frame : m_frames) {
+        VkQueryPoolCreateInfo qi{ VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+        qi.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        qi.queryCount = MAX_PASSES * 2;
+        VK_CHECK(vkCreateQueryPool(m_dev, &qi, nullptr, &frame.pool));
+    }
+    m_supported = true;
+    NOVA_INFO("GPU profiler ready (" + std::to_string(framesInFlight) + " query pools, period " +
+              std::to_string(m_timestampPeriod) + " ns, " + std::to_string(validBits) + " valid bits)");
+}
+
+void GpuProfiler::Shutdown() {
+    for (auto& frame : m_frames) {
+        if (frame.pool) vkDestroyQueryPool(m_dev, frame.pool, nullptr);
+    }
+    m_frames.clear();
+    m_results.clear();
+    m_supported = false;
+}
+
+void GpuProfiler::BeginFrame(VkCommandBuffer cmd, uint32_t frameIndex) {
+    if (!m_supported || frameIndex >= m_frames.size()) return;
+    m_activeFrame = frameIndex;
+    auto& frame = m_frames[frameIndex];
+
+    // The caller has already waited on this slot's fence, so the previous
+    // submission's queries are complete and can be read back without blocking.
+    if (frame.pending) CollectResults(frame);
+
+    vkCmdResetQueryPool(cmd, frame.pool, 0, MAX_PASSES * 2);
+    frame.passes.clear();
+    frame.queryCount = 0;
+    frame.pending = false;
+    m_openPasses.clear();
+}
+
+void GpuProfiler::BeginPass(VkCommandBuffer cmd, const char* name) {
+    if (!m_supported) return;
+    auto& frame = m_frames[m_activeFrame];
+    if (frame.queryCount + 2 > MAX_PASSES * 2) return;
+
+    PassRecord pass;
+    pass.name = name;
+    pass.beginQuery = frame.queryCount++;
+    pass.endQuery = frame.queryCount++;
+    vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, frame.pool, pass.beginQuery);
+    m_openPasses.push_back(static_cast<uint32_t>(frame.passes.size()));
+    frame.passes.push_back(std::move(pass));
+    frame.pending = true;
+}
+
+void GpuProfiler::EndPass(VkCommandBuffer cmd) {
+    if (!m_supported || m_openPasses.empty()) return;
+    auto& frame = m_frames[m_activeFrame];
+    const auto& pass = frame.passes[m_openPasses.back()];
+    m_openPasses.pop_back();
+    vkCmdWriteTimestamp(cmd, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, frame.pool, pass.endQuery);
+}
+
+void GpuProfiler::CollectResults(FrameQueries& frame) {
+    frame.pending = false;
+    if (frame.queryCount == 0) return;
+
+    // Pairs of (timestamp, availability)
+    std::vector<uint64_t> data(frame.queryCount * 2, 0);
+    VkResult res = vkGetQueryPoolResults(m_dev, frame.pool, 0, frame.queryCount,
+                                         data.size() * sizeof(uint64_t), data.data(), sizeof(uint64_t) * 2,
+                                         VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+    if (res != VK_SUCCESS && res != VK_NOT_READY) return;
+
+    m_results.clear();
+    uint64_t frameBegin = ~0ull, frameEnd = 0;
+    for (const auto& pass : frame.passes) {
+        uint64_t begin = data[pass.beginQuery * 2] & m_timestampMask;
+        uint64_t end = data[pass.endQuery * 2] & m_timestampMask;
+        bool available = data[pass.beginQuery * 2 + 1] != 0 && data[pass.endQuery * 2 + 1] != 0;
+        if (!available || end < begin) continue;
+        frameBegin = std::min(frameBegin, begin);
+        frameEnd = std::max(frameEnd, end);
+    }
+    for (const auto& pass : frame.passes) {
+        uint64_t begin = data[pass.beginQuery * 2] & m_timestampMask;
+        uint64_t end = data[pass.endQuery * 2] & m_timestampMask;
+        bool available = data[pass.beginQuery * 2 + 1] != 0 && data[pass.endQuery * 2 + 1] != 0;
+        if (!available || end < begin) continue;
+        double startMs = double(begin - frameBegin) * m_timestampPeriod * 1e-6;
+        double durMs = double(end - begin) * m_timestampPeriod * 1e-6;
+        m_results.push_back({ pass.name, float(durMs) });
+        Profiler::AddEvent(pass.name, "gpu", startMs, durMs);
+    }
+    m_frameTimeMs = frameEnd > frameBegin ? float(double(frameEnd - frameBegin) * m_timestampPeriod * 1e-6) : 0.0f;
+    Profiler::AddCounter("GPU ms", m_frameTimeMs);
+}
+
+} // namespace nova
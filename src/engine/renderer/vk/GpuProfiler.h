@@ -0,0 +1,61 @@
+#pragma once
+
+#ifndef VK_NO_PROTOTYPES
+#define VK_NO_PROTOTYPES
+#endif
+
+#include <volk.h>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "renderer/IRenderer.h"
+
+namespace nova {
+
+// Per-pass GPU timings via timestamp queries.
+// One query pool per frame in flight; a slot's results are collected the next
+// time that slot is recorded, i.e. after its fence has been waited on, so the
+// readback never stalls the CPU.
+class GpuProfiler {
+public:
+    static constexpr uint32_t MAX_PASSES = 32;
+
+    void Init(VkDevice device, VkPhysicalDevice phys, uint32_t queueFamily, uint32_t framesInFlight);
+    void Shutdown();
+
+    // Call right after vkBeginCommandBuffer (outside any render pass).
+    void BeginFrame(VkCommandBuffer cmd, uint32_t frameIndex);
+    void BeginPass(VkCommandBuffer cmd, const char* name);
+    void EndPass(VkCommandBuffer cmd);
+
+    bool IsSupported() const { return m_supported; }
+    const std::vector<GpuPassTiming>& GetPassTimings() const { return m_results; }
+    float GetFrameTimeMs() const { return m_frameTimeMs; }
+
+private:
+    struct PassRecord {
+        std::string name;
+        uint32_t beginQuery = 0;
+        uint32_t endQuery = 0;
+    };
+    struct FrameQueries {
+        VkQueryPool pool = VK_NULL_HANDLE;
+        std::vector<PassRecord> passes;
+        uint32_t queryCount = 0;
+        bool pending = false;
+    };
+
+    void CollectResults(FrameQueries& frame);
+
+    VkDevice m_dev = VK_NULL_HANDLE;
+    bool m_supported = false;
+    float m_timestampPeriod = 1.0f;   // Nanoseconds per tick
+    uint64_t m_timestampMask = ~0ull;
+    std::vector<FrameQueries> m_frames;
+    uint32_t m_activeFrame = 0;
+    std::vector<uint32_t> m_openPasses;
+    std::vector<GpuPassTiming> m_results;
+    float m_frameTimeMs = 0.0f;
+};
+
+} // namespace nova
@@ -0,0 +1,744 @@
+#include "GpuScene.h"
+#include "VulkanHelpers.h"
+#include "core/Log.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iterator>
+
+namespace nova {
+
+namespace {
+constexpr uint32_t BINDING_COUNT = 8;
+// Draw count, late draw count, occluded count, then draws per LOD
+constexpr uint32_t COUNTER_COUNT = 3 + MAX_MESH_LODS;
+constexpr float UNBOUNDED_RADIUS = 1e30f; // Meshes without bounds are never culled
+constexpr float VALIDATION_SLACK = 1e-3f; // Float differences between CPU and GPU plane tests
+
+struct CullConstants {
+    glm::vec4 planes[Frustum::PlaneCount];
+    uint32_t objectCount;
+    uint32_t meshCount;
+    uint32_t phase;
+    uint32_t historyCount;
+    float lodScale;
+    float lodThreshold;
+    float lodHysteresis;
+};
+static_assert(sizeof(CullConstants) <= 128, "CullConstants must fit the guaranteed push constant range");
+
+// std140 block of occlusion.comp's set 1
+struct OcclusionParams {
+    glm::mat4 viewProjection;
+    glm::vec2 pyramidSize;
+    uint32_t pyramidLevels;
+    uint32_t lateOffset;
+};
+
+struct GpuMeshLod {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    float error;
+    uint32_t pad;
+};
+
+struct GpuMesh {
+    int32_t vertexOffset;
+    uint32_t lodCount;        // 0 = released handle
+    uint32_t pad[2];
+    glm::vec4 dequantize;     // GeometryPool::PositionDequantize
+    GpuMeshLod lods[MAX_MESH_LODS];
+};
+static_assert(sizeof(GpuMesh) == 32 + 16 * MAX_MESH_LODS, "GpuMesh must match the std430 layout in cull_common.glsl");
+
+float MaxScale(const glm::mat4& m) {
+    return std::max(glm::length(glm::vec3(m[0])), std::max(glm::length(glm::vec3(m[1])), glm::length(glm::vec3(m[2]))));
+}
+}
+
+void GpuScene::Init(VkDevice device, GpuAllocator* allocator, GeometryPool* geometry, PipelineCache* pipelines,
+                    FrameTimeline* frames, uint32_t framesInFlight, bool drawIndirectCount) {
+    m_dev = device;
+    m_allocator = allocator;
+    m_geometry = geometry;
+    m_pipelines = pipelines;
+    m_frames = frames;
+    m_slots.resize(std::max(1u, framesInFlight));
+
+    VkDescriptorSetLayoutBinding bindings[BINDING_COUNT]{};
+    for (uint32_t i = 0; i < BINDING_COUNT; ++i) {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = BINDING_COUNT;
+    layoutInfo.pBindings = bindings;
+    VK_CHECK(vkCreateDescriptorSetLayout(m_dev, &layoutInfo, nullptr, &m_setLayout));
+
+    // Set 1 of occlusion.comp: its parameters and the depth pyramid
+    VkDescriptorSetLayoutBinding occlusionBindings[2]{};
+    occlusionBindings[0].binding = 0;
+    occlusionBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    occlusionBindings[0].descriptorCount = 1;
+    occlusionBindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    occlusionBindings[1].binding = 1;
+    occlusionBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    occlusionBindings[1].descriptorCount = 1;
+    occlusionBindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    layoutInfo.bindingCount = 2;
+    layoutInfo.pBindings = occlusionBindings;
+    VK_CHECK(vkCreateDescriptorSetLayout(m_dev, &layoutInfo, nullptr, &m_occlusionSetLayout));
+
+    uint32_t slotCount = static_cast<uint32_t>(m_slots.size());
+    VkDescriptorPoolSize poolSizes[3]{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[0].descriptorCount = BINDING_COUNT * slotCount;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+    poolSizes[1].descriptorCount = slotCount;
+    poolSizes[2].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    poolSizes[2].descriptorCount = slotCount;
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = 2 * slotCount;
+    poolInfo.poolSizeCount = 3;
+    poolInfo.pPoolSizes = poolSizes;
+    VK_CHECK(vkCreateDescriptorPool(m_dev, &poolInfo, nullptr, &m_descriptorPool));
+
+    std::vector<VkDescriptorSetLayout> layouts(m_slots.size(), m_setLayout);
+    layouts.resize(2 * m_slots.size(), m_occlusionSetLayout);
+    std::vector<VkDescriptorSet> sets(layouts.size());
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.descriptorSetCount = static_cast<uint32_t>(sets.size());
+    allocInfo.pSetLayouts = layouts.data();
+    VK_CHECK(vkAllocateDescriptorSets(m_dev, &allocInfo, sets.data()));
+    for (size_t i = 0; i < m_slots.size(); ++i) {
+        m_slots[i].set = sets[i];
+        m_slots[i].occlusionSet = sets[m_slots.size() + i];
+    }
+
+    // Start small; slots grow on demand in BeginFrame
+    EnsureHistoryCapacity(0, 0);
+    for (auto& slot : m_slots) {
+        EnsureObjectCapacity(slot, 0);
+        EnsureMeshCapacity(slot, 0);
+        if (!CreateBuffer(slot.occlusionParams, sizeof(OcclusionParams), VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, true)) {
+            NOVA_ERROR("GpuScene: failed to allocate occlusion parameters");
+            continue;
+        }
+        VkDescriptorBufferInfo paramsInfo{ slot.occlusionParams.buffer, 0, VK_WHOLE_SIZE };
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = slot.occlusionSet;
+        write.dstBinding = 0;
+        write.descriptorCount = 1;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        write.pBufferInfo = &paramsInfo;
+        vkUpdateDescriptorSets(m_dev, 1, &write, 0, nullptr);
+    }
+
+    if (!drawIndirectCount) {
+        NOVA_WARN("GpuScene: drawIndirectCount/multiDrawIndirect unsupported, using CPU culling");
+    } else if (CreatePipeline()) {
+        NOVA_INFO("GpuScene ready: compute culling with indirect count draws");
+        CreateOcclusionPipeline();
+    }
+}
+
+void GpuScene::Shutdown() {
+    if (m_dev == VK_NULL_HANDLE) return;
+    for (auto& slot : m_slots) {
+        DestroyBuffer(slot.objects);
+        DestroyBuffer(slot.meshes);
+        DestroyBuffer(slot.commands);
+        DestroyBuffer(slot.count);
+        DestroyBuffer(slot.instances);
+        DestroyBuffer(slot.visible);
+        DestroyBuffer(slot.readback);
+        DestroyBuffer(slot.occlusionParams);
+    }
+    m_slots.clear();
+    DestroyBuffer(m_visibility);
+    DestroyBuffer(m_lodHistory);
+    m_historyCapacity = 0;
+    m_historyCount = 0;
+    DestroyRetired(true);
+    if (m_occlusionPipeline != VK_NULL_HANDLE) vkDestroyPipeline(m_dev, m_occlusionPipeline, nullptr);
+    if (m_occlusionPipelineLayout != VK_NULL_HANDLE) vkDestroyPipelineLayout(m_dev, m_occlusionPipelineLayout, nullptr);
+    if (m_pipeline != VK_NULL_HANDLE) vkDestroyPipeline(m_dev, m_pipeline, nullptr);
+    if (m_pipelineLayout != VK_NULL_HANDLE) vkDestroyPipelineLayout(m_dev, m_pipelineLayout, nullptr);
+    if (m_descriptorPool != VK_NULL_HANDLE) vkDestroyDescriptorPool(m_dev, m_descriptorPool, nullptr); // Frees the sets
+    if (m_setLayout != VK_NULL_HANDLE) vkDestroyDescriptorSetLayout(m_dev, m_setLayout, nullptr);
+    if (m_occlusionSetLayout != VK_NULL_HANDLE) vkDestroyDescriptorSetLayout(m_dev, m_occlusionSetLayout, nullptr);
+    m_occlusionPipeline = VK_NULL_HANDLE;
+    m_occlusionPipelineLayout = VK_NULL_HANDLE;
+    m_pipeline = VK_NULL_HANDLE;
+    m_pipelineLayout = VK_NULL_HANDLE;
+    m_descriptorPool = VK_NULL_HANDLE;
+    m_setLayout = VK_NULL_HANDLE;
+    m_occlusionSetLayout = VK_NULL_HANDLE;
+    m_dev = VK_NULL_HANDLE;
+}
+
+uint32_t GpuScene::AddObject(MeshHandle mesh, const glm::mat4& transform, uint32_t material) {
+    if (!mesh.IsValid()) return INVALID_OBJECT;
+
+    GpuObject object;
+    object.transform = transform;
+    object.sphere = mesh.id < m_meshBounds.size() && m_meshBounds[mesh.id].w > 0.0f
+                        ? m_meshBounds[mesh.id]
+                        : glm::vec4(0.0f, 0.0f, 0.0f, UNBOUNDED_RADIUS);
+    object.mesh = mesh.id;
+    object.material = material;
+
+    uint32_t id;
+    if (!m_freeIds.empty()) {
+        id = m_freeIds.back();
+        m_freeIds.pop_back();
+    } else {
+        id = static_cast<uint32_t>(m_idToDense.size());
+        m_idToDense.push_back(INVALID_OBJECT);
+    }
+    uint32_t dense = static_cast<uint32_t>(m_objects.size());
+    m_objects.push_back(object);
+    m_cpuLods.push_back(0);
+    m_denseToId.push_back(id);
+    m_idToDense[id] = dense;
+    MarkDirty(dense);
+    return id;
+}
+
+void GpuScene::UpdateObject(uint32_t object, const glm::mat4& transform) {
+    if (object >= m_idToDense.size() || m_idToDense[object] == INVALID_OBJECT) return;
+    uint32_t dense = m_idToDense[object];
+    m_objects[dense].transform = transform;
+    MarkDirty(dense);
+}
+
+void GpuScene::RemoveObject(uint32_t object) {
+    if (object >= m_idToDense.size() || m_idToDense[object] == INVALID_OBJECT) return;
+
+    // Swap-remove keeps the array dense for the dispatch
+    uint32_t dense = m_idToDense[object];
+    uint32_t last = static_cast<uint32_t>(m_objects.size()) - 1;
+    if (dense != last) {
+        m_objects[dense] = m_objects[last];
+        m_cpuLods[dense] = m_cpuLods[last];
+        m_denseToId[dense] = m_denseToId[last];
+        m_idToDense[m_denseToId[dense]] = dense;
+        MarkDirty(dense);
+    }
+    m_objects.pop_back();
+    m_cpuLods.pop_back();
+    m_denseToId.pop_back();
+    m_idToDense[object] = INVALID_OBJECT;
+    m_freeIds.push_back(object);
+}
+
+void GpuScene::SetMeshBounds(MeshHandle mesh, const glm::vec4& sphere) {
+    if (!mesh.IsValid()) return;
+    if (mesh.id >= m_meshBounds.size()) m_meshBounds.resize(mesh.id + 1, glm::vec4(0.0f));
+    m_meshBounds[mesh.id] = sphere;
+}
+
+void GpuScene::MarkDirty(uint32_t dense) {
+    for (auto& slot : m_slots) {
+        if (slot.fullSync) continue;
+        // Past this point a full copy is cheaper than chasing indices
+        if (slot.dirty.size() >= m_objects.size() / 2 + 64) {
+            slot.fullSync = true;
+            slot.dirty.clear();
+            continue;
+        }
+        slot.dirty.push_back(dense);
+    }
+}
+
+void GpuScene::BeginFrame(uint32_t slotIndex, uint64_t frameNumber) {
+    if (slotIndex >= m_slots.size()) return;
+    Slot& slot = m_slots[slotIndex];
+
+    ReadResults(slot);
+    DestroyRetired(false);
+
+    uint32_t count = static_cast<uint32_t>(m_objects.size());
+    if (!EnsureHistoryCapacity(count, frameNumber)) return;
+    if (!EnsureObjectCapacity(slot, count)) return;
+    // Other slots still point at retired history buffers until they come round
+    if (slot.historyBinding != m_visibility.buffer) WriteDescriptors(slot);
+    auto* mapped = static_cast<GpuObject*>(slot.objects.allocation.mapped);
+    if (slot.fullSync) {
+        if (count > 0) memcpy(mapped, m_objects.data(), size_t(count) * sizeof(GpuObject));
+        slot.fullSync = false;
+    } else {
+        for (uint32_t dense : slot.dirty) {
+            if (dense < count) mapped[dense] = m_objects[dense];
+        }
+    }
+    slot.dirty.clear();
+
+    if (slot.meshVersion != m_geometry->Version()) {
+        uint32_t meshCount = m_geometry->HandleLimit();
+        if (!EnsureMeshCapacity(slot, meshCount)) return;
+        auto* meshes = static_cast<GpuMesh*>(slot.meshes.allocation.mapped);
+        for (uint32_t id = 0; id < meshCount; ++id) {
+            const MeshRange* range = m_geometry->Find(MeshHandle{ id });
+            GpuMesh mesh{};
+            if (range) {
+                mesh.vertexOffset = range->vertexOffset;
+                mesh.lodCount = m_geometry->LodCount(MeshHandle{ id });
+                mesh.dequantize = m_geometry->PositionDequantize(MeshHandle{ id });
+                for (uint32_t lod = 0; lod < mesh.lodCount; ++lod) {
+                    const MeshLodRange* lodRange = m_geometry->FindLod(MeshHandle{ id }, lod);
+                    mesh.lods[lod] = GpuMeshLod{ lodRange->firstIndex, lodRange->indexCount, lodRange->error, 0 };
+                }
+            }
+            meshes[id] = mesh;
+        }
+        slot.meshVersion = m_geometry->Version();
+    }
+}
+
+void GpuScene::RecordCull(VkCommandBuffer cmd, uint32_t slotIndex, const Frustum& frustum, CullPhase phase) {
+    if (!GpuCullingAvailable() || slotIndex >= m_slots.size()) return;
+    Slot& slot = m_slots[slotIndex];
+    slot.dispatched = std::min({ static_cast<uint32_t>(m_objects.size()), slot.objectCapacity, m_historyCapacity });
+    slot.occlusion = phase == CullPhase::Early && OcclusionCullingAvailable();
+    slot.historyCount = slot.occlusion ? std::min(m_historyCount, slot.dispatched) : 0;
+    if (slot.dispatched == 0) return;
+
+    // The late phase of the previous frame wrote the visibility the early
+    // phase reads, and the next late phase rewrites it. A new LOD history
+    // starts every object at level 0.
+    vkCmdFillBuffer(cmd, slot.count.buffer, 0, COUNTER_COUNT * sizeof(uint32_t), 0);
+    if (!m_historyCleared) {
+        vkCmdFillBuffer(cmd, m_lodHistory.buffer, 0, VK_WHOLE_SIZE, 0);
+        m_historyCleared = true;
+    }
+    VkMemoryBarrier clearBarrier{};
+    clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                         VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+    CullConstants constants{};
+    for (int i = 0; i < Frustum::PlaneCount; ++i) constants.planes[i] = frustum.planes[i];
+    constants.objectCount = slot.dispatched;
+    constants.meshCount = std::min(m_geometry->HandleLimit(), slot.meshCapacity);
+    constants.phase = static_cast<uint32_t>(slot.occlusion ? CullPhase::Early : CullPhase::All);
+    constants.historyCount = slot.historyCount;
+    constants.lodScale = m_lodScale;
+    constants.lodThreshold = LodThreshold();
+    constants.lodHysteresis = m_lodSettings.hysteresis;
+
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &slot.set, 0, nullptr);
+    vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+    vkCmdDispatch(cmd, (slot.dispatched + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+
+    // The late phase reads back both phases' results
+    if (!slot.occlusion) RecordReadback(cmd, slot, frustum);
+}
+
+void GpuScene::RecordOcclusionCull(VkCommandBuffer cmd, uint32_t slotIndex, const Frustum& frustum,
+                                   const glm::mat4& viewProjection, const DepthPyramid& pyramid) {
+    if (slotIndex >= m_slots.size()) return;
+    Slot& slot = m_slots[slotIndex];
+    if (!slot.occlusion || slot.dispatched == 0 || pyramid.View() == VK_NULL_HANDLE) return;
+
+    // The slot's fence has been waited, so its set and parameters are idle
+    if (slot.pyramidBinding != pyramid.View()) {
+        VkDescriptorImageInfo pyramidInfo{ pyramid.Sampler(), pyramid.View(), VK_IMAGE_LAYOUT_GENERAL };
+        VkWriteDescriptorSet write{};
+        write.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet = slot.occlusionSet;
+        write.dstBinding = 1;
+        write.descriptorCount = 1;
+        write.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        write.pImageInfo = &pyramidInfo;
+        vkUpdateDescriptorSets(m_dev, 1, &write, 0, nullptr);
+        slot.pyramidBinding = pyramid.View();
+    }
+    auto* params = static_cast<OcclusionParams*>(slot.occlusionParams.allocation.mapped);
+    params->viewProjection = viewProjection;
+    params->pyramidSize = glm::vec2(static_cast<float>(pyramid.Extent().width), static_cast<float>(pyramid.Extent().height));
+    params->pyramidLevels = pyramid.Levels();
+    params->lateOffset = slot.objectCapacity;
+
+    CullConstants constants{};
+    for (int i = 0; i < Frustum::PlaneCount; ++i) constants.planes[i] = frustum.planes[i];
+    constants.objectCount = slot.dispatched;
+    constants.meshCount = std::min(m_geometry->HandleLimit(), slot.meshCapacity);
+    constants.phase = static_cast<uint32_t>(CullPhase::Late);
+    constants.historyCount = slot.historyCount;
+    constants.lodScale = m_lodScale;
+    constants.lodThreshold = LodThreshold();
+    constants.lodHysteresis = m_lodSettings.hysteresis;
+
+    VkDescriptorSet sets[2] = { slot.set, slot.occlusionSet };
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_occlusionPipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_occlusionPipelineLayout, 0, 2, sets, 0, nullptr);
+    vkCmdPushConstants(cmd, m_occlusionPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+    vkCmdDispatch(cmd, (slot.dispatched + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+    m_historyCount = slot.dispatched;
+
+    RecordReadback(cmd, slot, frustum);
+}
+
+void GpuScene::RecordReadback(VkCommandBuffer cmd, Slot& slot, const Frustum& frustum) {
+    // Only for the readback copies; the render graph makes the results visible
+    // to the indirect draw
+    VkMemoryBarrier cullBarrier{};
+    cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    cullBarrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                         1, &cullBarrier, 0, nullptr, 0, nullptr);
+
+    // The draw counts are always read back for stats; the visible lists only when validating
+    VkBufferCopy countCopy{ 0, 0, COUNTER_COUNT * sizeof(uint32_t) };
+    vkCmdCopyBuffer(cmd, slot.count.buffer, slot.readback.buffer, 1, &countCopy);
+    if (m_validate) {
+        VkDeviceSize ids = VkDeviceSize(slot.dispatched) * sizeof(uint32_t);
+        VkDeviceSize lateOffset = VkDeviceSize(slot.objectCapacity) * sizeof(uint32_t);
+        VkBufferCopy idsCopies[2] = {
+            { 0, COUNTER_COUNT * sizeof(uint32_t), ids },
+            { lateOffset, COUNTER_COUNT * sizeof(uint32_t) + lateOffset, ids },
+        };
+        vkCmdCopyBuffer(cmd, slot.visible.buffer, slot.readback.buffer, slot.occlusion ? 2 : 1, idsCopies);
+        CullCpu(frustum, slot.expectInner, -VALIDATION_SLACK);
+        CullCpu(frustum, slot.expectOuter, VALIDATION_SLACK);
+    }
+    VkMemoryBarrier hostBarrier{};
+    hostBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    hostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+                         1, &hostBarrier, 0, nullptr, 0, nullptr);
+
+    slot.resultsPending = true;
+    slot.validationPending = m_validate;
+}
+
+uint32_t GpuScene::RecordDraw(VkCommandBuffer cmd, uint32_t slotIndex, CullPhase phase) {
+    if (!GpuCullingAvailable() || slotIndex >= m_slots.size()) return 0;
+    Slot& slot = m_slots[slotIndex];
+    if (slot.dispatched == 0) return 0;
+    bool late = phase == CullPhase::Late;
+    if (late && !slot.occlusion) return 0;
+
+    // firstInstance is absolute, so both lists share the instance binding
+    VkDeviceSize offset = 0;
+    vkCmdBindVertexBuffers(cmd, 1, 1, &slot.instances.buffer, &offset);
+    VkDeviceSize commandOffset = late ? VkDeviceSize(slot.objectCapacity) * sizeof(VkDrawIndexedIndirectCommand) : 0;
+    VkDeviceSize countOffset = late ? sizeof(uint32_t) : 0;
+    vkCmdDrawIndexedIndirectCount(cmd, slot.commands.buffer, commandOffset, slot.count.buffer, countOffset, slot.dispatched,
+                                  sizeof(VkDrawIndexedIndirectCommand));
+    return 1;
+}
+
+void GpuScene::CullCpu(const Frustum& frustum, std::vector<uint32_t>& visible, float slack) const {
+    visible.clear();
+    for (uint32_t i = 0; i < m_objects.size(); ++i) {
+        if (!m_geometry->Find(MeshHandle{ m_objects[i].mesh })) continue;
+        glm::vec4 sphere = WorldSphere(m_objects[i]);
+        float radius = sphere.w * (1.0f + slack) + slack;
+        if (frustum.IntersectsSphere(glm::vec3(sphere), radius)) visible.push_back(i);
+    }
+}
+
+glm::vec4 GpuScene::WorldSphere(const GpuObject& object) {
+    const glm::mat4& m = object.transform;
+    glm::vec3 center = glm::vec3(m * glm::vec4(glm::vec3(object.sphere), 1.0f));
+    return glm::vec4(center, object.sphere.w * MaxScale(m));
+}
+
+void GpuScene::SelectLodsCpu(const Frustum& frustum, const std::vector<uint32_t>& visible, std::vector<uint8_t>& lods) {
+    lods.resize(visible.size());
+    std::fill(std::begin(m_lastLodDrawn), std::end(m_lastLodDrawn), 0u);
+    const float threshold = LodThreshold();
+    const glm::vec4& nearPlane = frustum.planes[Frustum::Near];
+    for (size_t v = 0; v < visible.size(); ++v) {
+        uint32_t dense = visible[v];
+        MeshHandle mesh{ m_objects[dense].mesh };
+        uint32_t lodCount = std::max(m_geometry->LodCount(mesh), 1u);
+        uint32_t previous = std::min<uint32_t>(m_cpuLods[dense], lodCount - 1);
+
+        // Same selection as SelectLod in cull_common.glsl
+        uint32_t lod = 0;
+        glm::vec4 sphere = WorldSphere(m_objects[dense]);
+        float depth = glm::dot(glm::vec3(nearPlane), glm::vec3(sphere)) + nearPlane.w - sphere.w;
+        if (depth > 0.0f && threshold > 0.0f) {
+            float pixels = m_lodScale * MaxScale(m_objects[dense].transform) / depth;
+            for (uint32_t i = 1; i < lodCount; ++i) {
+                float limit = i > previous ? threshold * (1.0f - m_lodSettings.hysteresis) : threshold;
+                if (m_geometry->FindLod(mesh, i)->error * pixels <= limit) lod = i;
+            }
+        }
+        m_cpuLods[dense] = static_cast<uint8_t>(lod);
+        lods[v] = static_cast<uint8_t>(lod);
+        m_lastLodDrawn[lod]++;
+    }
+}
+
+GpuSceneStats GpuScene::Stats() const {
+    GpuSceneStats stats;
+    stats.objects = ObjectCount();
+    stats.visible = m_lastVisible;
+    stats.lateDrawn = m_lastLateDrawn;
+    stats.occluded = m_lastOccluded;
+    std::copy(std::begin(m_lastLodDrawn), std::end(m_lastLodDrawn), stats.lodDrawn);
+    stats.validatedFrames = m_validatedFrames;
+    stats.mismatchedFrames = m_mismatchedFrames;
+    stats.lastMissing = m_lastMissing;
+    stats.lastExtra = m_lastExtra;
+    return stats;
+}
+
+void GpuScene::ReadResults(Slot& slot) {
+    if (!slot.resultsPending) return;
+    slot.resultsPending = false;
+
+    const auto* data = static_cast<const uint32_t*>(slot.readback.allocation.mapped);
+    uint32_t drawnEarly = std::min(data[0], slot.dispatched);
+    m_lastLateDrawn = slot.occlusion ? std::min(data[1], slot.dispatched) : 0;
+    m_lastOccluded = slot.occlusion ? std::min(data[2], slot.dispatched) : 0;
+    m_lastVisible = drawnEarly + m_lastLateDrawn;
+    std::copy(data + 3, data + COUNTER_COUNT, m_lastLodDrawn);
+    if (!slot.validationPending) return;
+    slot.validationPending = false;
+
+    const uint32_t* ids = data + COUNTER_COUNT;
+    std::vector<uint32_t> drawn(ids, ids + drawnEarly);
+    drawn.insert(drawn.end(), ids + slot.objectCapacity, ids + slot.objectCapacity + m_lastLateDrawn);
+    std::sort(drawn.begin(), drawn.end());
+
+    // Every object visible with shrunken spheres must be drawn, unless the
+    // depth pyramid hid it; every drawn object must be visible with grown spheres
+    std::vector<uint32_t> missing, extra;
+    if (!slot.occlusion) {
+        std::set_difference(slot.expectInner.begin(), slot.expectInner.end(), drawn.begin(), drawn.end(),
+                            std::back_inserter(missing));
+    }
+    std::set_difference(drawn.begin(), drawn.end(), slot.expectOuter.begin(), slot.expectOuter.end(),
+                        std::back_inserter(extra));
+    m_validatedFrames++;
+    m_lastMissing = static_cast<uint32_t>(missing.size());
+    m_lastExtra = static_cast<uint32_t>(extra.size());
+    if (!missing.empty() || !extra.empty()) {
+        m_mismatchedFrames++;
+        NOVA_ERROR("GpuScene: GPU culling disagrees with CPU culling: " + std::to_string(missing.size()) +
+                   " missing, " + std::to_string(extra.size()) + " extra of " + std::to_string(drawn.size()) + " drawn" +
+                   (missing.empty() ? "" : " (first missing object " + std::to_string(missing[0]) + ")"));
+    }
+}
+
+bool GpuScene::EnsureObjectCapacity(Slot& slot, uint32_t count) {
+    if (count <= slot.objectCapacity && slot.objects.buffer != VK_NULL_HANDLE) return true;
+
+    // The slot's fence has been waited, so its old buffers are idle
+    uint32_t capacity = std::max(count, std::max(slot.objectCapacity * 2, 1024u));
+    // Commands, instances and visible ids hold an early and a late list
+    VkDeviceSize lists = 2 * VkDeviceSize(capacity);
+    DestroyBuffer(slot.objects);
+    DestroyBuffer(slot.commands);
+    DestroyBuffer(slot.instances);
+    DestroyBuffer(slot.visible);
+    DestroyBuffer(slot.readback);
+    DestroyBuffer(slot.count);
+    slot.resultsPending = false;
+    slot.validationPending = false;
+    slot.objectCapacity = 0;
+
+    bool ok = CreateBuffer(slot.objects, VkDeviceSize(capacity) * sizeof(GpuObject), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, true) &&
+              CreateBuffer(slot.commands, lists * sizeof(VkDrawIndexedIndirectCommand),
+                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, false) &&
+              CreateBuffer(slot.instances, lists * sizeof(glm::mat4),
+                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, false) &&
+              CreateBuffer(slot.visible, lists * sizeof(uint32_t),
+                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT, false) &&
+              CreateBuffer(slot.readback, (COUNTER_COUNT + lists) * sizeof(uint32_t), VK_BUFFER_USAGE_TRANSFER_DST_BIT, true) &&
+              CreateBuffer(slot.count, COUNTER_COUNT * sizeof(uint32_t),
+                           VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT |
+                               VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, false);
+    if (!ok) {
+        NOVA_ERROR("GpuScene: failed to allocate buffers for " + std::to_string(capacity) + " objects");
+        return false;
+    }
+    slot.objectCapacity = capacity;
+    slot.fullSync = true;
+    slot.dirty.clear();
+    WriteDescriptors(slot);
+    return true;
+}
+
+bool GpuScene::EnsureMeshCapacity(Slot& slot, uint32_t count) {
+    if (count <= slot.meshCapacity && slot.meshes.buffer != VK_NULL_HANDLE) return true;
+    uint32_t capacity = std::max(count, std::max(slot.meshCapacity * 2, 64u));
+    DestroyBuffer(slot.meshes);
+    slot.meshCapacity = 0;
+    if (!CreateBuffer(slot.meshes, VkDeviceSize(capacity) * sizeof(GpuMesh), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, true)) {
+        NOVA_ERROR("GpuScene: failed to allocate mesh table for " + std::to_string(capacity) + " meshes");
+        return false;
+    }
+    slot.meshCapacity = capacity;
+    slot.meshVersion = ~0ull;
+    WriteDescriptors(slot);
+    return true;
+}
+
+bool GpuScene::EnsureHistoryCapacity(uint32_t count, uint64_t frameNumber) {
+    if (count <= m_historyCapacity && m_visibility.buffer != VK_NULL_HANDLE && m_lodHistory.buffer != VK_NULL_HANDLE) return true;
+
+    // Every slot's frames may still read the old buffers; slots rebind the new
+    // ones in BeginFrame. The new ones start without history.
+    for (Buffer* history : { &m_visibility, &m_lodHistory }) {
+        if (history->buffer != VK_NULL_HANDLE) m_retired.push_back(RetiredBuffer{ *history, frameNumber });
+        *history = Buffer{};
+    }
+    uint32_t capacity = std::max(count, std::max(m_historyCapacity * 2, 1024u));
+    m_historyCapacity = 0;
+    m_historyCount = 0;
+    m_historyCleared = false;
+    VkDeviceSize size = VkDeviceSize(capacity) * sizeof(uint32_t);
+    VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    if (!CreateBuffer(m_visibility, size, usage, false) || !CreateBuffer(m_lodHistory, size, usage, false)) {
+        NOVA_ERROR("GpuScene: failed to allocate culling history for " + std::to_string(capacity) + " objects");
+        return false;
+    }
+    m_historyCapacity = capacity;
+    return true;
+}
+
+float GpuScene::LodThreshold() const {
+    return m_lodSettings.enabled ? m_lodSettings.pixelError * std::exp2(m_lodSettings.bias) : 0.0f;
+}
+
+void GpuScene::DestroyRetired(bool all) {
+    // Retired while building frame N: frame N is the last that may use it
+    auto destroy = [&](RetiredBuffer& retired) {
+        if (!all && !m_frames->IsComplete(retired.frameNumber)) return false;
+        DestroyBuffer(retired.buffer);
+        return true;
+    };
+    m_retired.erase(std::remove_if(m_retired.begin(), m_retired.end(), destroy), m_retired.end());
+}
+
+void GpuScene::WriteDescriptors(Slot& slot) {
+    const Buffer* buffers[BINDING_COUNT] = { &slot.objects, &slot.meshes, &slot.commands,
+                                             &slot.count, &slot.instances, &slot.visible, &m_visibility, &m_lodHistory };
+    for (const Buffer* buffer : buffers) {
+        if (buffer->buffer == VK_NULL_HANDLE) return; // Written once everything exists
+    }
+
+    VkDescriptorBufferInfo infos[BINDING_COUNT]{};
+    VkWriteDescriptorSet writes[BINDING_COUNT]{};
+    for (uint32_t i = 0; i < BINDING_COUNT; ++i) {
+        infos[i].buffer = buffers[i]->buffer;
+        infos[i].offset = 0;
+        infos[i].range = VK_WHOLE_SIZE;
+        writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        writes[i].dstSet = slot.set;
+        writes[i].dstBinding = i;
+        writes[i].descriptorCount = 1;
+        writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        writes[i].pBufferInfo = &infos[i];
+    }
+    vkUpdateDescriptorSets(m_dev, BINDING_COUNT, writes, 0, nullptr);
+    slot.historyBinding = m_visibility.buffer;
+}
+
+bool GpuScene::CreateBuffer(Buffer& buffer, VkDeviceSize size, VkBufferUsageFlags usage, bool hostVisible) {
+    VkMemoryPropertyFlags props = hostVisible ? VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+                                              : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    VkResult result = m_allocator->CreateBuffer(size, usage, props, buffer.buffer, buffer.allocation);
+    if (result != VK_SUCCESS) {
+        DestroyBuffer(buffer);
+        return false;
+    }
+    return true;
+}
+
+void GpuScene::DestroyBuffer(Buffer& buffer) {
+    m_allocator->DestroyBuffer(buffer.buffer, buffer.allocation);
+}
+
+bool GpuScene::CreatePipeline() {
+    VkShaderModule shader = m_pipelines->GetShaderModule("assets/shaders/cull.comp.spv");
+    if (shader == VK_NULL_HANDLE) {
+        NOVA_WARN("GpuScene: cull shader unavailable, using CPU culling");
+        return false;
+    }
+
+    VkPushConstantRange pushRange{};
+    pushRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushRange.offset = 0;
+    pushRange.size = sizeof(CullConstants);
+
+    VkPipelineLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layoutInfo.setLayoutCount = 1;
+    layoutInfo.pSetLayouts = &m_setLayout;
+    layoutInfo.pushConstantRangeCount = 1;
+    layoutInfo.pPushConstantRanges = &pushRange;
+    VK_CHECK(vkCreatePipelineLayout(m_dev, &layoutInfo, nullptr, &m_pipelineLayout));
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shader;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = m_pipelineLayout;
+    VkResult result = m_pipelines->CreateComputePipeline(pipelineInfo, &m_pipeline);
+    if (result != VK_SUCCESS) {
+        NOVA_ERROR("GpuScene: failed to create cull pipeline: " + std::to_string(result));
+        m_pipeline = VK_NULL_HANDLE;
+        return false;
+    }
+    return true;
+}
+
+bool GpuScene::CreateOcclusionPipeline() {
+    VkShaderModule shader = m_pipelines->GetShaderModule("assets/shaders/occlusion.comp.spv");
+    if (shader == VK_NULL_HANDLE) {
+        NOVA_WARN("GpuScene: occlusion shader unavailable, occlusion culling disabled");
+        return false;
+    }
+
+    VkPushConstantRange pushRange{};
+    pushRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushRange.offset = 0;
+    pushRange.size = sizeof(CullConstants);
+
+    VkDescriptorSetLayout setLayouts[] = { m_setLayout, m_occlusionSetLayout };
+    VkPipelineLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layoutInfo.setLayoutCount = 2;
+    layoutInfo.pSetLayouts = setLayouts;
+    layoutInfo.pushConstantRangeCount = 1;
+    layoutInfo.pPushConstantRanges = &pushRange;
+    VK_CHECK(vkCreatePipelineLayout(m_dev, &layoutInfo, nullptr, &m_occlusionPipelineLayout));
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shader;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = m_occlusionPipelineLayout;
+    VkResult result = m_pipelines->CreateComputePipeline(pipelineInfo, &m_occlusionPipeline);
+    if (result != VK_SUCCESS) {
+        NOVA_ERROR("GpuScene: failed to create occlusion pipeline: " + std::to_string(result));
+        m_occlusionPipeline = VK_NULL_HANDLE;
+        return false;
+    }
+    return true;
+}
+
+} // namespace nova
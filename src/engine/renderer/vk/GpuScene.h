@@ -0,0 +1,233 @@
+#pragma once
+
+#ifndef VK_NO_PROTOTYPES
+#define VK_NO_PROTOTYPES
+#endif
+
+#include <volk.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include "GpuAllocator.h"
+#include "GeometryPool.h"
+#include "PipelineCache.h"
+#include "FrameTimeline.h"
+#include "DepthPyramid.h"
+#include "core/Frustum.h"
+
+namespace nova {
+
+// std430 layout shared with cull_common.glsl
+struct GpuObject {
+    glm::mat4 transform{1.0f};
+    glm::vec4 sphere{0.0f};   // Local-space bounding sphere
+    uint32_t mesh = 0;        // MeshHandle id
+    uint32_t material = 0;
+    uint32_t pad[2] = {};
+};
+static_assert(sizeof(GpuObject) == 96, "GpuObject must match the std430 layout in cull_common.glsl");
+
+struct GpuSceneStats {
+    uint32_t objects = 0;
+    uint32_t visible = 0;            // GPU path: read back, lags by the frames-in-flight count
+    uint32_t lateDrawn = 0;          // Of those, drawn by the late occlusion phase
+    uint32_t occluded = 0;           // In the frustum but behind the depth pyramid
+    uint32_t lodDrawn[MAX_MESH_LODS] = {}; // Drawn objects by level of detail, GPU or CPU path
+    uint64_t validatedFrames = 0;
+    uint64_t mismatchedFrames = 0;
+    uint32_t lastMissing = 0;        // Visible on the CPU but not drawn by the GPU
+    uint32_t lastExtra = 0;          // Drawn by the GPU but culled on the CPU
+};
+
+// Persistent per-object data for GPU-driven rendering. Objects live in a dense
+// array mirrored into one host-visible SSBO per frame slot; only objects that
+// changed are copied when a slot comes around again. cull.comp frustum-culls
+// every object and writes compacted VkDrawIndexedIndirectCommands plus their
+// instance transforms, which the main pass consumes with a single
+// vkCmdDrawIndexedIndirectCount, so CPU cost does not depend on object count.
+// CullCpu is the same test on the CPU, used as a fallback where compute
+// culling or drawIndirectCount is unavailable and to validate the GPU results.
+//
+// Occlusion culling splits the frame in two. The early phase draws the objects
+// the previous frame found visible; a Hi-Z pyramid is built from the depth
+// they leave, and the late phase (occlusion.comp) tests every object in the
+// frustum against it, records the result for the next frame and draws the
+// visible objects the early phase missed. Objects that stay hidden behind
+// others cost one test per frame and no draw.
+//
+// Every drawn object also picks a level of detail: the coarsest whose error,
+// projected to pixels at the sphere's nearest view depth, stays under
+// LodSettings::pixelError * 2^bias. Switching to a coarser level than last
+// time needs the error to fall a further `hysteresis` fraction below that, so
+// objects near a threshold do not flicker between levels. The level drawn last
+// is kept per object (on the GPU and for the CPU path alike); swap-removing
+// an object hands its slot's history to the one moved into it.
+class GpuScene {
+public:
+    static constexpr uint32_t WORKGROUP_SIZE = 64;
+    static constexpr uint32_t INVALID_OBJECT = UINT32_MAX;
+
+    // Matches the phase constants in cull_common.glsl
+    enum class CullPhase : uint32_t { All, Early, Late };
+
+    struct LodSettings {
+        bool enabled = true;
+        float pixelError = 1.0f;       // Largest error allowed on screen, in pixels
+        float bias = 0.0f;             // Scales pixelError by 2^bias; positive is coarser
+        float hysteresis = 0.25f;      // Extra margin, as a fraction of the threshold, to go coarser
+    };
+
+    void Init(VkDevice device, GpuAllocator* allocator, GeometryPool* geometry, PipelineCache* pipelines,
+              FrameTimeline* frames, uint32_t framesInFlight, bool drawIndirectCount);
+    void Shutdown();
+
+    uint32_t AddObject(MeshHandle mesh, const glm::mat4& transform, uint32_t material = 0);
+    void UpdateObject(uint32_t object, const glm::mat4& transform);
+    void RemoveObject(uint32_t object);
+    // Local bounding sphere used for objects added afterwards; meshes without
+    // bounds are never culled.
+    void SetMeshBounds(MeshHandle mesh, const glm::vec4& sphere);
+
+    bool GpuCullingAvailable() const { return m_pipeline != VK_NULL_HANDLE; }
+    bool OcclusionCullingAvailable() const { return m_occlusionPipeline != VK_NULL_HANDLE; }
+    // Draw commands written by RecordCull; stands for all of its outputs
+    VkBuffer IndirectBuffer(uint32_t slot) const { return slot < m_slots.size() ? m_slots[slot].commands.buffer : VK_NULL_HANDLE; }
+    void SetValidation(bool enabled) { m_validate = enabled; }
+    bool Validation() const { return m_validate; }
+    void SetLodSettings(const LodSettings& settings) { m_lodSettings = settings; }
+    const LodSettings& GetLodSettings() const { return m_lodSettings; }
+    // Once per frame before culling: pixels one world unit covers at view
+    // depth 1, i.e. half the viewport height times projection[1][1]
+    void SetLodScale(float pixelsPerUnit) { m_lodScale = pixelsPerUnit; }
+
+    // Call once `slot`'s fence has been waited for `frameNumber`: reads back
+    // that slot's last results, then brings its buffers up to date.
+    void BeginFrame(uint32_t slot, uint64_t frameNumber);
+    // Outside a render pass, before RecordDraw. The draw must wait for the
+    // compute writes to IndirectBuffer(slot) (indirect and vertex input reads).
+    // `phase` is All, or Early when RecordOcclusionCull follows this frame.
+    void RecordCull(VkCommandBuffer cmd, uint32_t slot, const Frustum& frustum, CullPhase phase = CullPhase::All);
+    // The late phase, outside a render pass once the early draws are done and
+    // `pyramid` has been built from their depth. Rewrites IndirectBuffer(slot)
+    // like RecordCull.
+    void RecordOcclusionCull(VkCommandBuffer cmd, uint32_t slot, const Frustum& frustum, const glm::mat4& viewProjection,
+                             const DepthPyramid& pyramid);
+    // Inside the render pass with the geometry pool bound; Late draws what the
+    // late phase added, the others what RecordCull kept. Returns draw calls issued.
+    uint32_t RecordDraw(VkCommandBuffer cmd, uint32_t slot, CullPhase phase = CullPhase::All);
+
+    // Dense object indices that pass the frustum test, in object order. `slack`
+    // grows (positive) or shrinks (negative) every sphere by that fraction.
+    void CullCpu(const Frustum& frustum, std::vector<uint32_t>& visible, float slack = 0.0f) const;
+    // Level of detail for each of CullCpu's `visible` objects, as the GPU
+    // path selects it; updates their history and the LOD stats
+    void SelectLodsCpu(const Frustum& frustum, const std::vector<uint32_t>& visible, std::vector<uint8_t>& lods);
+    static glm::vec4 WorldSphere(const GpuObject& object);
+
+    uint32_t ObjectCount() const { return static_cast<uint32_t>(m_objects.size()); }
+    const GpuObject& Object(uint32_t dense) const { return m_objects[dense]; }
+    GpuSceneStats Stats() const;
+
+private:
+    struct Buffer {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        GpuAllocation allocation;
+    };
+    struct Slot {
+        Buffer objects;       // Host visible
+        Buffer meshes;        // Host visible
+        // Device local, written by cull.comp and occlusion.comp. Commands,
+        // instances and visible ids hold two lists: the late phase's starts
+        // at objectCapacity.
+        Buffer commands;
+        Buffer count;         // Draw count, late draw count, occluded count
+        Buffer instances;
+        Buffer visible;
+        Buffer readback;      // Host visible: the counts followed by both lists of visible object ids
+        Buffer occlusionParams; // Host visible, for occlusion.comp
+        uint32_t objectCapacity = 0;
+        uint32_t meshCapacity = 0;
+        uint64_t meshVersion = ~0ull;
+        VkDescriptorSet set = VK_NULL_HANDLE;
+        VkDescriptorSet occlusionSet = VK_NULL_HANDLE;
+        VkBuffer historyBinding = VK_NULL_HANDLE;      // m_visibility when `set` was written
+        VkImageView pyramidBinding = VK_NULL_HANDLE;   // Depth pyramid view in `occlusionSet`
+        std::vector<uint32_t> dirty;   // Dense indices changed since this slot was synced
+        bool fullSync = true;
+        uint32_t dispatched = 0;       // Objects culled by the last RecordCull
+        uint32_t historyCount = 0;     // Visibility entries its early phase trusted
+        bool occlusion = false;        // The last cull was split into early and late phases
+        bool resultsPending = false;
+        bool validationPending = false;
+        std::vector<uint32_t> expectInner; // CPU-visible with shrunken spheres: must be drawn
+        std::vector<uint32_t> expectOuter; // CPU-visible with grown spheres: may be drawn
+    };
+
+    struct RetiredBuffer {
+        Buffer buffer;
+        uint64_t frameNumber = 0;      // Last frame that may use it
+    };
+
+    void MarkDirty(uint32_t dense);
+    bool EnsureObjectCapacity(Slot& slot, uint32_t count);
+    bool EnsureMeshCapacity(Slot& slot, uint32_t count);
+    bool EnsureHistoryCapacity(uint32_t count, uint64_t frameNumber);
+    // Projected error allowed in pixels; 0 when LOD selection is off
+    float LodThreshold() const;
+    // Copies the counts, and both id lists when validating, for ReadResults
+    void RecordReadback(VkCommandBuffer cmd, Slot& slot, const Frustum& frustum);
+    void ReadResults(Slot& slot);
+    void WriteDescriptors(Slot& slot);
+    bool CreateBuffer(Buffer& buffer, VkDeviceSize size, VkBufferUsageFlags usage, bool hostVisible);
+    void DestroyBuffer(Buffer& buffer);
+    void DestroyRetired(bool all);
+    bool CreatePipeline();
+    bool CreateOcclusionPipeline();
+
+    VkDevice m_dev = VK_NULL_HANDLE;
+    GpuAllocator* m_allocator = nullptr;
+    GeometryPool* m_geometry = nullptr;
+    PipelineCache* m_pipelines = nullptr;
+    FrameTimeline* m_frames = nullptr;
+    bool m_validate = false;
+
+    VkDescriptorSetLayout m_setLayout = VK_NULL_HANDLE;
+    VkDescriptorSetLayout m_occlusionSetLayout = VK_NULL_HANDLE;
+    VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+    VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_pipeline = VK_NULL_HANDLE;
+    VkPipelineLayout m_occlusionPipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_occlusionPipeline = VK_NULL_HANDLE;
+    std::vector<Slot> m_slots;
+
+    // One visibility and one LOD entry per object, shared by every slot: each
+    // frame's early phase reads what the previous frame's late phase wrote,
+    // and each cull reads the levels the last one drew
+    Buffer m_visibility;
+    Buffer m_lodHistory;
+    uint32_t m_historyCapacity = 0;
+    uint32_t m_historyCount = 0;          // Visibility entries the last late phase wrote
+    bool m_historyCleared = false;        // The LOD history has been zeroed since it was allocated
+    std::vector<RetiredBuffer> m_retired;
+
+    LodSettings m_lodSettings;
+    float m_lodScale = 0.0f;
+    std::vector<uint8_t> m_cpuLods;       // CPU path's LOD history, parallel to m_objects
+
+    std::vector<GpuObject> m_objects;     // Dense, in GPU layout
+    std::vector<uint32_t> m_denseToId;
+    std::vector<uint32_t> m_idToDense;
+    std::vector<uint32_t> m_freeIds;
+    std::vector<glm::vec4> m_meshBounds;  // By MeshHandle id
+
+    uint32_t m_lastVisible = 0;
+    uint32_t m_lastLateDrawn = 0;
+    uint32_t m_lastOccluded = 0;
+    uint32_t m_lastLodDrawn[MAX_MESH_LODS] = {};
+    uint64_t m_validatedFrames = 0;
+    uint64_t m_mismatchedFrames = 0;
+    uint32_t m_lastMissing = 0;
+    uint32_t m_lastExtra = 0;
+};
+
+} // namespace nova
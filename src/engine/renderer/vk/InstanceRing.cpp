@@ -0,0 +1,107 @@
+#include "InstanceRing.h"
+#include "core/Log.h"
+#include <algorithm>
+
+namespace nova {
+
+void InstanceRing::Init(GpuAllocator* allocator, FrameTimeline* frames, uint32_t slots, uint32_t instancesPerFrame) {
+    m_allocator = allocator;
+    m_frames = frames;
+    m_framesInFlight = std::max(1u, slots);
+    m_slices.assign(m_framesInFlight, Slice{});
+    m_capacity = std::max(1u, instancesPerFrame);
+    if (!CreateBlock(m_capacity, m_block)) {
+        m_capacity = 0;
+        return;
+    }
+    NOVA_INFO("Instance ring ready: " + std::to_string(m_framesInFlight) + " x " + std::to_string(m_capacity) +
+              " instances (" + std::to_string(BufferSize() / 1024) + " KB)");
+}
+
+void InstanceRing::Shutdown() {
+    if (!m_allocator) return;
+    for (auto& block : m_retired) DestroyBlock(block);
+    m_retired.clear();
+    DestroyBlock(m_block);
+    m_slices.clear();
+    m_capacity = 0;
+}
+
+InstanceRange InstanceRing::Allocate(uint32_t slot, uint64_t frameNumber, uint32_t count) {
+    InstanceRange range{};
+    if (count == 0 || slot >= m_slices.size()) return range;
+
+    CollectRetired(frameNumber);
+
+    Slice& slice = m_slices[slot];
+    if (slice.frameNumber != frameNumber) {
+        slice.frameNumber = frameNumber;
+        slice.cursor = 0;
+    }
+    if (m_block.buffer == VK_NULL_HANDLE || uint64_t(slice.cursor) + count > m_capacity) {
+        Grow(slice.cursor + count, frameNumber);
+        if (m_block.buffer == VK_NULL_HANDLE) return range;
+    }
+
+    uint32_t first = slot * m_capacity + slice.cursor;
+    slice.cursor += count;
+
+    range.buffer = m_block.buffer;
+    range.firstInstance = first;
+    range.count = count;
+    range.frameNumber = frameNumber;
+    range.data = m_block.mapped + first;
+    return range;
+}
+
+bool InstanceRing::CreateBlock(uint32_t capacity, Block& block) {
+    VkDeviceSize size = VkDeviceSize(capacity) * m_framesInFlight * sizeof(glm::mat4);
+    VkResult result = m_allocator->CreateBuffer(size, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                                                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                                block.buffer, block.allocation);
+    if (result != VK_SUCCESS || !block.allocation.mapped) {
+        NOVA_ERROR("InstanceRing: failed to create " + std::to_string(size) + " byte buffer: " + std::to_string(result));
+        DestroyBlock(block);
+        return false;
+    }
+    block.mapped = static_cast<glm::mat4*>(block.allocation.mapped);
+    return true;
+}
+
+void InstanceRing::DestroyBlock(Block& block) {
+    m_allocator->DestroyBuffer(block.buffer, block.allocation);
+    block = Block{};
+}
+
+void InstanceRing::Grow(uint32_t minCapacity, uint64_t frameNumber) {
+    uint32_t newCapacity = std::max(minCapacity, m_capacity * 2);
+    Block block;
+    if (!CreateBlock(newCapacity, block)) return;
+
+    // Ranges handed out earlier this frame keep pointing at the old block,
+    // which stays alive until this frame has completed.
+    if (m_block.buffer != VK_NULL_HANDLE) {
+        m_block.retireFrame = frameNumber;
+        m_retired.push_back(m_block);
+    }
+    m_block = block;
+    m_capacity = newCapacity;
+    m_growCount++;
+    for (auto& slice : m_slices) slice.cursor = 0;
+
+    NOVA_WARN("InstanceRing: grew to " + std::to_string(m_capacity) + " instances per frame (" +
+              std::to_string(BufferSize() / 1024) + " KB)");
+}
+
+void InstanceRing::CollectRetired(uint64_t frameNumber) {
+    // Besides the GPU, the CPU may still copy a range of the retiring frame
+    // forward out of the block while recording the next one.
+    auto done = [&](Block& block) {
+        if (frameNumber <= block.retireFrame + 1 || !m_frames->IsComplete(block.retireFrame)) return false;
+        DestroyBlock(block);
+        return true;
+    };
+    m_retired.erase(std::remove_if(m_retired.begin(), m_retired.end(), done), m_retired.end());
+}
+
+} // namespace nova
@@ -0,0 +1,72 @@
+#pragma once
+
+#ifndef VK_NO_PROTOTYPES
+#define VK_NO_PROTOTYPES
+#endif
+
+#include <volk.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include "GpuAllocator.h"
+#include "FrameTimeline.h"
+
+namespace nova {
+
+// A contiguous run of instance matrices inside the ring. Bind `buffer` at
+// offset 0 on the instance binding and draw with `firstInstance`.
+struct InstanceRange {
+    VkBuffer buffer = VK_NULL_HANDLE;
+    uint32_t firstInstance = 0;
+    uint32_t count = 0;
+    uint64_t frameNumber = 0;   // Frame the range was written for
+    glm::mat4* data = nullptr;  // Persistently mapped, host coherent
+};
+
+// Persistently mapped instance buffer split into one slice per frame in flight.
+// Ranges are suballocated linearly from the slice of the frame being recorded
+// and the cursor rewinds the first time a slot is used in a new frame, so an
+// update is a single memcpy with no Vulkan object churn. When a slice runs out
+// the whole ring is reallocated at twice the size; the old buffer stays alive
+// until every frame that may still read it has completed.
+class InstanceRing {
+public:
+    // `slots` is the most frames that can be in flight at once
+    void Init(GpuAllocator* allocator, FrameTimeline* frames, uint32_t slots, uint32_t instancesPerFrame);
+    void Shutdown();
+
+    // The caller must have waited for the frame that last used `slot`.
+    InstanceRange Allocate(uint32_t slot, uint64_t frameNumber, uint32_t count);
+
+    uint32_t CapacityPerFrame() const { return m_capacity; }
+    VkDeviceSize BufferSize() const { return VkDeviceSize(m_capacity) * m_framesInFlight * sizeof(glm::mat4); }
+    uint32_t GrowCount() const { return m_growCount; }
+
+private:
+    struct Block {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        GpuAllocation allocation;
+        glm::mat4* mapped = nullptr;
+        uint64_t retireFrame = 0;
+    };
+    struct Slice {
+        uint32_t cursor = 0;
+        uint64_t frameNumber = ~0ull;
+    };
+
+    bool CreateBlock(uint32_t capacity, Block& block);
+    void DestroyBlock(Block& block);
+    void Grow(uint32_t minCapacity, uint64_t frameNumber);
+    void CollectRetired(uint64_t frameNumber);
+
+    GpuAllocator* m_allocator = nullptr;
+    FrameTimeline* m_frames = nullptr;
+    uint32_t m_framesInFlight = 0;  // Slots
+    uint32_t m_capacity = 0;     // Instances per slice
+    uint32_t m_growCount = 0;
+    Block m_block;
+    std::vector<Slice> m_slices;
+    std::vector<Block> m_retired;
+};
+
+} // namespace nova
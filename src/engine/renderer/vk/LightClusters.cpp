@@ -0,0 +1,298 @@
+#include "LightClusters.h"
+#include "VulkanHelpers.h"
+#include "core/Log.h"
+#include <algorithm>
+#include <cmath>
+
+namespace nova {
+
+namespace {
+constexpr uint32_t BINDING_COUNT = 4;
+
+struct BinConstants {
+    glm::mat4 view;
+    glm::vec4 projection;   // P[0][0], P[1][1], P[2][0], P[2][1]
+    float zNear;
+    float zFar;
+    uint32_t firstLight;    // Clustered lights follow the global ones
+    uint32_t lightCount;
+};
+
+// Lights that reach every cluster are not binned
+bool IsGlobal(const Light& light) {
+    return light.type == LightType::Directional || light.range <= 0.0f;
+}
+
+GpuLight ToGpuLight(const Light& light) {
+    GpuLight gpu;
+    gpu.positionRange = glm::vec4(light.position, std::max(light.range, 0.0f));
+    gpu.colorType = glm::vec4(light.color * light.intensity, static_cast<float>(light.type));
+    float length = glm::length(light.direction);
+    glm::vec3 direction = length > 0.0f ? light.direction / length : glm::vec3(0.0f, -1.0f, 0.0f);
+    // spotAngle is the half-angle of the cone; spotBlend the fraction of it that fades out
+    float cosOuter = std::cos(glm::radians(std::clamp(light.spotAngle, 0.0f, 89.0f)));
+    float cosInner = std::cos(glm::radians(std::clamp(light.spotAngle * (1.0f - light.spotBlend), 0.0f, 89.0f)));
+    gpu.directionCos = glm::vec4(direction, cosOuter);
+    gpu.attenuation = glm::vec4(light.constant, light.linear, light.quadratic, std::max(cosInner, cosOuter + 1e-4f));
+    return gpu;
+}
+}
+
+bool LightClusters::Init(VkDevice device, GpuAllocator* allocator, UploadManager* uploads, PipelineCache* pipelines,
+                         uint32_t framesInFlight) {
+    m_dev = device;
+    m_allocator = allocator;
+    m_uploads = uploads;
+    m_pipelines = pipelines;
+    m_slots.resize(std::max(1u, framesInFlight));
+
+    VkDescriptorSetLayoutBinding bindings[BINDING_COUNT]{};
+    for (uint32_t i = 0; i < BINDING_COUNT; ++i) {
+        bindings[i].binding = i;
+        bindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        bindings[i].descriptorCount = 1;
+        bindings[i].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = BINDING_COUNT;
+    layoutInfo.pBindings = bindings;
+    VK_CHECK(vkCreateDescriptorSetLayout(m_dev, &layoutInfo, nullptr, &m_setLayout));
+
+    VkDescriptorPoolSize poolSize{};
+    poolSize.type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSize.descriptorCount = BINDING_COUNT * static_cast<uint32_t>(m_slots.size());
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.maxSets = static_cast<uint32_t>(m_slots.size());
+    poolInfo.poolSizeCount = 1;
+    poolInfo.pPoolSizes = &poolSize;
+    VK_CHECK(vkCreateDescriptorPool(m_dev, &poolInfo, nullptr, &m_descriptorPool));
+
+    std::vector<VkDescriptorSetLayout> layouts(m_slots.size(), m_setLayout);
+    std::vector<VkDescriptorSet> sets(m_slots.size());
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.descriptorPool = m_descriptorPool;
+    allocInfo.descriptorSetCount = static_cast<uint32_t>(sets.size());
+    allocInfo.pSetLayouts = layouts.data();
+    VK_CHECK(vkAllocateDescriptorSets(m_dev, &allocInfo, sets.data()));
+
+    for (size_t i = 0; i < m_slots.size(); ++i) {
+        Slot& slot = m_slots[i];
+        slot.set = sets[i];
+        bool ok = CreateBuffer(slot.lights, VkDeviceSize(MAX_LIGHTS) * sizeof(GpuLight),
+                               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, false, true) &&
+                  CreateBuffer(slot.counts, VkDeviceSize(CLUSTER_COUNT) * sizeof(uint32_t),
+                               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, false) &&
+                  CreateBuffer(slot.indices, VkDeviceSize(CLUSTER_COUNT) * MAX_LIGHTS_PER_CLUSTER * sizeof(uint32_t),
+                               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, false) &&
+                  CreateBuffer(slot.stats, 2 * sizeof(uint32_t),
+                               VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, true);
+        if (!ok) {
+            NOVA_ERROR("LightClusters: failed to allocate cluster buffers");
+            return false;
+        }
+
+        const Buffer* buffers[BINDING_COUNT] = { &slot.lights, &slot.counts, &slot.indices, &slot.stats };
+        VkDescriptorBufferInfo infos[BINDING_COUNT]{};
+        VkWriteDescriptorSet writes[BINDING_COUNT]{};
+        for (uint32_t b = 0; b < BINDING_COUNT; ++b) {
+            infos[b].buffer = buffers[b]->buffer;
+            infos[b].offset = 0;
+            infos[b].range = VK_WHOLE_SIZE;
+            writes[b].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            writes[b].dstSet = slot.set;
+            writes[b].dstBinding = b;
+            writes[b].descriptorCount = 1;
+            writes[b].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            writes[b].pBufferInfo = &infos[b];
+        }
+        vkUpdateDescriptorSets(m_dev, BINDING_COUNT, writes, 0, nullptr);
+    }
+
+    if (CreatePipeline()) {
+        NOVA_INFO("LightClusters ready: " + std::to_string(CLUSTER_X) + "x" + std::to_string(CLUSTER_Y) + "x" +
+                  std::to_string(CLUSTER_Z) + " clusters, up to " + std::to_string(MAX_LIGHTS) + " lights");
+    }
+    return true;
+}
+
+void LightClusters::Shutdown() {
+    if (m_dev == VK_NULL_HANDLE) return;
+    for (auto& slot : m_slots) {
+        DestroyBuffer(slot.lights);
+        DestroyBuffer(slot.counts);
+        DestroyBuffer(slot.indices);
+        DestroyBuffer(slot.stats);
+    }
+    m_slots.clear();
+    if (m_pipeline != VK_NULL_HANDLE) vkDestroyPipeline(m_dev, m_pipeline, nullptr);
+    if (m_pipelineLayout != VK_NULL_HANDLE) vkDestroyPipelineLayout(m_dev, m_pipelineLayout, nullptr);
+    if (m_descriptorPool != VK_NULL_HANDLE) vkDestroyDescriptorPool(m_dev, m_descriptorPool, nullptr); // Frees the sets
+    if (m_setLayout != VK_NULL_HANDLE) vkDestroyDescriptorSetLayout(m_dev, m_setLayout, nullptr);
+    m_pipeline = VK_NULL_HANDLE;
+    m_pipelineLayout = VK_NULL_HANDLE;
+    m_descriptorPool = VK_NULL_HANDLE;
+    m_setLayout = VK_NULL_HANDLE;
+    m_dev = VK_NULL_HANDLE;
+}
+
+void LightClusters::SetLights(const std::vector<Light>& lights) {
+    m_sourceLights = lights;
+    m_lights.clear();
+    m_globalLights = 0;
+    for (const Light& light : lights) {
+        if (IsGlobal(light) && m_lights.size() < MAX_LIGHTS) m_lights.push_back(ToGpuLight(light));
+    }
+    m_globalLights = static_cast<uint32_t>(m_lights.size());
+    for (const Light& light : lights) {
+        if (!IsGlobal(light) && m_lights.size() < MAX_LIGHTS) m_lights.push_back(ToGpuLight(light));
+    }
+    uint32_t dropped = static_cast<uint32_t>(lights.size() - m_lights.size());
+    if (dropped > 0 && m_droppedLights == 0) {
+        NOVA_WARN("LightClusters: " + std::to_string(lights.size()) + " lights, only the first " +
+                  std::to_string(MAX_LIGHTS) + " are shaded");
+    }
+    m_droppedLights = dropped;
+    m_version++;
+}
+
+uint32_t LightClusters::GlobalLightCount() const {
+    return GpuBinningAvailable() ? m_globalLights : static_cast<uint32_t>(m_lights.size());
+}
+
+void LightClusters::BeginFrame(uint32_t slotIndex) {
+    if (slotIndex >= m_slots.size()) return;
+    Slot& slot = m_slots[slotIndex];
+
+    if (slot.statsPending) {
+        const auto* stats = static_cast<const uint32_t*>(slot.stats.allocation.mapped);
+        m_maxClusterLights = stats[0];
+        m_fullClusters = stats[1];
+        slot.statsPending = false;
+    }
+
+    // The slot's previous frame has completed, so nothing reads its buffer
+    if (slot.version == m_version) return;
+    VkDeviceSize bytes = VkDeviceSize(m_lights.size()) * sizeof(GpuLight);
+    if (bytes > 0) m_uploads->UploadBuffer(slot.lights.buffer, 0, m_lights.data(), bytes);
+    slot.version = m_version;
+}
+
+void LightClusters::RecordBinning(VkCommandBuffer cmd, uint32_t slotIndex, const glm::mat4& view, const glm::mat4& projection,
+                                  float zNear, float zFar) {
+    if (slotIndex >= m_slots.size()) return;
+    Slot& slot = m_slots[slotIndex];
+
+    // Without the compute shader every light is global and the clusters stay empty
+    if (!GpuBinningAvailable()) {
+        vkCmdFillBuffer(cmd, slot.counts.buffer, 0, VK_WHOLE_SIZE, 0);
+        return;
+    }
+
+    vkCmdFillBuffer(cmd, slot.stats.buffer, 0, VK_WHOLE_SIZE, 0);
+    VkMemoryBarrier clearBarrier{};
+    clearBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    clearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    clearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+                         1, &clearBarrier, 0, nullptr, 0, nullptr);
+
+    BinConstants constants{};
+    constants.view = view;
+    constants.projection = glm::vec4(projection[0][0], projection[1][1], projection[2][0], projection[2][1]);
+    constants.zNear = zNear;
+    constants.zFar = std::max(zFar, zNear * 1.001f);
+    constants.firstLight = m_globalLights;
+    constants.lightCount = static_cast<uint32_t>(m_lights.size());
+
+    // Every cluster is written, empty or not, so the counts need no clear
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipelineLayout, 0, 1, &slot.set, 0, nullptr);
+    vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+    vkCmdDispatch(cmd, CLUSTER_X, CLUSTER_Y, CLUSTER_Z);
+
+    // Only for the stats; the render graph makes the clusters visible to the main pass
+    VkMemoryBarrier hostBarrier{};
+    hostBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    hostBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    hostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+                         1, &hostBarrier, 0, nullptr, 0, nullptr);
+    slot.statsPending = true;
+}
+
+glm::vec4 LightClusters::ClusterScale(VkExtent2D extent, float zNear, float zFar) {
+    // Slice of view depth d: log(d) * z + w, so slices are exponentially spaced
+    float logRatio = std::log(std::max(zFar, zNear * 1.001f) / zNear);
+    return glm::vec4(float(CLUSTER_X) / float(std::max(1u, extent.width)), float(CLUSTER_Y) / float(std::max(1u, extent.height)),
+                     float(CLUSTER_Z) / logRatio, -float(CLUSTER_Z) * std::log(zNear) / logRatio);
+}
+
+LightClusterStats LightClusters::Stats() const {
+    LightClusterStats stats;
+    stats.lights = static_cast<uint32_t>(m_lights.size());
+    stats.globalLights = GlobalLightCount();
+    stats.droppedLights = m_droppedLights;
+    stats.maxClusterLights = m_maxClusterLights;
+    stats.fullClusters = m_fullClusters;
+    return stats;
+}
+
+bool LightClusters::CreateBuffer(Buffer& buffer, VkDeviceSize size, VkBufferUsageFlags usage, bool hostVisible,
+                                 bool uploadTarget) {
+    VkMemoryPropertyFlags props = hostVisible ? VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+                                              : VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    VkResult result = uploadTarget
+        ? m_allocator->CreateBuffer(size, usage, props, buffer.buffer, buffer.allocation,
+                                    m_uploads->SharingFamilyCount(), m_uploads->SharingFamilies())
+        : m_allocator->CreateBuffer(size, usage, props, buffer.buffer, buffer.allocation);
+    if (result != VK_SUCCESS) {
+        DestroyBuffer(buffer);
+        return false;
+    }
+    return true;
+}
+
+void LightClusters::DestroyBuffer(Buffer& buffer) {
+    m_allocator->DestroyBuffer(buffer.buffer, buffer.allocation);
+}
+
+bool LightClusters::CreatePipeline() {
+    VkShaderModule shader = m_pipelines->GetShaderModule("assets/shaders/cluster.comp.spv");
+    if (shader == VK_NULL_HANDLE) {
+        NOVA_WARN("LightClusters: cluster shader unavailable, every light is shaded by every fragment");
+        return false;
+    }
+
+    VkPushConstantRange pushRange{};
+    pushRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushRange.offset = 0;
+    pushRange.size = sizeof(BinConstants);
+
+    VkPipelineLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    layoutInfo.setLayoutCount = 1;
+    layoutInfo.pSetLayouts = &m_setLayout;
+    layoutInfo.pushConstantRangeCount = 1;
+    layoutInfo.pPushConstantRanges = &pushRange;
+    VK_CHECK(vkCreatePipelineLayout(m_dev, &layoutInfo, nullptr, &m_pipelineLayout));
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = shader;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = m_pipelineLayout;
+    VkResult result = m_pipelines->CreateComputePipeline(pipelineInfo, &m_pipeline);
+    if (result != VK_SUCCESS) {
+        NOVA_ERROR("LightClusters: failed to create cluster pipeline: " + std::to_string(result));
+        m_pipeline = VK_NULL_HANDLE;
+        return false;
+    }
+    return true;
+}
+
+} // namespace nova
@@ -0,0 +1,131 @@
+#pragma once
+
+#ifndef VK_NO_PROTOTYPES
+#define VK_NO_PROTOTYPES
+#endif
+
+#include <volk.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include "GpuAllocator.h"
+#include "UploadManager.h"
+#include "PipelineCache.h"
+#include "core/Light.h"
+
+namespace nova {
+
+// std430 layout shared with light_common.glsl
+struct GpuLight {
+    glm::vec4 positionRange{0.0f};   // xyz world position, w range (0 = unbounded)
+    glm::vec4 colorType{0.0f};       // rgb color * intensity, w LightType
+    glm::vec4 directionCos{0.0f};    // xyz direction the light points, w cos of the outer cone angle
+    glm::vec4 attenuation{0.0f};     // x constant, y linear, z quadratic, w cos of the inner cone angle
+};
+static_assert(sizeof(GpuLight) == 64, "GpuLight must match the std430 layout in light_common.glsl");
+
+struct LightClusterStats {
+    uint32_t lights = 0;             // Uploaded this frame, global and clustered
+    uint32_t globalLights = 0;       // Directional and unbounded lights, shaded by every fragment
+    uint32_t droppedLights = 0;      // Past MAX_LIGHTS
+    // GPU path: read back, lag by the frames-in-flight count
+    uint32_t maxClusterLights = 0;   // Most lights binned into one cluster
+    uint32_t fullClusters = 0;       // Clusters that hit MAX_LIGHTS_PER_CLUSTER and dropped lights
+};
+
+// Clustered forward lighting. The view frustum is split into a froxel grid:
+// CLUSTER_X x CLUSTER_Y screen tiles times CLUSTER_Z slices, spaced
+// exponentially between the camera's near and far planes. Lights live in one
+// device-local SSBO per frame slot, refreshed through the UploadManager only
+// when SetLights changed them; cluster.comp tests every bounded point and
+// spot light against every cluster's view-space box and writes a count and a
+// fixed-size list of light indices per cluster, which pbr.frag walks for its
+// own cluster only. Directional and unbounded lights light everything and are
+// kept at the front of the buffer, outside the grid. Fragment cost follows the
+// lights near a pixel, not the total light count.
+class LightClusters {
+public:
+    static constexpr uint32_t CLUSTER_X = 16;
+    static constexpr uint32_t CLUSTER_Y = 9;
+    static constexpr uint32_t CLUSTER_Z = 24;
+    static constexpr uint32_t CLUSTER_COUNT = CLUSTER_X * CLUSTER_Y * CLUSTER_Z;
+    static constexpr uint32_t MAX_LIGHTS = 4096;
+    static constexpr uint32_t MAX_LIGHTS_PER_CLUSTER = 128;
+    static constexpr uint32_t WORKGROUP_SIZE = 64;   // One workgroup per cluster
+
+    // Buffers are allocated once at full capacity, so the descriptors that
+    // point at them never change
+    bool Init(VkDevice device, GpuAllocator* allocator, UploadManager* uploads, PipelineCache* pipelines,
+              uint32_t framesInFlight);
+    void Shutdown();
+
+    // Takes effect when each slot next comes round in BeginFrame
+    void SetLights(const std::vector<Light>& lights);
+    const std::vector<Light>& Lights() const { return m_sourceLights; }
+
+    bool GpuBinningAvailable() const { return m_pipeline != VK_NULL_HANDLE; }
+    VkBuffer LightBuffer(uint32_t slot) const { return slot < m_slots.size() ? m_slots[slot].lights.buffer : VK_NULL_HANDLE; }
+    VkBuffer CountBuffer(uint32_t slot) const { return slot < m_slots.size() ? m_slots[slot].counts.buffer : VK_NULL_HANDLE; }
+    VkBuffer IndexBuffer(uint32_t slot) const { return slot < m_slots.size() ? m_slots[slot].indices.buffer : VK_NULL_HANDLE; }
+    // Lights every fragment shades before its cluster's; all of them when
+    // binning is unavailable
+    uint32_t GlobalLightCount() const;
+
+    // Call once `slot`'s fence has been waited: reads back that slot's last
+    // stats, then queues an upload of the lights if they changed since it
+    // last ran. The frame's submission must wait for the UploadManager.
+    void BeginFrame(uint32_t slot);
+    // Outside a render pass. Main-pass fragment shaders must wait for the
+    // compute writes to CountBuffer(slot), which stands for both outputs; the
+    // fallback clears the counts with a transfer instead.
+    void RecordBinning(VkCommandBuffer cmd, uint32_t slot, const glm::mat4& view, const glm::mat4& projection,
+                       float zNear, float zFar);
+
+    // What pbr.frag needs to find its cluster
+    static glm::vec4 ClusterScale(VkExtent2D extent, float zNear, float zFar);
+
+    LightClusterStats Stats() const;
+
+private:
+    struct Buffer {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        GpuAllocation allocation;
+    };
+    struct Slot {
+        Buffer lights;        // Device local, written by the UploadManager
+        Buffer counts;        // Device local, written by cluster.comp
+        Buffer indices;
+        Buffer stats;         // Host visible: max lights in a cluster, full clusters
+        VkDescriptorSet set = VK_NULL_HANDLE;
+        uint64_t version = ~0ull;
+        bool statsPending = false;
+    };
+
+    // `uploadTarget` buffers are shared with the UploadManager's transfer queue
+    bool CreateBuffer(Buffer& buffer, VkDeviceSize size, VkBufferUsageFlags usage, bool hostVisible,
+                      bool uploadTarget = false);
+    void DestroyBuffer(Buffer& buffer);
+    bool CreatePipeline();
+
+    VkDevice m_dev = VK_NULL_HANDLE;
+    GpuAllocator* m_allocator = nullptr;
+    UploadManager* m_uploads = nullptr;
+    PipelineCache* m_pipelines = nullptr;
+
+    VkDescriptorSetLayout m_setLayout = VK_NULL_HANDLE;
+    VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
+    VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_pipeline = VK_NULL_HANDLE;
+    std::vector<Slot> m_slots;
+
+    std::vector<Light> m_sourceLights;
+    std::vector<GpuLight> m_lights;       // Global lights first, in GPU layout
+    uint32_t m_globalLights = 0;
+    uint32_t m_droppedLights = 0;
+    uint64_t m_version = 0;
+
+    uint32_t m_maxClusterLights = 0;
+    uint32_t m_fullClusters = 0;
+};
+
+} // namespace nova
@@ -0,0 +1,280 @@
+#include "PipelineCache.h"
+#include "core/Log.h"
+#include "core/MappedFile.h"
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace nova {
+
+namespace {
+constexpr uint32_t CACHE_MAGIC = 0x4E505043;   // "NPPC"
+constexpr uint32_t CACHE_VERSION = 1;
+
+double MsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+template <typename T>
+bool ReadValue(const uint8_t*& cursor, const uint8_t* end, T& value) {
+    if (size_t(end - cursor) < sizeof(T)) return false;
+    std::memcpy(&value, cursor, sizeof(T));
+    cursor += sizeof(T);
+    return true;
+}
+
+template <typename T>
+void AppendValue(std::vector<uint8_t>& out, const T& value) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+} // namespace
+
+void PipelineCache::Init(VkDevice device, VkPhysicalDevice phys, const std::string& path) {
+    m_dev = device;
+    m_path = path;
+    m_stats = {};
+    vkGetPhysicalDeviceProperties(phys, &m_props);
+
+    std::vector<uint8_t> data;
+    if (m_path.empty()) {
+        m_stats.rejectReason = "disabled";
+    } else {
+        data = ReadFile(m_path, m_stats.rejectReason);
+    }
+
+    VkPipelineCacheCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    info.initialDataSize = data.size();
+    info.pInitialData = data.empty() ? nullptr : data.data();
+    VkResult result = vkCreatePipelineCache(m_dev, &info, nullptr, &m_cache);
+    if (result != VK_SUCCESS && !data.empty()) {
+        // The driver rejected the blob despite our header; start cold
+        m_stats.rejectReason = "driver rejected data";
+        data.clear();
+        info.initialDataSize = 0;
+        info.pInitialData = nullptr;
+        result = vkCreatePipelineCache(m_dev, &info, nullptr, &m_cache);
+    }
+    if (result != VK_SUCCESS) {
+        NOVA_WARN("PipelineCache: vkCreatePipelineCache failed (" + std::to_string(result) + "), pipelines are not cached");
+        m_cache = VK_NULL_HANDLE;
+        return;
+    }
+
+    m_stats.warm = !data.empty();
+    m_stats.loadedBytes = data.size();
+    if (m_stats.warm) {
+        NOVA_INFO("PipelineCache: loaded " + std::to_string(data.size()) + " bytes from " + m_path);
+    } else if (!m_path.empty()) {
+        NOVA_INFO("PipelineCache: starting cold (" + m_stats.rejectReason + ")");
+    }
+}
+
+void PipelineCache::Shutdown() {
+    if (m_dev == VK_NULL_HANDLE) return;
+    if (m_cache != VK_NULL_HANDLE) {
+        if (!m_path.empty()) Save();
+        vkDestroyPipelineCache(m_dev, m_cache, nullptr);
+        m_cache = VK_NULL_HANDLE;
+    }
+    for (auto& [hash, module] : m_modules) {
+        vkDestroyShaderModule(m_dev, module, nullptr);
+    }
+    m_modules.clear();
+    m_shaders.clear();
+    m_dev = VK_NULL_HANDLE;
+}
+
+VkShaderModule PipelineCache::GetShaderModule(const std::string& path) {
+    auto known = m_shaders.find(path);
+    if (known != m_shaders.end() && known->second.module != VK_NULL_HANDLE) {
+        m_stats.shaderModuleHits++;
+        return known->second.module;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    MappedFile file;
+    if (!file.Open(path) || file.Size() % 4 != 0) {
+        NOVA_ERROR("PipelineCache: cannot read SPIR-V " + path);
+        return VK_NULL_HANDLE;
+    }
+    ShaderFile& shader = m_shaders[path];
+    shader.hash = HashBytes(file.Data(), file.Size());
+
+    // Same bytes under another path
+    auto existing = m_modules.find(shader.hash);
+    if (existing != m_modules.end()) {
+        shader.module = existing->second;
+        m_stats.shaderModuleHits++;
+        return shader.module;
+    }
+
+    VkShaderModuleCreateInfo ci{};
+    ci.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    ci.codeSize = file.Size();
+    ci.pCode = reinterpret_cast<const uint32_t*>(file.Data());
+    VkShaderModule module = VK_NULL_HANDLE;
+    if (vkCreateShaderModule(m_dev, &ci, nullptr, &module) != VK_SUCCESS) {
+        NOVA_ERROR("PipelineCache: vkCreateShaderModule failed for " + path);
+        m_shaders.erase(path);
+        return VK_NULL_HANDLE;
+    }
+    m_modules[shader.hash] = module;
+    shader.module = module;
+    m_stats.shaderModules++;
+    m_stats.shaderLoadMs += MsSince(start);
+    return module;
+}
+
+VkResult PipelineCache::CreateGraphicsPipeline(const VkGraphicsPipelineCreateInfo& info, VkPipeline* pipeline) {
+    auto start = std::chrono::steady_clock::now();
+    VkResult result = vkCreateGraphicsPipelines(m_dev, m_cache, 1, &info, nullptr, pipeline);
+    double ms = MsSince(start);
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    m_stats.pipelineCreateMs += ms;
+    if (result == VK_SUCCESS) m_stats.pipelinesCreated++;
+    return result;
+}
+
+VkResult PipelineCache::CreateComputePipeline(const VkComputePipelineCreateInfo& info, VkPipeline* pipeline) {
+    auto start = std::chrono::steady_clock::now();
+    VkResult result = vkCreateComputePipelines(m_dev, m_cache, 1, &info, nullptr, pipeline);
+    double ms = MsSince(start);
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    m_stats.pipelineCreateMs += ms;
+    if (result == VK_SUCCESS) m_stats.pipelinesCreated++;
+    return result;
+}
+
+PipelineCacheStats PipelineCache::Stats() const {
+    std::lock_guard<std::mutex> lock(m_statsMutex);
+    return m_stats;
+}
+
+bool PipelineCache::HashShader(const std::string& path, uint64_t& hash) {
+    auto known = m_shaders.find(path);
+    if (known != m_shaders.end()) {
+        hash = known->second.hash;
+        return true;
+    }
+    MappedFile file;
+    if (!file.Open(path)) return false;
+    hash = HashBytes(file.Data(), file.Size());
+    // Remembered so GetShaderModule and Save see the same contents
+    m_shaders[path].hash = hash;
+    return true;
+}
+
+std::vector<uint8_t> PipelineCache::ReadFile(const std::string& path, std::string& reason) {
+    MappedFile file;
+    if (!file.Open(path)) {
+        reason = "no cache file";
+        return {};
+    }
+    const uint8_t* cursor = file.Data();
+    const uint8_t* end = cursor + file.Size();
+
+    FileHeader header{};
+    if (!ReadValue(cursor, end, header) || header.magic != CACHE_MAGIC || header.version != CACHE_VERSION) {
+        reason = "unrecognized file";
+        return {};
+    }
+    if (header.vendorID != m_props.vendorID || header.deviceID != m_props.deviceID ||
+        std::memcmp(header.uuid, m_props.pipelineCacheUUID, VK_UUID_SIZE) != 0) {
+        reason = "different device";
+        return {};
+    }
+    if (header.driverVersion != m_props.driverVersion) {
+        reason = "different driver version";
+        return {};
+    }
+    for (uint32_t i = 0; i < header.shaderCount; ++i) {
+        uint64_t hash = 0;
+        uint32_t length = 0;
+        if (!ReadValue(cursor, end, hash) || !ReadValue(cursor, end, length) || size_t(end - cursor) < length) {
+            reason = "truncated file";
+            return {};
+        }
+        std::string shaderPath(reinterpret_cast<const char*>(cursor), length);
+        cursor += length;
+        uint64_t current = 0;
+        if (!HashShader(shaderPath, current) || current != hash) {
+            reason = "shader changed: " + shaderPath;
+            return {};
+        }
+    }
+    if (size_t(end - cursor) != header.dataSize || HashBytes(cursor, size_t(header.dataSize)) != header.dataHash) {
+        reason = "corrupt data";
+        return {};
+    }
+    return std::vector<uint8_t>(cursor, end);
+}
+
+void PipelineCache::Save() {
+    // Fold in whatever another run saved since we loaded, so concurrent
+    // editor and bench processes do not drop each other's pipelines
+    std::string ignored;
+    std::vector<uint8_t> onDisk = ReadFile(m_path, ignored);
+    if (!onDisk.empty()) {
+        VkPipelineCacheCreateInfo info{};
+        info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        info.initialDataSize = onDisk.size();
+        info.pInitialData = onDisk.data();
+        VkPipelineCache other = VK_NULL_HANDLE;
+        if (vkCreatePipelineCache(m_dev, &info, nullptr, &other) == VK_SUCCESS) {
+            vkMergePipelineCaches(m_dev, m_cache, 1, &other);
+            vkDestroyPipelineCache(m_dev, other, nullptr);
+        }
+    }
+
+    size_t dataSize = 0;
+    if (vkGetPipelineCacheData(m_dev, m_cache, &dataSize, nullptr) != VK_SUCCESS || dataSize == 0) return;
+    std::vector<uint8_t> data(dataSize);
+    if (vkGetPipelineCacheData(m_dev, m_cache, &dataSize, data.data()) != VK_SUCCESS) return;
+    data.resize(dataSize);
+
+    FileHeader header{};
+    header.magic = CACHE_MAGIC;
+    header.version = CACHE_VERSION;
+    header.vendorID = m_props.vendorID;
+    header.deviceID = m_props.deviceID;
+    header.driverVersion = m_props.driverVersion;
+    std::memcpy(header.uuid, m_props.pipelineCacheUUID, VK_UUID_SIZE);
+    header.shaderCount = static_cast<uint32_t>(m_shaders.size());
+    header.dataSize = data.size();
+    header.dataHash = HashBytes(data.data(), data.size());
+
+    std::vector<uint8_t> out;
+    AppendValue(out, header);
+    for (const auto& [shaderPath, shader] : m_shaders) {
+        AppendValue(out, shader.hash);
+        AppendValue(out, static_cast<uint32_t>(shaderPath.size()));
+        out.insert(out.end(), shaderPath.begin(), shaderPath.end());
+    }
+    out.insert(out.end(), data.begin(), data.end());
+
+    // Write next to the target and rename, so a crash never leaves a torn file
+    std::error_code ec;
+    std::filesystem::path target(m_path);
+    if (target.has_parent_path()) std::filesystem::create_directories(target.parent_path(), ec);
+    std::string tempPath = m_path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.write(reinterpret_cast<const char*>(out.data()), std::streamsize(out.size()))) {
+            NOVA_WARN("PipelineCache: cannot write " + tempPath);
+            return;
+        }
+    }
+    std::filesystem::rename(tempPath, target, ec);
+    if (ec) {
+        NOVA_WARN("PipelineCache: cannot replace " + m_path + ": " + ec.message());
+        std::filesystem::remove(tempPath, ec);
+        return;
+    }
+    m_stats.savedBytes = out.size();
+    NOVA_INFO("PipelineCache: saved " + std::to_string(data.size()) + " bytes to " + m_path);
+}
+
+} // namespace nova
@@ -0,0 +1,91 @@
+#pragma once
+
+#ifndef VK_NO_PROTOTYPES
+#define VK_NO_PROTOTYPES
+#endif
+
+#include <volk.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+namespace nova {
+
+struct PipelineCacheStats {
+    bool warm = false;              // A valid cache file was loaded at startup
+    std::string rejectReason;       // Why the file on disk was not used, if it was not
+    size_t loadedBytes = 0;
+    size_t savedBytes = 0;
+    uint32_t pipelinesCreated = 0;
+    double pipelineCreateMs = 0.0;  // Time spent inside vkCreate*Pipelines
+    uint32_t shaderModules = 0;     // Distinct SPIR-V blobs turned into modules
+    uint32_t shaderModuleHits = 0;  // Requests served from the module cache
+    double shaderLoadMs = 0.0;      // Mapping, hashing and vkCreateShaderModule
+};
+
+// VkPipelineCache persisted to disk plus a cache of shader modules.
+//
+// The file starts with our own header: device identity (vendor, device,
+// pipelineCacheUUID), driver version, and the path and content hash of every
+// SPIR-V file the previous run built modules from. The cache is only loaded
+// if all of them still match; otherwise the run starts cold and overwrites it.
+// On shutdown the file on disk is merged in again (another process may have
+// written it meanwhile) before saving, through a temporary file and a rename.
+//
+// SPIR-V is read through a memory mapping and modules are keyed by content
+// hash, so identical shaders share a module. Modules belong to the cache and
+// live until Shutdown; callers must not destroy them.
+//
+// Create*Pipeline may be called from any thread (VkPipelineCache is
+// internally synchronized); GetShaderModule is render-thread only.
+class PipelineCache {
+public:
+    // An empty `path` keeps the cache in memory only
+    void Init(VkDevice device, VkPhysicalDevice phys, const std::string& path);
+    void Shutdown();
+
+    // VK_NULL_HANDLE if the file cannot be read or the module cannot be created
+    VkShaderModule GetShaderModule(const std::string& path);
+
+    VkResult CreateGraphicsPipeline(const VkGraphicsPipelineCreateInfo& info, VkPipeline* pipeline);
+    VkResult CreateComputePipeline(const VkComputePipelineCreateInfo& info, VkPipeline* pipeline);
+
+    VkPipelineCache Handle() const { return m_cache; }
+    PipelineCacheStats Stats() const;
+
+private:
+    struct FileHeader {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint32_t driverVersion;
+        uint8_t uuid[VK_UUID_SIZE];
+        uint32_t shaderCount;       // Followed by {uint64 hash, uint32 length, path} per shader
+        uint64_t dataSize;          // Then the vkGetPipelineCacheData blob
+        uint64_t dataHash;
+    };
+    struct ShaderFile {
+        uint64_t hash = 0;
+        VkShaderModule module = VK_NULL_HANDLE;
+    };
+
+    // Returns the pipeline cache data in `path` if it is valid for this device
+    // and its shaders, else an empty vector with `reason` set
+    std::vector<uint8_t> ReadFile(const std::string& path, std::string& reason);
+    bool HashShader(const std::string& path, uint64_t& hash);
+    void Save();
+
+    VkDevice m_dev = VK_NULL_HANDLE;
+    VkPhysicalDeviceProperties m_props{};
+    std::string m_path;
+    VkPipelineCache m_cache = VK_NULL_HANDLE;
+    std::map<std::string, ShaderFile> m_shaders;          // By path
+    std::map<uint64_t, VkShaderModule> m_modules;         // By content hash
+    mutable std::mutex m_statsMutex;                      // Pipelines are created on worker threads
+    PipelineCacheStats m_stats;
+};
+
+} // namespace nova
@@ -0,0 +1,319 @@
+#include "PipelineStateCache.h"
+#include "core/Log.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <chrono>
+
+namespace nova {
+
+namespace {
+// Specialization constant IDs in pbr.frag.glsl and pbr.vert.glsl
+constexpr uint32_t SPEC_SHADING_MODEL = 0;
+constexpr uint32_t SPEC_ALPHA_MASK = 1;
+constexpr uint32_t SPEC_OCT_NORMALS = 2;
+
+struct FragmentSpecialization {
+    int32_t shadingModel;
+    VkBool32 alphaMask;
+};
+} // namespace
+
+uint64_t PipelineKey::Hash() const {
+    return uint64_t(shadingModel) |
+           uint64_t(blendMode) << 4 |
+           uint64_t(doubleSided ? 1 : 0) << 8 |
+           uint64_t(vertexLayout) << 9 |
+           uint64_t(depthTest) << 12 |
+           uint64_t(renderPass) << 16;
+}
+
+bool PipelineStateCache::Init(VkDevice device, PipelineCache* cache, VkPipelineLayout layout, VkShaderModule vertex,
+                              VkShaderModule fragment, VkRenderPass renderPass, const PipelineKey& fallback,
+                              uint32_t workerCount) {
+    m_dev = device;
+    m_cache = cache;
+    m_layout = layout;
+    m_vertex = vertex;
+    m_fragment = fragment;
+    m_renderPasses.assign(1, renderPass);
+    m_stopping = false;
+    m_stats = {};
+
+    double totalMs = 0.0;
+    for (size_t i = 0; i < size_t(DepthTest::Count); ++i) {
+        PipelineKey key = fallback;
+        key.depthTest = static_cast<DepthTest>(i);
+        double ms = 0.0;
+        m_fallbacks[i] = Compile(key, renderPass, ms);
+        if (m_fallbacks[i] == VK_NULL_HANDLE) return false;
+        Entry& entry = m_entries[key.Hash()];
+        entry.state = State::Ready;
+        entry.pipeline = m_fallbacks[i];
+        m_stats.pipelines++;
+        m_stats.compileMs += ms;
+        m_stats.maxCompileMs = std::max(m_stats.maxCompileMs, ms);
+        totalMs += ms;
+    }
+
+    workerCount = std::max(1u, workerCount);
+    for (uint32_t i = 0; i < workerCount; ++i) {
+        m_workers.emplace_back([this] { WorkerLoop(); });
+    }
+    NOVA_INFO("PipelineStateCache: fallbacks compiled in " + std::to_string(totalMs) + " ms, " +
+              std::to_string(workerCount) + " compile threads");
+    return true;
+}
+
+void PipelineStateCache::Shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+        m_queue.clear();
+    }
+    m_wake.notify_all();
+    for (auto& worker : m_workers) worker.join();
+    m_workers.clear();
+
+    for (auto& [hash, entry] : m_entries) {
+        if (entry.pipeline != VK_NULL_HANDLE) vkDestroyPipeline(m_dev, entry.pipeline, nullptr);
+    }
+    m_entries.clear();
+    m_renderPasses.clear();
+    for (VkPipeline& fallback : m_fallbacks) fallback = VK_NULL_HANDLE;
+}
+
+uint8_t PipelineStateCache::AddRenderPass(VkRenderPass renderPass) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (size_t i = 0; i < m_renderPasses.size(); ++i) {
+        if (m_renderPasses[i] == renderPass) return static_cast<uint8_t>(i);
+    }
+    m_renderPasses.push_back(renderPass);
+    return static_cast<uint8_t>(m_renderPasses.size() - 1);
+}
+
+VkPipeline PipelineStateCache::Get(const PipelineKey& key) {
+    uint64_t hash = key.Hash();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(hash);
+    if (it != m_entries.end() && it->second.state == State::Ready) {
+        m_stats.hits++;
+        return it->second.pipeline;
+    }
+    if (it == m_entries.end() && Enqueue(key, hash)) m_stats.misses++;
+    m_stats.fallbacks++;
+    return m_fallbacks[size_t(key.depthTest)];
+}
+
+void PipelineStateCache::Prewarm(const PipelineKey& key) {
+    uint64_t hash = key.Hash();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_entries.find(hash) == m_entries.end()) Enqueue(key, hash);
+}
+
+bool PipelineStateCache::Enqueue(const PipelineKey& key, uint64_t hash) {
+    if (m_stopping || key.renderPass >= m_renderPasses.size()) {
+        // Unknown render pass: remembered as failed so it is not retried every frame
+        m_entries[hash].state = State::Failed;
+        m_stats.failed++;
+        return false;
+    }
+    m_entries[hash].state = State::Pending;
+    m_queue.push_back(key);
+    m_stats.pending++;
+    m_wake.notify_one();
+    return true;
+}
+
+PipelineStateStats PipelineStateCache::Stats() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_stats;
+}
+
+void PipelineStateCache::WorkerLoop() {
+    for (;;) {
+        PipelineKey key;
+        VkRenderPass renderPass = VK_NULL_HANDLE;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+            if (m_stopping) return;
+            key = m_queue.front();
+            m_queue.pop_front();
+            renderPass = m_renderPasses[key.renderPass];
+        }
+
+        double ms = 0.0;
+        VkPipeline pipeline = Compile(key, renderPass, ms);
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Entry& entry = m_entries[key.Hash()];
+        entry.pipeline = pipeline;
+        entry.state = pipeline != VK_NULL_HANDLE ? State::Ready : State::Failed;
+        m_stats.pending--;
+        if (pipeline != VK_NULL_HANDLE) m_stats.pipelines++;
+        else m_stats.failed++;
+        m_stats.compileMs += ms;
+        m_stats.maxCompileMs = std::max(m_stats.maxCompileMs, ms);
+    }
+}
+
+VkPipeline PipelineStateCache::Compile(const PipelineKey& key, VkRenderPass renderPass, double& ms) const {
+    auto start = std::chrono::steady_clock::now();
+
+    FragmentSpecialization specData{};
+    specData.shadingModel = static_cast<int32_t>(key.shadingModel);
+    specData.alphaMask = key.blendMode == MaterialBlendMode::Masked ? VK_TRUE : VK_FALSE;
+    VkSpecializationMapEntry specEntries[2]{};
+    specEntries[0].constantID = SPEC_SHADING_MODEL;
+    specEntries[0].offset = offsetof(FragmentSpecialization, shadingModel);
+    specEntries[0].size = sizeof(int32_t);
+    specEntries[1].constantID = SPEC_ALPHA_MASK;
+    specEntries[1].offset = offsetof(FragmentSpecialization, alphaMask);
+    specEntries[1].size = sizeof(VkBool32);
+    VkSpecializationInfo specInfo{};
+    specInfo.mapEntryCount = 2;
+    specInfo.pMapEntries = specEntries;
+    specInfo.dataSize = sizeof(specData);
+    specInfo.pData = &specData;
+
+    VkBool32 octNormals = key.vertexLayout == VertexLayout::Compact ? VK_TRUE : VK_FALSE;
+    VkSpecializationMapEntry vertexSpecEntry{ SPEC_OCT_NORMALS, 0, sizeof(VkBool32) };
+    VkSpecializationInfo vertexSpecInfo{};
+    vertexSpecInfo.mapEntryCount = 1;
+    vertexSpecInfo.pMapEntries = &vertexSpecEntry;
+    vertexSpecInfo.dataSize = sizeof(octNormals);
+    vertexSpecInfo.pData = &octNormals;
+
+    VkPipelineShaderStageCreateInfo stages[2]{};
+    stages[0].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    stages[0].module = m_vertex;
+    stages[0].pName = "main";
+    stages[0].pSpecializationInfo = &vertexSpecInfo;
+    stages[1].sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stages[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    stages[1].module = m_fragment;
+    stages[1].pName = "main";
+    stages[1].pSpecializationInfo = &specInfo;
+
+    // Vertex input
+    VkVertexInputBindingDescription bindings[3]{};
+    uint32_t bindingCount = 2;
+    std::array<VkVertexInputAttributeDescription, 7> attributes{};
+    switch (key.vertexLayout) {
+    case VertexLayout::Standard:
+        bindings[0].binding = 0;
+        bindings[0].stride = 8 * sizeof(float);         // pos(3) + normal(3) + uv(2)
+        bindings[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+        bindings[1].binding = 1;
+        bindings[1].stride = sizeof(glm::mat4);
+        bindings[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+        attributes[0] = {0, 0, VK_FORMAT_R32G32B32_SFLOAT, 0};
+        attributes[1] = {1, 0, VK_FORMAT_R32G32B32_SFLOAT, 3 * sizeof(float)};
+        attributes[2] = {2, 0, VK_FORMAT_R32G32_SFLOAT, 6 * sizeof(float)};
+        // mat4 instance transform takes four locations, one column each
+        for (uint32_t column = 0; column < 4; ++column) {
+            attributes[3 + column] = {3 + column, 1, VK_FORMAT_R32G32B32A32_SFLOAT, column * 16};
+        }
+        break;
+    case VertexLayout::Compact:
+        // Positions are the geometry pool's position stream, dequantized by
+        // the instance transform; the rest of the vertex is a second stream
+        bindings[0] = {0, 4 * sizeof(uint16_t), VK_VERTEX_INPUT_RATE_VERTEX};
+        bindings[1] = {1, sizeof(glm::mat4), VK_VERTEX_INPUT_RATE_INSTANCE};
+        bindings[2] = {2, 4 * sizeof(uint16_t), VK_VERTEX_INPUT_RATE_VERTEX};
+        bindingCount = 3;
+        attributes[0] = {0, 0, VK_FORMAT_R16G16B16A16_UNORM, 0};
+        attributes[1] = {1, 2, VK_FORMAT_R16G16_SNORM, 0};
+        attributes[2] = {2, 2, VK_FORMAT_R16G16_SFLOAT, 2 * sizeof(uint16_t)};
+        for (uint32_t column = 0; column < 4; ++column) {
+            attributes[3 + column] = {3 + column, 1, VK_FORMAT_R32G32B32A32_SFLOAT, column * 16};
+        }
+        break;
+    }
+    VkPipelineVertexInputStateCreateInfo vertexInput{};
+    vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInput.vertexBindingDescriptionCount = bindingCount;
+    vertexInput.pVertexBindingDescriptions = bindings;
+    vertexInput.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributes.size());
+    vertexInput.pVertexAttributeDescriptions = attributes.data();
+
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+
+    // Viewport and scissor are dynamic
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.cullMode = key.doubleSided ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT;
+    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    bool blended = key.blendMode == MaterialBlendMode::Translucent || key.blendMode == MaterialBlendMode::Additive;
+    bool equal = key.depthTest == DepthTest::EqualNoWrite;
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = VK_TRUE;
+    depthStencil.depthWriteEnable = blended || equal ? VK_FALSE : VK_TRUE;
+    depthStencil.depthCompareOp = equal ? VK_COMPARE_OP_EQUAL : VK_COMPARE_OP_LESS;
+
+    VkPipelineColorBlendAttachmentState blend{};
+    blend.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+    blend.blendEnable = blended ? VK_TRUE : VK_FALSE;
+    blend.srcColorBlendFactor = key.blendMode == MaterialBlendMode::Additive ? VK_BLEND_FACTOR_ONE : VK_BLEND_FACTOR_SRC_ALPHA;
+    blend.dstColorBlendFactor = key.blendMode == MaterialBlendMode::Additive ? VK_BLEND_FACTOR_ONE : VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    blend.colorBlendOp = VK_BLEND_OP_ADD;
+    blend.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    blend.dstAlphaBlendFactor = VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA;
+    blend.alphaBlendOp = VK_BLEND_OP_ADD;
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    colorBlending.attachmentCount = 1;
+    colorBlending.pAttachments = &blend;
+
+    VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
+
+    VkGraphicsPipelineCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    info.stageCount = 2;
+    info.pStages = stages;
+    info.pVertexInputState = &vertexInput;
+    info.pInputAssemblyState = &inputAssembly;
+    info.pViewportState = &viewportState;
+    info.pRasterizationState = &rasterizer;
+    info.pMultisampleState = &multisampling;
+    info.pDepthStencilState = &depthStencil;
+    info.pColorBlendState = &colorBlending;
+    info.pDynamicState = &dynamicState;
+    info.layout = m_layout;
+    info.renderPass = renderPass;
+    info.subpass = 0;
+
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    VkResult result = m_cache->CreateGraphicsPipeline(info, &pipeline);
+    ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (result != VK_SUCCESS) {
+        NOVA_ERROR("PipelineStateCache: failed to compile pipeline " + std::to_string(key.Hash()) + " (" +
+                   std::to_string(result) + ")");
+        return VK_NULL_HANDLE;
+    }
+    return pipeline;
+}
+
+} // namespace nova
@@ -0,0 +1,115 @@
+#pragma once
+
+#ifndef VK_NO_PROTOTYPES
+#define VK_NO_PROTOTYPES
+#endif
+
+#include <volk.h>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+#include "PipelineCache.h"
+#include "assets/Material.h"
+
+namespace nova {
+
+// Vertex formats the main pass can consume
+enum class VertexLayout : uint8_t {
+    Standard,   // Binding 0: pos3 normal3 uv2 floats; binding 1: per-instance mat4
+    Compact,    // Binding 0: unorm16x4 position; binding 1 as Standard; binding 2:
+                // octahedral snorm16x2 normal, half2 uv. 16 bytes per vertex.
+};
+
+// Depth test of a main-pass pipeline
+enum class DepthTest : uint8_t {
+    Less,           // Writes unless the blend mode is translucent or additive
+    EqualNoWrite,   // Depth laid down by a prepass: only the visible surface is shaded
+    Count
+};
+
+// Everything that selects a main-pass pipeline. Blend mode also decides depth
+// writes (off for translucent and additive); shading model and alpha masking
+// are specialization constants of the same SPIR-V.
+struct PipelineKey {
+    MaterialShadingModel shadingModel = MaterialShadingModel::PBR;
+    MaterialBlendMode blendMode = MaterialBlendMode::Opaque;
+    bool doubleSided = false;
+    VertexLayout vertexLayout = VertexLayout::Standard;
+    DepthTest depthTest = DepthTest::Less;
+    uint8_t renderPass = 0;     // From PipelineStateCache::AddRenderPass
+
+    // Every field packed into one word; equal words mean identical pipelines
+    uint64_t Hash() const;
+};
+
+struct PipelineStateStats {
+    uint32_t pipelines = 0;     // Compiled and ready
+    uint32_t pending = 0;       // Queued or compiling
+    uint32_t failed = 0;
+    uint64_t hits = 0;          // Get calls served with the requested pipeline
+    uint64_t misses = 0;        // Get calls that queued a compile
+    uint64_t fallbacks = 0;     // Get calls served with the fallback (misses included)
+    double compileMs = 0.0;     // Worker time inside vkCreateGraphicsPipelines
+    double maxCompileMs = 0.0;
+};
+
+// Main-pass pipelines keyed by PipelineKey. Get never compiles on the calling
+// thread: an unknown key is queued for the worker threads and the fallback
+// pipeline with the key's depth test is returned until it is ready (a
+// fallback testing differently could hide or overdraw the surface). Only the
+// fallbacks, one per DepthTest, are compiled synchronously, in Init.
+// Pipelines live until Shutdown.
+class PipelineStateCache {
+public:
+    // `renderPass` becomes render pass 0 and `fallback` is compiled against it,
+    // once per DepthTest
+    bool Init(VkDevice device, PipelineCache* cache, VkPipelineLayout layout, VkShaderModule vertex,
+              VkShaderModule fragment, VkRenderPass renderPass, const PipelineKey& fallback, uint32_t workerCount);
+    void Shutdown();
+
+    // Registers a compatibility class for PipelineKey::renderPass; call before
+    // requesting pipelines that use it
+    uint8_t AddRenderPass(VkRenderPass renderPass);
+
+    // Render thread; never blocks on compilation
+    VkPipeline Get(const PipelineKey& key);
+    // Queues `key` without counting a request, e.g. at load time
+    void Prewarm(const PipelineKey& key);
+
+    VkPipeline Fallback(DepthTest depthTest = DepthTest::Less) const { return m_fallbacks[size_t(depthTest)]; }
+    PipelineStateStats Stats() const;
+
+private:
+    enum class State { Pending, Ready, Failed };
+    struct Entry {
+        State state = State::Pending;
+        VkPipeline pipeline = VK_NULL_HANDLE;
+    };
+
+    // Any thread; only reads state fixed at Init
+    VkPipeline Compile(const PipelineKey& key, VkRenderPass renderPass, double& ms) const;
+    bool Enqueue(const PipelineKey& key, uint64_t hash);   // m_mutex held
+    void WorkerLoop();
+
+    VkDevice m_dev = VK_NULL_HANDLE;
+    PipelineCache* m_cache = nullptr;
+    VkPipelineLayout m_layout = VK_NULL_HANDLE;
+    VkShaderModule m_vertex = VK_NULL_HANDLE;
+    VkShaderModule m_fragment = VK_NULL_HANDLE;
+    VkPipeline m_fallbacks[size_t(DepthTest::Count)] = {};
+
+    mutable std::mutex m_mutex;
+    std::vector<VkRenderPass> m_renderPasses;
+    std::condition_variable m_wake;
+    std::unordered_map<uint64_t, Entry> m_entries;
+    std::deque<PipelineKey> m_queue;
+    std::vector<std::thread> m_workers;
+    bool m_stopping = false;
+    PipelineStateStats m_stats;
+};
+
+} // namespace nova
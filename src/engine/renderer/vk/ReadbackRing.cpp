@@ -0,0 +1,103 @@
+#include "ReadbackRing.h"
+#include "core/Log.h"
+#include <algorithm>
+#include <cstring>
+
+namespace nova {
+
+bool ReadbackRing::Init(GpuAllocator* allocator, FrameTimeline* frames, uint32_t slots) {
+    m_allocator = allocator;
+    m_frames = frames;
+    m_slots.assign(std::max(1u, slots), Slot{});
+    m_stats = {};
+    m_stats.slots = static_cast<uint32_t>(m_slots.size());
+    return true;
+}
+
+void ReadbackRing::Shutdown() {
+    if (!m_allocator) return;
+    for (Slot& slot : m_slots) m_allocator->DestroyBuffer(slot.buffer, slot.allocation);
+    m_slots.clear();
+}
+
+uint32_t ReadbackRing::ReserveSlot(uint64_t frameNumber, VkExtent2D extent) {
+    m_stats.requested++;
+    uint32_t index = 0;
+    while (index < m_slots.size() && m_slots[index].pending) index++;
+    if (index == m_slots.size()) {
+        m_stats.dropped++;
+        return UINT32_MAX;
+    }
+
+    // A slot that is not pending has been polled, so the GPU is done with its buffer
+    Slot& slot = m_slots[index];
+    VkDeviceSize size = VkDeviceSize(extent.width) * extent.height * 4;
+    if (slot.size < size) {
+        m_allocator->DestroyBuffer(slot.buffer, slot.allocation);
+        slot.size = 0;
+        // Cached memory makes the CPU read fast; coherent spares the invalidate
+        VkResult result = m_allocator->CreateBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                    VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT |
+                                                    VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+                                                    slot.buffer, slot.allocation);
+        if (result != VK_SUCCESS) {
+            result = m_allocator->CreateBuffer(size, VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                               VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                               slot.buffer, slot.allocation);
+        }
+        if (result != VK_SUCCESS || !slot.allocation.mapped) {
+            NOVA_ERROR("ReadbackRing: failed to create " + std::to_string(size) + " byte buffer: " + std::to_string(result));
+            m_allocator->DestroyBuffer(slot.buffer, slot.allocation);
+            m_stats.dropped++;
+            return UINT32_MAX;
+        }
+        slot.size = size;
+    }
+    slot.extent = extent;
+    slot.frameNumber = frameNumber;
+    slot.pending = true;
+    return index;
+}
+
+void ReadbackRing::RecordCopy(VkCommandBuffer cmd, uint32_t slot, VkImage image) {
+    if (slot >= m_slots.size() || !m_slots[slot].pending) return;
+    const Slot& target = m_slots[slot];
+
+    VkBufferImageCopy region{};
+    region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    region.imageSubresource.layerCount = 1;
+    region.imageExtent = {target.extent.width, target.extent.height, 1};
+    vkCmdCopyImageToBuffer(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, target.buffer, 1, &region);
+
+    // The timeline wait orders the host after the frame; the barrier makes the copy visible to it
+    VkBufferMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barrier.buffer = target.buffer;
+    barrier.size = VK_WHOLE_SIZE;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0,
+                         0, nullptr, 1, &barrier, 0, nullptr);
+}
+
+bool ReadbackRing::Poll(FrameReadback& out) {
+    Slot* oldest = nullptr;
+    for (Slot& slot : m_slots) {
+        if (slot.pending && (!oldest || slot.frameNumber < oldest->frameNumber)) oldest = &slot;
+    }
+    if (!oldest || !m_frames->IsComplete(oldest->frameNumber)) return false;
+
+    size_t bytes = size_t(oldest->extent.width) * oldest->extent.height * 4;
+    out.frameNumber = oldest->frameNumber;
+    out.width = oldest->extent.width;
+    out.height = oldest->extent.height;
+    out.pixels.resize(bytes);
+    std::memcpy(out.pixels.data(), oldest->allocation.mapped, bytes);
+    oldest->pending = false;
+    m_stats.completed++;
+    return true;
+}
+
+} // namespace nova
@@ -0,0 +1,59 @@
+#pragma once
+
+#ifndef VK_NO_PROTOTYPES
+#define VK_NO_PROTOTYPES
+#endif
+
+#include <volk.h>
+#include <vector>
+#include <cstdint>
+#include "GpuAllocator.h"
+#include "FrameTimeline.h"
+#include "renderer/IRenderer.h"
+
+namespace nova {
+
+struct ReadbackStats {
+    uint32_t slots = 0;
+    uint64_t requested = 0;
+    uint64_t completed = 0;     // Handed to the caller by Poll
+    uint64_t dropped = 0;       // Requests that found every slot busy
+};
+
+// Host-visible staging buffers that rendered images are copied into. A slot
+// is reserved for frame N, filled by a copy recorded into that frame and
+// returned by Poll once the frame timeline says N has completed. Nothing
+// here waits: a request that finds every slot busy is dropped, and slots are
+// only freed by Poll, so an unpolled copy is never overwritten.
+class ReadbackRing {
+public:
+    bool Init(GpuAllocator* allocator, FrameTimeline* frames, uint32_t slots);
+    void Shutdown();
+
+    // Slot for a copy of an RGBA8 image of `extent` in `frameNumber`, or
+    // UINT32_MAX when every slot still holds an unpolled copy
+    uint32_t ReserveSlot(uint64_t frameNumber, VkExtent2D extent);
+    // `image` must be in TRANSFER_SRC_OPTIMAL
+    void RecordCopy(VkCommandBuffer cmd, uint32_t slot, VkImage image);
+    // Oldest completed copy, if any
+    bool Poll(FrameReadback& out);
+
+    const ReadbackStats& Stats() const { return m_stats; }
+
+private:
+    struct Slot {
+        VkBuffer buffer = VK_NULL_HANDLE;
+        GpuAllocation allocation;
+        VkDeviceSize size = 0;
+        VkExtent2D extent = {0, 0};
+        uint64_t frameNumber = 0;
+        bool pending = false;
+    };
+
+    GpuAllocator* m_allocator = nullptr;
+    FrameTimeline* m_frames = nullptr;
+    std::vector<Slot> m_slots;
+    ReadbackStats m_stats;
+};
+
+} // namespace nova
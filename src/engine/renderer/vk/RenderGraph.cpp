@@ -0,0 +1,839 @@
+#include "RenderGraph.h"
+#include "VulkanHelpers.h"
+#include "core/Log.h"
+#include <algorithm>
+#include <numeric>
+#include <tuple>
+
+namespace nova {
+
+namespace {
+
+constexpr VkAccessFlags WRITE_ACCESS = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+                                       VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+constexpr VkPipelineStageFlags FRAGMENT_TESTS = VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT |
+                                                VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+
+} // namespace
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Read(RGResource resource, RGAccess access) {
+    m_graph->AddAccess(m_pass, resource, access, false);
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Write(RGResource resource, RGAccess access) {
+    m_graph->AddAccess(m_pass, resource, access, true);
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::Clear(RGResource resource, VkClearValue value) {
+    for (Access& access : m_graph->m_passes[m_pass].accesses) {
+        if (access.resource != resource.id || !access.write) continue;
+        access.clear = true;
+        access.clearValue = value;
+        return *this;
+    }
+    NOVA_WARN("RenderGraph: pass '" + m_graph->m_passes[m_pass].name + "' clears a resource it does not write");
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::SideEffect() {
+    m_graph->m_passes[m_pass].sideEffect = true;
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::ExternalRenderPass() {
+    m_graph->m_passes[m_pass].externalRenderPass = true;
+    return *this;
+}
+
+RenderGraph::PassBuilder& RenderGraph::PassBuilder::SecondaryCommandBuffers() {
+    m_graph->m_passes[m_pass].secondaryContents = true;
+    return *this;
+}
+
+bool RenderGraph::FramebufferKey::operator<(const FramebufferKey& o) const {
+    return std::tie(renderPass, views, width, height, layers) < std::tie(o.renderPass, o.views, o.width, o.height, o.layers);
+}
+
+void RenderGraph::Init(VkDevice device, GpuAllocator* allocator, FrameTimeline* frames) {
+    m_dev = device;
+    m_allocator = allocator;
+    m_frames = frames;
+    // Tilers can keep attachments that never leave the render pass in tile memory
+    m_lazyMemorySupported = allocator->FindMemoryType(~0u, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT |
+                                                               VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT) != UINT32_MAX;
+    NOVA_INFO(std::string("Render graph ready") + (m_lazyMemorySupported ? " (lazily allocated memory available)" : ""));
+}
+
+void RenderGraph::Shutdown() {
+    if (m_dev == VK_NULL_HANDLE) return;
+    RetireTransients();
+    RetireFramebuffers();
+    DestroyRetired(true);
+    for (auto& entry : m_renderPasses) vkDestroyRenderPass(m_dev, entry.second, nullptr);
+    m_renderPasses.clear();
+    m_resources.clear();
+    m_passes.clear();
+    m_dev = VK_NULL_HANDLE;
+}
+
+void RenderGraph::Reset(uint64_t frameNumber) {
+    m_frameNumber = frameNumber;
+    DestroyRetired(false);
+    m_resources.clear();
+    m_passes.clear();
+    m_compiled = false;
+    m_stats.passes = 0;
+    m_stats.culledPasses = 0;
+    m_stats.barrierBatches = 0;
+    m_stats.barriers = 0;
+}
+
+RGResource RenderGraph::ImportImage(const char* name, VkImage image, VkImageView view, const RGImageDesc& desc,
+                                    RGImageState* state, VkImageLayout finalLayout) {
+    Resource resource;
+    resource.name = name;
+    resource.imported = true;
+    resource.output = finalLayout != VK_IMAGE_LAYOUT_UNDEFINED;
+    resource.desc = desc;
+    resource.aspect = AspectFor(desc.format);
+    resource.image = image;
+    resource.view = view;
+    resource.external = state;
+    resource.finalLayout = finalLayout;
+    m_resources.push_back(resource);
+    return RGResource{ static_cast<uint32_t>(m_resources.size() - 1) };
+}
+
+RGResource RenderGraph::ImportBuffer(const char* name, VkBuffer buffer) {
+    Resource resource;
+    resource.name = name;
+    resource.isImage = false;
+    resource.imported = true;
+    resource.buffer = buffer;
+    m_resources.push_back(resource);
+    return RGResource{ static_cast<uint32_t>(m_resources.size() - 1) };
+}
+
+RGResource RenderGraph::CreateImage(const char* name, const RGImageDesc& desc) {
+    Resource resource;
+    resource.name = name;
+    resource.desc = desc;
+    resource.aspect = AspectFor(desc.format);
+    m_resources.push_back(resource);
+    return RGResource{ static_cast<uint32_t>(m_resources.size() - 1) };
+}
+
+RenderGraph::PassBuilder RenderGraph::AddPass(const char* name, ExecuteFn execute) {
+    Pass pass;
+    pass.name = name;
+    pass.execute = std::move(execute);
+    m_passes.push_back(std::move(pass));
+    return PassBuilder(this, static_cast<uint32_t>(m_passes.size() - 1));
+}
+
+void RenderGraph::AddAccess(uint32_t pass, RGResource resource, RGAccess access, bool write) {
+    if (!resource.IsValid() || resource.id >= m_resources.size()) {
+        NOVA_WARN("RenderGraph: pass '" + m_passes[pass].name + "' uses an invalid resource");
+        return;
+    }
+    Access entry;
+    entry.resource = resource.id;
+    entry.access = access;
+    entry.write = write;
+    m_passes[pass].accesses.push_back(entry);
+}
+
+void RenderGraph::Compile() {
+    CullPasses();
+    ComputeLifetimes();
+    PlaceTransients();
+    BuildAttachments();
+    m_compiled = true;
+}
+
+void RenderGraph::CullPasses() {
+    // Walk backwards from the roots: side-effect passes and writers of external
+    // outputs. Anything a live pass touches without clearing it must come from
+    // the passes before it.
+    std::vector<bool> needed(m_resources.size(), false);
+    for (size_t i = m_passes.size(); i-- > 0;) {
+        Pass& pass = m_passes[i];
+        pass.live = pass.sideEffect;
+        for (const Access& access : pass.accesses) {
+            if (access.write && (m_resources[access.resource].output || needed[access.resource])) pass.live = true;
+        }
+        if (!pass.live) {
+            m_stats.culledPasses++;
+            continue;
+        }
+        m_stats.passes++;
+        for (const Access& access : pass.accesses) {
+            if (access.clear) needed[access.resource] = false;
+        }
+        for (const Access& access : pass.accesses) {
+            if (!access.clear) needed[access.resource] = true;
+        }
+    }
+}
+
+void RenderGraph::ComputeLifetimes() {
+    for (Resource& resource : m_resources) {
+        resource.firstPass = -1;
+        resource.lastPass = -1;
+        resource.usage = resource.desc.usage;
+        resource.usedStages = 0;
+        resource.writtenAccess = 0;
+        resource.attachmentOnly = true;
+        resource.transient = UINT32_MAX;
+    }
+    for (int32_t i = 0; i < static_cast<int32_t>(m_passes.size()); ++i) {
+        if (!m_passes[i].live) continue;
+        for (const Access& access : m_passes[i].accesses) {
+            Resource& resource = m_resources[access.resource];
+            AccessInfo info = Describe(access.access, resource.aspect);
+            if (resource.firstPass < 0) resource.firstPass = i;
+            resource.lastPass = i;
+            resource.usage |= info.usage;
+            resource.usedStages |= info.stages;
+            if (access.write) resource.writtenAccess |= info.access & WRITE_ACCESS;
+            if (!info.attachment) resource.attachmentOnly = false;
+        }
+    }
+}
+
+void RenderGraph::PlaceTransients() {
+    std::vector<uint32_t> live;
+    std::vector<TransientKey> keys;
+    for (uint32_t i = 0; i < m_resources.size(); ++i) {
+        const Resource& r = m_resources[i];
+        if (r.imported || !r.isImage || r.firstPass < 0) continue;
+        VkImageUsageFlags usage = r.usage;
+        if (r.attachmentOnly && m_lazyMemorySupported) usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+        live.push_back(i);
+        keys.push_back({ r.desc.format, r.desc.extent.width, r.desc.extent.height, r.desc.layers, usage,
+                         r.firstPass, r.lastPass });
+    }
+
+    if (keys != m_transientKeys) {
+        // The old blocks are offered to the new placement before being retired.
+        // Frames still using them are ordered before the new images' first
+        // access by the block barrier, exactly as for aliases within a frame.
+        std::vector<TransientBlock> previousBlocks;
+        previousBlocks.swap(m_blocks);
+        RetireTransients();
+        m_transientKeys = keys;
+        m_transients.resize(keys.size());
+
+        std::vector<VkMemoryRequirements> requirements(keys.size());
+        for (size_t k = 0; k < keys.size(); ++k) {
+            const TransientKey& key = keys[k];
+            VkImageCreateInfo imageInfo{};
+            imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            imageInfo.imageType = VK_IMAGE_TYPE_2D;
+            imageInfo.extent = { key.width, key.height, 1 };
+            imageInfo.mipLevels = 1;
+            imageInfo.arrayLayers = key.layers;
+            imageInfo.format = key.format;
+            imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+            imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            imageInfo.usage = key.usage;
+            imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+            VK_CHECK(vkCreateImage(m_dev, &imageInfo, nullptr, &m_transients[k].image));
+            vkGetImageMemoryRequirements(m_dev, m_transients[k].image, &requirements[k]);
+        }
+
+        // Greedy placement, largest first: an image shares a block with images
+        // whose lifetimes it does not overlap
+        struct Placement {
+            VkMemoryRequirements requirements;
+            bool lazy;
+            std::vector<uint32_t> members;
+        };
+        std::vector<Placement> placements;
+        std::vector<uint32_t> order(keys.size());
+        std::iota(order.begin(), order.end(), 0u);
+        std::stable_sort(order.begin(), order.end(),
+                         [&](uint32_t a, uint32_t b) { return requirements[a].size > requirements[b].size; });
+        m_stats.unaliasedBytes = 0;
+        for (uint32_t k : order) {
+            const VkMemoryRequirements& req = requirements[k];
+            bool lazy = (keys[k].usage & VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) != 0;
+            m_stats.unaliasedBytes += req.size;
+            Placement* target = nullptr;
+            for (Placement& placement : placements) {
+                if (placement.lazy != lazy || !(placement.requirements.memoryTypeBits & req.memoryTypeBits)) continue;
+                bool overlaps = std::any_of(placement.members.begin(), placement.members.end(), [&](uint32_t m) {
+                    return keys[m].firstPass <= keys[k].lastPass && keys[k].firstPass <= keys[m].lastPass;
+                });
+                if (!overlaps) {
+                    target = &placement;
+                    break;
+                }
+            }
+            if (!target) {
+                placements.push_back({ req, lazy, {} });
+                target = &placements.back();
+            }
+            target->requirements.size = std::max(target->requirements.size, req.size);
+            target->requirements.alignment = std::max(target->requirements.alignment, req.alignment);
+            target->requirements.memoryTypeBits &= req.memoryTypeBits;
+            target->members.push_back(k);
+        }
+
+        m_blocks.resize(placements.size());
+        m_stats.transientBytes = 0;
+        m_stats.reusedBlocks = 0;
+        m_stats.lazyMemory = false;
+        for (uint32_t b = 0; b < placements.size(); ++b) {
+            const Placement& placement = placements[b];
+            TransientBlock& block = m_blocks[b];
+            block.lazy = placement.lazy;
+
+            // Smallest previous block the placement fits in
+            TransientBlock* reuse = nullptr;
+            for (TransientBlock& previous : previousBlocks) {
+                const GpuAllocation& a = previous.allocation;
+                if (!a.IsValid() || previous.lazy != placement.lazy || a.size < placement.requirements.size ||
+                    a.offset % placement.requirements.alignment != 0 ||
+                    !(placement.requirements.memoryTypeBits & (1u << a.memoryType))) {
+                    continue;
+                }
+                if (!reuse || a.size < reuse->allocation.size) reuse = &previous;
+            }
+            if (reuse) {
+                block.allocation = reuse->allocation;
+                block.inheritedStages = reuse->stages;
+                block.inheritedWriteAccess = reuse->writeAccess;
+                reuse->allocation = GpuAllocation{};
+                m_stats.reusedBlocks++;
+            } else {
+                VkMemoryPropertyFlags properties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+                VkResult result = VK_ERROR_FEATURE_NOT_PRESENT;
+                if (placement.lazy) {
+                    result = m_allocator->Allocate(placement.requirements, properties | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT,
+                                                   true, block.allocation);
+                }
+                if (result != VK_SUCCESS) {
+                    block.lazy = false;
+                    result = m_allocator->Allocate(placement.requirements, properties, true, block.allocation);
+                }
+                VK_CHECK(result);
+            }
+            m_stats.lazyMemory |= block.lazy;
+            m_stats.transientBytes += block.allocation.size;
+
+            for (uint32_t k : placement.members) {
+                TransientImage& transient = m_transients[k];
+                transient.block = b;
+                VK_CHECK(vkBindImageMemory(m_dev, transient.image, m_blocks[b].allocation.memory,
+                                           m_blocks[b].allocation.offset));
+
+                VkImageAspectFlags aspect = AspectFor(keys[k].format);
+                VkImageViewCreateInfo viewInfo{};
+                viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+                viewInfo.image = transient.image;
+                viewInfo.viewType = keys[k].layers > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D;
+                viewInfo.format = keys[k].format;
+                viewInfo.subresourceRange.aspectMask = (aspect & VK_IMAGE_ASPECT_DEPTH_BIT) ? VK_IMAGE_ASPECT_DEPTH_BIT : aspect;
+                viewInfo.subresourceRange.baseMipLevel = 0;
+                viewInfo.subresourceRange.levelCount = 1;
+                viewInfo.subresourceRange.baseArrayLayer = 0;
+                viewInfo.subresourceRange.layerCount = keys[k].layers;
+                VK_CHECK(vkCreateImageView(m_dev, &viewInfo, nullptr, &transient.view));
+            }
+        }
+        for (TransientBlock& previous : previousBlocks) {
+            if (!previous.allocation.IsValid()) continue;
+            Retired retired;
+            retired.allocation = previous.allocation;
+            retired.frameNumber = m_frameNumber;
+            m_retired.push_back(retired);
+        }
+        m_stats.transientImages = static_cast<uint32_t>(keys.size());
+        m_stats.transientBlocks = static_cast<uint32_t>(m_blocks.size());
+        NOVA_INFO("RenderGraph: " + std::to_string(keys.size()) + " transient images in " +
+                  std::to_string(m_blocks.size()) + " blocks (" + std::to_string(m_stats.reusedBlocks) + " reused), " +
+                  std::to_string(m_stats.transientBytes >> 10) + " KB (" + std::to_string(m_stats.unaliasedBytes >> 10) +
+                  " KB unaliased)");
+    }
+
+    // A block's first user each frame waits for everything done with that
+    // memory before: earlier aliases this frame and all of them last frame
+    for (TransientBlock& block : m_blocks) {
+        block.stages = block.inheritedStages;
+        block.writeAccess = block.inheritedWriteAccess;
+        block.inheritedStages = 0;
+        block.inheritedWriteAccess = 0;
+    }
+    for (size_t k = 0; k < live.size(); ++k) {
+        Resource& resource = m_resources[live[k]];
+        resource.transient = static_cast<uint32_t>(k);
+        TransientBlock& block = m_blocks[m_transients[k].block];
+        block.stages |= resource.usedStages;
+        block.writeAccess |= resource.writtenAccess;
+    }
+}
+
+void RenderGraph::BuildAttachments() {
+    std::vector<bool> hasContents(m_resources.size(), false);
+    for (size_t i = 0; i < m_resources.size(); ++i) {
+        const Resource& r = m_resources[i];
+        hasContents[i] = r.imported && (!r.isImage || (r.external && r.external->layout != VK_IMAGE_LAYOUT_UNDEFINED));
+    }
+
+    for (int32_t i = 0; i < static_cast<int32_t>(m_passes.size()); ++i) {
+        Pass& pass = m_passes[i];
+        pass.attachments.clear();
+        if (!pass.live) continue;
+        if (!pass.externalRenderPass) {
+            Attachment depth;
+            bool hasDepth = false;
+            for (const Access& access : pass.accesses) {
+                const Resource& r = m_resources[access.resource];
+                AccessInfo info = Describe(access.access, r.aspect);
+                if (!info.attachment) continue;
+                Attachment attachment;
+                attachment.resource = access.resource;
+                attachment.layout = info.layout;
+                attachment.clearValue = access.clearValue;
+                attachment.loadOp = access.clear ? VK_ATTACHMENT_LOAD_OP_CLEAR
+                                  : hasContents[access.resource] ? VK_ATTACHMENT_LOAD_OP_LOAD
+                                  : VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+                attachment.storeOp = (r.imported || r.lastPass > i) ? VK_ATTACHMENT_STORE_OP_STORE
+                                                                     : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+                if (info.depth) {
+                    depth = attachment;
+                    hasDepth = true;
+                } else {
+                    pass.attachments.push_back(attachment);
+                }
+            }
+            if (hasDepth) pass.attachments.push_back(depth);
+        }
+        for (const Access& access : pass.accesses) {
+            if (access.write) hasContents[access.resource] = true;
+        }
+    }
+}
+
+void RenderGraph::Execute(VkCommandBuffer cmd) {
+    if (!m_compiled) Compile();
+
+    for (Resource& r : m_resources) {
+        r.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        r.writeStages = 0;
+        r.writeAccess = 0;
+        r.readStages = 0;
+        r.visibleStages = 0;
+        r.visibleAccess = 0;
+        if (r.imported && r.isImage && r.external) {
+            r.layout = r.external->layout;
+            r.writeStages = r.external->stages;
+            r.writeAccess = r.external->access;
+        } else if (r.transient != UINT32_MAX) {
+            const TransientBlock& block = m_blocks[m_transients[r.transient].block];
+            r.writeStages = block.stages;
+            r.writeAccess = block.writeAccess;
+        }
+    }
+
+    for (const Pass& pass : m_passes) {
+        if (!pass.live) continue;
+        RecordBarriers(cmd, pass);
+        bool renderPass = BeginRenderPass(cmd, pass);
+        if (pass.execute) pass.execute(cmd);
+        if (renderPass) {
+            vkCmdEndRenderPass(cmd);
+            m_activeRenderPass = VK_NULL_HANDLE;
+            m_activeFramebuffer = VK_NULL_HANDLE;
+        }
+    }
+    RecordFinalBarriers(cmd);
+
+    for (const Resource& r : m_resources) {
+        if (!r.imported || !r.isImage || !r.external) continue;
+        r.external->layout = r.layout;
+        r.external->stages = (r.writeStages | r.readStages) ? (r.writeStages | r.readStages)
+                                                            : VkPipelineStageFlags(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+        r.external->access = r.writeAccess;
+    }
+}
+
+void RenderGraph::RecordBarriers(VkCommandBuffer cmd, const Pass& pass) {
+    VkPipelineStageFlags srcStages = 0;
+    VkPipelineStageFlags dstStages = 0;
+    VkMemoryBarrier memory{};
+    memory.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    m_imageBarriers.clear();
+
+    for (const Access& access : pass.accesses) {
+        Resource& r = m_resources[access.resource];
+        AccessInfo info = Describe(access.access, r.aspect);
+        VkAccessFlags dstAccess = access.write ? info.access : (info.access & ~WRITE_ACCESS);
+        if (dstAccess == 0) dstAccess = info.access;
+        VkImageLayout layout = r.isImage ? info.layout : VK_IMAGE_LAYOUT_UNDEFINED;
+        bool layoutChange = r.isImage && r.layout != layout;
+
+        // Writes wait for the last write and every read since (WAW, WAR); reads
+        // wait for the last write unless it is already visible to them
+        VkPipelineStageFlags src = 0;
+        bool hazard = false;
+        if (access.write || layoutChange) {
+            src = r.writeStages | r.readStages;
+            hazard = src != 0 || layoutChange;
+        } else if (r.writeStages && ((r.visibleStages & info.stages) != info.stages ||
+                                     (r.visibleAccess & dstAccess) != dstAccess)) {
+            src = r.writeStages;
+            hazard = true;
+        }
+
+        if (hazard) {
+            srcStages |= src ? src : VkPipelineStageFlags(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+            dstStages |= info.stages;
+            if (r.isImage) {
+                VkImageMemoryBarrier barrier{};
+                barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+                barrier.srcAccessMask = r.writeAccess;
+                barrier.dstAccessMask = dstAccess;
+                // A cleared attachment's old contents are discarded anyway
+                barrier.oldLayout = access.clear ? VK_IMAGE_LAYOUT_UNDEFINED : r.layout;
+                barrier.newLayout = layout;
+                barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+                barrier.image = r.imported ? r.image : m_transients[r.transient].image;
+                barrier.subresourceRange.aspectMask = r.aspect;
+                barrier.subresourceRange.baseMipLevel = 0;
+                barrier.subresourceRange.levelCount = 1;
+                barrier.subresourceRange.baseArrayLayer = 0;
+                barrier.subresourceRange.layerCount = r.desc.layers;
+                m_imageBarriers.push_back(barrier);
+            } else if (r.writeAccess) {
+                memory.srcAccessMask |= r.writeAccess;
+                memory.dstAccessMask |= dstAccess;
+            }
+        }
+
+        r.layout = layout;
+        if (access.write) {
+            r.writeStages = info.stages;
+            r.writeAccess = info.access & WRITE_ACCESS;
+            r.readStages = 0;
+            r.visibleStages = info.stages;
+            r.visibleAccess = info.access;
+        } else if (layoutChange) {
+            // The transition is a write ordered before this read
+            r.writeStages = info.stages;
+            r.writeAccess = 0;
+            r.readStages = info.stages;
+            r.visibleStages = info.stages;
+            r.visibleAccess = dstAccess;
+        } else {
+            r.readStages |= info.stages;
+            r.visibleStages |= info.stages;
+            r.visibleAccess |= dstAccess;
+        }
+    }
+
+    if (srcStages == 0) return;
+    uint32_t memoryCount = memory.srcAccessMask ? 1 : 0;
+    vkCmdPipelineBarrier(cmd, srcStages, dstStages, 0, memoryCount, &memory, 0, nullptr,
+                         static_cast<uint32_t>(m_imageBarriers.size()), m_imageBarriers.data());
+    m_stats.barrierBatches++;
+    m_stats.barriers += memoryCount + static_cast<uint32_t>(m_imageBarriers.size());
+}
+
+void RenderGraph::RecordFinalBarriers(VkCommandBuffer cmd) {
+    VkPipelineStageFlags srcStages = 0;
+    m_imageBarriers.clear();
+    for (Resource& r : m_resources) {
+        if (!r.output || r.layout == r.finalLayout) continue;
+        VkImageMemoryBarrier barrier{};
+        barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.srcAccessMask = r.writeAccess;
+        barrier.dstAccessMask = 0;
+        barrier.oldLayout = r.layout;
+        barrier.newLayout = r.finalLayout;
+        barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image = r.image;
+        barrier.subresourceRange.aspectMask = r.aspect;
+        barrier.subresourceRange.baseMipLevel = 0;
+        barrier.subresourceRange.levelCount = 1;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount = r.desc.layers;
+        m_imageBarriers.push_back(barrier);
+
+        VkPipelineStageFlags src = r.writeStages | r.readStages;
+        srcStages |= src ? src : VkPipelineStageFlags(VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT);
+        r.layout = r.finalLayout;
+        r.writeStages = src;
+        r.writeAccess = 0;
+        r.readStages = 0;
+    }
+    if (m_imageBarriers.empty()) return;
+    vkCmdPipelineBarrier(cmd, srcStages, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr,
+                         static_cast<uint32_t>(m_imageBarriers.size()), m_imageBarriers.data());
+    m_stats.barrierBatches++;
+    m_stats.barriers += static_cast<uint32_t>(m_imageBarriers.size());
+}
+
+bool RenderGraph::BeginRenderPass(VkCommandBuffer cmd, const Pass& pass) {
+    if (pass.externalRenderPass || pass.attachments.empty()) return false;
+    VkRenderPass renderPass = GetRenderPass(pass);
+    VkExtent2D extent{};
+    VkFramebuffer framebuffer = renderPass ? GetFramebuffer(renderPass, pass, extent) : VK_NULL_HANDLE;
+    if (framebuffer == VK_NULL_HANDLE) {
+        NOVA_ERROR("RenderGraph: no framebuffer for pass '" + pass.name + "'");
+        return false;
+    }
+
+    m_clearValues.clear();
+    for (const Attachment& attachment : pass.attachments) m_clearValues.push_back(attachment.clearValue);
+
+    VkRenderPassBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+    beginInfo.renderPass = renderPass;
+    beginInfo.framebuffer = framebuffer;
+    beginInfo.renderArea.offset = {0, 0};
+    beginInfo.renderArea.extent = extent;
+    beginInfo.clearValueCount = static_cast<uint32_t>(m_clearValues.size());
+    beginInfo.pClearValues = m_clearValues.data();
+    vkCmdBeginRenderPass(cmd, &beginInfo, pass.secondaryContents ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS
+                                                                 : VK_SUBPASS_CONTENTS_INLINE);
+    m_activeRenderPass = renderPass;
+    m_activeFramebuffer = framebuffer;
+    return true;
+}
+
+VkRenderPass RenderGraph::GetRenderPass(const Pass& pass) {
+    RenderPassKey key;
+    for (const Attachment& attachment : pass.attachments) {
+        key.words.push_back(m_resources[attachment.resource].desc.format);
+        key.words.push_back((uint64_t(attachment.loadOp) << 32) | uint64_t(attachment.storeOp));
+        key.words.push_back(attachment.layout);
+    }
+    auto it = m_renderPasses.find(key);
+    if (it != m_renderPasses.end()) return it->second;
+
+    // Layouts never change inside the render pass: the graph's barriers do all
+    // transitions, so no external subpass dependencies are needed. Pipelines
+    // built against any render pass with the same formats stay compatible.
+    std::vector<VkAttachmentDescription> descriptions;
+    std::vector<VkAttachmentReference> colorRefs;
+    VkAttachmentReference depthRef{};
+    bool hasDepth = false;
+    for (uint32_t i = 0; i < pass.attachments.size(); ++i) {
+        const Attachment& attachment = pass.attachments[i];
+        VkAttachmentDescription description{};
+        description.format = m_resources[attachment.resource].desc.format;
+        description.samples = VK_SAMPLE_COUNT_1_BIT;
+        description.loadOp = attachment.loadOp;
+        description.storeOp = attachment.storeOp;
+        description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        description.initialLayout = attachment.layout;
+        description.finalLayout = attachment.layout;
+        descriptions.push_back(description);
+        if (m_resources[attachment.resource].aspect & VK_IMAGE_ASPECT_DEPTH_BIT) {
+            depthRef = { i, attachment.layout };
+            hasDepth = true;
+        } else {
+            colorRefs.push_back({ i, attachment.layout });
+        }
+    }
+
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.colorAttachmentCount = static_cast<uint32_t>(colorRefs.size());
+    subpass.pColorAttachments = colorRefs.data();
+    subpass.pDepthStencilAttachment = hasDepth ? &depthRef : nullptr;
+
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = static_cast<uint32_t>(descriptions.size());
+    renderPassInfo.pAttachments = descriptions.data();
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    VK_CHECK(vkCreateRenderPass(m_dev, &renderPassInfo, nullptr, &renderPass));
+    m_renderPasses[key] = renderPass;
+    return renderPass;
+}
+
+VkFramebuffer RenderGraph::GetFramebuffer(VkRenderPass renderPass, const Pass& pass, VkExtent2D& extent) {
+    FramebufferKey key{ renderPass, {}, 0, 0, 1 };
+    for (const Attachment& attachment : pass.attachments) {
+        const Resource& r = m_resources[attachment.resource];
+        key.views.push_back(View(RGResource{ attachment.resource }));
+        key.width = r.desc.extent.width;
+        key.height = r.desc.extent.height;
+    }
+    extent = { key.width, key.height };
+    if (std::find(key.views.begin(), key.views.end(), VK_NULL_HANDLE) != key.views.end()) return VK_NULL_HANDLE;
+
+    auto it = m_framebuffers.find(key);
+    if (it != m_framebuffers.end()) return it->second;
+
+    VkFramebufferCreateInfo framebufferInfo{};
+    framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferInfo.renderPass = renderPass;
+    framebufferInfo.attachmentCount = static_cast<uint32_t>(key.views.size());
+    framebufferInfo.pAttachments = key.views.data();
+    framebufferInfo.width = key.width;
+    framebufferInfo.height = key.height;
+    framebufferInfo.layers = key.layers;
+
+    VkFramebuffer framebuffer = VK_NULL_HANDLE;
+    VK_CHECK(vkCreateFramebuffer(m_dev, &framebufferInfo, nullptr, &framebuffer));
+    m_framebuffers[key] = framebuffer;
+    return framebuffer;
+}
+
+VkImageView RenderGraph::View(RGResource resource) const {
+    if (!resource.IsValid() || resource.id >= m_resources.size()) return VK_NULL_HANDLE;
+    const Resource& r = m_resources[resource.id];
+    if (r.imported) return r.view;
+    return r.transient != UINT32_MAX ? m_transients[r.transient].view : VK_NULL_HANDLE;
+}
+
+void RenderGraph::InvalidateFramebuffers() {
+    RetireFramebuffers();
+}
+
+void RenderGraph::RetireTransients() {
+    // Framebuffers may reference the views
+    RetireFramebuffers();
+    for (TransientImage& transient : m_transients) {
+        Retired retired;
+        retired.image = transient.image;
+        retired.view = transient.view;
+        retired.frameNumber = m_frameNumber;
+        m_retired.push_back(retired);
+    }
+    for (TransientBlock& block : m_blocks) {
+        Retired retired;
+        retired.allocation = block.allocation;
+        retired.frameNumber = m_frameNumber;
+        m_retired.push_back(retired);
+    }
+    m_transients.clear();
+    m_blocks.clear();
+    m_transientKeys.clear();
+}
+
+void RenderGraph::RetireFramebuffers() {
+    for (auto& entry : m_framebuffers) {
+        Retired retired;
+        retired.framebuffer = entry.second;
+        retired.frameNumber = m_frameNumber;
+        m_retired.push_back(retired);
+    }
+    m_framebuffers.clear();
+}
+
+void RenderGraph::DestroyRetired(bool all) {
+    // Retired while building frame N, or between frames after N was recorded:
+    // frame N is the last that may use it
+    auto destroy = [&](Retired& retired) {
+        if (!all && !m_frames->IsComplete(retired.frameNumber)) return false;
+        if (retired.framebuffer != VK_NULL_HANDLE) vkDestroyFramebuffer(m_dev, retired.framebuffer, nullptr);
+        if (retired.view != VK_NULL_HANDLE) vkDestroyImageView(m_dev, retired.view, nullptr);
+        if (retired.image != VK_NULL_HANDLE) vkDestroyImage(m_dev, retired.image, nullptr);
+        if (retired.allocation.IsValid()) m_allocator->Free(retired.allocation);
+        return true;
+    };
+    m_retired.erase(std::remove_if(m_retired.begin(), m_retired.end(), destroy), m_retired.end());
+}
+
+RenderGraph::AccessInfo RenderGraph::Describe(RGAccess access, VkImageAspectFlags aspect) {
+    bool depth = (aspect & VK_IMAGE_ASPECT_DEPTH_BIT) != 0;
+    VkImageLayout sampled = depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    AccessInfo info;
+    switch (access) {
+    case RGAccess::ColorAttachment:
+        info.stages = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        info.access = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        info.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        info.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+        info.attachment = true;
+        break;
+    case RGAccess::DepthAttachment:
+        info.stages = FRAGMENT_TESTS;
+        info.access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        info.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        info.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+        info.attachment = true;
+        info.depth = true;
+        break;
+    case RGAccess::DepthRead:
+        info.stages = FRAGMENT_TESTS;
+        info.access = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+        info.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+        info.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+        info.attachment = true;
+        info.depth = true;
+        break;
+    case RGAccess::SampledFragment:
+    case RGAccess::SampledCompute:
+        info.stages = access == RGAccess::SampledFragment ? VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
+                                                          : VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        info.access = VK_ACCESS_SHADER_READ_BIT;
+        info.layout = sampled;
+        info.usage = VK_IMAGE_USAGE_SAMPLED_BIT;
+        break;
+    case RGAccess::StorageCompute:
+        info.stages = VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        info.access = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        info.layout = VK_IMAGE_LAYOUT_GENERAL;
+        info.usage = VK_IMAGE_USAGE_STORAGE_BIT;
+        break;
+    case RGAccess::StorageFragment:
+        info.stages = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        info.access = VK_ACCESS_SHADER_READ_BIT;
+        info.layout = VK_IMAGE_LAYOUT_GENERAL;
+        info.usage = VK_IMAGE_USAGE_STORAGE_BIT;
+        break;
+    case RGAccess::IndirectRead:
+        info.stages = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT;
+        info.access = VK_ACCESS_INDIRECT_COMMAND_READ_BIT;
+        break;
+    case RGAccess::VertexRead:
+        info.stages = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT;
+        info.access = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+        break;
+    case RGAccess::TransferRead:
+        info.stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        info.access = VK_ACCESS_TRANSFER_READ_BIT;
+        info.layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        info.usage = VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        break;
+    case RGAccess::TransferWrite:
+        info.stages = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        info.access = VK_ACCESS_TRANSFER_WRITE_BIT;
+        info.layout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        info.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+        break;
+    }
+    return info;
+}
+
+VkImageAspectFlags RenderGraph::AspectFor(VkFormat format) {
+    switch (format) {
+    case VK_FORMAT_D16_UNORM:
+    case VK_FORMAT_X8_D24_UNORM_PACK32:
+    case VK_FORMAT_D32_SFLOAT:
+        return VK_IMAGE_ASPECT_DEPTH_BIT;
+    case VK_FORMAT_D16_UNORM_S8_UINT:
+    case VK_FORMAT_D24_UNORM_S8_UINT:
+    case VK_FORMAT_D32_SFLOAT_S8_UINT:
+        return VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+    default:
+        return VK_IMAGE_ASPECT_COLOR_BIT;
+    }
+}
+
+} // namespace nova
@@ -0,0 +1,282 @@
+#pragma once
+
+#ifndef VK_NO_PROTOTYPES
+#define VK_NO_PROTOTYPES
+#endif
+
+#include <volk.h>
+#include <vector>
+#include <map>
+#include <string>
+#include <functional>
+#include <cstdint>
+#include "GpuAllocator.h"
+#include "FrameTimeline.h"
+
+namespace nova {
+
+// How a pass touches a resource. Each maps to a pipeline stage, access mask
+// and, for images, the layout the pass needs.
+enum class RGAccess {
+    ColorAttachment,
+    DepthAttachment,      // Depth test with writes
+    DepthRead,            // Read-only depth test
+    SampledFragment,
+    SampledCompute,
+    StorageCompute,
+    StorageFragment,      // Read-only storage access from fragment shaders
+    IndirectRead,         // Buffers: indirect draw arguments and counts
+    VertexRead,           // Buffers: vertex or instance attributes
+    TransferRead,
+    TransferWrite,
+};
+
+struct RGResource {
+    uint32_t id = UINT32_MAX;
+    bool IsValid() const { return id != UINT32_MAX; }
+};
+
+struct RGImageDesc {
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    VkExtent2D extent = {0, 0};
+    uint32_t layers = 1;
+    VkImageUsageFlags usage = 0;   // On top of the usage implied by the declared accesses
+};
+
+// Layout and last access of an imported image, carried across frames by its owner
+struct RGImageState {
+    VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+    VkPipelineStageFlags stages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    VkAccessFlags access = 0;
+};
+
+struct RenderGraphStats {
+    uint32_t passes = 0;
+    uint32_t culledPasses = 0;
+    uint32_t barrierBatches = 0;      // vkCmdPipelineBarrier calls
+    uint32_t barriers = 0;            // Image and memory barriers inside them
+    uint32_t transientImages = 0;
+    uint32_t transientBlocks = 0;     // Memory allocations backing them
+    uint32_t reusedBlocks = 0;        // Blocks kept across re-placements (e.g. shrinking resizes)
+    VkDeviceSize transientBytes = 0;  // Allocated for transient images
+    VkDeviceSize unaliasedBytes = 0;  // What they would need without aliasing
+    bool lazyMemory = false;          // Some blocks are lazily allocated
+};
+
+// Per-frame graph of passes. Passes declare what they read and write, in
+// submission order. Compile culls passes nothing depends on, derives
+// attachment load/store ops and places transient images. Images whose
+// lifetimes do not overlap share one memory block. Execute records each live
+// pass behind a single batched vkCmdPipelineBarrier that covers every layout
+// transition and hazard it needs, and begins/ends its render pass.
+//
+// The graph is rebuilt every frame, but render passes, framebuffers and
+// transient images are cached. Transients are only reallocated when the set
+// of live transients changes (e.g. on resize); their memory blocks are kept
+// when the new placement still fits, so shrinking never reallocates. Replaced
+// objects are destroyed once the last frame that may use them has completed.
+class RenderGraph {
+public:
+    using ExecuteFn = std::function<void(VkCommandBuffer)>;
+
+    class PassBuilder {
+    public:
+        PassBuilder& Read(RGResource resource, RGAccess access);
+        PassBuilder& Write(RGResource resource, RGAccess access);
+        // Clears the attachment on load instead of keeping its contents
+        PassBuilder& Clear(RGResource resource, VkClearValue value);
+        // Never culled, e.g. passes with host-visible results
+        PassBuilder& SideEffect();
+        // Attachments are still transitioned, but the pass begins its own render passes
+        PassBuilder& ExternalRenderPass();
+        // The render pass is begun for secondary command buffers: the pass may
+        // only call vkCmdExecuteCommands, with ActiveRenderPass/Framebuffer
+        // as the secondaries' inheritance
+        PassBuilder& SecondaryCommandBuffers();
+
+    private:
+        friend class RenderGraph;
+        PassBuilder(RenderGraph* graph, uint32_t pass) : m_graph(graph), m_pass(pass) {}
+        RenderGraph* m_graph;
+        uint32_t m_pass;
+    };
+
+    void Init(VkDevice device, GpuAllocator* allocator, FrameTimeline* frames);
+    void Shutdown();
+
+    // Starts a new graph; call once the frame that last used this frame's slot has completed
+    void Reset(uint64_t frameNumber);
+
+    // `state` is read now and updated after Execute. A `finalLayout` other than
+    // UNDEFINED marks the image as consumed outside the graph (e.g. presented),
+    // so passes writing it are never culled.
+    RGResource ImportImage(const char* name, VkImage image, VkImageView view, const RGImageDesc& desc,
+                           RGImageState* state, VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED);
+    // Buffers are synchronized with global memory barriers; the owner keeps
+    // them alive and handles reuse across frames
+    RGResource ImportBuffer(const char* name, VkBuffer buffer);
+    // Graph-owned image whose contents do not survive the frame
+    RGResource CreateImage(const char* name, const RGImageDesc& desc);
+    PassBuilder AddPass(const char* name, ExecuteFn execute);
+
+    void Compile();
+    void Execute(VkCommandBuffer cmd);
+
+    // Drops framebuffers built on imported views (call when the swapchain is recreated)
+    void InvalidateFramebuffers();
+
+    VkImageView View(RGResource resource) const;
+    VkRenderPass ActiveRenderPass() const { return m_activeRenderPass; }
+    VkFramebuffer ActiveFramebuffer() const { return m_activeFramebuffer; }
+    const RenderGraphStats& Stats() const { return m_stats; }
+
+private:
+    struct Resource {
+        std::string name;
+        bool isImage = true;
+        bool imported = false;
+        bool output = false;                // Consumed outside the graph
+        RGImageDesc desc;
+        VkImageAspectFlags aspect = 0;
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        VkBuffer buffer = VK_NULL_HANDLE;
+        RGImageState* external = nullptr;
+        VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        // Compile
+        int32_t firstPass = -1;             // Live passes only
+        int32_t lastPass = -1;
+        VkImageUsageFlags usage = 0;
+        VkPipelineStageFlags usedStages = 0;
+        VkAccessFlags writtenAccess = 0;
+        bool attachmentOnly = true;
+        uint32_t transient = UINT32_MAX;    // Index into m_transients
+
+        // Execute: current layout, the last write and the reads made visible since
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkPipelineStageFlags writeStages = 0;
+        VkAccessFlags writeAccess = 0;
+        VkPipelineStageFlags readStages = 0;
+        VkPipelineStageFlags visibleStages = 0;
+        VkAccessFlags visibleAccess = 0;
+    };
+    struct Access {
+        uint32_t resource = 0;
+        RGAccess access = RGAccess::ColorAttachment;
+        bool write = false;
+        bool clear = false;
+        VkClearValue clearValue{};
+    };
+    struct Attachment {
+        uint32_t resource = 0;
+        VkAttachmentLoadOp loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        VkAttachmentStoreOp storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkClearValue clearValue{};
+    };
+    struct Pass {
+        std::string name;
+        ExecuteFn execute;
+        std::vector<Access> accesses;
+        bool sideEffect = false;
+        bool externalRenderPass = false;
+        bool secondaryContents = false;
+        bool live = false;
+        std::vector<Attachment> attachments; // Colors first, then depth
+    };
+    struct AccessInfo {
+        VkPipelineStageFlags stages = 0;
+        VkAccessFlags access = 0;
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkImageUsageFlags usage = 0;
+        bool attachment = false;
+        bool depth = false;
+    };
+
+    // One physical transient image, bound into a shared block
+    struct TransientImage {
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        uint32_t block = 0;
+    };
+    struct TransientBlock {
+        GpuAllocation allocation;
+        bool lazy = false;                  // Lazily allocated memory
+        VkPipelineStageFlags stages = 0;    // Every access of every image placed in it
+        VkAccessFlags writeAccess = 0;
+        // Accesses of the images it backed before a re-placement, which the
+        // first frame using the new images must also wait for
+        VkPipelineStageFlags inheritedStages = 0;
+        VkAccessFlags inheritedWriteAccess = 0;
+    };
+    // Identifies a transient placement; equal keys reuse the physical images
+    struct TransientKey {
+        VkFormat format;
+        uint32_t width, height, layers;
+        VkImageUsageFlags usage;
+        int32_t firstPass, lastPass;
+        bool operator==(const TransientKey& o) const {
+            return format == o.format && width == o.width && height == o.height && layers == o.layers &&
+                   usage == o.usage && firstPass == o.firstPass && lastPass == o.lastPass;
+        }
+    };
+    struct RenderPassKey {
+        std::vector<uint64_t> words;
+        bool operator<(const RenderPassKey& o) const { return words < o.words; }
+    };
+    struct FramebufferKey {
+        VkRenderPass renderPass;
+        std::vector<VkImageView> views;
+        uint32_t width, height, layers;
+        bool operator<(const FramebufferKey& o) const;
+    };
+    struct Retired {
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        VkFramebuffer framebuffer = VK_NULL_HANDLE;
+        GpuAllocation allocation;
+        uint64_t frameNumber = 0;
+    };
+
+    static AccessInfo Describe(RGAccess access, VkImageAspectFlags aspect);
+    static VkImageAspectFlags AspectFor(VkFormat format);
+    void AddAccess(uint32_t pass, RGResource resource, RGAccess access, bool write);
+    void CullPasses();
+    void ComputeLifetimes();
+    void PlaceTransients();
+    void BuildAttachments();
+    void RecordBarriers(VkCommandBuffer cmd, const Pass& pass);
+    void RecordFinalBarriers(VkCommandBuffer cmd);
+    bool BeginRenderPass(VkCommandBuffer cmd, const Pass& pass);
+    VkRenderPass GetRenderPass(const Pass& pass);
+    VkFramebuffer GetFramebuffer(VkRenderPass renderPass, const Pass& pass, VkExtent2D& extent);
+    void RetireTransients();
+    void RetireFramebuffers();
+    void DestroyRetired(bool all);
+
+    VkDevice m_dev = VK_NULL_HANDLE;
+    GpuAllocator* m_allocator = nullptr;
+    FrameTimeline* m_frames = nullptr;
+    uint64_t m_frameNumber = 0;
+    bool m_lazyMemorySupported = false;
+
+    std::vector<Resource> m_resources;
+    std::vector<Pass> m_passes;
+    bool m_compiled = false;
+
+    std::vector<TransientKey> m_transientKeys;
+    std::vector<TransientImage> m_transients;
+    std::vector<TransientBlock> m_blocks;
+    std::map<RenderPassKey, VkRenderPass> m_renderPasses;
+    std::map<FramebufferKey, VkFramebuffer> m_framebuffers;
+    std::vector<Retired> m_retired;
+
+    std::vector<VkImageMemoryBarrier> m_imageBarriers; // Scratch for one batch
+    std::vector<VkClearValue> m_clearValues;
+    VkRenderPass m_activeRenderPass = VK_NULL_HANDLE;
+    VkFramebuffer m_activeFramebuffer = VK_NULL_HANDLE;
+    RenderGraphStats m_stats;
+};
+
+} // namespace nova
@@ -0,0 +1,83 @@
+#include "SecondaryCommandPools.h"
+#include "core/Log.h"
+#include <algorithm>
+
+namespace nova {
+
+bool SecondaryCommandPools::Init(VkDevice device, uint32_t queueFamily, uint32_t framesInFlight, uint32_t threadCount) {
+    m_dev = device;
+    m_framesInFlight = std::max(1u, framesInFlight);
+    m_threadCount = std::max(1u, threadCount);
+    m_pools.assign(size_t(m_framesInFlight) * m_threadCount, Pool{});
+
+    // Transient: the buffers are re-recorded every time the slot comes around
+    VkCommandPoolCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    info.queueFamilyIndex = queueFamily;
+    for (Pool& pool : m_pools) {
+        if (vkCreateCommandPool(m_dev, &info, nullptr, &pool.pool) != VK_SUCCESS) {
+            NOVA_ERROR("SecondaryCommandPools: vkCreateCommandPool failed");
+            Shutdown();
+            return false;
+        }
+    }
+    NOVA_INFO("Secondary command pools ready: " + std::to_string(m_framesInFlight) + " frames x " +
+              std::to_string(m_threadCount) + " threads");
+    return true;
+}
+
+void SecondaryCommandPools::Shutdown() {
+    if (m_dev == VK_NULL_HANDLE) return;
+    // Destroying a pool frees its buffers
+    for (Pool& pool : m_pools) {
+        if (pool.pool != VK_NULL_HANDLE) vkDestroyCommandPool(m_dev, pool.pool, nullptr);
+    }
+    m_pools.clear();
+    m_threadCount = 0;
+    m_dev = VK_NULL_HANDLE;
+}
+
+void SecondaryCommandPools::BeginFrame(uint32_t slot) {
+    if (slot >= m_framesInFlight) return;
+    for (uint32_t thread = 0; thread < m_threadCount; ++thread) {
+        Pool& pool = At(slot, thread);
+        if (pool.used == 0) continue;
+        vkResetCommandPool(m_dev, pool.pool, 0);
+        pool.used = 0;
+    }
+}
+
+VkCommandBuffer SecondaryCommandPools::Begin(uint32_t slot, uint32_t thread, const VkCommandBufferInheritanceInfo& inheritance) {
+    if (slot >= m_framesInFlight || thread >= m_threadCount) return VK_NULL_HANDLE;
+    Pool& pool = At(slot, thread);
+    if (pool.used == pool.buffers.size()) {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = pool.pool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        allocInfo.commandBufferCount = 1;
+        VkCommandBuffer buffer = VK_NULL_HANDLE;
+        if (vkAllocateCommandBuffers(m_dev, &allocInfo, &buffer) != VK_SUCCESS) return VK_NULL_HANDLE;
+        pool.buffers.push_back(buffer);
+    }
+    VkCommandBuffer cmd = pool.buffers[pool.used++];
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    beginInfo.pInheritanceInfo = &inheritance;
+    if (vkBeginCommandBuffer(cmd, &beginInfo) != VK_SUCCESS) return VK_NULL_HANDLE;
+    return cmd;
+}
+
+uint32_t SecondaryCommandPools::UsedCount(uint32_t slot) const {
+    uint32_t used = 0;
+    if (slot >= m_framesInFlight) return used;
+    for (uint32_t thread = 0; thread < m_threadCount; ++thread) {
+        used += m_pools[slot * m_threadCount + thread].used;
+    }
+    return used;
+}
+
+} // namespace nova
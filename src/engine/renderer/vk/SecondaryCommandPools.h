@@ -0,0 +1,48 @@
+#pragma once
+
+#ifndef VK_NO_PROTOTYPES
+#define VK_NO_PROTOTYPES
+#endif
+
+#include <volk.h>
+#include <vector>
+#include <cstdint>
+
+namespace nova {
+
+// Secondary command buffers for multithreaded recording. Command pools are
+// externally synchronized, so every (frame slot, thread) pair gets its own
+// pool; a thread only ever touches its own pool and needs no lock. Buffers
+// are allocated on demand and recycled by resetting the whole pool once the
+// slot's fence has been waited.
+class SecondaryCommandPools {
+public:
+    bool Init(VkDevice device, uint32_t queueFamily, uint32_t framesInFlight, uint32_t threadCount);
+    void Shutdown();
+
+    // Render thread, after the slot's fence wait; recycles every buffer of `slot`
+    void BeginFrame(uint32_t slot);
+
+    // Thread `thread` only. Returns a begun secondary that continues the
+    // render pass in `inheritance`, or VK_NULL_HANDLE on failure.
+    VkCommandBuffer Begin(uint32_t slot, uint32_t thread, const VkCommandBufferInheritanceInfo& inheritance);
+
+    uint32_t ThreadCount() const { return m_threadCount; }
+    // Secondaries handed out for `slot` since its BeginFrame
+    uint32_t UsedCount(uint32_t slot) const;
+
+private:
+    struct Pool {
+        VkCommandPool pool = VK_NULL_HANDLE;
+        std::vector<VkCommandBuffer> buffers;
+        uint32_t used = 0;
+    };
+    Pool& At(uint32_t slot, uint32_t thread) { return m_pools[slot * m_threadCount + thread]; }
+
+    VkDevice m_dev = VK_NULL_HANDLE;
+    uint32_t m_framesInFlight = 0;
+    uint32_t m_threadCount = 0;
+    std::vector<Pool> m_pools;      // [slot * threadCount + thread]
+};
+
+} // namespace nova
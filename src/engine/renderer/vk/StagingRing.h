@@ -0,0 +1,79 @@
+#pragma once
+#include <cstdint>
+
+namespace nova {
+
+// Space accounting for UploadManager's staging ring, kept free of Vulkan so the
+// wrap/retire rules can be exercised on their own. Allocations are charged to
+// a Span (one per upload batch); releasing spans in submission order returns
+// their bytes, including any padding skipped when an allocation wrapped.
+class StagingRing {
+public:
+    struct Span {
+        uint64_t end = 0;   // Head position after the span's last allocation
+        uint64_t bytes = 0; // Bytes consumed, including alignment and wrap padding
+    };
+
+    void Reset(uint64_t size, uint64_t alignment) {
+        m_size = size;
+        m_alignment = alignment;
+        m_head = 0;
+        m_tail = 0;
+        m_used = 0;
+    }
+
+    bool Allocate(uint64_t size, Span& span, uint64_t& offset) {
+        if (size > m_size) return false;
+        if (m_used == 0) {
+            m_head = 0;
+            m_tail = 0;
+        } else if (m_head == m_tail) {
+            return false; // Completely full
+        }
+
+        uint64_t start = (m_head + m_alignment - 1) & ~(m_alignment - 1);
+        uint64_t consumed = 0;
+        if (m_head >= m_tail) {
+            // Free space is [head, end) followed by [0, tail)
+            if (start + size <= m_size) {
+                consumed = start - m_head + size;
+            } else if (size <= m_tail) {
+                consumed = m_size - m_head + size; // Skip the tail end of the ring
+                start = 0;
+            } else {
+                return false;
+            }
+        } else {
+            if (start + size > m_tail) return false;
+            consumed = start - m_head + size;
+        }
+
+        offset = start;
+        m_head = start + size;
+        m_used += consumed;
+        span.bytes += consumed;
+        span.end = m_head;
+        return true;
+    }
+
+    // Spans must be released in the order they were filled. A span that never
+    // allocated (a batch that only recorded GPU-side copies) owns no bytes and
+    // leaves the tail where it is.
+    void Release(const Span& span) {
+        if (span.bytes == 0) return;
+        m_tail = span.end;
+        m_used -= span.bytes;
+    }
+
+    uint64_t Size() const { return m_size; }
+    uint64_t Used() const { return m_used; }
+
+private:
+    uint64_t m_size = 0;
+    uint64_t m_alignment = 1;
+    uint64_t m_head = 0; // Next write position
+    uint64_t m_tail = 0; // Start of the oldest unreleased data
+    uint64_t m_used = 0; // Bytes between tail and head, including wrap padding
+};
+
+} // namespace nova
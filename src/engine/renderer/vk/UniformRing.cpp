@@ -0,0 +1,63 @@
+#include "UniformRing.h"
+#include "core/Log.h"
+#include <algorithm>
+
+namespace nova {
+
+bool UniformRing::Init(GpuAllocator* allocator, VkDeviceSize minAlignment, uint32_t framesInFlight, VkDeviceSize bytesPerFrame) {
+    m_allocator = allocator;
+    m_alignment = std::max<VkDeviceSize>(1, minAlignment);
+    m_slices.assign(std::max(1u, framesInFlight), Slice{});
+    m_stats = {};
+    // Slices start on an aligned boundary so every offset inside them is aligned
+    m_stats.bytesPerFrame = (bytesPerFrame + m_alignment - 1) / m_alignment * m_alignment;
+
+    VkDeviceSize size = m_stats.bytesPerFrame * m_slices.size();
+    VkResult result = m_allocator->CreateBuffer(size, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
+                                                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                                m_buffer, m_allocation);
+    if (result != VK_SUCCESS || !m_allocation.mapped) {
+        NOVA_ERROR("UniformRing: failed to create " + std::to_string(size) + " byte buffer: " + std::to_string(result));
+        Shutdown();
+        return false;
+    }
+    m_mapped = static_cast<uint8_t*>(m_allocation.mapped);
+    NOVA_INFO("Uniform ring ready: " + std::to_string(m_slices.size()) + " x " + std::to_string(m_stats.bytesPerFrame / 1024) +
+              " KB, " + std::to_string(m_alignment) + " byte alignment");
+    return true;
+}
+
+void UniformRing::Shutdown() {
+    if (!m_allocator) return;
+    m_allocator->DestroyBuffer(m_buffer, m_allocation);
+    m_buffer = VK_NULL_HANDLE;
+    m_mapped = nullptr;
+    m_slices.clear();
+}
+
+UniformAllocation UniformRing::Allocate(uint32_t slot, uint64_t frameNumber, VkDeviceSize size) {
+    UniformAllocation allocation;
+    if (!m_mapped || size == 0 || slot >= m_slices.size()) return allocation;
+
+    Slice& slice = m_slices[slot];
+    if (slice.frameNumber != frameNumber) {
+        slice.frameNumber = frameNumber;
+        slice.cursor = 0;
+    }
+    VkDeviceSize aligned = (size + m_alignment - 1) / m_alignment * m_alignment;
+    if (slice.cursor + aligned > m_stats.bytesPerFrame) {
+        if (m_stats.failedAllocations++ == 0) {
+            NOVA_WARN("UniformRing: frame slice of " + std::to_string(m_stats.bytesPerFrame) + " bytes is full");
+        }
+        return allocation;
+    }
+
+    VkDeviceSize offset = slot * m_stats.bytesPerFrame + slice.cursor;
+    slice.cursor += aligned;
+    m_stats.peakBytes = std::max(m_stats.peakBytes, slice.cursor);
+    allocation.offset = static_cast<uint32_t>(offset);
+    allocation.data = m_mapped + offset;
+    return allocation;
+}
+
+} // namespace nova
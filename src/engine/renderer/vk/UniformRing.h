@@ -0,0 +1,67 @@
+#pragma once
+
+#ifndef VK_NO_PROTOTYPES
+#define VK_NO_PROTOTYPES
+#endif
+
+#include <volk.h>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include "GpuAllocator.h"
+
+namespace nova {
+
+// A block of uniform data inside the ring. Bind the ring's buffer through a
+// UNIFORM_BUFFER_DYNAMIC descriptor and pass `offset` as the dynamic offset.
+struct UniformAllocation {
+    uint32_t offset = 0;
+    void* data = nullptr;       // Write-only: mapped memory may be write-combined
+    bool IsValid() const { return data != nullptr; }
+};
+
+struct UniformRingStats {
+    VkDeviceSize bytesPerFrame = 0;
+    VkDeviceSize peakBytes = 0;     // Most any frame has used
+    uint32_t failedAllocations = 0; // Requests that did not fit their frame's slice
+};
+
+// Persistently mapped uniform buffer split into one slice per frame in flight,
+// suballocated linearly with offsets aligned to minUniformBufferOffsetAlignment.
+// The cursor rewinds the first time a slot is used in a new frame, so data
+// the GPU is still reading for other frames is never overwritten. Unlike
+// InstanceRing it never grows: descriptors point at the one buffer, so an
+// allocation that does not fit fails and the caller skips that data.
+class UniformRing {
+public:
+    bool Init(GpuAllocator* allocator, VkDeviceSize minAlignment, uint32_t framesInFlight, VkDeviceSize bytesPerFrame);
+    void Shutdown();
+
+    // The caller must have waited on the fence of `slot` for this frame.
+    UniformAllocation Allocate(uint32_t slot, uint64_t frameNumber, VkDeviceSize size);
+    template <typename T>
+    UniformAllocation Push(uint32_t slot, uint64_t frameNumber, const T& value) {
+        UniformAllocation allocation = Allocate(slot, frameNumber, sizeof(T));
+        if (allocation.data) std::memcpy(allocation.data, &value, sizeof(T));
+        return allocation;
+    }
+
+    VkBuffer Buffer() const { return m_buffer; }
+    const UniformRingStats& Stats() const { return m_stats; }
+
+private:
+    struct Slice {
+        VkDeviceSize cursor = 0;
+        uint64_t frameNumber = ~0ull;
+    };
+
+    GpuAllocator* m_allocator = nullptr;
+    VkBuffer m_buffer = VK_NULL_HANDLE;
+    GpuAllocation m_allocation;
+    uint8_t* m_mapped = nullptr;
+    VkDeviceSize m_alignment = 1;
+    std::vector<Slice> m_slices;
+    UniformRingStats m_stats;
+};
+
+} // namespace nova
@@ -0,0 +1,207 @@
+#include "UploadManager.h"
+#include "VulkanHelpers.h"
+#include "core/Log.h"
+#include <algorithm>
+#include <cstring>
+
+namespace nova {
+
+namespace {
+constexpr VkDeviceSize RING_ALIGNMENT = 16; // Satisfies optimalBufferCopyOffsetAlignment on common hardware
+}
+
+void UploadManager::Init(VkDevice device, GpuAllocator* allocator, uint32_t graphicsFamily, uint32_t transferFamily,
+                         VkQueue transferQueue, RenderCounters* counters, VkDeviceSize ringSize) {
+    m_dev = device;
+    m_allocator = allocator;
+    m_counters = counters;
+    m_graphicsFamily = graphicsFamily;
+    m_transferFamily = transferFamily;
+    m_families[0] = graphicsFamily;
+    m_families[1] = transferFamily;
+    m_queue = transferQueue;
+    m_ringSpace.Reset(ringSize, RING_ALIGNMENT);
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT | VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+    poolInfo.queueFamilyIndex = transferFamily;
+    VK_CHECK(vkCreateCommandPool(m_dev, &poolInfo, nullptr, &m_pool));
+
+    VkSemaphoreTypeCreateInfo typeInfo{};
+    typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    typeInfo.initialValue = 0;
+    VkSemaphoreCreateInfo semInfo{};
+    semInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    semInfo.pNext = &typeInfo;
+    VK_CHECK(vkCreateSemaphore(m_dev, &semInfo, nullptr, &m_timeline));
+
+    VK_CHECK(m_allocator->CreateBuffer(ringSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+                                       VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                                       m_ring, m_ringAlloc));
+
+    NOVA_INFO("Upload manager ready: " + std::to_string(ringSize >> 20) + " MB staging ring on " +
+              (HasDedicatedQueue() ? "dedicated transfer queue family " + std::to_string(transferFamily)
+                                   : std::string("the graphics queue")));
+}
+
+void UploadManager::Shutdown() {
+    if (m_dev == VK_NULL_HANDLE) return;
+
+    Flush();
+    if (m_lastSubmitted > 0) Wait(m_lastSubmitted);
+    Retire();
+
+    m_allocator->DestroyBuffer(m_ring, m_ringAlloc);
+    if (m_timeline != VK_NULL_HANDLE) vkDestroySemaphore(m_dev, m_timeline, nullptr);
+    if (m_pool != VK_NULL_HANDLE) vkDestroyCommandPool(m_dev, m_pool, nullptr); // Frees all command buffers
+    m_timeline = VK_NULL_HANDLE;
+    m_pool = VK_NULL_HANDLE;
+    m_freeCmds.clear();
+    m_inFlight.clear();
+    m_dev = VK_NULL_HANDLE;
+}
+
+VkCommandBuffer UploadManager::OpenBatch() {
+    if (m_open.cmd != VK_NULL_HANDLE) return m_open.cmd;
+
+    if (!m_freeCmds.empty()) {
+        m_open.cmd = m_freeCmds.back();
+        m_freeCmds.pop_back();
+    } else {
+        VkCommandBufferAllocateInfo allocInfo{};
+        allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        allocInfo.commandPool = m_pool;
+        allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        allocInfo.commandBufferCount = 1;
+        VK_CHECK(vkAllocateCommandBuffers(m_dev, &allocInfo, &m_open.cmd));
+    }
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    VK_CHECK(vkBeginCommandBuffer(m_open.cmd, &beginInfo));
+    return m_open.cmd;
+}
+
+void UploadManager::UploadBuffer(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size) {
+    if (dst == VK_NULL_HANDLE || size == 0) return;
+
+    const auto* src = static_cast<const char*>(data);
+    const VkDeviceSize maxChunk = std::max<VkDeviceSize>(m_ringSpace.Size() / 4, RING_ALIGNMENT);
+    VkDeviceSize done = 0;
+    while (done < size) {
+        VkDeviceSize chunk = std::min(size - done, maxChunk);
+        VkDeviceSize ringOffset = 0;
+        while (!m_ringSpace.Allocate(chunk, m_open.span, ringOffset)) {
+            // Ring is full: submit what we have and wait for the oldest batch
+            Flush();
+            if (m_inFlight.empty()) {
+                NOVA_ERROR("UploadManager: " + std::to_string(chunk) + " byte chunk does not fit the staging ring");
+                return;
+            }
+            WaitForOldest();
+        }
+
+        memcpy(static_cast<char*>(m_ringAlloc.mapped) + ringOffset, src + done, chunk);
+
+        VkBufferCopy region{};
+        region.srcOffset = ringOffset;
+        region.dstOffset = dstOffset + done;
+        region.size = chunk;
+        vkCmdCopyBuffer(OpenBatch(), m_ring, dst, 1, &region);
+        done += chunk;
+    }
+    if (m_counters) m_counters->bufferBytesUploaded += size;
+}
+
+void UploadManager::CopyBuffer(VkBuffer src, VkBuffer dst, VkDeviceSize srcOffset, VkDeviceSize dstOffset,
+                               VkDeviceSize size) {
+    if (src == VK_NULL_HANDLE || dst == VK_NULL_HANDLE || size == 0) return;
+
+    VkCommandBuffer cmd = OpenBatch();
+
+    // Earlier uploads into `src` may still be executing on this queue...
+    VkMemoryBarrier barrier{};
+    barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                         1, &barrier, 0, nullptr, 0, nullptr);
+
+    VkBufferCopy region{};
+    region.srcOffset = srcOffset;
+    region.dstOffset = dstOffset;
+    region.size = size;
+    vkCmdCopyBuffer(cmd, src, dst, 1, &region);
+
+    // ...and later uploads may land inside the copied range of `dst`
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+                         1, &barrier, 0, nullptr, 0, nullptr);
+}
+
+uint64_t UploadManager::Flush() {
+    if (m_open.cmd == VK_NULL_HANDLE) return m_lastSubmitted;
+
+    VK_CHECK(vkEndCommandBuffer(m_open.cmd));
+
+    uint64_t value = m_lastSubmitted + 1;
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    timelineInfo.signalSemaphoreValueCount = 1;
+    timelineInfo.pSignalSemaphoreValues = &value;
+
+    VkSubmitInfo submitInfo{};
+    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submitInfo.pNext = &timelineInfo;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &m_open.cmd;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &m_timeline;
+    VK_CHECK(vkQueueSubmit(m_queue, 1, &submitInfo, VK_NULL_HANDLE));
+
+    m_open.value = value;
+    m_inFlight.push_back(m_open);
+    m_open = Batch{};
+    m_lastSubmitted = value;
+    m_submitCount++;
+
+    Retire();
+    return value;
+}
+
+bool UploadManager::IsComplete(uint64_t value) const {
+    uint64_t completed = 0;
+    vkGetSemaphoreCounterValue(m_dev, m_timeline, &completed);
+    return completed >= value;
+}
+
+void UploadManager::Wait(uint64_t value) {
+    VkSemaphoreWaitInfo waitInfo{};
+    waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+    waitInfo.semaphoreCount = 1;
+    waitInfo.pSemaphores = &m_timeline;
+    waitInfo.pValues = &value;
+    VK_CHECK(vkWaitSemaphores(m_dev, &waitInfo, UINT64_MAX));
+}
+
+void UploadManager::WaitForOldest() {
+    if (m_inFlight.empty()) return;
+    Wait(m_inFlight.front().value);
+    Retire();
+}
+
+void UploadManager::Retire() {
+    uint64_t completed = 0;
+    vkGetSemaphoreCounterValue(m_dev, m_timeline, &completed);
+    while (!m_inFlight.empty() && m_inFlight.front().value <= completed) {
+        Batch& batch = m_inFlight.front();
+        m_ringSpace.Release(batch.span);
+        vkResetCommandBuffer(batch.cmd, 0);
+        m_freeCmds.push_back(batch.cmd);
+        m_inFlight.pop_front();
+    }
+}
+
+} // namespace nova
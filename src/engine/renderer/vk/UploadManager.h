@@ -0,0 +1,90 @@
+#pragma once
+
+#ifndef VK_NO_PROTOTYPES
+#define VK_NO_PROTOTYPES
+#endif
+
+#include <volk.h>
+#include <vector>
+#include <deque>
+#include <cstdint>
+#include "GpuAllocator.h"
+#include "StagingRing.h"
+
+namespace nova {
+
+// Batched buffer uploads through a persistent staging ring.
+// Copies are recorded into an open batch and submitted together by Flush() on
+// the transfer queue (a dedicated one when the device has it). Each batch
+// signals a timeline semaphore value; graphics submissions wait on that value
+// instead of the CPU idling the queue, and ring space is reclaimed as values
+// complete. Destination buffers must be created with SharingFamilies() so they
+// can be written by the transfer queue and read by graphics without ownership
+// transfers.
+class UploadManager {
+public:
+    static constexpr VkDeviceSize DEFAULT_RING_SIZE = 32ull << 20;
+
+    void Init(VkDevice device, GpuAllocator* allocator, uint32_t graphicsFamily, uint32_t transferFamily,
+              VkQueue transferQueue, RenderCounters* counters, VkDeviceSize ringSize = DEFAULT_RING_SIZE);
+    void Shutdown();
+
+    // Copy `size` bytes into `dst` at `dstOffset`. Large uploads are split
+    // across several ring chunks; blocks only when the ring is full of
+    // in-flight batches.
+    void UploadBuffer(VkBuffer dst, VkDeviceSize dstOffset, const void* data, VkDeviceSize size);
+
+    // GPU-side copy between two buffers, ordered after every copy recorded or
+    // submitted before it (used to migrate a buffer that is being grown).
+    void CopyBuffer(VkBuffer src, VkBuffer dst, VkDeviceSize srcOffset, VkDeviceSize dstOffset, VkDeviceSize size);
+
+    // Submit the open batch. Returns the timeline value that marks completion
+    // of every upload recorded so far (0 if nothing was ever submitted).
+    uint64_t Flush();
+
+    VkSemaphore Timeline() const { return m_timeline; }
+    uint64_t LastSubmittedValue() const { return m_lastSubmitted; }
+    bool IsComplete(uint64_t value) const;
+    void Wait(uint64_t value);
+
+    bool HasDedicatedQueue() const { return m_transferFamily != m_graphicsFamily; }
+    uint32_t SharingFamilyCount() const { return HasDedicatedQueue() ? 2u : 1u; }
+    const uint32_t* SharingFamilies() const { return m_families; }
+
+    uint64_t SubmitCount() const { return m_submitCount; }
+    VkDeviceSize RingSize() const { return m_ringSpace.Size(); }
+    VkDeviceSize RingUsed() const { return m_ringSpace.Used(); }
+
+private:
+    struct Batch {
+        VkCommandBuffer cmd = VK_NULL_HANDLE;
+        uint64_t value = 0;
+        StagingRing::Span span;      // Staging bytes this batch reads from
+    };
+
+    void Retire();
+    void WaitForOldest();
+    VkCommandBuffer OpenBatch();
+
+    VkDevice m_dev = VK_NULL_HANDLE;
+    GpuAllocator* m_allocator = nullptr;
+    RenderCounters* m_counters = nullptr;
+    uint32_t m_graphicsFamily = 0;
+    uint32_t m_transferFamily = 0;
+    uint32_t m_families[2] = {};
+    VkQueue m_queue = VK_NULL_HANDLE;
+    VkCommandPool m_pool = VK_NULL_HANDLE;
+    VkSemaphore m_timeline = VK_NULL_HANDLE;
+
+    VkBuffer m_ring = VK_NULL_HANDLE;
+    GpuAllocation m_ringAlloc;
+    StagingRing m_ringSpace;
+
+    Batch m_open;                  // Batch currently being recorded
+    std::deque<Batch> m_inFlight;
+    std::vector<VkCommandBuffer> m_freeCmds;
+    uint64_t m_lastSubmitted = 0;
+    uint64_t m_submitCount = 0;
+};
+
+} // namespace nova
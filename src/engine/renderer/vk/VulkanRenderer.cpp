@@ -12,14 +12,19 @@
 #include <glm/gtc/type_ptr.hpp>
 #include <vector>
 #include <array>
+#include <algorithm>
 #include <cstring>
 #include <stdexcept>
 #include <thread>
 #include <chrono>
+#include <cmath>
+#include <limits>
 
 #include "VulkanRenderer.h"
 #include "VulkanHelpers.h"
 #include "core/Log.h"
+#include "core/Profiler.h"
+#include "core/MemoryTracker.h"
 #include "core/Camera.h"
 #include "core/LightingManager.h"
 
@@ -44,11 +49,34 @@ struct PushConstants {
 // Uniform buffer data (moved from push constants)
 struct UniformBufferObject {
     glm::mat4 model;           // Model matrix (moved from push constants)
-    glm::vec4 lightPositions[3];  // 3 light positions
-    glm::vec4 lightColors[3];     // 3 light colors
+    glm::vec4 clusterScale;       // LightClusters::ClusterScale, for pbr.frag's cluster lookup
+    glm::uvec4 lightCounts;       // x: global lights at the start of the light buffer
     glm::mat4 lightSpaceMatrices[3];   // Light space matrices for all lights
 };
 
+// Splits a glm::perspective (-1..1 depth) view-projection with a rigid view
+// back into the two matrices and the near/far distances. A y-flipped
+// projection comes back unflipped with the flip in `view`; the product and
+// view depths are unchanged, which is all culling and light binning need.
+static void SplitViewProjection(const glm::mat4& viewProj, glm::mat4& view, glm::mat4& projection,
+                                float& zNear, float& zFar) {
+    auto row = [&](int r) { return glm::vec4(viewProj[0][r], viewProj[1][r], viewProj[2][r], viewProj[3][r]); };
+    glm::vec4 rowZ = row(2);
+    glm::vec4 rowW = row(3); // -(view z row)
+    float a = -glm::dot(glm::vec3(rowZ), glm::vec3(rowW));
+    float b = rowZ.w + a * rowW.w;
+    zNear = b / (a - 1.0f);
+    zFar = b / (a + 1.0f);
+
+    projection = glm::mat4(0.0f);
+    projection[0][0] = glm::length(glm::vec3(row(0)));
+    projection[1][1] = glm::length(glm::vec3(row(1)));
+    projection[2][2] = a;
+    projection[2][3] = -1.0f;
+    projection[3][2] = b;
+    view = glm::inverse(projection) * viewProj;
+}
+
 void VulkanRenderer::Init(GLFWwindow* window) {
     NOVA_INFO("Initializing Vulkan renderer...");
     
@@ -59,32 +87,90 @@ void VulkanRenderer::Init(GLFWwindow* window) {
     CreateInstance();
     NOVA_INFO("Instance created, creating device...");
     CreateDevice();
-    NOVA_INFO("Device created, creating swapchain...");
-    CreateSwapchain();
+    m_allocator.Init(m_dev, m_phys, &m_counters);
+    m_pipelineCache.Init(m_dev, m_phys, m_pipelineCachePath);
+    m_uploads.Init(m_dev, &m_allocator, m_queueFamily, m_transferFamily, m_transferQueue, &m_counters);
+    m_frameTimeline.Init(m_dev);
+    m_geometry.Init(&m_allocator, &m_uploads, &m_frameTimeline, m_vertexLayout);
+    m_materials[0].key.vertexLayout = m_vertexLayout;
+    m_scene.Init(m_dev, &m_allocator, &m_geometry, &m_pipelineCache, &m_frameTimeline, MAX_FRAMES_IN_FLIGHT,
+                 m_supportsIndirectCount);
+    m_depthPyramid.Init(m_dev, &m_allocator, &m_pipelineCache, &m_frameTimeline, MAX_FRAMES_IN_FLIGHT,
+                        m_supportsStorageImageIndexing);
+    if (!m_lightClusters.Init(m_dev, &m_allocator, &m_uploads, &m_pipelineCache, MAX_FRAMES_IN_FLIGHT)) {
+        throw std::runtime_error("Failed to create the light cluster buffers");
+    }
+    m_renderGraph.Init(m_dev, &m_allocator, &m_frameTimeline);
+    if (m_headless) {
+        NOVA_INFO("Device created, creating offscreen targets...");
+        CreateOffscreenTargets();
+    } else {
+        NOVA_INFO("Device created, creating swapchain...");
+        CreateSwapchain();
+    }
     NOVA_INFO("Swapchain created, creating render pass...");
     CreateRenderPass();
-    NOVA_INFO("Render pass created, creating framebuffers...");
-    CreateFramebuffers();
-    NOVA_INFO("Framebuffers created, creating uniform buffer...");
+    NOVA_INFO("Render pass created, creating uniform buffer...");
     CreateUniformBuffer();
-    NOVA_INFO("Uniform buffer created, creating light buffer...");
-    CreateLightBuffer();
-    NOVA_INFO("Light buffer created, creating command pool...");
+    NOVA_INFO("Uniform buffer created, creating command pool...");
     CreateCommandPool();
     NOVA_INFO("Command pool created, creating sync objects...");
     CreateSyncObjects();
+    m_gpuProfiler.Init(m_dev, m_phys, m_queueFamily, MAX_FRAMES_IN_FLIGHT);
+    {
+        // The render thread records too, so it counts as one of the threads
+        uint32_t threads = m_recordThreads > 0 ? m_recordThreads : std::max(1u, std::thread::hardware_concurrency());
+        m_jobs.Init(threads - 1);
+        m_secondaryPools.Init(m_dev, m_queueFamily, MAX_FRAMES_IN_FLIGHT, m_jobs.ThreadCount());
+        NOVA_INFO("Main pass records on up to " + std::to_string(m_jobs.ThreadCount()) + " threads");
+    }
+    m_instanceRing.Init(&m_allocator, &m_frameTimeline, MAX_FRAMES_IN_FLIGHT, 1024);
+    m_readback.Init(&m_allocator, &m_frameTimeline, MAX_FRAMES_IN_FLIGHT);
     NOVA_INFO("Sync objects created, skipping shadow system initialization...");
-    // m_shadowSystem.Initialize(m_dev, m_phys); // Temporarily disabled to prevent crashes
+    // m_shadowSystem.Initialize(m_dev, m_phys, &m_allocator, &m_pipelineCache); // Temporarily disabled to prevent crashes
     NOVA_INFO("Shadow system initialization skipped, creating pipeline...");
     CreatePipeline(); // Move this after shadow resources are created
     NOVA_INFO("Pipeline created");
     
+    const PipelineCacheStats& cache = m_pipelineCache.Stats();
+    NOVA_INFO("Pipelines: " + std::to_string(cache.pipelinesCreated) + " created in " +
+              std::to_string(cache.pipelineCreateMs) + " ms (" + (cache.warm ? "warm" : "cold") + " cache), " +
+              std::to_string(cache.shaderModules) + " shader modules in " + std::to_string(cache.shaderLoadMs) + " ms");
+    
     // Log sizes after full initialization
     LogSwapchainSizes("After full initialization");
     
     NOVA_INFO("Vulkan renderer initialized successfully");
 }
 
+bool VulkanRenderer::Init(void* glfwWindowHandle) {
+    try {
+        Init(static_cast<GLFWwindow*>(glfwWindowHandle));
+    } catch (const std::exception& e) {
+        NOVA_ERROR("Vulkan initialization failed: " + std::string(e.what()));
+        return false;
+    }
+    return true;
+}
+
+void VulkanRenderer::Resize(int w, int h) {
+    NOVA_INFO("Resize: " + std::to_string(w) + "x" + std::to_string(h));
+    RecreateSwapchain();
+}
+
+bool VulkanRenderer::InitHeadless(uint32_t width, uint32_t height) {
+    m_headless = true;
+    m_extent = {std::max(1u, width), std::max(1u, height)};
+    try {
+        Init(static_cast<GLFWwindow*>(nullptr));
+    } catch (const std::exception& e) {
+        NOVA_ERROR("Headless initialization failed: " + std::string(e.what()));
+        return false;
+    }
+    NOVA_INFO("Headless rendering at " + std::to_string(m_extent.width) + "x" + std::to_string(m_extent.height));
+    return true;
+}
+
 void VulkanRenderer::CreateInstance() {
     VkApplicationInfo appInfo{};
     appInfo.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
@@ -92,19 +178,21 @@ void VulkanRenderer::CreateInstance() {
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.pEngineName = "NovaEngine";
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    appInfo.apiVersion = VK_API_VERSION_1_2; // Timeline semaphores
 
     VkInstanceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
     createInfo.pApplicationInfo = &appInfo;
 
     std::vector<const char*> extensions = {
-        VK_KHR_SURFACE_EXTENSION_NAME,
-#ifdef _WIN32
-        VK_KHR_WIN32_SURFACE_EXTENSION_NAME,
-#endif
         VK_EXT_DEBUG_UTILS_EXTENSION_NAME
     };
+    if (!m_headless) {
+        extensions.push_back(VK_KHR_SURFACE_EXTENSION_NAME);
+#ifdef _WIN32
+        extensions.push_back(VK_KHR_WIN32_SURFACE_EXTENSION_NAME);
+#endif
+    }
     createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
     createInfo.ppEnabledExtensionNames = extensions.data();
 
@@ -225,6 +313,20 @@ void VulkanRenderer::CreateDevice() {
     }
     
     m_phys = devices[0]; // Use first available device
+    if (!m_preferredDevice.empty()) {
+        bool found = false;
+        for (VkPhysicalDevice device : devices) {
+            VkPhysicalDeviceProperties props{};
+            vkGetPhysicalDeviceProperties(device, &props);
+            if (std::string(props.deviceName).find(m_preferredDevice) != std::string::npos) {
+                m_phys = device;
+                found = true;
+                NOVA_INFO("Selected preferred device: " + std::string(props.deviceName));
+                break;
+            }
+        }
+        if (!found) NOVA_WARN("No Vulkan device matches '" + m_preferredDevice + "', using the first one");
+    }
     NOVA_INFO("Selected physical device: " + std::to_string(deviceCount) + " devices available");
     
     // Find queue family that supports both graphics and presentation
@@ -233,15 +335,19 @@ void VulkanRenderer::CreateDevice() {
     std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
     vkGetPhysicalDeviceQueueFamilyProperties(m_phys, &queueFamilyCount, queueFamilies.data());
     
-    // Create a temporary surface to check presentation support
-    VkSurfaceKHR tempSurface;
-    glfwCreateWindowSurface(m_instance, m_window, nullptr, &tempSurface);
+    // Create a temporary surface to check presentation support; headless
+    // only needs graphics
+    VkSurfaceKHR tempSurface = VK_NULL_HANDLE;
+    if (!m_headless) {
+        glfwCreateWindowSurface(m_instance, m_window, nullptr, &tempSurface);
+    }
     
     bool foundSuitableQueueFamily = false;
     for (uint32_t i = 0; i < queueFamilyCount; i++) {
         if (queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-            VkBool32 presentSupport = false;
-            VkResult presentResult = vkGetPhysicalDeviceSurfaceSupportKHR(m_phys, i, tempSurface, &presentSupport);
+            VkBool32 presentSupport = m_headless;
+            VkResult presentResult = VK_SUCCESS;
+            if (!m_headless) presentResult = vkGetPhysicalDeviceSurfaceSupportKHR(m_phys, i, tempSurface, &presentSupport);
             if (presentResult == VK_SUCCESS && presentSupport) {
                 m_queueFamily = i;
                 foundSuitableQueueFamily = true;
@@ -255,7 +361,18 @@ void VulkanRenderer::CreateDevice() {
         throw std::runtime_error("Failed to find a suitable queue family");
     }
     
-    vkDestroySurfaceKHR(m_instance, tempSurface, nullptr);
+    if (tempSurface != VK_NULL_HANDLE) vkDestroySurfaceKHR(m_instance, tempSurface, nullptr);
+    
+    // Prefer a transfer-only family (DMA engine) for uploads, else share the graphics queue
+    m_transferFamily = m_queueFamily;
+    for (uint32_t i = 0; i < queueFamilyCount; i++) {
+        VkQueueFlags flags = queueFamilies[i].queueFlags;
+        if ((flags & VK_QUEUE_TRANSFER_BIT) && !(flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))) {
+            m_transferFamily = i;
+            NOVA_INFO("Found dedicated transfer queue family: " + std::to_string(i));
+            break;
+        }
+    }
     
     // Query physical device features and properties
     VkPhysicalDeviceFeatures2 features2{};
@@ -280,6 +397,9 @@ void VulkanRenderer::CreateDevice() {
     NOVA_INFO("  multiDrawIndirect: " + std::string(features2.features.multiDrawIndirect ? "YES" : "NO"));
     NOVA_INFO("  timelineSemaphore: " + std::string(vulkan12Features.timelineSemaphore ? "YES" : "NO"));
     NOVA_INFO("  descriptorIndexing: " + std::string(vulkan12Features.descriptorIndexing ? "YES" : "NO"));
+    NOVA_INFO("  drawIndirectCount: " + std::string(vulkan12Features.drawIndirectCount ? "YES" : "NO"));
+    m_supportsIndirectCount = vulkan12Features.drawIndirectCount && features2.features.multiDrawIndirect;
+    m_supportsStorageImageIndexing = features2.features.shaderStorageImageArrayDynamicIndexing;
     
     // Get device properties for alignment requirements
     VkPhysicalDeviceProperties deviceProps{};
@@ -292,20 +412,21 @@ void VulkanRenderer::CreateDevice() {
     
     // Create logical device
     float queuePriority = 1.0f;
-    VkDeviceQueueCreateInfo queueCreateInfo{};
-    queueCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-    queueCreateInfo.queueFamilyIndex = m_queueFamily;
-    queueCreateInfo.queueCount = 1;
-    queueCreateInfo.pQueuePriorities = &queuePriority;
-    
-    std::vector<const char*> deviceExtensions = {
-        VK_KHR_SWAPCHAIN_EXTENSION_NAME
-    };
+    VkDeviceQueueCreateInfo queueCreateInfos[2]{};
+    queueCreateInfos[0].sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+    queueCreateInfos[0].queueFamilyIndex = m_queueFamily;
+    queueCreateInfos[0].queueCount = 1;
+    queueCreateInfos[0].pQueuePriorities = &queuePriority;
+    queueCreateInfos[1] = queueCreateInfos[0];
+    queueCreateInfos[1].queueFamilyIndex = m_transferFamily;
+    
+    std::vector<const char*> deviceExtensions;
+    if (!m_headless) deviceExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
     
     VkDeviceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
-    createInfo.pQueueCreateInfos = &queueCreateInfo;
-    createInfo.queueCreateInfoCount = 1;
+    createInfo.pQueueCreateInfos = queueCreateInfos;
+    createInfo.queueCreateInfoCount = m_transferFamily != m_queueFamily ? 2 : 1;
     createInfo.pNext = &features2; // Use modern feature chain
     createInfo.pEnabledFeatures = nullptr; // Not used when using pNext
     createInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
@@ -315,6 +436,7 @@ void VulkanRenderer::CreateDevice() {
     volkLoadDevice(m_dev);
     
     vkGetDeviceQueue(m_dev, m_queueFamily, 0, &m_queue);
+    vkGetDeviceQueue(m_dev, m_transferFamily, 0, &m_transferQueue);
     
     NOVA_INFO("Logical device created successfully with feature chain");
 }
@@ -362,11 +484,28 @@ void VulkanRenderer::CreateSwapchain() {
         m_extent.height = static_cast<uint32_t>(height);
     }
     
+    // FIFO is the only mode every surface supports
+    uint32_t presentModeCount = 0;
+    vkGetPhysicalDeviceSurfacePresentModesKHR(m_phys, surface, &presentModeCount, nullptr);
+    std::vector<VkPresentModeKHR> presentModes(presentModeCount);
+    vkGetPhysicalDeviceSurfacePresentModesKHR(m_phys, surface, &presentModeCount, presentModes.data());
+    m_activePresentMode = VK_PRESENT_MODE_FIFO_KHR;
+    if (std::find(presentModes.begin(), presentModes.end(), m_presentMode) != presentModes.end()) {
+        m_activePresentMode = m_presentMode;
+    } else {
+        NOVA_WARN("Present mode " + std::to_string(m_presentMode) + " not supported by the surface, using FIFO");
+    }
+    
+    // One image more than the minimum, so acquire does not wait on the
+    // presentation engine (mailbox needs it to have an image to replace)
+    uint32_t imageCount = capabilities.minImageCount + 1;
+    if (capabilities.maxImageCount > 0) imageCount = std::min(imageCount, capabilities.maxImageCount);
+    
     // Create swapchain
     VkSwapchainCreateInfoKHR createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
     createInfo.surface = surface;
-    createInfo.minImageCount = capabilities.minImageCount + 1;
+    createInfo.minImageCount = imageCount;
     createInfo.imageFormat = m_format;
     createInfo.imageColorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
     createInfo.imageExtent = m_extent;
@@ -375,7 +514,7 @@ void VulkanRenderer::CreateSwapchain() {
     createInfo.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
     createInfo.preTransform = capabilities.currentTransform;
     createInfo.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-    createInfo.presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    createInfo.presentMode = m_activePresentMode;
     createInfo.clipped = VK_TRUE;
     createInfo.oldSwapchain = m_swapchain; // Use existing swapchain if recreating
     
@@ -383,7 +522,6 @@ void VulkanRenderer::CreateSwapchain() {
     NOVA_INFO("Swapchain created successfully");
     
     // Get swapchain images
-    uint32_t imageCount;
     vkGetSwapchainImagesKHR(m_dev, m_swapchain, &imageCount, nullptr);
     m_swapchainImages.resize(imageCount);
     vkGetSwapchainImagesKHR(m_dev, m_swapchain, &imageCount, m_swapchainImages.data());
@@ -420,6 +558,45 @@ void VulkanRenderer::CreateSwapchain() {
     SanitySwapchainSizes();
 }
 
+// Headless stand-in for the swapchain: one image per frame slot, so a slot's
+// image is free again once WaitForFrameSlot returns. They are never
+// presented, and TRANSFER_SRC lets the readback ring copy from them.
+void VulkanRenderer::CreateOffscreenTargets() {
+    m_format = VK_FORMAT_R8G8B8A8_SRGB;
+    m_swapchainImages.assign(MAX_FRAMES_IN_FLIGHT, VK_NULL_HANDLE);
+    m_offscreenAllocs.assign(MAX_FRAMES_IN_FLIGHT, GpuAllocation{});
+    SyncPerImageVectors(MAX_FRAMES_IN_FLIGHT);
+    for (uint32_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        VkImageCreateInfo imageInfo{};
+        imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        imageInfo.imageType = VK_IMAGE_TYPE_2D;
+        imageInfo.format = m_format;
+        imageInfo.extent = {m_extent.width, m_extent.height, 1};
+        imageInfo.mipLevels = 1;
+        imageInfo.arrayLayers = 1;
+        imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+        imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+        imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+        imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VK_CHECK(vkCreateImage(m_dev, &imageInfo, nullptr, &m_swapchainImages[i]));
+        VK_CHECK(m_allocator.AllocateForImage(m_swapchainImages[i], VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_offscreenAllocs[i]));
+        
+        VkImageViewCreateInfo viewInfo{};
+        viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        viewInfo.image = m_swapchainImages[i];
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        viewInfo.format = m_format;
+        viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        viewInfo.subresourceRange.levelCount = 1;
+        viewInfo.subresourceRange.layerCount = 1;
+        VK_CHECK(vkCreateImageView(m_dev, &viewInfo, nullptr, &m_swapchainImageViews[i]));
+    }
+    LogSwapchainSizes("After CreateOffscreenTargets");
+}
+
+// Pipelines and ImGui are created against this pass. The render graph begins
+// its own passes with the same attachment formats, which keeps them compatible.
 void VulkanRenderer::CreateRenderPass() {
     VkAttachmentDescription colorAttachment{};
     colorAttachment.format = m_format;
@@ -475,235 +652,17 @@ void VulkanRenderer::CreateRenderPass() {
     renderPassInfo.pDependencies = &dependency;
     
     VK_CHECK(vkCreateRenderPass(m_dev, &renderPassInfo, nullptr, &m_renderPass));
-    
-    CreateDepthResources();
-}
-
-void VulkanRenderer::CreateFramebuffers() {
-    m_framebuffers.resize(m_swapchainImageViews.size());
-    
-    for (size_t i = 0; i < m_swapchainImageViews.size(); i++) {
-        VkImageView attachments[] = {m_swapchainImageViews[i], m_depthImageView};
-        
-        VkFramebufferCreateInfo framebufferInfo{};
-        framebufferInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-        framebufferInfo.renderPass = m_renderPass;
-        framebufferInfo.attachmentCount = 2;
-        framebufferInfo.pAttachments = attachments;
-        framebufferInfo.width = m_extent.width;
-        framebufferInfo.height = m_extent.height;
-        framebufferInfo.layers = 1;
-        
-        VK_CHECK(vkCreateFramebuffer(m_dev, &framebufferInfo, nullptr, &m_framebuffers[i]));
-    }
-}
-
-void VulkanRenderer::CreateDepthResources() {
-    VkFormat depthFormat = VK_FORMAT_D32_SFLOAT;
-    
-    VkImageCreateInfo imageInfo{};
-    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
-    imageInfo.imageType = VK_IMAGE_TYPE_2D;
-    imageInfo.extent.width = m_extent.width;
-    imageInfo.extent.height = m_extent.height;
-    imageInfo.extent.depth = 1;
-    imageInfo.mipLevels = 1;
-    imageInfo.arrayLayers = 1;
-    imageInfo.format = depthFormat;
-    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
-    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    imageInfo.usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
-    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
-    
-    VK_CHECK(vkCreateImage(m_dev, &imageInfo, nullptr, &m_depthImage));
-    
-    VkMemoryRequirements memRequirements;
-    vkGetImageMemoryRequirements(m_dev, m_depthImage, &memRequirements);
-    
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = FindMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    
-    VK_CHECK(vkAllocateMemory(m_dev, &allocInfo, nullptr, &m_depthImageMemory));
-    vkBindImageMemory(m_dev, m_depthImage, m_depthImageMemory, 0);
-    
-    VkImageViewCreateInfo viewInfo{};
-    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-    viewInfo.image = m_depthImage;
-    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
-    viewInfo.format = depthFormat;
-    viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_DEPTH_BIT;
-    viewInfo.subresourceRange.baseMipLevel = 0;
-    viewInfo.subresourceRange.levelCount = 1;
-    viewInfo.subresourceRange.baseArrayLayer = 0;
-    viewInfo.subresourceRange.layerCount = 1;
-    
-    VK_CHECK(vkCreateImageView(m_dev, &viewInfo, nullptr, &m_depthImageView));
 }
 
 void VulkanRenderer::CreatePipeline() {
     NOVA_INFO("CreatePipeline: Loading shaders...");
-    // Load shaders
-    auto vertShader = vkutil::LoadShader(m_dev, "assets/shaders/pbr.vert.spv");
-    auto fragShader = vkutil::LoadShader(m_dev, "assets/shaders/pbr.frag.spv");
-    NOVA_INFO("CreatePipeline: Shaders loaded successfully");
-    
-    VkPipelineShaderStageCreateInfo vertShaderStageInfo{};
-    vertShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    vertShaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
-    vertShaderStageInfo.module = vertShader.module;
-    vertShaderStageInfo.pName = "main";
-    
-    VkPipelineShaderStageCreateInfo fragShaderStageInfo{};
-    fragShaderStageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-    fragShaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-    fragShaderStageInfo.module = fragShader.module;
-    fragShaderStageInfo.pName = "main";
-    
-    VkPipelineShaderStageCreateInfo shaderStages[] = {vertShaderStageInfo, fragShaderStageInfo};
-    
-    // Vertex input - updated for flat float array format (8 floats per vertex) + instance data
-    VkVertexInputBindingDescription bindingDescriptions[2]{};
-    
-    // Vertex data binding
-    bindingDescriptions[0].binding = 0;
-    bindingDescriptions[0].stride = 8 * sizeof(float); // 8 floats per vertex: pos(3) + normal(3) + uv(2)
-    bindingDescriptions[0].inputRate = VK_VERTEX_INPUT_RATE_VERTEX;
-    
-    // Instance data binding
-    bindingDescriptions[1].binding = 1;
-    bindingDescriptions[1].stride = sizeof(glm::mat4); // 4x4 matrix per instance
-    bindingDescriptions[1].inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
-    
-    std::array<VkVertexInputAttributeDescription, 7> attributeDescriptions{};
-    
-    // Vertex attributes (binding 0)
-    attributeDescriptions[0].binding = 0;
-    attributeDescriptions[0].location = 0;
-    attributeDescriptions[0].format = VK_FORMAT_R32G32B32_SFLOAT;
-    attributeDescriptions[0].offset = 0; // Position at offset 0
-    
-    attributeDescriptions[1].binding = 0;
-    attributeDescriptions[1].location = 1;
-    attributeDescriptions[1].format = VK_FORMAT_R32G32B32_SFLOAT;
-    attributeDescriptions[1].offset = 3 * sizeof(float); // Normal at offset 12
-    
-    attributeDescriptions[2].binding = 0;
-    attributeDescriptions[2].location = 2;
-    attributeDescriptions[2].format = VK_FORMAT_R32G32_SFLOAT;
-    attributeDescriptions[2].offset = 6 * sizeof(float); // UV at offset 24
-    
-    // Instance attributes (binding 1) - mat4 takes 4 locations
-    attributeDescriptions[3].binding = 1;
-    attributeDescriptions[3].location = 3;
-    attributeDescriptions[3].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-    attributeDescriptions[3].offset = 0; // First row of matrix
-    
-    attributeDescriptions[4].binding = 1;
-    attributeDescriptions[4].location = 4;
-    attributeDescriptions[4].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-    attributeDescriptions[4].offset = 16; // Second row of matrix
-    
-    attributeDescriptions[5].binding = 1;
-    attributeDescriptions[5].location = 5;
-    attributeDescriptions[5].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-    attributeDescriptions[5].offset = 32; // Third row of matrix
-    
-    attributeDescriptions[6].binding = 1;
-    attributeDescriptions[6].location = 6;
-    attributeDescriptions[6].format = VK_FORMAT_R32G32B32A32_SFLOAT;
-    attributeDescriptions[6].offset = 48; // Fourth row of matrix
-    
-    VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
-    vertexInputInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    vertexInputInfo.vertexBindingDescriptionCount = 2;
-    vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions;
-    vertexInputInfo.vertexAttributeDescriptionCount = static_cast<uint32_t>(attributeDescriptions.size());
-    vertexInputInfo.pVertexAttributeDescriptions = attributeDescriptions.data();
-    
-    // Debug: Log vertex input setup
-    NOVA_INFO("CreatePipeline: Vertex input setup:");
-    NOVA_INFO("  Binding 0: stride=" + std::to_string(bindingDescriptions[0].stride) + 
-              ", rate=" + std::to_string(bindingDescriptions[0].inputRate));
-    NOVA_INFO("  Binding 1: stride=" + std::to_string(bindingDescriptions[1].stride) + 
-              ", rate=" + std::to_string(bindingDescriptions[1].inputRate));
-    NOVA_INFO("  Attributes: " + std::to_string(attributeDescriptions.size()) + " total");
-    for (size_t i = 0; i < attributeDescriptions.size(); ++i) {
-        NOVA_INFO("    Location " + std::to_string(attributeDescriptions[i].location) + 
-                  ": binding=" + std::to_string(attributeDescriptions[i].binding) + 
-                  ", format=" + std::to_string(attributeDescriptions[i].format) + 
-                  ", offset=" + std::to_string(attributeDescriptions[i].offset));
+    // Load shaders; every material variant specializes the same pair
+    VkShaderModule vertShader = m_pipelineCache.GetShaderModule("assets/shaders/pbr.vert.spv");
+    VkShaderModule fragShader = m_pipelineCache.GetShaderModule("assets/shaders/pbr.frag.spv");
+    if (vertShader == VK_NULL_HANDLE || fragShader == VK_NULL_HANDLE) {
+        throw std::runtime_error("Failed to load PBR shaders");
     }
-    
-    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
-    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-    inputAssembly.primitiveRestartEnable = VK_FALSE;
-    
-    VkViewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = static_cast<float>(m_extent.width);
-    viewport.height = static_cast<float>(m_extent.height);
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-    
-    VkRect2D scissor{};
-    scissor.offset = {0, 0};
-    scissor.extent = m_extent;
-    
-    VkPipelineViewportStateCreateInfo viewportState{};
-    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-    viewportState.viewportCount = 1;
-    viewportState.pViewports = nullptr; // Dynamic viewport
-    viewportState.scissorCount = 1;
-    viewportState.pScissors = nullptr; // Dynamic scissor
-    
-    VkPipelineRasterizationStateCreateInfo rasterizer{};
-    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-    rasterizer.depthClampEnable = VK_FALSE;
-    rasterizer.rasterizerDiscardEnable = VK_FALSE;
-    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
-    rasterizer.lineWidth = 1.0f;
-    rasterizer.cullMode = VK_CULL_MODE_BACK_BIT;
-    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
-    rasterizer.depthBiasEnable = VK_FALSE;
-    
-    VkPipelineMultisampleStateCreateInfo multisampling{};
-    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-    multisampling.sampleShadingEnable = VK_FALSE;
-    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-    
-    VkPipelineDepthStencilStateCreateInfo depthStencil{};
-    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
-    depthStencil.depthTestEnable = VK_TRUE;
-    depthStencil.depthWriteEnable = VK_TRUE;
-    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
-    depthStencil.depthBoundsTestEnable = VK_FALSE;
-    depthStencil.stencilTestEnable = VK_FALSE;
-    
-    VkPipelineColorBlendAttachmentState colorBlendAttachment{};
-    colorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
-    colorBlendAttachment.blendEnable = VK_FALSE;
-    
-    VkPipelineColorBlendStateCreateInfo colorBlending{};
-    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-    colorBlending.logicOpEnable = VK_FALSE;
-    colorBlending.attachmentCount = 1;
-    colorBlending.pAttachments = &colorBlendAttachment;
-    
-    // Dynamic state for viewport and scissor
-    VkDynamicState dynamicStates[] = {
-        VK_DYNAMIC_STATE_VIEWPORT,
-        VK_DYNAMIC_STATE_SCISSOR
-    };
-    
-    VkPipelineDynamicStateCreateInfo dynamicState{};
-    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-    dynamicState.dynamicStateCount = 2;
-    dynamicState.pDynamicStates = dynamicStates;
+    NOVA_INFO("CreatePipeline: Shaders loaded successfully");
     
     // Push constant range (≤256 bytes)
     VkPushConstantRange pushConstantRange{};
@@ -715,18 +674,25 @@ void VulkanRenderer::CreatePipeline() {
     
     NOVA_INFO("CreatePipeline: Setting up pipeline layout...");
     
-    // Create descriptor set layout for uniform buffer
-    VkDescriptorSetLayoutBinding uboLayoutBinding{};
-    uboLayoutBinding.binding = 0;
-    uboLayoutBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    uboLayoutBinding.descriptorCount = 1;
-    uboLayoutBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
-    uboLayoutBinding.pImmutableSamplers = nullptr;
+    // Create descriptor set layout: the uniform buffer, then the lights, the
+    // cluster light counts and the cluster light indices for pbr.frag
+    VkDescriptorSetLayoutBinding layoutBindings[4]{};
+    layoutBindings[0].binding = 0;
+    layoutBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    layoutBindings[0].descriptorCount = 1;
+    layoutBindings[0].stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+    layoutBindings[0].pImmutableSamplers = nullptr;
+    for (uint32_t i = 1; i < 4; ++i) {
+        layoutBindings[i].binding = i;
+        layoutBindings[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        layoutBindings[i].descriptorCount = 1;
+        layoutBindings[i].stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+    }
     
     VkDescriptorSetLayoutCreateInfo layoutInfo{};
     layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-    layoutInfo.bindingCount = 1;
-    layoutInfo.pBindings = &uboLayoutBinding;
+    layoutInfo.bindingCount = 4;
+    layoutInfo.pBindings = layoutBindings;
     
     VK_CHECK(vkCreateDescriptorSetLayout(m_dev, &layoutInfo, nullptr, &m_descriptorSetLayout));
     
@@ -746,118 +712,168 @@ void VulkanRenderer::CreatePipeline() {
     }
     NOVA_INFO("Pipeline layout created successfully");
     
-    NOVA_INFO("CreatePipeline: About to create graphics pipeline...");
-    
-    VkGraphicsPipelineCreateInfo pipelineInfo{};
-    pipelineInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    pipelineInfo.stageCount = 2;
-    pipelineInfo.pStages = shaderStages;
-    pipelineInfo.pVertexInputState = &vertexInputInfo;
-    pipelineInfo.pInputAssemblyState = &inputAssembly;
-    pipelineInfo.pViewportState = &viewportState;
-    pipelineInfo.pRasterizationState = &rasterizer;
-    pipelineInfo.pMultisampleState = &multisampling;
-    pipelineInfo.pDepthStencilState = &depthStencil;
-    pipelineInfo.pColorBlendState = &colorBlending;
-    pipelineInfo.pDynamicState = &dynamicState;
-    pipelineInfo.layout = m_pipelineLayout;
-    pipelineInfo.renderPass = m_renderPass;
-    pipelineInfo.subpass = 0;
-    
-    VkResult pipelineResult = vkCreateGraphicsPipelines(m_dev, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_pipeline);
-    if (pipelineResult != VK_SUCCESS) {
+    // The default material's pipeline is compiled here and stands in for any
+    // other material until its pipeline comes back from the compile threads
+    NOVA_INFO("CreatePipeline: About to create fallback pipeline...");
+    uint32_t compileThreads = std::clamp(std::thread::hardware_concurrency() / 4, 1u, 2u);
+    if (!m_pipelineStates.Init(m_dev, &m_pipelineCache, m_pipelineLayout, vertShader, fragShader, m_renderPass,
+                               m_materials[0].key, compileThreads)) {
         NOVA_ERROR("Failed to create graphics pipeline!");
         throw std::runtime_error("Failed to create graphics pipeline");
     }
     NOVA_INFO("Graphics pipeline created successfully");
-    
-    vkDestroyShaderModule(m_dev, vertShader.module, nullptr);
-    vkDestroyShaderModule(m_dev, fragShader.module, nullptr);
+    m_pipelineVariants = {m_materials[0].key.Hash()};
+    CreateDepthPrepassPipelines();
     
     // Create descriptor pool and sets
     CreateDescriptorPool();
     CreateDescriptorSets();
 }
 
+void VulkanRenderer::CreateDepthPrepassPipelines() {
+    // Depth-only render pass for compatibility: the prepass has no color attachment
+    VkAttachmentDescription depthAttachment{};
+    depthAttachment.format = VK_FORMAT_D32_SFLOAT;
+    depthAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
+    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    VkAttachmentReference depthAttachmentRef{};
+    depthAttachmentRef.attachment = 0;
+    depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    VkSubpassDescription subpass{};
+    subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    subpass.pDepthStencilAttachment = &depthAttachmentRef;
+    VkRenderPassCreateInfo renderPassInfo{};
+    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
+    renderPassInfo.attachmentCount = 1;
+    renderPassInfo.pAttachments = &depthAttachment;
+    renderPassInfo.subpassCount = 1;
+    renderPassInfo.pSubpasses = &subpass;
+    VK_CHECK(vkCreateRenderPass(m_dev, &renderPassInfo, nullptr, &m_depthRenderPass));
+    
+    VkShaderModule vertShader = m_pipelineCache.GetShaderModule("assets/shaders/depth.vert.spv");
+    if (vertShader == VK_NULL_HANDLE) {
+        NOVA_WARN("Depth prepass unavailable: failed to load depth.vert.spv");
+        return;
+    }
+    // Vertex stage only; depth is all the pass produces
+    VkPipelineShaderStageCreateInfo stage{};
+    stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    stage.stage = VK_SHADER_STAGE_VERTEX_BIT;
+    stage.module = vertShader;
+    stage.pName = "main";
+    
+    // Binding 0 is the position stream; the instance transform keeps pbr.vert's locations
+    VkVertexInputBindingDescription bindings[2]{};
+    bindings[0] = {0, m_geometry.PositionStride(), VK_VERTEX_INPUT_RATE_VERTEX};
+    bindings[1] = {1, sizeof(glm::mat4), VK_VERTEX_INPUT_RATE_INSTANCE};
+    VkVertexInputAttributeDescription attributes[5]{};
+    attributes[0] = {0, 0, m_geometry.PositionFormat(), 0};
+    for (uint32_t column = 0; column < 4; ++column) {
+        attributes[1 + column] = {3 + column, 1, VK_FORMAT_R32G32B32A32_SFLOAT, column * 16};
+    }
+    VkPipelineVertexInputStateCreateInfo vertexInput{};
+    vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInput.vertexBindingDescriptionCount = 2;
+    vertexInput.pVertexBindingDescriptions = bindings;
+    vertexInput.vertexAttributeDescriptionCount = 5;
+    vertexInput.pVertexAttributeDescriptions = attributes;
+    
+    VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+    inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+    inputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+    VkPipelineRasterizationStateCreateInfo rasterizer{};
+    rasterizer.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+    rasterizer.polygonMode = VK_POLYGON_MODE_FILL;
+    rasterizer.lineWidth = 1.0f;
+    rasterizer.frontFace = VK_FRONT_FACE_COUNTER_CLOCKWISE;
+    VkPipelineMultisampleStateCreateInfo multisampling{};
+    multisampling.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+    multisampling.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    VkPipelineDepthStencilStateCreateInfo depthStencil{};
+    depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencil.depthTestEnable = VK_TRUE;
+    depthStencil.depthWriteEnable = VK_TRUE;
+    depthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
+    VkPipelineColorBlendStateCreateInfo colorBlending{};
+    colorBlending.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+    VkDynamicState dynamicStates[] = {VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR};
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = 2;
+    dynamicState.pDynamicStates = dynamicStates;
+    
+    VkGraphicsPipelineCreateInfo info{};
+    info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    info.stageCount = 1;
+    info.pStages = &stage;
+    info.pVertexInputState = &vertexInput;
+    info.pInputAssemblyState = &inputAssembly;
+    info.pViewportState = &viewportState;
+    info.pRasterizationState = &rasterizer;
+    info.pMultisampleState = &multisampling;
+    info.pDepthStencilState = &depthStencil;
+    info.pColorBlendState = &colorBlending;
+    info.pDynamicState = &dynamicState;
+    info.layout = m_pipelineLayout;
+    info.renderPass = m_depthRenderPass;
+    info.subpass = 0;
+    // Two pipelines only, so both are compiled up front
+    for (uint32_t doubleSided = 0; doubleSided < 2; ++doubleSided) {
+        rasterizer.cullMode = doubleSided ? VK_CULL_MODE_NONE : VK_CULL_MODE_BACK_BIT;
+        if (m_pipelineCache.CreateGraphicsPipeline(info, &m_prepassPipelines[doubleSided]) != VK_SUCCESS) {
+            NOVA_WARN("Depth prepass unavailable: failed to create its pipelines");
+            m_prepassPipelines[doubleSided] = VK_NULL_HANDLE;
+            m_depthPrepass = false;
+            return;
+        }
+    }
+    // Requested before Init: compile the EQUAL variants alongside the rest
+    if (m_depthPrepass) SetDepthPrepass(true);
+}
+
 void VulkanRenderer::CreateVertexBuffer() {
-    // This function is now deprecated - vertex/index buffers are created via SetAssetData
-    // Initialize with empty buffers that will be replaced by SetAssetData
-    m_vertexBuffer = VK_NULL_HANDLE;
-    m_vertexMemory = VK_NULL_HANDLE;
-    m_indexBuffer = VK_NULL_HANDLE;
-    m_indexMemory = VK_NULL_HANDLE;
-    m_indexCount = 0;
+    // This function is now deprecated - geometry lives in m_geometry and is
+    // added with RegisterMesh/SetAssetData
+    m_defaultMesh = MeshHandle{};
     
-    NOVA_INFO("VK: Vertex buffer creation deferred to SetAssetData");
+    NOVA_INFO("VK: Vertex buffer creation deferred to the geometry pool");
 }
 
 void VulkanRenderer::CreateUniformBuffer() {
-    NOVA_INFO("CreateUniformBuffer: Creating aligned uniform buffer");
-    
-    // Calculate aligned buffer size for proper UBO alignment
-    VkDeviceSize uboSize = sizeof(UniformBufferObject);
-    VkDeviceSize alignedSize = (uboSize + m_minUniformBufferOffsetAlignment - 1) & ~(m_minUniformBufferOffsetAlignment - 1);
-    
-    NOVA_INFO("CreateUniformBuffer: UBO size: " + std::to_string(uboSize) + ", aligned size: " + std::to_string(alignedSize));
-    NOVA_INFO("CreateUniformBuffer: minUniformBufferOffsetAlignment: " + std::to_string(m_minUniformBufferOffsetAlignment));
-    
-    // Validate alignment
-    assert(alignedSize % m_minUniformBufferOffsetAlignment == 0 && "UBO size must be aligned");
+    NOVA_INFO("CreateUniformBuffer: Creating per-frame uniform ring");
+    NOVA_INFO("CreateUniformBuffer: UBO size: " + std::to_string(sizeof(UniformBufferObject)) +
+              ", minUniformBufferOffsetAlignment: " + std::to_string(m_minUniformBufferOffsetAlignment));
     
-    VkBufferCreateInfo bufferInfo{};
-    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    bufferInfo.size = alignedSize;
-    bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    
-    VK_CHECK(vkCreateBuffer(m_dev, &bufferInfo, nullptr, &m_uniformBuffer));
-    
-    VkMemoryRequirements memRequirements;
-    vkGetBufferMemoryRequirements(m_dev, m_uniformBuffer, &memRequirements);
-    
-    // Log memory requirements
-    NOVA_INFO("CreateUniformBuffer: Memory requirements:");
-    NOVA_INFO("  size: " + std::to_string(memRequirements.size));
-    NOVA_INFO("  alignment: " + std::to_string(memRequirements.alignment));
-    NOVA_INFO("  memoryTypeBits: " + std::to_string(memRequirements.memoryTypeBits));
-    
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = FindMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-    
-    VK_CHECK(vkAllocateMemory(m_dev, &allocInfo, nullptr, &m_uniformMemory));
-    vkBindBufferMemory(m_dev, m_uniformBuffer, m_uniformMemory, 0);
-    
-    vkMapMemory(m_dev, m_uniformMemory, 0, alignedSize, 0, &m_uniformMapped);
-    
-    // Initialize with default values
-    UniformBufferObject ubo{};
-    ubo.model = glm::mat4(1.0f); // Initialize with identity matrix
-    
-    // Initialize light data
-    for (int i = 0; i < 3; ++i) {
-        ubo.lightPositions[i] = glm::vec4(0.0f, 5.0f, 0.0f, 1.0f);
-        ubo.lightColors[i] = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
-        ubo.lightSpaceMatrices[i] = glm::mat4(1.0f);
+    // One UniformBufferObject per frame today; the rest of each slice is
+    // headroom for per-draw blocks
+    constexpr VkDeviceSize UNIFORM_BYTES_PER_FRAME = 64 * 1024;
+    if (!m_uniformRing.Init(&m_allocator, m_minUniformBufferOffsetAlignment, MAX_FRAMES_IN_FLIGHT, UNIFORM_BYTES_PER_FRAME)) {
+        throw std::runtime_error("Failed to create the uniform ring");
     }
-    
-    memcpy(m_uniformMapped, &ubo, sizeof(ubo));
-    
-    NOVA_INFO("CreateUniformBuffer: Aligned uniform buffer created successfully");
 }
 
 void VulkanRenderer::CreateDescriptorPool() {
     NOVA_INFO("CreateDescriptorPool: Creating descriptor pool");
     
-    VkDescriptorPoolSize poolSize{};
-    poolSize.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-    poolSize.descriptorCount = MAX_FRAMES_IN_FLIGHT;
+    VkDescriptorPoolSize poolSizes[2]{};
+    poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    poolSizes[0].descriptorCount = MAX_FRAMES_IN_FLIGHT;
+    poolSizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    poolSizes[1].descriptorCount = 3 * MAX_FRAMES_IN_FLIGHT;
     
     VkDescriptorPoolCreateInfo poolInfo{};
     poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-    poolInfo.poolSizeCount = 1;
-    poolInfo.pPoolSizes = &poolSize;
+    poolInfo.poolSizeCount = 2;
+    poolInfo.pPoolSizes = poolSizes;
     poolInfo.maxSets = MAX_FRAMES_IN_FLIGHT;
     
     VK_CHECK(vkCreateDescriptorPool(m_dev, &poolInfo, nullptr, &m_descriptorPool));
@@ -881,23 +897,32 @@ void VulkanRenderer::CreateDescriptorSets() {
     
     VK_CHECK(vkAllocateDescriptorSets(m_dev, &allocInfo, m_descriptorSets.data()));
     
-    // Update descriptor sets with uniform buffer
+    // Every set views the whole ring; the frame's slice is picked with a
+    // dynamic offset at bind time. The light cluster buffers are per slot and
+    // never reallocated, so they are written once here.
     for (size_t i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-        VkDescriptorBufferInfo bufferInfo{};
-        bufferInfo.buffer = m_uniformBuffer;
-        bufferInfo.offset = 0;
-        bufferInfo.range = sizeof(UniformBufferObject);
+        uint32_t slot = static_cast<uint32_t>(i);
+        VkDescriptorBufferInfo bufferInfos[4]{};
+        bufferInfos[0].buffer = m_uniformRing.Buffer();
+        bufferInfos[0].offset = 0;
+        bufferInfos[0].range = sizeof(UniformBufferObject);
+        bufferInfos[1].buffer = m_lightClusters.LightBuffer(slot);
+        bufferInfos[2].buffer = m_lightClusters.CountBuffer(slot);
+        bufferInfos[3].buffer = m_lightClusters.IndexBuffer(slot);
+        for (uint32_t b = 1; b < 4; ++b) bufferInfos[b].range = VK_WHOLE_SIZE;
         
-        VkWriteDescriptorSet descriptorWrite{};
-        descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-        descriptorWrite.dstSet = m_descriptorSets[i];
-        descriptorWrite.dstBinding = 0;
-        descriptorWrite.dstArrayElement = 0;
-        descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-        descriptorWrite.descriptorCount = 1;
-        descriptorWrite.pBufferInfo = &bufferInfo;
+        VkWriteDescriptorSet descriptorWrites[4]{};
+        for (uint32_t b = 0; b < 4; ++b) {
+            descriptorWrites[b].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrites[b].dstSet = m_descriptorSets[i];
+            descriptorWrites[b].dstBinding = b;
+            descriptorWrites[b].dstArrayElement = 0;
+            descriptorWrites[b].descriptorType = b == 0 ? VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            descriptorWrites[b].descriptorCount = 1;
+            descriptorWrites[b].pBufferInfo = &bufferInfos[b];
+        }
         
-        vkUpdateDescriptorSets(m_dev, 1, &descriptorWrite, 0, nullptr);
+        vkUpdateDescriptorSets(m_dev, 4, descriptorWrites, 0, nullptr);
     }
     
     NOVA_INFO("CreateDescriptorSets: Descriptor sets created successfully");
@@ -905,17 +930,14 @@ void VulkanRenderer::CreateDescriptorSets() {
 
 void VulkanRenderer::SyncPerImageVectors(uint32_t count) {
     m_swapchainImageViews.resize(count);
-    m_framebuffers.resize(count);
-    m_imagesInFlight.assign(count, VK_NULL_HANDLE);
+    m_imagesInFlight.assign(count, NO_FRAME);
     NOVA_INFO("SyncPerImageVectors: count=" + std::to_string(count) + 
               ", views=" + std::to_string(m_swapchainImageViews.size()) + 
-              ", fbs=" + std::to_string(m_framebuffers.size()) + 
               ", imagesInFlight=" + std::to_string(m_imagesInFlight.size()));
 }
 
 void VulkanRenderer::SanitySwapchainSizes() {
     assert(m_swapchainImages.size() == m_swapchainImageViews.size() && "Swapchain images and views size mismatch");
-    assert(m_swapchainImages.size() == m_framebuffers.size() && "Swapchain images and framebuffers size mismatch");
     assert(m_swapchainImages.size() == m_imagesInFlight.size() && "Swapchain images and imagesInFlight size mismatch");
     NOVA_INFO("SanitySwapchainSizes: All vectors sized to " + std::to_string(m_swapchainImages.size()));
 }
@@ -923,60 +945,22 @@ void VulkanRenderer::SanitySwapchainSizes() {
 void VulkanRenderer::LogSwapchainSizes(const std::string& context) {
     NOVA_INFO("SwapchainSizes[" + context + "]: images=" + std::to_string(m_swapchainImages.size()) + 
               ", views=" + std::to_string(m_swapchainImageViews.size()) + 
-              ", fbs=" + std::to_string(m_framebuffers.size()) + 
               ", imagesInFlight=" + std::to_string(m_imagesInFlight.size()));
 }
 
-void VulkanRenderer::CreateLightBuffer() {
-    // Create light buffer for up to 8 lights (position + color for each)
-    VkDeviceSize bufferSize = 8 * 2 * sizeof(glm::vec4); // 8 lights, 2 vec4s each
-    
-    VkBufferCreateInfo bufferInfo{};
-    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    bufferInfo.size = bufferSize;
-    bufferInfo.usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
-    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    
-    VK_CHECK(vkCreateBuffer(m_dev, &bufferInfo, nullptr, &m_lightBuffer));
-    
-    VkMemoryRequirements memRequirements;
-    vkGetBufferMemoryRequirements(m_dev, m_lightBuffer, &memRequirements);
-    
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = FindMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-    
-    VK_CHECK(vkAllocateMemory(m_dev, &allocInfo, nullptr, &m_lightMemory));
-    vkBindBufferMemory(m_dev, m_lightBuffer, m_lightMemory, 0);
-    
-    vkMapMemory(m_dev, m_lightMemory, 0, bufferSize, 0, &m_lightMapped);
-    
-    // Initialize with default lights
-    std::vector<glm::vec4> defaultLights = {
-        glm::vec4(0.0f, 5.0f, 0.0f, 1.0f),  // Position
-        glm::vec4(1.0f, 1.0f, 1.0f, 1.0f),  // Color
-        glm::vec4(0.0f, 0.0f, 0.0f, 0.0f),  // Position
-        glm::vec4(0.0f, 0.0f, 0.0f, 0.0f),  // Color
-        glm::vec4(0.0f, 0.0f, 0.0f, 0.0f),  // Position
-        glm::vec4(0.0f, 0.0f, 0.0f, 0.0f),  // Color
-        glm::vec4(0.0f, 0.0f, 0.0f, 0.0f),  // Position
-        glm::vec4(0.0f, 0.0f, 0.0f, 0.0f),  // Color
-    };
-    
-    memcpy(m_lightMapped, defaultLights.data(), defaultLights.size() * sizeof(glm::vec4));
-    m_lightCount = 1;
-    
-    NOVA_INFO("Light buffer created successfully");
-}
-
+// Recreates the swapchain without idling the device: the new one is created
+// from the old (oldSwapchain), and the old swapchain, its views and the
+// framebuffers built on them are retired until the frames in flight that may
+// use them have completed. The depth buffer is a render graph transient and
+// follows the new extent on the next Compile.
 void VulkanRenderer::RecreateSwapchain() {
+    if (m_headless) {
+        NOVA_WARN("RecreateSwapchain: headless targets have a fixed size");
+        return;
+    }
     NOVA_INFO("RecreateSwapchain: Starting swapchain recreation");
     
     try {
-        // Wait for device to be idle
-        vkDeviceWaitIdle(m_dev);
-        
         // Check if window is minimized
         int width = 0, height = 0;
         glfwGetFramebufferSize(m_window, &width, &height);
@@ -985,46 +969,19 @@ void VulkanRenderer::RecreateSwapchain() {
             glfwWaitEvents();
             glfwGetFramebufferSize(m_window, &width, &height);
         }
+        double startMs = Profiler::NowMs();
         
-        // Store old swapchain for proper recreation
-        VkSwapchainKHR oldSwapchain = m_swapchain;
-        
-        // Clean up old swapchain resources
-        for (auto framebuffer : m_framebuffers) {
-            if (framebuffer != VK_NULL_HANDLE) {
-                vkDestroyFramebuffer(m_dev, framebuffer, nullptr);
-            }
-        }
-        m_framebuffers.clear();
-        
-        for (auto imageView : m_swapchainImageViews) {
-            if (imageView != VK_NULL_HANDLE) {
-                vkDestroyImageView(m_dev, imageView, nullptr);
-            }
-        }
+        // CreateSwapchain passes the current swapchain as oldSwapchain
+        RetiredSwapchain retired{ m_swapchain, std::move(m_swapchainImageViews), m_frameNumber };
         m_swapchainImageViews.clear();
-        
-        // Clean up old depth resources
-        if (m_depthImageView != VK_NULL_HANDLE) {
-            vkDestroyImageView(m_dev, m_depthImageView, nullptr);
-            m_depthImageView = VK_NULL_HANDLE;
-        }
-        if (m_depthImage != VK_NULL_HANDLE) {
-            vkDestroyImage(m_dev, m_depthImage, nullptr);
-            m_depthImage = VK_NULL_HANDLE;
-        }
-        if (m_depthImageMemory != VK_NULL_HANDLE) {
-            vkFreeMemory(m_dev, m_depthImageMemory, nullptr);
-            m_depthImageMemory = VK_NULL_HANDLE;
-        }
-        
-        // Clear swapchain images vector
         m_swapchainImages.clear();
+        m_renderGraph.InvalidateFramebuffers();
         
         // Recreate swapchain (this includes creating image views)
         CreateSwapchain();
-        CreateDepthResources();
-        CreateFramebuffers();
+        if (retired.swapchain != VK_NULL_HANDLE) {
+            m_retiredSwapchains.push_back(std::move(retired));
+        }
         
         // Sync all per-image vectors to the new swapchain size
         SyncPerImageVectors(static_cast<uint32_t>(m_swapchainImages.size()));
@@ -1035,12 +992,11 @@ void VulkanRenderer::RecreateSwapchain() {
         // Sanity check after recreation
         SanitySwapchainSizes();
         
-        // Destroy old swapchain after creating new one
-        if (oldSwapchain != VK_NULL_HANDLE) {
-            vkDestroySwapchainKHR(m_dev, oldSwapchain, nullptr);
-        }
-        
-        NOVA_INFO("RecreateSwapchain: Swapchain recreated successfully");
+        m_swapchainRecreations++;
+        m_lastSwapchainRecreateMs = static_cast<float>(Profiler::NowMs() - startMs);
+        NOVA_INFO("RecreateSwapchain: Swapchain recreated successfully (" + std::to_string(m_extent.width) + "x" +
+                  std::to_string(m_extent.height) + ", " + std::to_string(m_lastSwapchainRecreateMs) + " ms, " +
+                  std::to_string(m_retiredSwapchains.size()) + " retired)");
         
     } catch (const std::exception& e) {
         NOVA_INFO("Error during swapchain recreation: " + std::string(e.what()));
@@ -1112,6 +1068,7 @@ void VulkanRenderer::RenderUI(Camera* camera, LightingManager* lightingManager)
     if (!m_imguiReady) {
         return;
     }
+    NOVA_MEM_TAG(UI);
     
 
     
@@ -1143,6 +1100,209 @@ void VulkanRenderer::RenderUI(Camera* camera, LightingManager* lightingManager)
     ImGui::TextColored(fpsColor, "FPS: %.1f", fps);
     ImGui::Text("Frame Time: %.2f ms", frameTime);
     ImGui::Text("Frame Count: %d", frameCount);
+    ImGui::Text("p50 %.2f  p95 %.2f  p99 %.2f  max %.2f ms", m_frameStats.P50(), m_frameStats.P95(),
+                m_frameStats.P99(), m_frameStats.Max());
+    ImGui::Text("Hitches: %llu", static_cast<unsigned long long>(m_frameStats.HitchCount()));
+    
+    // Work counters for the last completed frame
+    if (ImGui::CollapsingHeader("Render Counters", ImGuiTreeNodeFlags_DefaultOpen)) {
+        const RenderCounters& c = m_lastCounters;
+        ImGui::Text("Draws: %u  Instances: %u  Triangles: %llu", c.drawCalls, c.instances,
+                    static_cast<unsigned long long>(c.triangles));
+        ImGui::Text("Binds: pipeline %u, descriptor %u, vertex %u  Push constants: %u",
+                    c.pipelineBinds, c.descriptorBinds, c.vertexBufferBinds, c.pushConstantUpdates);
+        ImGui::Text("Uploads: buffers %.1f KB, textures %.1f KB, staging allocs %u",
+                    double(c.bufferBytesUploaded) / 1024.0, double(c.textureBytesUploaded) / 1024.0, c.stagingAllocations);
+        ImVec4 allocColor = c.deviceAllocations > 0 ? ImVec4(1.0f, 0.4f, 0.2f, 1.0f) : ImVec4(0.8f, 0.8f, 0.8f, 1.0f);
+        ImGui::TextColored(allocColor, "vkAllocateMemory: %u (%.1f KB)", c.deviceAllocations,
+                           double(c.deviceBytesAllocated) / 1024.0);
+        ImGui::Text("Instance ring: %u per frame x %u (%.1f KB), grown %u times", m_instanceRing.CapacityPerFrame(),
+                    MAX_FRAMES_IN_FLIGHT, double(m_instanceRing.BufferSize()) / 1024.0, m_instanceRing.GrowCount());
+        const UniformRingStats& uniforms = m_uniformRing.Stats();
+        ImGui::Text("Uniform ring: %.1f of %.1f KB per frame, %u failed", double(uniforms.peakBytes) / 1024.0,
+                    double(uniforms.bytesPerFrame) / 1024.0, uniforms.failedAllocations);
+        int framesInFlight = static_cast<int>(m_framesInFlight);
+        if (ImGui::SliderInt("Frames in flight", &framesInFlight, 1, static_cast<int>(MAX_FRAMES_IN_FLIGHT))) {
+            SetFramesInFlight(static_cast<uint32_t>(framesInFlight));
+        }
+        const VkPresentModeKHR presentModes[] = { VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR };
+        const char* presentModeNames[] = { "FIFO", "Mailbox", "Immediate" };
+        int presentMode = static_cast<int>(std::find(std::begin(presentModes), std::end(presentModes), m_presentMode) - std::begin(presentModes));
+        if (ImGui::Combo("Present mode", &presentMode, presentModeNames, IM_ARRAYSIZE(presentModeNames))) {
+            SetPresentMode(presentModes[presentMode]);
+        }
+        if (m_activePresentMode != m_presentMode && !m_swapchainDirty) {
+            ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.2f, 1.0f), "Present mode unsupported, using FIFO");
+        }
+        int recordThreads = static_cast<int>(GetRecordThreads());
+        if (ImGui::SliderInt("Record threads", &recordThreads, 1, static_cast<int>(m_jobs.ThreadCount()))) {
+            SetRecordThreads(static_cast<uint32_t>(recordThreads));
+        }
+        ImGui::Text("Secondary command buffers: %u", c.secondaryCommandBuffers);
+        ImGui::Checkbox("Sort draws", &m_sortDraws);
+        ImGui::Text("State changes: %u unsorted, %u sorted (%u draws sorted)", c.stateChangesUnsorted,
+                    c.stateChangesSorted, c.sortedDraws);
+        bool depthPrepass = m_depthPrepass;
+        if (ImGui::Checkbox("Depth prepass", &depthPrepass)) SetDepthPrepass(depthPrepass);
+        ImGui::Text("Prepass draws: %u", c.prepassDraws);
+        // Prepass + main pass against the main pass alone, measured on the GPU
+        const DepthPrepassStats& prepass = m_prepassStats;
+        if (m_gpuProfiler.IsSupported()) {
+            ImGui::Text("Shading GPU ms: %.3f with prepass (%llu frames), %.3f without (%llu frames)",
+                        prepass.withPrepassMs, static_cast<unsigned long long>(prepass.withPrepassFrames),
+                        prepass.withoutPrepassMs, static_cast<unsigned long long>(prepass.withoutPrepassFrames));
+        }
+    }
+    
+    // GPU-driven scene culling
+    if (ImGui::CollapsingHeader("Culling")) {
+        GpuSceneStats scene = m_scene.Stats();
+        bool gpuAvailable = m_scene.GpuCullingAvailable();
+        int mode = static_cast<int>(m_cullMode);
+        ImGui::RadioButton("CPU", &mode, static_cast<int>(CullMode::Cpu));
+        ImGui::SameLine();
+        ImGui::RadioButton(gpuAvailable ? "GPU (compute + indirect count)" : "GPU (unavailable)", &mode, static_cast<int>(CullMode::Gpu));
+        m_cullMode = static_cast<CullMode>(mode);
+        bool validate = m_scene.Validation();
+        if (ImGui::Checkbox("Validate GPU against CPU", &validate)) m_scene.SetValidation(validate);
+        bool occlusion = m_occlusionCulling;
+        if (ImGui::Checkbox(IsOcclusionCullingAvailable() ? "Occlusion culling (Hi-Z)" : "Occlusion culling (unavailable)",
+                            &occlusion)) {
+            m_occlusionCulling = occlusion;
+        }
+        ImGui::Text("Objects: %u  Visible: %u", m_lastCounters.sceneObjects, m_lastCounters.visibleObjects);
+        if (m_occlusionThisFrame) {
+            ImGui::Text("Early: %u  Late: %u  Occluded: %u", scene.visible - scene.lateDrawn, scene.lateDrawn, scene.occluded);
+        }
+        GpuScene::LodSettings lods = m_scene.GetLodSettings();
+        bool lodsChanged = ImGui::Checkbox("Levels of detail", &lods.enabled);
+        lodsChanged |= ImGui::SliderFloat("LOD pixel error", &lods.pixelError, 0.25f, 8.0f, "%.2f");
+        lodsChanged |= ImGui::SliderFloat("LOD bias", &lods.bias, -4.0f, 4.0f, "%.1f");
+        if (lodsChanged) m_scene.SetLodSettings(lods);
+        ImGui::Text("Drawn per LOD:");
+        for (uint32_t lod = 0; lod < MAX_MESH_LODS; ++lod) {
+            ImGui::SameLine();
+            ImGui::Text("%u", scene.lodDrawn[lod]);
+        }
+        if (scene.validatedFrames > 0) {
+            ImVec4 color = scene.mismatchedFrames > 0 ? ImVec4(1.0f, 0.4f, 0.2f, 1.0f) : ImVec4(0.4f, 1.0f, 0.4f, 1.0f);
+            ImGui::TextColored(color, "Validated %llu frames, %llu mismatched (last: %u missing, %u extra)",
+                               static_cast<unsigned long long>(scene.validatedFrames),
+                               static_cast<unsigned long long>(scene.mismatchedFrames), scene.lastMissing, scene.lastExtra);
+        }
+    }
+    
+    // Clustered forward lighting
+    if (ImGui::CollapsingHeader("Light Clusters")) {
+        LightClusterStats lights = m_lightClusters.Stats();
+        ImGui::Text("Grid: %ux%ux%u, %s", LightClusters::CLUSTER_X, LightClusters::CLUSTER_Y, LightClusters::CLUSTER_Z,
+                    m_lightClusters.GpuBinningAvailable() ? "binned by compute" : "binning unavailable, every light is global");
+        ImGui::Text("Lights: %u (%u global, %u dropped)", lights.lights, lights.globalLights, lights.droppedLights);
+        ImVec4 color = lights.fullClusters > 0 ? ImVec4(1.0f, 0.4f, 0.2f, 1.0f) : ImVec4(0.4f, 1.0f, 0.4f, 1.0f);
+        ImGui::TextColored(color, "Most in one cluster: %u of %u, %u clusters full", lights.maxClusterLights,
+                           LightClusters::MAX_LIGHTS_PER_CLUSTER, lights.fullClusters);
+    }
+    
+    // Device memory suballocation
+    if (ImGui::CollapsingHeader("GPU Memory")) {
+        GpuAllocatorStats mem = m_allocator.GetStats();
+        ImGui::Text("Blocks: %u  Dedicated: %u  Allocations: %u", mem.blockCount, mem.dedicatedCount, mem.allocationCount);
+        ImGui::Text("Used %.2f MB of %.2f MB reserved", double(mem.usedBytes) / (1024.0 * 1024.0),
+                    double(mem.reservedBytes) / (1024.0 * 1024.0));
+        ImGui::Text("Free in blocks %.2f MB, largest range %.2f MB", double(mem.freeBytes) / (1024.0 * 1024.0),
+                    double(mem.largestFreeRange) / (1024.0 * 1024.0));
+        ImGui::Text("Fragmentation: %.1f%%", mem.fragmentation * 100.0f);
+        ImGui::Text("Staging ring: %.2f / %.2f MB, %llu upload submits%s", double(m_uploads.RingUsed()) / (1024.0 * 1024.0),
+                    double(m_uploads.RingSize()) / (1024.0 * 1024.0), static_cast<unsigned long long>(m_uploads.SubmitCount()),
+                    m_uploads.HasDedicatedQueue() ? " (transfer queue)" : "");
+        ImGui::Text("Geometry pool: %u meshes, %u / %u vertices, %u / %u indices, %u grows", m_geometry.MeshCount(),
+                    m_geometry.VerticesUsed(), m_geometry.VertexCapacity(), m_geometry.IndicesUsed(),
+                    m_geometry.IndexCapacity(), m_geometry.GrowCount());
+        ImGui::Text("Vertex layout: %s, %u bytes per vertex",
+                    m_geometry.Layout() == VertexLayout::Compact ? "compact" : "standard",
+                    m_geometry.VertexStride() + m_geometry.PositionStride());
+    }
+    
+    // Pipeline cache and main-pass pipeline variants
+    if (ImGui::CollapsingHeader("Pipelines")) {
+        PipelineCacheStats cache = m_pipelineCache.Stats();
+        PipelineStateStats pso = m_pipelineStates.Stats();
+        ImGui::Text("Cache: %s, %u pipelines created in %.1f ms", cache.warm ? "warm" : "cold",
+                    cache.pipelinesCreated, cache.pipelineCreateMs);
+        ImGui::Text("Variants: %u ready, %u compiling, %u failed", pso.pipelines, pso.pending, pso.failed);
+        ImGui::Text("Requests: %llu hits, %llu misses, %llu served by fallback",
+                    static_cast<unsigned long long>(pso.hits), static_cast<unsigned long long>(pso.misses),
+                    static_cast<unsigned long long>(pso.fallbacks));
+        ImGui::Text("Compile: %.1f ms total, %.1f ms max", pso.compileMs, pso.maxCompileMs);
+    }
+    
+    // Render graph of the last recorded frame
+    if (ImGui::CollapsingHeader("Render Graph")) {
+        const RenderGraphStats& rg = m_renderGraph.Stats();
+        ImGui::Text("Passes: %u (%u culled)", rg.passes, rg.culledPasses);
+        ImGui::Text("Barriers: %u in %u batches", rg.barriers, rg.barrierBatches);
+        ImGui::Text("Transients: %u images in %u blocks, %.1f KB (%.1f KB unaliased)%s", rg.transientImages,
+                    rg.transientBlocks, double(rg.transientBytes) / 1024.0, double(rg.unaliasedBytes) / 1024.0,
+                    rg.lazyMemory ? ", lazily allocated" : "");
+        ImGui::Text("Swapchain: %ux%u, recreated %u times (last %.2f ms), %u blocks reused, %zu retired", m_extent.width,
+                    m_extent.height, m_swapchainRecreations, m_lastSwapchainRecreateMs, rg.reusedBlocks,
+                    m_retiredSwapchains.size());
+    }
+    
+    // Rolling frame-time graph; the buffer is sized for the whole history once
+    static std::vector<float> frameTimes;
+    frameTimes.reserve(FrameStats::HISTORY_SIZE);
+    frameTimes.clear();
+    m_frameStats.ForEachSample([](const FrameSample& sample) { frameTimes.push_back(sample.frameMs); });
+    if (!frameTimes.empty()) {
+        ImGui::PlotLines("##FrameTimes", frameTimes.data(), static_cast<int>(frameTimes.size()), 0, nullptr,
+                         0.0f, std::max(33.3f, m_frameStats.Max()), ImVec2(0, 50));
+    }
+    
+    // Per-phase breakdown of the last completed frame
+    if (const FrameSample* latest = m_frameStats.Latest()) {
+        const FramePhaseTimes& phases = latest->phases;
+        ImGui::Text("Sim %.2f | Record %.2f | GPU %.2f | Wait %.2f ms",
+                    phases.cpuSimMs, phases.cpuRecordMs, phases.gpuMs, phases.presentWaitMs);
+    }
+    if (ImGui::Button("Dump Frame CSV")) {
+        if (m_frameStats.WriteCsv(".logs/frametimes.csv")) {
+            NOVA_INFO("Frame times written to .logs/frametimes.csv");
+        } else {
+            NOVA_WARN("Failed to write frame time CSV");
+        }
+    }
+    ImGui::SameLine();
+    if (ImGui::Button("Reset Histogram")) {
+        m_frameStats.ResetHistogram();
+    }
+    
+    // GPU pass timings (timestamp queries, read back when their slot comes round again)
+    if (m_gpuProfiler.IsSupported()) {
+        ImGui::Text("GPU Time: %.3f ms", m_gpuProfiler.GetFrameTimeMs());
+        if (ImGui::BeginTable("GpuPasses", 2, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+            ImGui::TableSetupColumn("Pass");
+            ImGui::TableSetupColumn("GPU ms");
+            ImGui::TableHeadersRow();
+            for (const auto& pass : m_gpuProfiler.GetPassTimings()) {
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                ImGui::TextUnformatted(pass.name.c_str());
+                ImGui::TableSetColumnIndex(1);
+                ImGui::Text("%.3f", pass.ms);
+            }
+            ImGui::EndTable();
+        }
+    } else {
+        ImGui::TextDisabled("GPU timestamps unavailable");
+    }
+    if (ImGui::Button("Export Trace")) {
+        if (Profiler::WriteTrace(".logs/trace.json")) {
+            NOVA_INFO("Trace written to .logs/trace.json");
+        } else {
+            NOVA_WARN("Failed to write trace");
+        }
+    }
     
     ImGui::Separator();
     
@@ -1169,7 +1329,7 @@ void VulkanRenderer::RenderUI(Camera* camera, LightingManager* lightingManager)
     
     // Lighting info with real-time updates
     ImGui::TextColored(ImVec4(1.0f, 0.6f, 0.2f, 1.0f), "Lighting System:");
-    ImGui::Text("Active Lights: 3");
+    ImGui::Text("Active Lights: %zu", m_lightClusters.Lights().size());
     
     // Interactive light controls
     static float light1Pos[3] = {-5.97f, 3.99f, -5.33f};
@@ -1276,6 +1436,47 @@ void VulkanRenderer::RenderUI(Camera* camera, LightingManager* lightingManager)
     ImGui::Text("Asset Hot-Reload: Active");
     
     ImGui::End();
+    
+    // Memory Window (only with NOVA_MEMORY_TRACKING)
+    if (MemoryTracker::Enabled()) {
+        ImGui::SetNextWindowPos(ImVec2(420, 20), ImGuiCond_FirstUseEver);
+        ImGui::SetNextWindowSize(ImVec2(460, 360), ImGuiCond_FirstUseEver);
+        ImGui::Begin("Memory", nullptr, ImGuiWindowFlags_AlwaysVerticalScrollbar);
+        
+        ImGui::Text("Live: %.2f MB", double(MemoryTracker::GetTotalLiveBytes()) / (1024.0 * 1024.0));
+        if (ImGui::BeginTable("MemTags", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+            ImGui::TableSetupColumn("Tag");
+            ImGui::TableSetupColumn("Live KB");
+            ImGui::TableSetupColumn("Allocs/frame");
+            ImGui::TableSetupColumn("KB/frame");
+            ImGui::TableHeadersRow();
+            for (uint32_t t = 0; t < static_cast<uint32_t>(MemTag::Count); ++t) {
+                MemTagStats stats = MemoryTracker::GetTagStats(static_cast<MemTag>(t));
+                ImGui::TableNextRow();
+                ImGui::TableSetColumnIndex(0);
+                ImGui::TextUnformatted(MemoryTracker::TagName(static_cast<MemTag>(t)));
+                ImGui::TableSetColumnIndex(1);
+                ImGui::Text("%.1f", double(stats.liveBytes) / 1024.0);
+                ImGui::TableSetColumnIndex(2);
+                ImGui::Text("%llu", static_cast<unsigned long long>(stats.frameAllocs));
+                ImGui::TableSetColumnIndex(3);
+                ImGui::Text("%.1f", double(stats.frameBytes) / 1024.0);
+            }
+            ImGui::EndTable();
+        }
+        
+        // Call-site lookup symbolizes addresses, so only refresh on demand
+        static std::vector<MemCallSite> topSites;
+        if (ImGui::Button("Refresh Top Call Sites")) {
+            topSites = MemoryTracker::GetTopCallSites(16);
+        }
+        for (const auto& site : topSites) {
+            ImGui::Text("%8llu x  %8.1f KB  %s", static_cast<unsigned long long>(site.count),
+                        double(site.bytes) / 1024.0, site.symbol.c_str());
+        }
+        
+        ImGui::End();
+    }
 }
 
 void VulkanRenderer::CreateCommandPool() {
@@ -1322,16 +1523,12 @@ void VulkanRenderer::CreateCommandPool() {
 void VulkanRenderer::CreateSyncObjects() {
     NOVA_INFO("CreateSyncObjects: Creating frame-in-flight synchronization objects");
     
-    // Resize arrays to MAX_FRAMES_IN_FLIGHT
+    // Resize arrays to MAX_FRAMES_IN_FLIGHT; completion is tracked on m_frameTimeline
     m_imageAvailableSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
     m_renderFinishedSemaphores.resize(MAX_FRAMES_IN_FLIGHT);
-    m_inFlightFences.resize(MAX_FRAMES_IN_FLIGHT);
+    m_slotFrames.assign(MAX_FRAMES_IN_FLIGHT, NO_FRAME);
     m_commandBuffers.resize(MAX_FRAMES_IN_FLIGHT);
     
-    VkFenceCreateInfo fenceInfo{};
-    fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
-    fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT; // Start signaled so first frame doesn't wait
-    
     VkSemaphoreCreateInfo semaphoreInfo{};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
     
@@ -1341,64 +1538,510 @@ void VulkanRenderer::CreateSyncObjects() {
         
         VK_CHECK(vkCreateSemaphore(m_dev, &semaphoreInfo, nullptr, &m_imageAvailableSemaphores[i]));
         VK_CHECK(vkCreateSemaphore(m_dev, &semaphoreInfo, nullptr, &m_renderFinishedSemaphores[i]));
-        VK_CHECK(vkCreateFence(m_dev, &fenceInfo, nullptr, &m_inFlightFences[i]));
         
         // Set debug names for validation
 #ifdef _DEBUG
         SetDebugName(m_imageAvailableSemaphores[i], "ImageAvailableSemaphore_" + std::to_string(i));
         SetDebugName(m_renderFinishedSemaphores[i], "RenderFinishedSemaphore_" + std::to_string(i));
-        SetDebugName(m_inFlightFences[i], "InFlightFence_" + std::to_string(i));
 #endif
     }
     
     // Initialize imagesInFlight array (will be resized when swapchain is created)
     m_imagesInFlight.resize(0);
+#ifdef _DEBUG
+    SetDebugName(m_frameTimeline.Semaphore(), "FrameTimeline");
+#endif
     
     NOVA_INFO("CreateSyncObjects: Frame-in-flight sync objects created successfully");
 }
 
-uint32_t VulkanRenderer::FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
-    VkPhysicalDeviceMemoryProperties memProperties;
-    vkGetPhysicalDeviceMemoryProperties(m_phys, &memProperties);
-    
-    for (uint32_t i = 0; i < memProperties.memoryTypeCount; i++) {
-        if ((typeFilter & (1 << i)) && (memProperties.memoryTypes[i].propertyFlags & properties) == properties) {
-            return i;
+void VulkanRenderer::RetireBuffer(VkBuffer& buffer, GpuAllocation& allocation) {
+    if (buffer != VK_NULL_HANDLE) m_retiredBuffers.push_back({ buffer, allocation, m_frameNumber });
+    buffer = VK_NULL_HANDLE;
+    allocation = GpuAllocation{};
+}
+
+void VulkanRenderer::DestroyRetiredBuffers(bool all) {
+    // A buffer retired during frame N is used by frame N at the latest
+    auto done = [&](RetiredBuffer& r) {
+        if (!all && !m_frameTimeline.IsComplete(r.frameNumber)) return false;
+        m_allocator.DestroyBuffer(r.buffer, r.allocation);
+        return true;
+    };
+    m_retiredBuffers.erase(std::remove_if(m_retiredBuffers.begin(), m_retiredBuffers.end(), done), m_retiredBuffers.end());
+}
+
+void VulkanRenderer::DestroyRetiredSwapchains(bool all) {
+    // Same rule as buffers: frames up to N-1 rendered to and presented the old
+    // images, and frame N was the first to wait on anything from the new swapchain
+    auto done = [&](RetiredSwapchain& r) {
+        if (!all && !m_frameTimeline.IsComplete(r.frameNumber)) return false;
+        for (VkImageView view : r.views) {
+            if (view != VK_NULL_HANDLE) vkDestroyImageView(m_dev, view, nullptr);
         }
-    }
-    
-    throw std::runtime_error("Failed to find suitable memory type!");
+        vkDestroySwapchainKHR(m_dev, r.swapchain, nullptr);
+        return true;
+    };
+    m_retiredSwapchains.erase(std::remove_if(m_retiredSwapchains.begin(), m_retiredSwapchains.end(), done),
+                              m_retiredSwapchains.end());
+}
+
+VkResult VulkanRenderer::WaitForFrameSlot() {
+    if (m_frameSlotReady) return VK_SUCCESS;
+    // The slot's previous frame must be done with its resources, and at most
+    // m_framesInFlight frames may be queued; the two differ only just after
+    // SetFramesInFlight
+    uint64_t wait = idx(m_slotFrames, m_currentFrame, "slotFrames");
+    if (m_frameNumber >= m_framesInFlight) {
+        uint64_t oldest = m_frameNumber - m_framesInFlight;
+        if (wait == NO_FRAME || oldest > wait) wait = oldest;
+    }
+    if (wait == NO_FRAME) {
+        m_frameSlotReady = true;
+        return VK_SUCCESS;
+    }
+    double startMs = Profiler::NowMs();
+    VkResult result = m_frameTimeline.Wait(wait);
+    m_slotWaitMs += static_cast<float>(Profiler::NowMs() - startMs);
+    m_frameSlotReady = result == VK_SUCCESS;
+    return result;
 }
 
-void VulkanRenderer::RecordCommandBuffer(VkCommandBuffer cmd, VkFramebuffer framebuffer, Camera* camera) {
+void VulkanRenderer::LatchFrameCounters() {
+    m_lastCounters = m_counters;
+    m_counters = RenderCounters{};
+    
+    const RenderCounters& c = m_lastCounters;
+    Profiler::AddCounter("Draw calls", c.drawCalls);
+    Profiler::AddCounter("Instances", c.instances);
+    Profiler::AddCounter("Triangles", double(c.triangles));
+    Profiler::AddCounter("Pipeline binds", c.pipelineBinds);
+    Profiler::AddCounter("Descriptor binds", c.descriptorBinds);
+    Profiler::AddCounter("Upload KB", double(c.bufferBytesUploaded + c.textureBytesUploaded) / 1024.0);
+    Profiler::AddCounter("vkAllocateMemory", c.deviceAllocations);
+}
+
+void VulkanRenderer::RecordCommandBuffer(VkCommandBuffer cmd, uint32_t imageIndex, Camera* camera) {
     VkCommandBufferBeginInfo beginInfo{};
     beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
     
     VK_CHECK(vkBeginCommandBuffer(cmd, &beginInfo));
     
-    // Render shadow maps using the new shadow system
-    // For now, just a placeholder to prevent crashes
-    // TODO: Implement proper shadow rendering with the new system
+    // Reads back this slot's timestamps from its previous submission and resets the pool
+    m_gpuProfiler.BeginFrame(cmd, m_currentFrame);
+    UpdateDepthPrepassStats();
+    m_prepassThisFrame = m_depthPrepass && m_prepassPipelines[0] != VK_NULL_HANDLE && m_prepassPipelines[1] != VK_NULL_HANDLE;
+    // The slot's fence has been waited, so its secondaries can be recycled
+    m_secondaryPools.BeginFrame(m_currentFrame);
+    
+    // Use camera if provided, otherwise use default view
+    glm::mat4 view;
+    glm::mat4 projection;
+    float aspectRatio = static_cast<float>(m_extent.width) / static_cast<float>(m_extent.height);
+    float zNear = 0.1f;
+    float zFar = 100.0f;
+    
+    if (camera) {
+        // Use camera's view and projection matrices
+        view = camera->GetViewMatrix();
+        projection = camera->GetProjectionMatrix();
+        zNear = camera->GetNearPlane();
+        zFar = camera->GetFarPlane();
+        
+        // Debug: Log camera position
+        glm::vec3 camPos = camera->GetPosition();
+        NOVA_INFO("RecordCommandBuffer: Using camera at (" + std::to_string(camPos.x) + 
+                  ", " + std::to_string(camPos.y) + ", " + std::to_string(camPos.z) + 
+                  "), aspect ratio: " + std::to_string(aspectRatio) + 
+                  ", extent: " + std::to_string(m_extent.width) + "x" + std::to_string(m_extent.height));
+    } else if (m_hasFrameViewProj) {
+        // IRenderer::BeginFrame supplies only the combined matrix
+        SplitViewProjection(m_frameViewProj, view, projection, zNear, zFar);
+    } else {
+        // Fallback to default view
+        view = glm::lookAt(glm::vec3(6.0f, 4.0f, 6.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        projection = glm::perspective(glm::radians(45.0f), aspectRatio, zNear, zFar);
+        
+        NOVA_INFO("RecordCommandBuffer: Using default camera at (6,4,6), aspect ratio: " + std::to_string(aspectRatio) + 
+                  ", extent: " + std::to_string(m_extent.width) + "x" + std::to_string(m_extent.height));
+    }
+    
+    glm::mat4 viewProjection = projection * view;
+    Frustum frustum = Frustum::FromMatrix(viewProjection);
+    m_scene.SetLodScale(0.5f * static_cast<float>(m_extent.height) * std::abs(projection[1][1]));
+    
+    // This frame's uniforms, built from CPU-side state into the frame's own
+    // slice of the ring, so frames still in flight keep theirs
+    UniformBufferObject ubo{};
+    ubo.model = m_currentMVP;
+    ubo.clusterScale = LightClusters::ClusterScale(m_extent, zNear, zFar);
+    ubo.lightCounts = glm::uvec4(m_lightClusters.GlobalLightCount(), 0, 0, 0);
+    for (int i = 0; i < 3; ++i) {
+        // TODO: Implement proper light space matrix calculation with the new shadow system
+        ubo.lightSpaceMatrices[i] = glm::mat4(1.0f);
+    }
+    UniformAllocation frameUniforms = m_uniformRing.Push(m_currentFrame, m_frameNumber, ubo);
+    m_frameUniformOffset = frameUniforms.offset;
+    if (frameUniforms.IsValid()) m_counters.bufferBytesUploaded += sizeof(ubo);
+    
+    // Passes declare what they touch; the graph orders the barriers, culls
+    // unused passes and owns the depth buffer
+    m_renderGraph.Reset(m_frameNumber);
+    
+    // The acquire semaphore is waited at COLOR_ATTACHMENT_OUTPUT, so the first
+    // transition of the swapchain image chains from that stage. Offscreen
+    // targets were last used by a frame the CPU has already waited for.
+    RGImageDesc backbufferDesc{m_format, m_extent};
+    RGImageState backbufferState{VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0};
+    VkImage backbufferImage = idx(m_swapchainImages, imageIndex, "swapchainImages");
+    RGResource backbuffer = m_renderGraph.ImportImage("Backbuffer", backbufferImage,
+                                                      idx(m_swapchainImageViews, imageIndex, "swapchainImageViews"),
+                                                      backbufferDesc, &backbufferState,
+                                                      m_headless ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+    RGResource depth = m_renderGraph.CreateImage("Depth", RGImageDesc{VK_FORMAT_D32_SFLOAT, m_extent});
+    
+    // GPU-driven scene objects are culled by compute before the main pass.
+    // With occlusion culling that is only the early phase: the rest are
+    // tested against the depth it leaves and drawn by MainLate.
+    bool gpuCulling = m_cullMode == CullMode::Gpu && m_scene.GpuCullingAvailable() && m_scene.ObjectCount() > 0;
+    m_occlusionThisFrame = gpuCulling && m_occlusionCulling && IsOcclusionCullingAvailable();
+    RGResource sceneDraws;
+    if (gpuCulling) {
+        sceneDraws = m_renderGraph.ImportBuffer("SceneDraws", m_scene.IndirectBuffer(m_currentFrame));
+        GpuScene::CullPhase phase = m_occlusionThisFrame ? GpuScene::CullPhase::Early : GpuScene::CullPhase::All;
+        // Also writes the visible-object readback, so it is never culled
+        m_renderGraph.AddPass("Cull", [&, phase](VkCommandBuffer cmd) {
+            m_gpuProfiler.BeginPass(cmd, "Cull");
+            m_scene.RecordCull(cmd, m_currentFrame, frustum, phase);
+            m_gpuProfiler.EndPass(cmd);
+        }).Write(sceneDraws, RGAccess::StorageCompute).SideEffect();
+    }
+    
+    // Lights are binned into the froxel grid for this frame's camera; the
+    // count buffer stands for the counts and the index lists
+    RGResource lightClusters = m_renderGraph.ImportBuffer("LightClusters", m_lightClusters.CountBuffer(m_currentFrame));
+    m_renderGraph.AddPass("LightCull", [&](VkCommandBuffer cmd) {
+        m_gpuProfiler.BeginPass(cmd, "LightCull");
+        m_lightClusters.RecordBinning(cmd, m_currentFrame, view, projection, zNear, zFar);
+        m_gpuProfiler.EndPass(cmd);
+    }).Write(lightClusters, m_lightClusters.GpuBinningAvailable() ? RGAccess::StorageCompute : RGAccess::TransferWrite);
+    
+    // Culled by the graph until a pass samples the shadow map
+    if (m_shadowSystem.IsInitialized()) {
+        m_shadowSystem.AddShadowPass(m_renderGraph, {}, &m_gpuProfiler);
+    }
+    
+    // Everything drawn this frame: the default mesh (instanced if we have
+    // instances, otherwise a single instance), every mesh queued with DrawMesh
+    // or Submit this frame, then the scene objects. Sorted below.
+    m_frameDraws.clear();
+    
+    // Instance data written for an earlier frame lives in another slot's slice,
+    // which may be overwritten while this frame is in flight; carry it forward
+    if (m_instanceRange.count > 0 && m_instanceRange.frameNumber != m_frameNumber) {
+        InstanceRange range = m_instanceRing.Allocate(m_currentFrame, m_frameNumber, m_instanceRange.count);
+        if (range.data) {
+            memcpy(range.data, m_instanceRange.data, size_t(range.count) * sizeof(glm::mat4));
+            m_counters.bufferBytesUploaded += size_t(range.count) * sizeof(glm::mat4);
+        }
+        m_instanceRange = range;
+    }
+    if (m_defaultMesh.IsValid()) {
+        m_frameDraws.push_back(FrameDraw{m_defaultMesh, 0, m_instanceRange});
+    }
+    for (const MeshDraw& draw : m_meshDraws) {
+        m_frameDraws.push_back(FrameDraw{draw.mesh, draw.material, draw.instances});
+    }
+    for (const SubmittedDraw& draw : m_submitted) {
+        m_frameDraws.push_back(FrameDraw{draw.mesh, draw.material, InstanceRange{}, &draw.transform});
+    }
+    
+    // Scene objects: a single indirect count draw on the GPU path, which
+    // draws everything with the default material; otherwise CPU culling
+    m_counters.sceneObjects = m_scene.ObjectCount();
+    if (gpuCulling) {
+        FrameDraw indirect;
+        indirect.sceneIndirect = true;
+        m_frameDraws.push_back(indirect);
+        GpuSceneStats scene = m_scene.Stats(); // Read back, lags by the frames in flight
+        m_counters.visibleObjects = scene.visible;
+        m_counters.occludedObjects = scene.occluded;
+        m_counters.instances += m_counters.visibleObjects;
+    } else if (m_scene.ObjectCount() > 0) {
+        m_scene.CullCpu(frustum, m_cpuVisible);
+        m_scene.SelectLodsCpu(frustum, m_cpuVisible, m_cpuLods);
+        m_counters.visibleObjects = static_cast<uint32_t>(m_cpuVisible.size());
+        for (size_t i = 0; i < m_cpuVisible.size(); ++i) {
+            const GpuObject& visible = m_scene.Object(m_cpuVisible[i]);
+            FrameDraw draw{MeshHandle{ visible.mesh }, visible.material, InstanceRange{}, &visible.transform};
+            draw.lod = m_cpuLods[i];
+            m_frameDraws.push_back(draw);
+        }
+    }
+    BuildDrawItems(viewProjection);
+    
+    VkClearValue depthClear{};
+    depthClear.depthStencil = {1.0f, 0};
+    if (m_prepassThisFrame) {
+        auto prepass = m_renderGraph.AddPass("DepthPrepass", [&](VkCommandBuffer cmd) {
+            m_gpuProfiler.BeginPass(cmd, "DepthPrepass");
+            RecordDepthPrepass(cmd, viewProjection);
+            m_gpuProfiler.EndPass(cmd);
+        });
+        prepass.Write(depth, RGAccess::DepthAttachment).Clear(depth, depthClear);
+        if (gpuCulling) {
+            prepass.Read(sceneDraws, RGAccess::IndirectRead).Read(sceneDraws, RGAccess::VertexRead);
+        }
+    }
     
-    VkRenderPassBeginInfo renderPassInfo{};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassInfo.renderPass = m_renderPass;
-    renderPassInfo.framebuffer = framebuffer;
-    renderPassInfo.renderArea.offset = {0, 0};
-    renderPassInfo.renderArea.extent = m_extent;
+    // The main pass only executes secondaries. Draws are recorded by the job
+    // system, one contiguous slice per secondary, so executing them in slice
+    // order keeps submission order. Profiler scopes and ImGui are render-thread
+    // state and get their own secondaries at either end.
+    auto mainPass = m_renderGraph.AddPass("Main", [&](VkCommandBuffer cmd) {
+        // Track current render pass
+        m_currentRenderPass = m_renderGraph.ActiveRenderPass();
+        m_secondaries.clear();
+    
+        VkCommandBuffer head = BeginMainPassSecondary(0);
+        if (head != VK_NULL_HANDLE) {
+            m_gpuProfiler.BeginPass(head, "Main");
+            if (vkEndCommandBuffer(head) == VK_SUCCESS) m_secondaries.push_back(head);
+        }
     
-    VkClearValue clearValues[2];
-    clearValues[0].color = {{0.2f, 0.3f, 0.4f, 1.0f}};
-    clearValues[1].depthStencil = {1.0f, 0};
-    renderPassInfo.clearValueCount = 2;
-    renderPassInfo.pClearValues = clearValues;
+        NOVA_INFO("RecordCommandBuffer: About to draw indexed");
+        uint32_t threads = GetRecordThreads();
+        size_t drawCount = m_drawItems.size();
+        uint32_t slices = static_cast<uint32_t>(std::min<size_t>(threads, (drawCount + MIN_DRAWS_PER_SLICE - 1) / MIN_DRAWS_PER_SLICE));
+        size_t firstSlice = m_secondaries.size();
+        m_secondaries.resize(firstSlice + slices, VK_NULL_HANDLE);
+        m_sliceCounters.assign(slices, RenderCounters{});
+        ResolveMaterialPipelines();
+        m_jobs.ParallelFor(slices, threads, [&](uint32_t slice, uint32_t thread) {
+            size_t begin = drawCount * slice / slices;
+            size_t end = drawCount * (slice + 1) / slices;
+            VkCommandBuffer secondary = BeginMainPassSecondary(thread);
+            if (secondary == VK_NULL_HANDLE) return;
+            RecordDraws(secondary, m_drawItems.data() + begin, end - begin, viewProjection, m_sliceCounters[slice]);
+            if (vkEndCommandBuffer(secondary) == VK_SUCCESS) m_secondaries[firstSlice + slice] = secondary;
+        });
+        for (const RenderCounters& counters : m_sliceCounters) {
+            m_counters.drawCalls += counters.drawCalls;
+            m_counters.instances += counters.instances;
+            m_counters.triangles += counters.triangles;
+            m_counters.pipelineBinds += counters.pipelineBinds;
+            m_counters.descriptorBinds += counters.descriptorBinds;
+            m_counters.vertexBufferBinds += counters.vertexBufferBinds;
+            m_counters.pushConstantUpdates += counters.pushConstantUpdates;
+        }
+        NOVA_INFO("RecordCommandBuffer: Mesh draws completed");
+    
+        // Render ImGui UI within the render pass, unless MainLate follows
+        VkCommandBuffer tail = BeginMainPassSecondary(0);
+        if (tail != VK_NULL_HANDLE) {
+            m_gpuProfiler.EndPass(tail);
+            if (!m_occlusionThisFrame) RecordImGui(tail);
+            if (vkEndCommandBuffer(tail) == VK_SUCCESS) m_secondaries.push_back(tail);
+        }
     
-    vkCmdBeginRenderPass(cmd, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+        // A slice that failed to record is dropped rather than executed half-built
+        m_secondaries.erase(std::remove(m_secondaries.begin(), m_secondaries.end(), VK_NULL_HANDLE), m_secondaries.end());
+        if (!m_secondaries.empty()) {
+            vkCmdExecuteCommands(cmd, static_cast<uint32_t>(m_secondaries.size()), m_secondaries.data());
+        }
+        m_counters.secondaryCommandBuffers += static_cast<uint32_t>(m_secondaries.size());
+    });
+    mainPass.SecondaryCommandBuffers();
+    mainPass.Write(backbuffer, RGAccess::ColorAttachment).Clear(backbuffer, VkClearValue{{{0.2f, 0.3f, 0.4f, 1.0f}}});
+    // Loads the prepass depth; masked materials still write to it
+    mainPass.Write(depth, RGAccess::DepthAttachment);
+    if (!m_prepassThisFrame) mainPass.Clear(depth, depthClear);
+    mainPass.Read(lightClusters, RGAccess::StorageFragment);
+    if (gpuCulling) {
+        mainPass.Read(sceneDraws, RGAccess::IndirectRead).Read(sceneDraws, RGAccess::VertexRead);
+    }
+    
+    // Late phase of occlusion culling: the early draws' depth is reduced into
+    // the Hi-Z pyramid, every object is tested against it (which also becomes
+    // next frame's early list), and the newly visible ones are drawn on top
+    if (m_occlusionThisFrame) {
+        m_renderGraph.AddPass("OcclusionCull", [&](VkCommandBuffer cmd) {
+            m_gpuProfiler.BeginPass(cmd, "HiZ");
+            bool built = m_depthPyramid.RecordBuild(cmd, m_currentFrame, m_frameNumber, m_renderGraph.View(depth), m_extent);
+            m_gpuProfiler.EndPass(cmd);
+            if (!built) return;
+            m_gpuProfiler.BeginPass(cmd, "OcclusionCull");
+            m_scene.RecordOcclusionCull(cmd, m_currentFrame, frustum, viewProjection, m_depthPyramid);
+            m_gpuProfiler.EndPass(cmd);
+        }).Read(depth, RGAccess::SampledCompute).Write(sceneDraws, RGAccess::StorageCompute).SideEffect();
+    
+        auto latePass = m_renderGraph.AddPass("MainLate", [&](VkCommandBuffer cmd) {
+            m_currentRenderPass = m_renderGraph.ActiveRenderPass();
+            m_gpuProfiler.BeginPass(cmd, "MainLate");
+            RenderCounters counters;
+            RecordLateDraws(cmd, viewProjection, counters);
+            m_counters.drawCalls += counters.drawCalls;
+            m_counters.pipelineBinds += counters.pipelineBinds;
+            m_counters.descriptorBinds += counters.descriptorBinds;
+            m_counters.vertexBufferBinds += counters.vertexBufferBinds;
+            m_counters.pushConstantUpdates += counters.pushConstantUpdates;
+            m_gpuProfiler.EndPass(cmd);
+            RecordImGui(cmd);
+        });
+        // Loads what the main pass left
+        latePass.Write(backbuffer, RGAccess::ColorAttachment).Write(depth, RGAccess::DepthAttachment);
+        latePass.Read(lightClusters, RGAccess::StorageFragment);
+        latePass.Read(sceneDraws, RGAccess::IndirectRead).Read(sceneDraws, RGAccess::VertexRead);
+    }
+    
+    // A requested readback copies the finished image into a staging slot;
+    // PollReadback hands it out once this frame's timeline value is reached
+    if (m_headless && m_readbackRequested) {
+        m_readbackRequested = false;
+        uint32_t readbackSlot = m_readback.ReserveSlot(m_frameNumber, m_extent);
+        if (readbackSlot != UINT32_MAX) {
+            m_renderGraph.AddPass("Readback", [this, readbackSlot, backbufferImage](VkCommandBuffer cmd) {
+                m_readback.RecordCopy(cmd, readbackSlot, backbufferImage);
+            }).Read(backbuffer, RGAccess::TransferRead).SideEffect();
+        }
+    }
     
-    // Track current render pass
-    m_currentRenderPass = m_renderPass;
+    m_renderGraph.Compile();
+    m_renderGraph.Execute(cmd);
+    m_counters.pipelineBarriers += m_renderGraph.Stats().barrierBatches;
     
-    // Set viewport dynamically to match current extent
+    VK_CHECK(vkEndCommandBuffer(cmd));
+}
+
+void VulkanRenderer::BuildDrawItems(const glm::mat4& viewProjection) {
+    // View depth is clip-space w, the last row of the view-projection matrix
+    auto viewDepth = [&](const glm::vec3& p) {
+        return viewProjection[0][3] * p.x + viewProjection[1][3] * p.y + viewProjection[2][3] * p.z + viewProjection[3][3];
+    };
+    const size_t drawCount = m_frameDraws.size();
+    m_sortEntries.resize(drawCount);
+    uint32_t singleObjects = 0;
+    for (size_t i = 0; i < drawCount; ++i) {
+        FrameDraw& draw = m_frameDraws[i];
+        if (draw.material >= m_materials.size()) draw.material = 0;
+        const MaterialSlot& slot = m_materials[draw.material];
+        // Prebuilt instance ranges live in write-combined memory and are not
+        // read back; they sort at depth 0. The indirect draw sorts with the
+        // default material's opaque draws.
+        uint16_t depth = draw.transform ? QuantizeDepth(viewDepth(glm::vec3((*draw.transform)[3]))) : 0;
+        uint32_t mesh = draw.sceneIndirect ? 0xFFFF : draw.mesh.id;
+        m_sortEntries[i].key = MakeDrawKey(DrawPassFor(slot.key.blendMode), slot.pipelineId, draw.material, mesh, depth);
+        m_sortEntries[i].index = static_cast<uint32_t>(i);
+        if (draw.transform) singleObjects++;
+    }
+    
+    // Switches of pipeline, material and mesh along the list, before and after sorting
+    auto stateChanges = [&]() {
+        uint32_t changes = 0;
+        for (size_t i = 1; i < drawCount; ++i) {
+            const FrameDraw& a = m_frameDraws[m_sortEntries[i - 1].index];
+            const FrameDraw& b = m_frameDraws[m_sortEntries[i].index];
+            changes += m_materials[a.material].pipelineId != m_materials[b.material].pipelineId;
+            changes += a.material != b.material;
+            changes += a.mesh.id != b.mesh.id || a.sceneIndirect != b.sceneIndirect;
+        }
+        return changes;
+    };
+    m_counters.stateChangesUnsorted = stateChanges();
+    if (m_sortDraws) {
+        RadixSort(m_sortEntries, m_sortScratch, &m_jobs, GetRecordThreads());
+        m_counters.sortedDraws = static_cast<uint32_t>(drawCount);
+        m_counters.stateChangesSorted = stateChanges();
+    } else {
+        m_counters.stateChangesSorted = m_counters.stateChangesUnsorted;
+    }
+    
+    // Single objects get their instance data written in draw order, so a run
+    // of the same mesh and material is one contiguous, instanced draw
+    m_drawItems.clear();
+    InstanceRange objects = m_instanceRing.Allocate(m_currentFrame, m_frameNumber, singleObjects);
+    const bool compact = m_geometry.Layout() == VertexLayout::Compact;
+    uint32_t written = 0;
+    bool extendable = false;   // m_drawItems.back() is a run of single objects
+    for (const SortEntry& entry : m_sortEntries) {
+        const FrameDraw& draw = m_frameDraws[entry.index];
+        if (!draw.transform) {
+            DrawItem item;
+            item.mesh = draw.mesh;
+            item.instances = draw.instances;
+            item.material = draw.material;
+            item.sceneIndirect = draw.sceneIndirect;
+            m_drawItems.push_back(item);
+            extendable = false;
+            continue;
+        }
+        if (!objects.data) continue;
+        objects.data[written] = compact ? GeometryPool::Dequantized(*draw.transform, m_geometry.PositionDequantize(draw.mesh))
+                                        : *draw.transform;
+        if (extendable && m_drawItems.back().mesh.id == draw.mesh.id && m_drawItems.back().material == draw.material &&
+            m_drawItems.back().lod == draw.lod) {
+            m_drawItems.back().instances.count++;
+        } else {
+            DrawItem item;
+            item.mesh = draw.mesh;
+            item.instances = objects;
+            item.instances.firstInstance += written;
+            item.instances.count = 1;
+            item.material = draw.material;
+            item.lod = draw.lod;
+            m_drawItems.push_back(item);
+            extendable = true;
+        }
+        written++;
+    }
+    m_counters.bufferBytesUploaded += size_t(written) * sizeof(glm::mat4);
+}
+
+uint32_t VulkanRenderer::GetRecordThreads() const {
+    uint32_t available = m_jobs.ThreadCount();
+    return m_recordThreads > 0 ? std::min(m_recordThreads, available) : available;
+}
+
+void VulkanRenderer::SetFramesInFlight(uint32_t frames) {
+    frames = std::clamp(frames, 1u, MAX_FRAMES_IN_FLIGHT);
+    if (frames == m_framesInFlight) return;
+    m_framesInFlight = frames;
+    // Slots keep their last frame, so the current slot may be past the new
+    // count; the next advance wraps it. Fewer frames may mean a longer wait.
+    m_frameSlotReady = false;
+    NOVA_INFO("Frames in flight: " + std::to_string(m_framesInFlight));
+}
+
+void VulkanRenderer::SetPresentMode(VkPresentModeKHR mode) {
+    if (mode == m_presentMode) return;
+    m_presentMode = mode;
+    m_swapchainDirty = m_swapchain != VK_NULL_HANDLE;
+}
+
+VkCommandBuffer VulkanRenderer::BeginMainPassSecondary(uint32_t thread) {
+    VkCommandBufferInheritanceInfo inheritance{};
+    inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritance.renderPass = m_renderGraph.ActiveRenderPass();
+    inheritance.subpass = 0;
+    inheritance.framebuffer = m_renderGraph.ActiveFramebuffer();
+    return m_secondaryPools.Begin(m_currentFrame, thread, inheritance);
+}
+
+void VulkanRenderer::ResolveMaterialPipelines() {
+    // Grows only when materials are added; entries are cleared, not freed
+    m_materialPipelines.assign(m_materials.size(), VK_NULL_HANDLE);
+    for (const DrawItem& item : m_drawItems) {
+        uint32_t material = item.material < m_materials.size() ? item.material : 0;
+        if (m_materialPipelines[material] == VK_NULL_HANDLE) {
+            m_materialPipelines[material] = m_pipelineStates.Get(MainPassKey(m_materials[material]));
+        }
+    }
+}
+
+void VulkanRenderer::RecordDraws(VkCommandBuffer cmd, const DrawItem* items, size_t count, const glm::mat4& viewProjection,
+                                 RenderCounters& counters) {
+    // Secondaries inherit no state: viewport, scissor, descriptor set and the
+    // shared geometry pool (binding 0 + index buffer) are set per slice
     VkViewport viewport{};
     viewport.x = 0.0f;
     viewport.y = 0.0f;
@@ -1408,85 +2051,187 @@ void VulkanRenderer::RecordCommandBuffer(VkCommandBuffer cmd, VkFramebuffer fram
     viewport.maxDepth = 1.0f;
     vkCmdSetViewport(cmd, 0, 1, &viewport);
     
-    // Set scissor dynamically to match current extent
     VkRect2D scissor{};
     scissor.offset = {0, 0};
     scissor.extent = m_extent;
     vkCmdSetScissor(cmd, 0, 1, &scissor);
     
-    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &m_descriptorSets[m_currentFrame],
+                            1, &m_frameUniformOffset);
+    counters.descriptorBinds++;
     
-    // Bind descriptor set for uniform buffer
-    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &m_descriptorSets[m_currentFrame], 0, nullptr);
-    
-    // Bind vertex buffer (binding 0)
     VkDeviceSize offsets[] = {0};
-    vkCmdBindVertexBuffers(cmd, 0, 1, &m_vertexBuffer, offsets);
+    BindGeometry(cmd, counters);
     
-    // Bind instance buffer if we have instances (binding 1)
-    if (m_instanceBuffer != VK_NULL_HANDLE && m_instanceCount > 0) {
-        vkCmdBindVertexBuffers(cmd, 1, 1, &m_instanceBuffer, offsets);
-    }
-    
-    vkCmdBindIndexBuffer(cmd, m_indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+    // Pipeline and material constants change only when the material does.
+    // A variant still compiling draws with the default pipeline meanwhile.
+    // Pipelines come from m_materialPipelines, resolved before the slices
+    // started, so slices neither allocate nor take the pipeline cache's lock.
+    PushConstants pushConstants{};
+    pushConstants.viewProjection = viewProjection;
+    const std::vector<VkPipeline>& pipelines = m_materialPipelines;
+    uint32_t boundMaterial = UINT32_MAX;
+    VkPipeline boundPipeline = VK_NULL_HANDLE;
+    auto bindMaterial = [&](uint32_t material) {
+        if (material >= m_materials.size()) material = 0;
+        if (material == boundMaterial) return;
+        const MaterialSlot& slot = m_materials[material];
+        if (pipelines[material] != boundPipeline) {
+            boundPipeline = pipelines[material];
+            vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, boundPipeline);
+            counters.pipelineBinds++;
+        }
+        pushConstants.baseColor = slot.baseColor;
+        pushConstants.metallic = slot.metallic;
+        pushConstants.roughness = slot.roughness;
+        vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConstants), &pushConstants);
+        counters.pushConstantUpdates++;
+        boundMaterial = material;
+    };
     
-    // Use the current uniform buffer data (updated by UpdateMVP)
-    UniformBufferObject ubo{};
-    memcpy(&ubo, m_uniformMapped, sizeof(ubo));
+    // The instance buffer (binding 1) is only rebound when a range lives in a different buffer
+    VkBuffer boundInstances = VK_NULL_HANDLE;
+    for (size_t i = 0; i < count; ++i) {
+        const DrawItem& item = items[i];
+        bindMaterial(item.material);
+        if (item.sceneIndirect) {
+            // Binds its own instance buffer
+            counters.drawCalls += m_scene.RecordDraw(cmd, m_currentFrame);
+            counters.vertexBufferBinds++;
+            boundInstances = VK_NULL_HANDLE;
+            continue;
+        }
+        const MeshRange* range = m_geometry.Find(item.mesh);
+        const MeshLodRange* lod = m_geometry.FindLod(item.mesh, item.lod);
+        if (!range || !lod) continue;
+        bool hasInstances = item.instances.buffer != VK_NULL_HANDLE && item.instances.count > 0;
+        if (hasInstances && item.instances.buffer != boundInstances) {
+            vkCmdBindVertexBuffers(cmd, 1, 1, &item.instances.buffer, offsets);
+            counters.vertexBufferBinds++;
+            boundInstances = item.instances.buffer;
+        }
+        uint32_t drawInstances = hasInstances ? item.instances.count : 1;
+        uint32_t firstInstance = hasInstances ? item.instances.firstInstance : 0;
+        vkCmdDrawIndexed(cmd, lod->indexCount, drawInstances, lod->firstIndex, range->vertexOffset, firstInstance);
+        counters.drawCalls++;
+        counters.instances += drawInstances;
+        counters.triangles += uint64_t(lod->indexCount / 3) * drawInstances;
+    }
+}
+
+void VulkanRenderer::RecordDepthPrepass(VkCommandBuffer cmd, const glm::mat4& viewProjection) {
+    VkViewport viewport{};
+    viewport.width = static_cast<float>(m_extent.width);
+    viewport.height = static_cast<float>(m_extent.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(cmd, 0, 1, &viewport);
+    VkRect2D scissor{};
+    scissor.extent = m_extent;
+    vkCmdSetScissor(cmd, 0, 1, &scissor);
     
-    // Create push constants with view-projection matrix and material data
+    // Only viewProjection is read; the range covers both stages, so the whole block is pushed
     PushConstants pushConstants{};
+    pushConstants.viewProjection = viewProjection;
+    vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConstants), &pushConstants);
+    m_counters.pushConstantUpdates++;
     
-    // Use camera if provided, otherwise use default view
-    glm::mat4 view;
-    glm::mat4 projection;
-    float aspectRatio = static_cast<float>(m_extent.width) / static_cast<float>(m_extent.height);
-    
-    if (camera) {
-        // Use camera's view and projection matrices
-        view = camera->GetViewMatrix();
-        projection = camera->GetProjectionMatrix();
-        
-        // Debug: Log camera position
-        glm::vec3 camPos = camera->GetPosition();
-        NOVA_INFO("RecordCommandBuffer: Using camera at (" + std::to_string(camPos.x) + 
-                  ", " + std::to_string(camPos.y) + ", " + std::to_string(camPos.z) + 
-                  "), aspect ratio: " + std::to_string(aspectRatio) + 
-                  ", extent: " + std::to_string(m_extent.width) + "x" + std::to_string(m_extent.height));
+    VkDeviceSize offsets[] = {0};
+    VkBuffer positions = m_geometry.PositionBuffer();
+    vkCmdBindVertexBuffers(cmd, 0, 1, &positions, offsets);
+    m_counters.vertexBufferBinds++;
+    vkCmdBindIndexBuffer(cmd, m_geometry.IndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+    
+    VkPipeline boundPipeline = VK_NULL_HANDLE;
+    VkBuffer boundInstances = VK_NULL_HANDLE;
+    for (const DrawItem& item : m_drawItems) {
+        const MaterialSlot& slot = m_materials[item.material < m_materials.size() ? item.material : 0];
+        // Masked surfaces need the fragment shader's alpha test and blended ones hide nothing
+        if (slot.key.blendMode != MaterialBlendMode::Opaque) continue;
+        VkPipeline pipeline = m_prepassPipelines[slot.key.doubleSided ? 1 : 0];
+        if (pipeline != boundPipeline) {
+            vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline);
+            m_counters.pipelineBinds++;
+            boundPipeline = pipeline;
+        }
+        if (item.sceneIndirect) {
+            m_counters.prepassDraws += m_scene.RecordDraw(cmd, m_currentFrame);
+            m_counters.vertexBufferBinds++;
+            boundInstances = VK_NULL_HANDLE;
+            continue;
+        }
+        const MeshRange* range = m_geometry.Find(item.mesh);
+        const MeshLodRange* lod = m_geometry.FindLod(item.mesh, item.lod);
+        if (!range || !lod) continue;
+        bool hasInstances = item.instances.buffer != VK_NULL_HANDLE && item.instances.count > 0;
+        if (hasInstances && item.instances.buffer != boundInstances) {
+            vkCmdBindVertexBuffers(cmd, 1, 1, &item.instances.buffer, offsets);
+            m_counters.vertexBufferBinds++;
+            boundInstances = item.instances.buffer;
+        }
+        uint32_t drawInstances = hasInstances ? item.instances.count : 1;
+        uint32_t firstInstance = hasInstances ? item.instances.firstInstance : 0;
+        vkCmdDrawIndexed(cmd, lod->indexCount, drawInstances, lod->firstIndex, range->vertexOffset, firstInstance);
+        m_counters.prepassDraws++;
+    }
+}
+
+void VulkanRenderer::BindGeometry(VkCommandBuffer cmd, RenderCounters& counters) {
+    VkDeviceSize offsets[] = {0};
+    if (m_geometry.Layout() == VertexLayout::Compact) {
+        // Positions at binding 0 as in the depth prepass, the rest at 2
+        VkBuffer positions = m_geometry.PositionBuffer();
+        VkBuffer attributes = m_geometry.VertexBuffer();
+        vkCmdBindVertexBuffers(cmd, 0, 1, &positions, offsets);
+        vkCmdBindVertexBuffers(cmd, 2, 1, &attributes, offsets);
+        counters.vertexBufferBinds += 2;
     } else {
-        // Fallback to default view
-        view = glm::lookAt(glm::vec3(6.0f, 4.0f, 6.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
-        projection = glm::perspective(glm::radians(45.0f), aspectRatio, 0.1f, 100.0f);
-        
-        NOVA_INFO("RecordCommandBuffer: Using default camera at (6,4,6), aspect ratio: " + std::to_string(aspectRatio) + 
-                  ", extent: " + std::to_string(m_extent.width) + "x" + std::to_string(m_extent.height));
+        VkBuffer poolVertexBuffer = m_geometry.VertexBuffer();
+        vkCmdBindVertexBuffers(cmd, 0, 1, &poolVertexBuffer, offsets);
+        counters.vertexBufferBinds++;
     }
+    vkCmdBindIndexBuffer(cmd, m_geometry.IndexBuffer(), 0, VK_INDEX_TYPE_UINT32);
+}
+
+void VulkanRenderer::RecordLateDraws(VkCommandBuffer cmd, const glm::mat4& viewProjection, RenderCounters& counters) {
+    VkViewport viewport{};
+    viewport.width = static_cast<float>(m_extent.width);
+    viewport.height = static_cast<float>(m_extent.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewport(cmd, 0, 1, &viewport);
+    VkRect2D scissor{};
+    scissor.extent = m_extent;
+    vkCmdSetScissor(cmd, 0, 1, &scissor);
     
-    pushConstants.viewProjection = projection * view;
-    pushConstants.baseColor = glm::vec4(1.0f, 0.2f, 0.2f, 1.0f); // Bright red color
-    pushConstants.metallic = 0.0f;
-    pushConstants.roughness = 0.3f;
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineLayout, 0, 1, &m_descriptorSets[m_currentFrame],
+                            1, &m_frameUniformOffset);
+    counters.descriptorBinds++;
+    BindGeometry(cmd, counters);
     
-    NOVA_INFO("RecordCommandBuffer: Pushing constants, size: " + std::to_string(sizeof(PushConstants)) + " bytes");
+    // Like the early indirect draw, everything uses the default material, but
+    // with its usual depth test: the prepass never saw these objects
+    const MaterialSlot& slot = m_materials[0];
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipelineStates.Get(slot.key));
+    counters.pipelineBinds++;
+    PushConstants pushConstants{};
+    pushConstants.viewProjection = viewProjection;
+    pushConstants.baseColor = slot.baseColor;
+    pushConstants.metallic = slot.metallic;
+    pushConstants.roughness = slot.roughness;
     vkCmdPushConstants(cmd, m_pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushConstants), &pushConstants);
+    counters.pushConstantUpdates++;
     
-    // Draw with instancing if we have instances, otherwise draw normally
-    NOVA_INFO("RecordCommandBuffer: About to draw indexed");
-    if (m_instanceBuffer != VK_NULL_HANDLE && m_instanceCount > 0) {
-        NOVA_INFO("RecordCommandBuffer: Drawing " + std::to_string(m_indexCount) + " indices with " + std::to_string(m_instanceCount) + " instances");
-        vkCmdDrawIndexed(cmd, m_indexCount, m_instanceCount, 0, 0, 0);
-        NOVA_INFO("RecordCommandBuffer: Instanced draw completed");
-    } else {
-        NOVA_INFO("RecordCommandBuffer: Drawing " + std::to_string(m_indexCount) + " indices with 1 instance");
-        vkCmdDrawIndexed(cmd, m_indexCount, 1, 0, 0, 0);
-        NOVA_INFO("RecordCommandBuffer: Single draw completed");
-    }
-    
-    // Render ImGui UI within the render pass
+    counters.drawCalls += m_scene.RecordDraw(cmd, m_currentFrame, GpuScene::CullPhase::Late);
+    counters.vertexBufferBinds++;
+}
+
+void VulkanRenderer::RecordImGui(VkCommandBuffer cmd) {
     NOVA_INFO("RecordCommandBuffer: About to render ImGui UI");
+    m_gpuProfiler.BeginPass(cmd, "ImGui");
     if (m_imguiReady) {
         ImDrawData* drawData = ImGui::GetDrawData();
-
+    
         if (drawData && drawData->Valid) {
             NOVA_INFO("RecordCommandBuffer: Rendering ImGui draw data");
             ImGui_ImplVulkan_RenderDrawData(drawData, cmd);
@@ -1497,38 +2242,82 @@ void VulkanRenderer::RecordCommandBuffer(VkCommandBuffer cmd, VkFramebuffer fram
     } else {
         NOVA_INFO("RecordCommandBuffer: ImGui not ready");
     }
-        
-    NOVA_INFO("RecordCommandBuffer: Ending render pass");
-    vkCmdEndRenderPass(cmd);
-    NOVA_INFO("RecordCommandBuffer: Render pass ended");
-    
-    VK_CHECK(vkEndCommandBuffer(cmd));
+    m_gpuProfiler.EndPass(cmd);
+}
+
+PipelineKey VulkanRenderer::MainPassKey(const MaterialSlot& slot) const {
+    PipelineKey key = slot.key;
+    if (m_prepassThisFrame && key.blendMode == MaterialBlendMode::Opaque) key.depthTest = DepthTest::EqualNoWrite;
+    return key;
+}
+
+void VulkanRenderer::SetDepthPrepass(bool enabled) {
+    m_depthPrepass = enabled;
+    if (!enabled || m_pipelineStates.Fallback() == VK_NULL_HANDLE) return;
+    // Opaque materials switch to their EQUAL variants; start compiling them now
+    for (const MaterialSlot& slot : m_materials) {
+        if (slot.key.blendMode != MaterialBlendMode::Opaque) continue;
+        PipelineKey key = slot.key;
+        key.depthTest = DepthTest::EqualNoWrite;
+        m_pipelineStates.Prewarm(key);
+    }
+}
+
+void VulkanRenderer::UpdateDepthPrepassStats() {
+    // The timings belong to an earlier frame; whether it had a prepass is read
+    // from the timings themselves, so frames around a toggle land correctly
+    float prepassMs = 0.0f;
+    float mainMs = 0.0f;
+    bool hasPrepass = false;
+    bool hasMain = false;
+    for (const GpuPassTiming& pass : m_gpuProfiler.GetPassTimings()) {
+        if (pass.name == "DepthPrepass") {
+            prepassMs += pass.ms;
+            hasPrepass = true;
+        } else if (pass.name == "Main" || pass.name == "MainLate") {
+            mainMs += pass.ms;
+            hasMain = true;
+        }
+    }
+    if (!hasMain) return;
+    // Exponential moving average; the first sample seeds it
+    constexpr float SMOOTHING = 0.05f;
+    float& average = hasPrepass ? m_prepassStats.withPrepassMs : m_prepassStats.withoutPrepassMs;
+    uint64_t& frames = hasPrepass ? m_prepassStats.withPrepassFrames : m_prepassStats.withoutPrepassFrames;
+    float sample = prepassMs + mainMs;
+    average = frames == 0 ? sample : average + (sample - average) * SMOOTHING;
+    frames++;
 }
 
 void VulkanRenderer::RenderFrame(Camera* camera, LightingManager* lightingManager) {
+    NOVA_MEM_TAG(Renderer);
     // Declare all variables that might be used after goto before any goto paths
     uint32_t imageIndex;
-    VkResult fenceResult;
+    VkResult slotResult;
     VkResult result;
     VkResult waitResult;
-    VkResult resetResult;
     VkResult resetCmdResult;
     VkSubmitInfo submitInfo{};
-    VkSemaphore waitSemaphores[1];
-    VkPipelineStageFlags waitStages[1];
-    VkSemaphore signalSemaphores[1];
+    VkSemaphore waitSemaphores[2];
+    VkPipelineStageFlags waitStages[2];
+    uint64_t waitValues[2] = {0, 0};
+    VkTimelineSemaphoreSubmitInfo timelineInfo{};
+    uint64_t uploadValue = 0;
+    VkSemaphore signalSemaphores[2];
+    uint64_t signalValues[2] = {0, 0};
     VkResult submitResult;
     VkPresentInfoKHR presentInfo{};
     VkSwapchainKHR swapChains[1];
+    double phaseStartMs = 0.0;
     
     NOVA_INFO("RenderFrame: Starting frame render - Frame " + std::to_string(m_currentFrame));
     
     // Log current frame and swapchain sizes for debugging
-    NOVA_INFO("RenderFrame: currentFrame=" + std::to_string(m_currentFrame) + " (MAX_FRAMES_IN_FLIGHT=" + std::to_string(MAX_FRAMES_IN_FLIGHT) + ")");
+    NOVA_INFO("RenderFrame: currentFrame=" + std::to_string(m_currentFrame) + " (framesInFlight=" + std::to_string(m_framesInFlight) + ")");
     NOVA_INFO("RenderFrame: swapchainImageCount=" + std::to_string(m_swapchainImages.size()));
     
     // Begin ImGui frame
-    BeginFrame();
+    BeginImGuiFrame();
     NOVA_INFO("RenderFrame: ImGui frame begun");
     
     // UI rendering with camera and lighting data
@@ -1555,30 +2344,48 @@ void VulkanRenderer::RenderFrame(Camera* camera, LightingManager* lightingManage
     
     // Validate array sizes - assert once per frame that sizes match (after healing)
     assert(m_swapchainImages.size() == m_imagesInFlight.size() && "ImagesInFlight size mismatch after heal");
-    assert(m_swapchainImages.size() == m_framebuffers.size() && "Framebuffers size mismatch");
     assert(m_commandBuffers.size() == MAX_FRAMES_IN_FLIGHT && "Command buffers size mismatch");
     
     // Wait for the fence for the current frame to be signaled
-    NOVA_INFO("RenderFrame: Waiting for fence " + std::to_string(m_currentFrame));
-    fenceResult = vkWaitForFences(m_dev, 1, &idx(m_inFlightFences, m_currentFrame, "inFlightFences"), VK_TRUE, UINT64_MAX);
-    if (fenceResult != VK_SUCCESS) {
-        NOVA_ERROR("RenderFrame: Failed to wait for fence: " + std::to_string(fenceResult));
+    NOVA_INFO("RenderFrame: Waiting for slot " + std::to_string(m_currentFrame));
+    slotResult = WaitForFrameSlot();
+    phaseStartMs = Profiler::NowMs();
+    m_framePhases.presentWaitMs += m_slotWaitMs; // Possibly waited earlier by SetInstanceData
+    m_slotWaitMs = 0.0f;
+    if (slotResult != VK_SUCCESS) {
+        NOVA_ERROR("RenderFrame: Failed to wait for the frame timeline: " + std::to_string(slotResult));
         goto FrameCleanup;
     }
-    NOVA_INFO("RenderFrame: Fence " + std::to_string(m_currentFrame) + " waited successfully");
-    
-    // Acquire the next image from the swapchain
-    NOVA_INFO("RenderFrame: About to acquire next image");
-    result = vkAcquireNextImageKHR(m_dev, m_swapchain, UINT64_MAX, 
-                                           idx(m_imageAvailableSemaphores, m_currentFrame, "imageAvailableSemaphores"), VK_NULL_HANDLE, &imageIndex);
+    NOVA_INFO("RenderFrame: Slot " + std::to_string(m_currentFrame) + " waited successfully");
+    DestroyRetiredBuffers();
+    DestroyRetiredSwapchains();
+    m_geometry.CollectReleased(m_frameNumber);
+    m_scene.BeginFrame(m_currentFrame, m_frameNumber);
+    m_lightClusters.BeginFrame(m_currentFrame); // Counted by the UploadManager
     
-    if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-        NOVA_INFO("RenderFrame: Swapchain out of date during acquire, recreating...");
+    // Present mode changes recreate the swapchain here, like a resize
+    if (m_swapchainDirty) {
+        m_swapchainDirty = false;
         RecreateSwapchain();
-        goto FrameCleanup;
-    } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
-        NOVA_ERROR("RenderFrame: Failed to acquire next image: " + std::to_string(result));
-        goto FrameCleanup;
+    }
+    
+    // Acquire the next image from the swapchain; headless frames render to
+    // their slot's offscreen image, which the slot wait has freed
+    NOVA_INFO("RenderFrame: About to acquire next image");
+    if (m_headless) {
+        imageIndex = m_currentFrame;
+    } else {
+        result = vkAcquireNextImageKHR(m_dev, m_swapchain, UINT64_MAX, 
+                                               idx(m_imageAvailableSemaphores, m_currentFrame, "imageAvailableSemaphores"), VK_NULL_HANDLE, &imageIndex);
+        
+        if (result == VK_ERROR_OUT_OF_DATE_KHR) {
+            NOVA_INFO("RenderFrame: Swapchain out of date during acquire, recreating...");
+            RecreateSwapchain();
+            goto FrameCleanup;
+        } else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
+            NOVA_ERROR("RenderFrame: Failed to acquire next image: " + std::to_string(result));
+            goto FrameCleanup;
+        }
     }
     NOVA_INFO("RenderFrame: Image " + std::to_string(imageIndex) + " acquired successfully");
     
@@ -1591,26 +2398,18 @@ void VulkanRenderer::RenderFrame(Camera* camera, LightingManager* lightingManage
         goto FrameCleanup;
     }
     
-    // Check if a previous frame is using this image (i.e. there is its fence to wait on)
-    if (m_imagesInFlight[imageIndex] != VK_NULL_HANDLE) {
+    // Check if a previous frame is still rendering to this image (more frames
+    // in flight than swapchain images)
+    if (m_imagesInFlight[imageIndex] != NO_FRAME) {
         NOVA_INFO("RenderFrame: Waiting for previous frame to finish using image " + std::to_string(imageIndex));
-        waitResult = vkWaitForFences(m_dev, 1, &m_imagesInFlight[imageIndex], VK_TRUE, UINT64_MAX);
+        waitResult = m_frameTimeline.Wait(m_imagesInFlight[imageIndex]);
         if (waitResult != VK_SUCCESS) {
-            NOVA_ERROR("RenderFrame: Failed to wait for previous frame fence: " + std::to_string(waitResult));
+            NOVA_ERROR("RenderFrame: Failed to wait for previous frame: " + std::to_string(waitResult));
             goto FrameCleanup;
         }
     }
     
-    // Mark the image as now being in use by this frame's fence
-    m_imagesInFlight[imageIndex] = idx(m_inFlightFences, m_currentFrame, "inFlightFences");
-    
-    // Reset the fence for the current frame
-    NOVA_INFO("RenderFrame: Resetting fence " + std::to_string(m_currentFrame));
-    resetResult = vkResetFences(m_dev, 1, &idx(m_inFlightFences, m_currentFrame, "inFlightFences"));
-    if (resetResult != VK_SUCCESS) {
-        NOVA_ERROR("RenderFrame: Failed to reset fence: " + std::to_string(resetResult));
-        goto FrameCleanup;
-    }
+    m_framePhases.presentWaitMs += static_cast<float>(Profiler::NowMs() - phaseStartMs);
     
     // End ImGui frame BEFORE recording command buffer
     if (m_imguiReady) {
@@ -1626,59 +2425,98 @@ void VulkanRenderer::RenderFrame(Camera* camera, LightingManager* lightingManage
     }
     
     NOVA_INFO("RenderFrame: Recording command buffer " + std::to_string(m_currentFrame) + " for image " + std::to_string(imageIndex));
-    RecordCommandBuffer(idx(m_commandBuffers, m_currentFrame, "commandBuffers"), idx(m_framebuffers, imageIndex, "framebuffers"), camera);
+    phaseStartMs = Profiler::NowMs();
+    RecordCommandBuffer(idx(m_commandBuffers, m_currentFrame, "commandBuffers"), imageIndex, camera);
+    m_framePhases.cpuRecordMs = static_cast<float>(Profiler::NowMs() - phaseStartMs);
     
     // Submit the command buffer
     submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
     
-    waitSemaphores[0] = idx(m_imageAvailableSemaphores, m_currentFrame, "imageAvailableSemaphores");
-    waitStages[0] = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    submitInfo.waitSemaphoreCount = 1;
+    if (!m_headless) {
+        waitSemaphores[0] = idx(m_imageAvailableSemaphores, m_currentFrame, "imageAvailableSemaphores");
+        waitStages[0] = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        submitInfo.waitSemaphoreCount = 1;
+    }
+    
+    // Submit pending uploads and make this frame wait for all of them on the GPU;
+    // a timeline value that already completed costs nothing
+    timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+    submitInfo.pNext = &timelineInfo;
+    uploadValue = m_uploads.Flush();
+    if (uploadValue > 0) {
+        uint32_t upload = submitInfo.waitSemaphoreCount;
+        waitSemaphores[upload] = m_uploads.Timeline();
+        waitStages[upload] = VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+                             VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT; // Light binning reads uploaded lights
+        waitValues[upload] = uploadValue;
+        submitInfo.waitSemaphoreCount = upload + 1;
+        timelineInfo.waitSemaphoreValueCount = upload + 1;
+        timelineInfo.pWaitSemaphoreValues = waitValues;
+    }
     submitInfo.pWaitSemaphores = waitSemaphores;
     submitInfo.pWaitDstStageMask = waitStages;
     submitInfo.commandBufferCount = 1;
     submitInfo.pCommandBuffers = &idx(m_commandBuffers, m_currentFrame, "commandBuffers");
     
+    // The binary semaphore gates present; the timeline value marks the frame
+    // complete. Headless frames are not presented and signal only the latter.
     signalSemaphores[0] = idx(m_renderFinishedSemaphores, m_currentFrame, "renderFinishedSemaphores");
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = signalSemaphores;
-    
-    NOVA_INFO("RenderFrame: Submitting command buffer " + std::to_string(m_currentFrame) + " with fence " + std::to_string(m_currentFrame));
-    submitResult = vkQueueSubmit(m_queue, 1, &submitInfo, idx(m_inFlightFences, m_currentFrame, "inFlightFences"));
+    signalSemaphores[1] = m_frameTimeline.Semaphore();
+    signalValues[1] = FrameTimeline::SignalValue(m_frameNumber);
+    submitInfo.signalSemaphoreCount = m_headless ? 1 : 2;
+    submitInfo.pSignalSemaphores = m_headless ? signalSemaphores + 1 : signalSemaphores;
+    timelineInfo.signalSemaphoreValueCount = submitInfo.signalSemaphoreCount;
+    timelineInfo.pSignalSemaphoreValues = m_headless ? signalValues + 1 : signalValues;
+    
+    NOVA_INFO("RenderFrame: Submitting command buffer " + std::to_string(m_currentFrame) + " as frame " + std::to_string(m_frameNumber));
+    submitResult = vkQueueSubmit(m_queue, 1, &submitInfo, VK_NULL_HANDLE);
     if (submitResult != VK_SUCCESS) {
         NOVA_ERROR("RenderFrame: Failed to submit command buffer: " + std::to_string(submitResult));
         goto FrameCleanup;
     }
+    m_slotFrames[m_currentFrame] = m_frameNumber;
+    m_imagesInFlight[imageIndex] = m_frameNumber;
     NOVA_INFO("RenderFrame: Command buffer submitted successfully");
     
     // Present the image
-    presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
-    presentInfo.waitSemaphoreCount = 1;
-    presentInfo.pWaitSemaphores = signalSemaphores;
-    
-    swapChains[0] = m_swapchain;
-    presentInfo.swapchainCount = 1;
-    presentInfo.pSwapchains = swapChains;
-    presentInfo.pImageIndices = &imageIndex;
-    
-    NOVA_INFO("RenderFrame: About to present image " + std::to_string(imageIndex));
-    result = vkQueuePresentKHR(m_queue, &presentInfo);
-    
-    if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
-        NOVA_INFO("RenderFrame: Swapchain out of date or suboptimal during present, will recreate next frame");
-        // Don't return, just note that we need to recreate the swapchain
-    } else if (result != VK_SUCCESS) {
-        NOVA_ERROR("RenderFrame: Failed to present image: " + std::to_string(result));
-        goto FrameCleanup;
+    if (!m_headless) {
+        presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+        presentInfo.waitSemaphoreCount = 1;
+        presentInfo.pWaitSemaphores = signalSemaphores;
+        
+        swapChains[0] = m_swapchain;
+        presentInfo.swapchainCount = 1;
+        presentInfo.pSwapchains = swapChains;
+        presentInfo.pImageIndices = &imageIndex;
+        
+        NOVA_INFO("RenderFrame: About to present image " + std::to_string(imageIndex));
+        phaseStartMs = Profiler::NowMs();
+        result = vkQueuePresentKHR(m_queue, &presentInfo);
+        m_framePhases.presentWaitMs += static_cast<float>(Profiler::NowMs() - phaseStartMs);
+        
+        if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
+            NOVA_INFO("RenderFrame: Swapchain out of date or suboptimal during present, will recreate next frame");
+            // Don't return, just note that we need to recreate the swapchain
+        } else if (result != VK_SUCCESS) {
+            // The frame was submitted and will signal its timeline value, so it
+            // still advances; timeline values must not be signaled twice
+            NOVA_ERROR("RenderFrame: Failed to present image: " + std::to_string(result));
+        } else {
+            NOVA_INFO("RenderFrame: Image presented successfully");
+        }
     }
-    NOVA_INFO("RenderFrame: Image presented successfully");
     
-    // Advance to the next frame only after successful present
-    m_currentFrame = (m_currentFrame + 1) % MAX_FRAMES_IN_FLIGHT;
+    // Advance to the next frame once this one is submitted
+    m_currentFrame = (m_currentFrame + 1) % m_framesInFlight;
+    m_frameNumber++;
+    m_frameSlotReady = false;
+    m_meshDraws.clear();
+    m_submitted.clear();
     NOVA_INFO("RenderFrame: Advanced to frame " + std::to_string(m_currentFrame));
     
     NOVA_INFO("RenderFrame: Frame completed successfully");
     NOVA_INFO("RenderFrame: SUCCESSFULLY RETURNING FROM RenderFrame");
+    LatchFrameCounters();
     return;
 
 FrameCleanup:
@@ -1689,33 +2527,26 @@ FrameCleanup:
         ImGui::Render();
         NOVA_INFO("RenderFrame: ImGui frame ended and rendered in cleanup");
     }
+    m_meshDraws.clear(); // Draws are per frame; a dropped frame drops them
+    m_submitted.clear();
+    LatchFrameCounters();
     NOVA_INFO("RenderFrame: Frame cleanup completed");
 }
 
 void VulkanRenderer::UpdateMVP(const glm::mat4& mvp) {
-    m_currentMVP = mvp; // Store the current MVP matrix
-    
-    UniformBufferObject ubo{};
-    ubo.model = mvp; // Store the model matrix in UBO
-    
-    // Copy light data from stored arrays (this ensures lights are updated every frame)
-    for (int i = 0; i < 3; ++i) {
-        if (i < static_cast<int>(m_lightPositions.size())) {
-            ubo.lightPositions[i] = m_lightPositions[i];
-            ubo.lightColors[i] = m_lightColors[i];
-        } else {
-            ubo.lightPositions[i] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
-            ubo.lightColors[i] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
-        }
-    }
-    
-    // Calculate light space matrices for all lights (for shadow mapping)
-    // TODO: Implement proper light space matrix calculation with the new shadow system
-    for (int i = 0; i < 3; i++) {
-        ubo.lightSpaceMatrices[i] = glm::mat4(1.0f);
-    }
-    
-    memcpy(m_uniformMapped, &ubo, sizeof(ubo));
+    // Copied into the frame's uniforms when it is recorded
+    m_currentMVP = mvp;
+}
+
+void VulkanRenderer::BeginFrame(const glm::mat4& viewProj) {
+    m_currentMVP = viewProj;
+    m_frameViewProj = viewProj;
+    m_hasFrameViewProj = true;
+}
+
+void VulkanRenderer::EndFrame() {
+    RenderFrame(nullptr, nullptr);
+    m_hasFrameViewProj = false;
 }
 
 void VulkanRenderer::UpdateMVP(float deltaTime) {
@@ -1732,149 +2563,20 @@ void VulkanRenderer::UpdateMVP(float deltaTime) {
 }
 
 void VulkanRenderer::SetAssetData(const std::vector<float>& vertexData, const std::vector<uint32_t>& indices) {
-    NOVA_INFO("SetAssetData: Creating device-local buffers with staging");
-    
-    // Destroy existing buffers if they exist
-    if (m_vertexBuffer != VK_NULL_HANDLE) {
-        vkDestroyBuffer(m_dev, m_vertexBuffer, nullptr);
-        vkFreeMemory(m_dev, m_vertexMemory, nullptr);
-        m_vertexBuffer = VK_NULL_HANDLE;
-        m_vertexMemory = VK_NULL_HANDLE;
-    }
-    
-    if (m_indexBuffer != VK_NULL_HANDLE) {
-        vkDestroyBuffer(m_dev, m_indexBuffer, nullptr);
-        vkFreeMemory(m_dev, m_indexMemory, nullptr);
-        m_indexBuffer = VK_NULL_HANDLE;
-        m_indexMemory = VK_NULL_HANDLE;
+    NOVA_MEM_TAG(Renderer);
+    NOVA_INFO("SetAssetData: Replacing the default mesh");
+    
+    // Frames in flight may still read the old mesh; the pool defers reuse
+    ReleaseMesh(m_defaultMesh);
+    m_defaultMesh = RegisterMesh(vertexData, indices);
+    if (!m_defaultMesh.IsValid()) {
+        NOVA_ERROR("SetAssetData: Failed to register mesh in the geometry pool");
+        return;
     }
     
-    // Create vertex buffer with proper staging
-    VkDeviceSize vertexBufferSize = vertexData.size() * sizeof(float);
-    NOVA_INFO("SetAssetData: Creating vertex buffer of size " + std::to_string(vertexBufferSize) + " bytes");
-    
-    // Create staging buffer
-    VkBuffer stagingVertexBuffer;
-    VkDeviceMemory stagingVertexMemory;
-    
-    VkBufferCreateInfo stagingBufferInfo{};
-    stagingBufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    stagingBufferInfo.size = vertexBufferSize;
-    stagingBufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-    stagingBufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    
-    VK_CHECK(vkCreateBuffer(m_dev, &stagingBufferInfo, nullptr, &stagingVertexBuffer));
-    
-    VkMemoryRequirements stagingMemRequirements;
-    vkGetBufferMemoryRequirements(m_dev, stagingVertexBuffer, &stagingMemRequirements);
-    
-    VkMemoryAllocateInfo stagingAllocInfo{};
-    stagingAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    stagingAllocInfo.allocationSize = stagingMemRequirements.size;
-    stagingAllocInfo.memoryTypeIndex = FindMemoryType(stagingMemRequirements.memoryTypeBits, 
-                                                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-    
-    VK_CHECK(vkAllocateMemory(m_dev, &stagingAllocInfo, nullptr, &stagingVertexMemory));
-    vkBindBufferMemory(m_dev, stagingVertexBuffer, stagingVertexMemory, 0);
-    
-    // Copy data to staging buffer
-    void* stagingData;
-    vkMapMemory(m_dev, stagingVertexMemory, 0, vertexBufferSize, 0, &stagingData);
-    memcpy(stagingData, vertexData.data(), vertexBufferSize);
-    vkUnmapMemory(m_dev, stagingVertexMemory);
-    
-    // Create device-local vertex buffer
-    VkBufferCreateInfo vertexBufferInfo{};
-    vertexBufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    vertexBufferInfo.size = vertexBufferSize;
-    vertexBufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-    vertexBufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    
-    VK_CHECK(vkCreateBuffer(m_dev, &vertexBufferInfo, nullptr, &m_vertexBuffer));
-    
-    VkMemoryRequirements vertexMemRequirements;
-    vkGetBufferMemoryRequirements(m_dev, m_vertexBuffer, &vertexMemRequirements);
-    
-    VkMemoryAllocateInfo vertexAllocInfo{};
-    vertexAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    vertexAllocInfo.allocationSize = vertexMemRequirements.size;
-    vertexAllocInfo.memoryTypeIndex = FindMemoryType(vertexMemRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    
-    VK_CHECK(vkAllocateMemory(m_dev, &vertexAllocInfo, nullptr, &m_vertexMemory));
-    vkBindBufferMemory(m_dev, m_vertexBuffer, m_vertexMemory, 0);
-    
-    // Create index buffer with proper staging
-    VkDeviceSize indexBufferSize = indices.size() * sizeof(uint32_t);
-    m_indexCount = static_cast<uint32_t>(indices.size());
-    NOVA_INFO("SetAssetData: Creating index buffer of size " + std::to_string(indexBufferSize) + " bytes");
-    
-    // Create staging buffer for indices
-    VkBuffer stagingIndexBuffer;
-    VkDeviceMemory stagingIndexMemory;
-    
-    stagingBufferInfo.size = indexBufferSize;
-    stagingBufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-    
-    VK_CHECK(vkCreateBuffer(m_dev, &stagingBufferInfo, nullptr, &stagingIndexBuffer));
-    
-    vkGetBufferMemoryRequirements(m_dev, stagingIndexBuffer, &stagingMemRequirements);
-    
-    stagingAllocInfo.allocationSize = stagingMemRequirements.size;
-    stagingAllocInfo.memoryTypeIndex = FindMemoryType(stagingMemRequirements.memoryTypeBits, 
-                                                      VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-    
-    VK_CHECK(vkAllocateMemory(m_dev, &stagingAllocInfo, nullptr, &stagingIndexMemory));
-    vkBindBufferMemory(m_dev, stagingIndexBuffer, stagingIndexMemory, 0);
-    
-    // Copy index data to staging buffer
-    vkMapMemory(m_dev, stagingIndexMemory, 0, indexBufferSize, 0, &stagingData);
-    memcpy(stagingData, indices.data(), indexBufferSize);
-    vkUnmapMemory(m_dev, stagingIndexMemory);
-    
-    // Create device-local index buffer
-    VkBufferCreateInfo indexBufferInfo{};
-    indexBufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    indexBufferInfo.size = indexBufferSize;
-    indexBufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT;
-    indexBufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    
-    VK_CHECK(vkCreateBuffer(m_dev, &indexBufferInfo, nullptr, &m_indexBuffer));
-    
-    VkMemoryRequirements indexMemRequirements;
-    vkGetBufferMemoryRequirements(m_dev, m_indexBuffer, &indexMemRequirements);
-    
-    VkMemoryAllocateInfo indexAllocInfo{};
-    indexAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    indexAllocInfo.allocationSize = indexMemRequirements.size;
-    indexAllocInfo.memoryTypeIndex = FindMemoryType(indexMemRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-    
-    VK_CHECK(vkAllocateMemory(m_dev, &indexAllocInfo, nullptr, &m_indexMemory));
-    vkBindBufferMemory(m_dev, m_indexBuffer, m_indexMemory, 0);
-    
-    // Copy from staging to device-local buffers using command buffer
-    VkCommandBuffer copyCmd = BeginSingleTimeCommands();
-    
-    VkBufferCopy vertexCopyRegion{};
-    vertexCopyRegion.srcOffset = 0;
-    vertexCopyRegion.dstOffset = 0;
-    vertexCopyRegion.size = vertexBufferSize;
-    vkCmdCopyBuffer(copyCmd, stagingVertexBuffer, m_vertexBuffer, 1, &vertexCopyRegion);
-    
-    VkBufferCopy indexCopyRegion{};
-    indexCopyRegion.srcOffset = 0;
-    indexCopyRegion.dstOffset = 0;
-    indexCopyRegion.size = indexBufferSize;
-    vkCmdCopyBuffer(copyCmd, stagingIndexBuffer, m_indexBuffer, 1, &indexCopyRegion);
-    
-    EndSingleTimeCommands(copyCmd);
-    
-    // Clean up staging buffers
-    vkDestroyBuffer(m_dev, stagingVertexBuffer, nullptr);
-    vkFreeMemory(m_dev, stagingVertexMemory, nullptr);
-    vkDestroyBuffer(m_dev, stagingIndexBuffer, nullptr);
-    vkFreeMemory(m_dev, stagingIndexMemory, nullptr);
-    
-    NOVA_INFO("SetAssetData: Device-local buffers created successfully");
+    // The copies are submitted with the next frame (or earlier if the staging
+    // ring fills up); that frame's submit waits on the upload timeline
+    NOVA_INFO("SetAssetData: Mesh registered in the geometry pool, uploads queued");
     NOVA_INFO("Asset data set: " + std::to_string(vertexData.size() / 8) + " vertices, " + std::to_string(indices.size()) + " indices");
     NOVA_INFO("First few vertices: ");
     for (int i = 0; i < std::min(static_cast<int>(vertexData.size()), 24); i += 8) {
@@ -1885,47 +2587,166 @@ void VulkanRenderer::SetAssetData(const std::vector<float>& vertexData, const st
     }
 }
 
-void VulkanRenderer::SetInstanceData(const std::vector<glm::mat4>& instanceMatrices) {
-    // Destroy existing instance buffer if it exists
-    if (m_instanceBuffer != VK_NULL_HANDLE) {
-        vkDestroyBuffer(m_dev, m_instanceBuffer, nullptr);
-        vkFreeMemory(m_dev, m_instanceMemory, nullptr);
-        m_instanceBuffer = VK_NULL_HANDLE;
-        m_instanceMemory = VK_NULL_HANDLE;
+MeshHandle VulkanRenderer::RegisterMesh(const std::vector<float>& vertexData, const std::vector<uint32_t>& indices,
+                                        const std::vector<MeshLod>& lods) {
+    NOVA_MEM_TAG(Renderer);
+    constexpr size_t floatsPerVertex = GeometryPool::VERTEX_STRIDE / sizeof(float);
+    if (vertexData.empty() || vertexData.size() % floatsPerVertex != 0 || indices.empty()) {
+        NOVA_ERROR("RegisterMesh: Expected " + std::to_string(floatsPerVertex) + " floats per vertex and at least one index");
+        return MeshHandle{};
+    }
+    
+    uint32_t vertexCount = static_cast<uint32_t>(vertexData.size() / floatsPerVertex);
+    for (uint32_t index : indices) {
+        if (index >= vertexCount) {
+            NOVA_ERROR("RegisterMesh: Index " + std::to_string(index) + " out of range for " + std::to_string(vertexCount) + " vertices");
+            return MeshHandle{};
+        }
+    }
+    // A malformed level ends the chain; the levels before it are kept
+    uint32_t lodCount = 0;
+    for (const MeshLod& lod : lods) {
+        bool valid = !lod.indices.empty() && lod.indices.size() % 3 == 0 && lodCount + 1 < MAX_MESH_LODS &&
+                     std::all_of(lod.indices.begin(), lod.indices.end(), [&](uint32_t index) { return index < vertexCount; });
+        if (!valid) {
+            NOVA_WARN("RegisterMesh: LOD " + std::to_string(lodCount + 1) + " is malformed or past MAX_MESH_LODS, dropping it and the rest");
+            break;
+        }
+        lodCount++;
+    }
+    MeshHandle mesh = m_geometry.Register(vertexData.data(), vertexCount, indices.data(), static_cast<uint32_t>(indices.size()),
+                                          lods.data(), lodCount);
+    
+    // Bounding sphere for culling: AABB center, farthest vertex as radius
+    glm::vec3 minPos(std::numeric_limits<float>::max());
+    glm::vec3 maxPos(std::numeric_limits<float>::lowest());
+    for (size_t i = 0; i < vertexData.size(); i += floatsPerVertex) {
+        glm::vec3 pos(vertexData[i], vertexData[i + 1], vertexData[i + 2]);
+        minPos = glm::min(minPos, pos);
+        maxPos = glm::max(maxPos, pos);
+    }
+    glm::vec3 center = (minPos + maxPos) * 0.5f;
+    float radiusSq = 0.0f;
+    for (size_t i = 0; i < vertexData.size(); i += floatsPerVertex) {
+        glm::vec3 d = glm::vec3(vertexData[i], vertexData[i + 1], vertexData[i + 2]) - center;
+        radiusSq = std::max(radiusSq, glm::dot(d, d));
+    }
+    m_scene.SetMeshBounds(mesh, glm::vec4(center, std::sqrt(radiusSq)));
+    return mesh;
+}
+
+uint32_t VulkanRenderer::AddSceneObject(MeshHandle mesh, const glm::mat4& transform, uint32_t material) {
+    NOVA_MEM_TAG(Renderer);
+    return m_scene.AddObject(mesh, transform, material);
+}
+
+void VulkanRenderer::UpdateSceneObject(uint32_t object, const glm::mat4& transform) {
+    m_scene.UpdateObject(object, transform);
+}
+
+void VulkanRenderer::RemoveSceneObject(uint32_t object) {
+    m_scene.RemoveObject(object);
+}
+
+void VulkanRenderer::ReleaseMesh(MeshHandle mesh) {
+    if (mesh.id == m_defaultMesh.id) m_defaultMesh = MeshHandle{};
+    m_geometry.Release(mesh, m_frameNumber);
+}
+
+void VulkanRenderer::DrawMesh(MeshHandle mesh, const std::vector<glm::mat4>& instanceMatrices, uint32_t material) {
+    NOVA_MEM_TAG(Renderer);
+    if (!m_geometry.Find(mesh) || instanceMatrices.empty()) return;
+    if (material >= m_materials.size()) material = 0;
+    
+    // Same slot wait as SetInstanceData; RenderFrame reuses it
+    if (WaitForFrameSlot() != VK_SUCCESS) {
+        NOVA_ERROR("DrawMesh: Failed to wait for frame " + std::to_string(m_currentFrame));
+        return;
     }
     
+    MeshDraw draw;
+    draw.mesh = mesh;
+    draw.material = material;
+    draw.instances = m_instanceRing.Allocate(m_currentFrame, m_frameNumber, static_cast<uint32_t>(instanceMatrices.size()));
+    if (!draw.instances.data) return;
+    size_t bufferSize = instanceMatrices.size() * sizeof(glm::mat4);
+    if (m_geometry.Layout() == VertexLayout::Compact) {
+        glm::vec4 dequantize = m_geometry.PositionDequantize(mesh);
+        for (size_t i = 0; i < instanceMatrices.size(); ++i) {
+            draw.instances.data[i] = GeometryPool::Dequantized(instanceMatrices[i], dequantize);
+        }
+    } else {
+        memcpy(draw.instances.data, instanceMatrices.data(), bufferSize);
+    }
+    m_counters.bufferBytesUploaded += bufferSize;
+    m_meshDraws.push_back(draw);
+}
+
+void VulkanRenderer::Submit(MeshHandle mesh, uint32_t material, const glm::mat4& transform) {
+    NOVA_MEM_TAG(Renderer);
+    if (!m_geometry.Find(mesh)) return;
+    if (material >= m_materials.size()) material = 0;
+    m_submitted.push_back(SubmittedDraw{mesh, material, transform});
+}
+
+uint32_t VulkanRenderer::CreateMaterial(const MaterialParams& params, MaterialShadingModel shadingModel) {
+    MaterialSlot slot;
+    slot.key.vertexLayout = m_vertexLayout;
+    slot.key.shadingModel = shadingModel;
+    slot.key.blendMode = params.blendMode;
+    slot.key.doubleSided = params.doubleSided;
+    slot.baseColor = params.baseColor;
+    slot.metallic = params.metallic;
+    slot.roughness = params.roughness;
+    // Dense id per distinct pipeline, so sort keys group materials sharing one
+    uint64_t hash = slot.key.Hash();
+    auto variant = std::find(m_pipelineVariants.begin(), m_pipelineVariants.end(), hash);
+    slot.pipelineId = static_cast<uint16_t>(variant - m_pipelineVariants.begin());
+    if (variant == m_pipelineVariants.end()) m_pipelineVariants.push_back(hash);
+    // Start compiling now so the variant is usually ready by its first draw
+    if (m_pipelineStates.Fallback() != VK_NULL_HANDLE) {
+        m_pipelineStates.Prewarm(slot.key);
+        if (m_depthPrepass && slot.key.blendMode == MaterialBlendMode::Opaque) {
+            PipelineKey equal = slot.key;
+            equal.depthTest = DepthTest::EqualNoWrite;
+            m_pipelineStates.Prewarm(equal);
+        }
+    }
+    m_materials.push_back(slot);
+    return static_cast<uint32_t>(m_materials.size() - 1);
+}
+
+void VulkanRenderer::SetInstanceData(const std::vector<glm::mat4>& instanceMatrices) {
+    NOVA_MEM_TAG(Renderer);
     if (instanceMatrices.empty()) {
         m_instanceCount = 0;
+        m_instanceRange = InstanceRange{};
         return;
     }
     
-    // Create new instance buffer
-    VkDeviceSize bufferSize = instanceMatrices.size() * sizeof(glm::mat4);
-    m_instanceCount = static_cast<uint32_t>(instanceMatrices.size());
-    
-    VkBufferCreateInfo bufferInfo{};
-    bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-    bufferInfo.size = bufferSize;
-    bufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
-    bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-    
-    VK_CHECK(vkCreateBuffer(m_dev, &bufferInfo, nullptr, &m_instanceBuffer));
-    
-    VkMemoryRequirements memRequirements;
-    vkGetBufferMemoryRequirements(m_dev, m_instanceBuffer, &memRequirements);
-    
-    VkMemoryAllocateInfo allocInfo{};
-    allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    allocInfo.allocationSize = memRequirements.size;
-    allocInfo.memoryTypeIndex = FindMemoryType(memRequirements.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-    
-    VK_CHECK(vkAllocateMemory(m_dev, &allocInfo, nullptr, &m_instanceMemory));
-    vkBindBufferMemory(m_dev, m_instanceBuffer, m_instanceMemory, 0);
+    // The slice for m_currentFrame is only free once its previous submission
+    // has finished; RenderFrame reuses this wait instead of waiting again
+    if (WaitForFrameSlot() != VK_SUCCESS) {
+        NOVA_ERROR("SetInstanceData: Failed to wait for frame " + std::to_string(m_currentFrame));
+        return;
+    }
     
-    void* data;
-    vkMapMemory(m_dev, m_instanceMemory, 0, bufferSize, 0, &data);
-    memcpy(data, instanceMatrices.data(), bufferSize);
-    vkUnmapMemory(m_dev, m_instanceMemory);
+    m_instanceCount = static_cast<uint32_t>(instanceMatrices.size());
+    m_instanceRange = m_instanceRing.Allocate(m_currentFrame, m_frameNumber, m_instanceCount);
+    if (!m_instanceRange.data) {
+        m_instanceCount = 0;
+        return;
+    }
+    size_t bufferSize = instanceMatrices.size() * sizeof(glm::mat4);
+    if (m_geometry.Layout() == VertexLayout::Compact) {
+        glm::vec4 dequantize = m_geometry.PositionDequantize(m_defaultMesh);
+        for (size_t i = 0; i < instanceMatrices.size(); ++i) {
+            m_instanceRange.data[i] = GeometryPool::Dequantized(instanceMatrices[i], dequantize);
+        }
+    } else {
+        memcpy(m_instanceRange.data, instanceMatrices.data(), bufferSize);
+    }
+    m_counters.bufferBytesUploaded += bufferSize;
     
     // Debug: Log the first instance matrix to verify translation is in the right place
     if (!instanceMatrices.empty()) {
@@ -1947,59 +2768,31 @@ void VulkanRenderer::SetInstanceData(const std::vector<glm::mat4>& instanceMatri
 }
 
 void VulkanRenderer::SetLights(const std::vector<glm::vec4>& lightPositions, const std::vector<glm::vec4>& lightColors) {
-    if (lightPositions.empty() || lightColors.empty()) {
-        m_lightCount = 0;
-        return;
-    }
-    
     // Ensure we have matching arrays
     size_t count = std::min(lightPositions.size(), lightColors.size());
-    m_lightCount = static_cast<uint32_t>(count);
-    
-    // Create light data array
-    std::vector<glm::vec4> lightData;
-    lightData.reserve(count * 2); // positions + colors
-    
+    std::vector<Light> lights(count);
     for (size_t i = 0; i < count; ++i) {
-        lightData.push_back(lightPositions[i]);
-        lightData.push_back(lightColors[i]);
-    }
-    
-    // Update light buffer
-    if (m_lightMapped) {
-        memcpy(m_lightMapped, lightData.data(), lightData.size() * sizeof(glm::vec4));
-    }
-    
-    NOVA_INFO("Light data set: " + std::to_string(m_lightCount) + " lights");
-    
-    // Store the light data for UI updates
-    m_lightPositions = lightPositions;
-    m_lightColors = lightColors;
+        lights[i].position = glm::vec3(lightPositions[i]);
+        lights[i].color = glm::vec3(lightColors[i]);
+        lights[i].range = 0.0f;
+        lights[i].constant = 1.0f;
+        lights[i].linear = 0.0f;
+        lights[i].quadratic = 0.0f;
+    }
+    m_lightClusters.SetLights(lights);
+    NOVA_INFO("Light data set: " + std::to_string(count) + " lights");
 }
 
 void VulkanRenderer::UpdateLight(int lightIndex, const glm::vec3& position, float intensity) {
-    if (lightIndex < 0 || lightIndex >= static_cast<int>(m_lightCount)) {
+    std::vector<Light> lights = m_lightClusters.Lights();
+    if (lightIndex < 0 || lightIndex >= static_cast<int>(lights.size())) {
         return;
     }
     
-    // Update position (w component is unused for point lights)
-    m_lightPositions[lightIndex] = glm::vec4(position, 1.0f);
-    
-    // Update color/intensity (assuming white light with intensity)
-    m_lightColors[lightIndex] = glm::vec4(intensity, intensity, intensity, 1.0f);
-    
-    // Update the light buffer
-    std::vector<glm::vec4> lightData;
-    lightData.reserve(m_lightCount * 2);
-    
-    for (size_t i = 0; i < m_lightCount; ++i) {
-        lightData.push_back(m_lightPositions[i]);
-        lightData.push_back(m_lightColors[i]);
-    }
-    
-    if (m_lightMapped) {
-        memcpy(m_lightMapped, lightData.data(), lightData.size() * sizeof(glm::vec4));
-    }
+    // Update position and intensity; the color keeps its hue
+    lights[lightIndex].position = position;
+    lights[lightIndex].intensity = intensity;
+    m_lightClusters.SetLights(lights);
 }
 
 void VulkanRenderer::UpdateLightInManager(int lightIndex, const glm::vec3& position, float intensity, LightingManager* lightingManager) {
@@ -2023,24 +2816,7 @@ void VulkanRenderer::UpdateLightInManager(int lightIndex, const glm::vec3& posit
         // Update the renderer with the new light data
         SetLightsFromManager(lightingManager);
         
-        // Force update the uniform buffer with new light data
-        if (m_uniformMapped) {
-            UniformBufferObject ubo{};
-            ubo.model = m_currentMVP; // Use the stored current MVP matrix as model matrix
-            
-            // Copy the updated light data
-            for (int i = 0; i < 3; ++i) {
-                if (i < static_cast<int>(m_lightPositions.size())) {
-                    ubo.lightPositions[i] = m_lightPositions[i];
-                    ubo.lightColors[i] = m_lightColors[i];
-                } else {
-                    ubo.lightPositions[i] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
-                    ubo.lightColors[i] = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
-                }
-            }
-            
-            memcpy(m_uniformMapped, &ubo, sizeof(ubo));
-        }
+        // Each frame slot uploads the new lights when it next comes round
     }
 }
 
@@ -2049,16 +2825,8 @@ void VulkanRenderer::SetLightsFromManager(LightingManager* lightingManager) {
         return;
     }
     
-    const auto& lights = lightingManager->GetLights();
-    std::vector<glm::vec4> lightPositions;
-    std::vector<glm::vec4> lightColors;
-    
-    for (const auto& light : lights) {
-        lightPositions.push_back(glm::vec4(light.position, 1.0f));
-        lightColors.push_back(glm::vec4(light.color * light.intensity, 1.0f));
-    }
-    
-    SetLights(lightPositions, lightColors);
+    SetLights(lightingManager->GetLights());
+    NOVA_INFO("Light data set: " + std::to_string(lightingManager->GetLightCount()) + " lights");
 }
 
 // ImGui implementation
@@ -2130,7 +2898,7 @@ void VulkanRenderer::InitImGui(GLFWwindow* window) {
     init_info.Device = m_dev;
     init_info.QueueFamily = m_queueFamily;
     init_info.Queue = m_queue;
-    init_info.PipelineCache = VK_NULL_HANDLE;
+    init_info.PipelineCache = m_pipelineCache.Handle();
     init_info.DescriptorPool = m_imguiDescriptorPool;
     init_info.RenderPass = m_renderPass;  // Add the render pass
     init_info.Subpass = 0;
@@ -2153,6 +2921,12 @@ void VulkanRenderer::InitImGui(GLFWwindow* window) {
     VkCommandBuffer cmd = BeginSingleTimeCommands();
     ImGui_ImplVulkan_CreateFontsTexture();
     EndSingleTimeCommands(cmd);
+    {
+        unsigned char* pixels = nullptr;
+        int fontWidth = 0, fontHeight = 0;
+        ImGui::GetIO().Fonts->GetTexDataAsRGBA32(&pixels, &fontWidth, &fontHeight);
+        m_counters.textureBytesUploaded += uint64_t(fontWidth) * fontHeight * 4;
+    }
     
     m_imguiReady = true;
     m_lastFrameTime = glfwGetTime();
@@ -2175,6 +2949,19 @@ void VulkanRenderer::UpdatePerformanceMetrics(double deltaTime) {
     m_frameTime = deltaTime * 1000.0; // Convert to milliseconds
     m_frameCount++;
     
+    // deltaTime spans the previous loop iteration, so pair it with the phases
+    // accumulated during that frame. The first call has no valid delta.
+    if (m_statsFrameIndex > 0) {
+        FrameSample sample;
+        sample.frameIndex = m_statsFrameIndex;
+        sample.frameMs = static_cast<float>(m_frameTime);
+        sample.phases = m_framePhases;
+        sample.phases.gpuMs = m_gpuProfiler.GetFrameTimeMs();
+        m_frameStats.AddFrame(sample);
+    }
+    m_statsFrameIndex++;
+    m_framePhases = FramePhaseTimes{};
+    
     // Update FPS every second
     double currentTime = glfwGetTime();
     if (currentTime - m_fpsUpdateTime >= 1.0) {
@@ -2184,7 +2971,35 @@ void VulkanRenderer::UpdatePerformanceMetrics(double deltaTime) {
     }
 }
 
-void VulkanRenderer::BeginFrame() {
+RenderStats VulkanRenderer::Stats() const {
+    RenderStats stats;
+    stats.frameTimeMs = static_cast<float>(m_frameTime);
+    stats.gpuFrameMs = m_gpuProfiler.GetFrameTimeMs();
+    stats.gpuPasses = m_gpuProfiler.GetPassTimings();
+    if (const FrameSample* latest = m_frameStats.Latest()) stats.phases = latest->phases;
+    stats.p50Ms = m_frameStats.P50();
+    stats.p95Ms = m_frameStats.P95();
+    stats.p99Ms = m_frameStats.P99();
+    stats.maxMs = m_frameStats.Max();
+    stats.hitchCount = m_frameStats.HitchCount();
+    stats.counters = m_lastCounters;
+    return stats;
+}
+
+void VulkanRenderer::RequestReadback() {
+    if (!m_headless) {
+        // Swapchain images are not created with TRANSFER_SRC
+        NOVA_WARN("RequestReadback: only supported by headless renderers");
+        return;
+    }
+    m_readbackRequested = true;
+}
+
+bool VulkanRenderer::PollReadback(FrameReadback& out) {
+    return m_headless && m_readback.Poll(out);
+}
+
+void VulkanRenderer::BeginImGuiFrame() {
     if (m_imguiReady && m_window) {
         ImGui_ImplVulkan_NewFrame();
         // Note: ImGui_ImplGlfw_NewFrame() is called in Editor before this
@@ -2192,14 +3007,14 @@ void VulkanRenderer::BeginFrame() {
     }
 }
 
-void VulkanRenderer::EndFrame(VkCommandBuffer cmd) {
+void VulkanRenderer::EndImGuiFrame(VkCommandBuffer cmd) {
     if (m_imguiReady) {
         ImGui::Render();
         ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), cmd);
     }
 }
 
-void VulkanRenderer::EndFrame() {
+void VulkanRenderer::EndImGuiFrame() {
     if (m_imguiReady) {
         ImGui::Render();
         ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), m_cmdBuffer);
@@ -2265,70 +3080,64 @@ void VulkanRenderer::Shutdown() {
         vkDestroyDescriptorPool(m_dev, m_imguiDescriptorPool, nullptr);
     }
     
-    if (m_uniformMapped && m_dev != VK_NULL_HANDLE) {
-        vkUnmapMemory(m_dev, m_uniformMemory);
-        m_uniformMapped = nullptr;
-    }
-    
-    if (m_uniformBuffer != VK_NULL_HANDLE && m_dev != VK_NULL_HANDLE) {
-        vkDestroyBuffer(m_dev, m_uniformBuffer, nullptr);
-        m_uniformBuffer = VK_NULL_HANDLE;
-    }
-    if (m_uniformMemory != VK_NULL_HANDLE && m_dev != VK_NULL_HANDLE) {
-        vkFreeMemory(m_dev, m_uniformMemory, nullptr);
-        m_uniformMemory = VK_NULL_HANDLE;
-    }
-    
-    if (m_indexBuffer != VK_NULL_HANDLE && m_dev != VK_NULL_HANDLE) {
-        vkDestroyBuffer(m_dev, m_indexBuffer, nullptr);
-        m_indexBuffer = VK_NULL_HANDLE;
-    }
-    if (m_indexMemory != VK_NULL_HANDLE && m_dev != VK_NULL_HANDLE) {
-        vkFreeMemory(m_dev, m_indexMemory, nullptr);
-        m_indexMemory = VK_NULL_HANDLE;
-    }
-    
-    if (m_vertexBuffer != VK_NULL_HANDLE && m_dev != VK_NULL_HANDLE) {
-        vkDestroyBuffer(m_dev, m_vertexBuffer, nullptr);
-        m_vertexBuffer = VK_NULL_HANDLE;
-    }
-    if (m_vertexMemory != VK_NULL_HANDLE && m_dev != VK_NULL_HANDLE) {
-        vkFreeMemory(m_dev, m_vertexMemory, nullptr);
-        m_vertexMemory = VK_NULL_HANDLE;
+    if (m_dev != VK_NULL_HANDLE) {
+        m_uploads.Shutdown();
+        DestroyRetiredBuffers(true);
+        m_uniformRing.Shutdown();
+        m_readback.Shutdown();
+        m_renderGraph.Shutdown();
+        m_scene.Shutdown();
+        m_depthPyramid.Shutdown();
+        m_lightClusters.Shutdown();
+        m_geometry.Shutdown();
+        m_defaultMesh = MeshHandle{};
+        m_meshDraws.clear();
+        m_submitted.clear();
     }
     
-    if (m_pipeline != VK_NULL_HANDLE && m_dev != VK_NULL_HANDLE) {
-        vkDestroyPipeline(m_dev, m_pipeline, nullptr);
-        m_pipeline = VK_NULL_HANDLE;
+    if (m_dev != VK_NULL_HANDLE) {
+        m_pipelineStates.Shutdown();
+        for (VkPipeline& pipeline : m_prepassPipelines) {
+            if (pipeline != VK_NULL_HANDLE) vkDestroyPipeline(m_dev, pipeline, nullptr);
+            pipeline = VK_NULL_HANDLE;
+        }
+        if (m_depthRenderPass != VK_NULL_HANDLE) {
+            vkDestroyRenderPass(m_dev, m_depthRenderPass, nullptr);
+            m_depthRenderPass = VK_NULL_HANDLE;
+        }
     }
     if (m_pipelineLayout != VK_NULL_HANDLE && m_dev != VK_NULL_HANDLE) {
         vkDestroyPipelineLayout(m_dev, m_pipelineLayout, nullptr);
         m_pipelineLayout = VK_NULL_HANDLE;
     }
     
+    // Saves the cache to disk; every pipeline has been created by now
+    m_pipelineCache.Shutdown();
+    m_gpuProfiler.Shutdown();
+    m_instanceRing.Shutdown();
+    m_instanceRange = InstanceRange{};
+    
     // Cleanup shadow system
     // m_shadowSystem.Shutdown(); // Temporarily disabled
     NOVA_INFO("VulkanRenderer::Shutdown: Shadow system shut down");
     
     if (m_dev != VK_NULL_HANDLE) {
-        for (auto framebuffer : m_framebuffers) {
-            if (framebuffer != VK_NULL_HANDLE) {
-                vkDestroyFramebuffer(m_dev, framebuffer, nullptr);
-            }
-        }
-        m_framebuffers.clear();
-        
         if (m_renderPass != VK_NULL_HANDLE) {
             vkDestroyRenderPass(m_dev, m_renderPass, nullptr);
             m_renderPass = VK_NULL_HANDLE;
         }
         
+        DestroyRetiredSwapchains(true);
         for (auto imageView : m_swapchainImageViews) {
             if (imageView != VK_NULL_HANDLE) {
                 vkDestroyImageView(m_dev, imageView, nullptr);
             }
         }
         m_swapchainImageViews.clear();
+        for (size_t i = 0; i < m_offscreenAllocs.size(); i++) {
+            m_allocator.DestroyImage(m_swapchainImages[i], m_offscreenAllocs[i]);
+        }
+        m_offscreenAllocs.clear();
         
         if (m_swapchain != VK_NULL_HANDLE) {
             vkDestroySwapchainKHR(m_dev, m_swapchain, nullptr);
@@ -2344,21 +3153,21 @@ void VulkanRenderer::Shutdown() {
                 vkDestroySemaphore(m_dev, m_renderFinishedSemaphores[i], nullptr);
                 m_renderFinishedSemaphores[i] = VK_NULL_HANDLE;
             }
-            if (m_inFlightFences[i] != VK_NULL_HANDLE) {
-                vkDestroyFence(m_dev, m_inFlightFences[i], nullptr);
-                m_inFlightFences[i] = VK_NULL_HANDLE;
-            }
         }
         m_imageAvailableSemaphores.clear();
         m_renderFinishedSemaphores.clear();
-        m_inFlightFences.clear();
+        m_frameTimeline.Shutdown();
+        m_slotFrames.clear();
         m_commandBuffers.clear();
         m_imagesInFlight.clear();
+        m_jobs.Shutdown();
+        m_secondaryPools.Shutdown();
         if (m_cmdPool != VK_NULL_HANDLE) {
             vkDestroyCommandPool(m_dev, m_cmdPool, nullptr);
             m_cmdPool = VK_NULL_HANDLE;
         }
         
+        m_allocator.Shutdown();
         vkDestroyDevice(m_dev, nullptr);
         m_dev = VK_NULL_HANDLE;
     }
@@ -9,9 +9,29 @@
 #include <GLFW/glfw3.h>
 #include <vector>
 #include <cstdint>
+#include <algorithm>
 #include <glm/glm.hpp>
 #include "renderer/shadows/ShadowSystem.h"
+#include "renderer/IRenderer.h"
+#include "renderer/DrawKey.h"
+#include "GpuProfiler.h"
+#include "GpuAllocator.h"
+#include "InstanceRing.h"
+#include "UniformRing.h"
+#include "FrameTimeline.h"
+#include "ReadbackRing.h"
+#include "UploadManager.h"
+#include "GeometryPool.h"
+#include "GpuScene.h"
+#include "DepthPyramid.h"
+#include "LightClusters.h"
+#include "RenderGraph.h"
+#include "PipelineCache.h"
+#include "PipelineStateCache.h"
+#include "SecondaryCommandPools.h"
 #include "core/Log.h"
+#include "core/JobSystem.h"
+#include "core/RadixSort.h"
 
 // Bounds-checked indexing helper
 template<typename T>
@@ -25,7 +45,19 @@ T& idx(std::vector<T>& v, size_t i, const char* name) {
 
 namespace nova {
 
-class VulkanRenderer {
+// GPU time of the depth prepass plus the main pass, averaged separately over
+// frames rendered with and without the prepass so the two can be compared
+struct DepthPrepassStats {
+    float withPrepassMs = 0.0f;      // DepthPrepass + Main
+    float withoutPrepassMs = 0.0f;   // Main alone
+    uint64_t withPrepassFrames = 0;
+    uint64_t withoutPrepassFrames = 0;
+};
+
+// Implements IRenderer, so front-end code (and NovaBench) can drive it or
+// NullRenderer through the same interface; the rest of the public API is
+// Vulkan-specific tuning and the editor's camera-driven RenderFrame path.
+class VulkanRenderer : public IRenderer {
 public:
     VulkanRenderer() = default;
     ~VulkanRenderer() = default;
@@ -37,7 +69,40 @@ public:
     VulkanRenderer& operator=(VulkanRenderer&&) = delete;
 
     // Core initialization
+    // Where the pipeline cache is persisted; empty disables it. Call before Init.
+    void SetPipelineCachePath(const std::string& path) { m_pipelineCachePath = path; }
+    // Picks the first physical device whose name contains `name` (e.g. "llvmpipe");
+    // empty or no match uses the first device. Call before Init.
+    void SetPreferredDevice(const std::string& name) { m_preferredDevice = name; }
+    // Format every mesh is stored in (see GeometryPool); Compact quantizes
+    // vertices to 16 bytes. Call before Init and before creating materials.
+    void SetVertexLayout(VertexLayout layout) { m_vertexLayout = layout; }
+    VertexLayout GetVertexLayout() const { return m_vertexLayout; }
+    // Threads recording main-pass draws into secondary command buffers. Before
+    // Init this sizes the worker pool (0 = one thread per core); afterwards it
+    // caps how many of those threads take part (0 = all of them).
+    void SetRecordThreads(uint32_t threads) { m_recordThreads = threads; }
+    uint32_t GetRecordThreads() const;
+    // Frames the CPU may run ahead of the GPU, 1 to MAX_FRAMES_IN_FLIGHT (default
+    // 2): fewer lowers latency, more hides GPU stalls. Takes effect next frame.
+    void SetFramesInFlight(uint32_t frames);
+    uint32_t GetFramesInFlight() const { return m_framesInFlight; }
+    // FIFO (vsync, default), MAILBOX or IMMEDIATE; falls back to FIFO when the
+    // surface does not support the mode. Before Init or at any time after, in
+    // which case the swapchain is recreated before the next acquire.
+    void SetPresentMode(VkPresentModeKHR mode);
+    VkPresentModeKHR GetPresentMode() const { return m_activePresentMode; }
     void Init(GLFWwindow* window);
+    // IRenderer::Init; the handle is a GLFWwindow*. False if initialization failed.
+    bool Init(void* glfwWindowHandle) override;
+    // Instead of Init: no surface or swapchain, frames render into offscreen
+    // RGBA8 sRGB images, one per frame slot, and are never presented. Needs
+    // no display, so it runs on lavapipe in CI. False if initialization failed.
+    bool InitHeadless(uint32_t width, uint32_t height) override;
+    bool IsHeadless() const override { return m_headless; }
+    // The swapchain follows the window's framebuffer, so this recreates it at
+    // whatever size the window now has; headless targets keep their size
+    void Resize(int w, int h) override;
     void Shutdown();
     
     // Debug utilities
@@ -53,9 +118,9 @@ public:
     
     // ImGui lifecycle
     void InitImGui(GLFWwindow* window);
-    void BeginFrame();
-    void EndFrame(VkCommandBuffer cmd);
-    void EndFrame();
+    void BeginImGuiFrame();
+    void EndImGuiFrame(VkCommandBuffer cmd);
+    void EndImGuiFrame();
     VkCommandBuffer GetActiveCmd() const;
     bool IsImGuiReady() const;
 
@@ -63,11 +128,72 @@ public:
     void RenderFrame(class Camera* camera = nullptr, class LightingManager* lightingManager = nullptr);
     void UpdateMVP(const glm::mat4& mvp);
     void UpdateMVP(float deltaTime);
+    // IRenderer frame: BeginFrame sets the view-projection the queued draws
+    // are rendered and culled with, EndFrame renders them (RenderFrame
+    // without a camera, which would otherwise take precedence)
+    void BeginFrame(const glm::mat4& viewProj) override;
+    void EndFrame() override;
     
     // Asset system integration
+    MeshHandle RegisterMesh(const std::vector<float>& vertexData, const std::vector<uint32_t>& indices,
+                            const std::vector<MeshLod>& lods = {}) override;
+    void ReleaseMesh(MeshHandle mesh) override;
+    // Queue `mesh` for this frame only; all queued meshes share one vertex/index bind
+    void DrawMesh(MeshHandle mesh, const std::vector<glm::mat4>& instanceMatrices, uint32_t material = 0) override;
+    // Queue one object for this frame only. Submitted objects are sorted with
+    // the rest of the frame's draws and runs of the same mesh and material
+    // become one instanced draw, so call order does not matter.
+    void Submit(MeshHandle mesh, uint32_t material, const glm::mat4& transform) override;
+    // Sort the frame's draws by DrawKey before recording (on by default);
+    // off keeps submission order, for comparing state changes
+    void SetDrawSorting(bool enabled) { m_sortDraws = enabled; }
+    // Lays depth down with a position-only pass first; the main pass then
+    // shades opaque materials with an EQUAL depth test and no depth writes, so
+    // each pixel is shaded once. Masked and blended materials are not in the
+    // prepass and keep their usual depth test. Off by default; next frame.
+    void SetDepthPrepass(bool enabled);
+    bool GetDepthPrepass() const { return m_depthPrepass; }
+    const DepthPrepassStats& GetDepthPrepassStats() const { return m_prepassStats; }
+    // Selects a pipeline variant (blend mode, double-sidedness, shading model)
+    // plus the constants pushed with it; 0 is the default material. A new
+    // variant draws with the default pipeline until it has compiled.
+    uint32_t CreateMaterial(const MaterialParams& params, MaterialShadingModel shadingModel) override;
+    // Replaces the default mesh, which is drawn every frame with SetInstanceData's instances
     void SetAssetData(const std::vector<float>& vertexData, const std::vector<uint32_t>& indices);
+    // With VertexLayout::Compact the default mesh's dequantization is folded
+    // into the instances here, so set them again after SetAssetData
     void SetInstanceData(const std::vector<glm::mat4>& instanceMatrices);
-    void SetLights(const std::vector<glm::vec4>& lightPositions, const std::vector<glm::vec4>& lightColors);
+    
+    // Persistent scene objects for the GPU-driven path (frustum culled every frame)
+    enum class CullMode { Cpu, Gpu };
+    uint32_t AddSceneObject(MeshHandle mesh, const glm::mat4& transform, uint32_t material = 0);
+    void UpdateSceneObject(uint32_t object, const glm::mat4& transform);
+    void RemoveSceneObject(uint32_t object);
+    // Gpu falls back to Cpu when compute culling or drawIndirectCount is unavailable
+    void SetCullMode(CullMode mode) { m_cullMode = mode; }
+    CullMode GetCullMode() const { return m_cullMode; }
+    bool IsGpuCullingAvailable() const { return m_scene.GpuCullingAvailable(); }
+    // Two-phase Hi-Z occlusion culling on top of GPU culling: last frame's
+    // visible objects are drawn first, the rest are tested against a depth
+    // pyramid built from them and drawn in a late pass. Off by default; needs
+    // GPU culling and shaderStorageImageArrayDynamicIndexing.
+    void SetOcclusionCulling(bool enabled) { m_occlusionCulling = enabled; }
+    bool GetOcclusionCulling() const { return m_occlusionCulling; }
+    bool IsOcclusionCullingAvailable() const { return m_scene.OcclusionCullingAvailable() && m_depthPyramid.Available(); }
+    // Compare every GPU culling result against CPU culling (costs a readback)
+    void SetCullValidation(bool enabled) { m_scene.SetValidation(enabled); }
+    // Level-of-detail selection for scene objects, on both culling paths;
+    // meshes registered without coarser levels always draw level 0
+    void SetLodSettings(const GpuScene::LodSettings& settings) { m_scene.SetLodSettings(settings); }
+    const GpuScene::LodSettings& GetLodSettings() const { return m_scene.GetLodSettings(); }
+    GpuSceneStats GetSceneStats() const { return m_scene.Stats(); }
+    RenderGraphStats GetRenderGraphStats() const { return m_renderGraph.Stats(); }
+    // Unbounded point lights without falloff: lit everywhere, never binned
+    void SetLights(const std::vector<glm::vec4>& lightPositions, const std::vector<glm::vec4>& lightColors) override;
+    // Any number of point, spot and directional lights up to
+    // LightClusters::MAX_LIGHTS; bounded ones are binned into clusters
+    void SetLights(const std::vector<Light>& lights) { m_lightClusters.SetLights(lights); }
+    LightClusterStats GetLightClusterStats() const { return m_lightClusters.Stats(); }
     void UpdateLight(int lightIndex, const glm::vec3& position, float intensity);
     void UpdateLightInManager(int lightIndex, const glm::vec3& position, float intensity, class LightingManager* lightingManager);
     void SetLightsFromManager(class LightingManager* lightingManager);
@@ -80,18 +206,37 @@ public:
     double GetFPS() const { return m_fps; }
     double GetFrameTime() const { return m_frameTime; }
     int GetFrameCount() const { return m_frameCount; }
+    RenderStats Stats() const override;
+    // Headless only: copies the next frame into a host-visible readback slot
+    // without waiting; PollReadback returns it once that frame has completed
+    void RequestReadback() override;
+    bool PollReadback(FrameReadback& out) override;
+    ReadbackStats GetReadbackStats() const { return m_readback.Stats(); }
+    // Fence time spent inside SetInstanceData belongs to presentWait, not simulation
+    void SetCpuSimTime(double ms) { m_framePhases.cpuSimMs = std::max(0.0f, static_cast<float>(ms) - m_slotWaitMs); }
+    FrameStats& GetFrameStats() { return m_frameStats; }
+    GpuAllocatorStats GetAllocatorStats() const { return m_allocator.GetStats(); }
+    PipelineCacheStats GetPipelineCacheStats() const { return m_pipelineCache.Stats(); }
+    PipelineStateStats GetPipelineStateStats() const { return m_pipelineStates.Stats(); }
     
     // Device properties
     VkDeviceSize GetMinUniformBufferOffsetAlignment() const { return m_minUniformBufferOffsetAlignment; }
     
-    // Frame-in-flight management
-    static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 2;
+    // Frame-in-flight management. Per-frame resources exist for
+    // MAX_FRAMES_IN_FLIGHT slots; m_framesInFlight of them are cycled.
+    static constexpr uint32_t MAX_FRAMES_IN_FLIGHT = 4;
+    static constexpr uint64_t NO_FRAME = ~0ull;
+    uint32_t m_framesInFlight = 2;
     uint32_t m_currentFrame = 0;
     std::vector<VkSemaphore> m_imageAvailableSemaphores;
     std::vector<VkSemaphore> m_renderFinishedSemaphores;
-    std::vector<VkFence> m_inFlightFences;
-    std::vector<VkFence> m_imagesInFlight;
+    FrameTimeline m_frameTimeline;
+    std::vector<uint64_t> m_slotFrames;      // Last frame submitted from each slot
+    std::vector<uint64_t> m_imagesInFlight;  // Last frame that rendered to each swapchain image
     std::vector<VkCommandBuffer> m_commandBuffers;
+    VkPresentModeKHR m_presentMode = VK_PRESENT_MODE_FIFO_KHR;        // Requested
+    VkPresentModeKHR m_activePresentMode = VK_PRESENT_MODE_FIFO_KHR;  // Used by the swapchain
+    bool m_swapchainDirty = false;
     
     // Device properties
     VkDeviceSize m_minUniformBufferOffsetAlignment = 0;
@@ -103,6 +248,8 @@ private:
     VkDevice      m_dev          = VK_NULL_HANDLE;
     uint32_t      m_queueFamily  = 0;
     VkQueue       m_queue        = VK_NULL_HANDLE;
+    uint32_t      m_transferFamily = 0;
+    VkQueue       m_transferQueue  = VK_NULL_HANDLE; // Same as m_queue without a dedicated family
     VkCommandPool m_cmdPool      = VK_NULL_HANDLE;
     VkCommandBuffer m_cmdBuffer  = VK_NULL_HANDLE;
     VkFence       m_fence        = VK_NULL_HANDLE;
@@ -116,47 +263,120 @@ private:
     VkSwapchainKHR m_swapchain   = VK_NULL_HANDLE;
     std::vector<VkImage> m_swapchainImages;
     std::vector<VkImageView> m_swapchainImageViews;
-    std::vector<VkFramebuffer> m_framebuffers;
-    VkRenderPass   m_renderPass  = VK_NULL_HANDLE;
+    VkRenderPass   m_renderPass  = VK_NULL_HANDLE; // Pipeline/ImGui compatibility; the render graph begins the real passes
     VkExtent2D     m_extent      = {0, 0};
     VkFormat       m_format      = VK_FORMAT_UNDEFINED;
 
     // Pipeline
     VkPipelineLayout m_pipelineLayout = VK_NULL_HANDLE;
-    VkPipeline m_pipeline = VK_NULL_HANDLE;
+    PipelineStateCache m_pipelineStates;   // Main-pass pipelines by material state
     VkDescriptorSetLayout m_descriptorSetLayout = VK_NULL_HANDLE;
     VkDescriptorPool m_descriptorPool = VK_NULL_HANDLE;
     std::vector<VkDescriptorSet> m_descriptorSets;
 
-    // Vertex buffer
-    VkBuffer m_vertexBuffer = VK_NULL_HANDLE;
-    VkDeviceMemory m_vertexMemory = VK_NULL_HANDLE;
-    VkBuffer m_indexBuffer = VK_NULL_HANDLE;
-    VkDeviceMemory m_indexMemory = VK_NULL_HANDLE;
-    uint32_t m_indexCount = 0;
+    // Shared vertex/index buffers for every registered mesh
+    GeometryPool m_geometry;
+    MeshHandle m_defaultMesh;          // Set by SetAssetData
+    struct MeshDraw {
+        MeshHandle mesh;
+        InstanceRange instances;
+        uint32_t material = 0;
+    };
+    std::vector<MeshDraw> m_meshDraws; // Queued by DrawMesh, cleared after present
+    struct SubmittedDraw {
+        MeshHandle mesh;
+        uint32_t material = 0;
+        glm::mat4 transform{1.0f};
+    };
+    std::vector<SubmittedDraw> m_submitted; // Queued by Submit, cleared with m_meshDraws
+    
+    // Everything drawn this frame before sorting. Single objects (Submit, CPU
+    // culled scene objects) get their instance data written after sorting, so
+    // equal mesh/material runs end up contiguous and instanced.
+    struct FrameDraw {
+        MeshHandle mesh;
+        uint32_t material = 0;
+        InstanceRange instances;               // Prebuilt (default mesh, DrawMesh)
+        const glm::mat4* transform = nullptr;  // Single object when set
+        bool sceneIndirect = false;
+        uint8_t lod = 0;                       // Level of detail of `mesh`
+    };
+    std::vector<FrameDraw> m_frameDraws;
+    std::vector<SortEntry> m_sortEntries;
+    std::vector<SortEntry> m_sortScratch;
+    bool m_sortDraws = true;
+    
+    // Main-pass draws in recording order. They are split into contiguous
+    // slices recorded in parallel, one secondary command buffer per slice.
+    struct DrawItem {
+        MeshHandle mesh;
+        InstanceRange instances;
+        uint32_t material = 0;
+        bool sceneIndirect = false;    // GpuScene's indirect count draw instead of `mesh`
+        uint8_t lod = 0;
+    };
+    static constexpr size_t MIN_DRAWS_PER_SLICE = 128; // Below this, waking a worker costs more than it saves
+    std::vector<DrawItem> m_drawItems;
+    JobSystem m_jobs;
+    SecondaryCommandPools m_secondaryPools;
+    uint32_t m_recordThreads = 0;
+    std::vector<VkCommandBuffer> m_secondaries;   // Executed in order by the main pass
+    std::vector<RenderCounters> m_sliceCounters;  // Merged into m_counters after recording
+    // This frame's main-pass pipeline per material id, resolved on the render
+    // thread before the slices record so they read it without locking
+    std::vector<VkPipeline> m_materialPipelines;
+    
+    // Pipeline key and pushed constants per material id
+    struct MaterialSlot {
+        PipelineKey key;
+        uint16_t pipelineId = 0;       // Index into m_pipelineVariants, for sort keys
+        glm::vec4 baseColor{1.0f};
+        float metallic = 0.0f;
+        float roughness = 0.5f;
+    };
+    std::vector<MaterialSlot> m_materials = {MaterialSlot{PipelineKey{}, 0, glm::vec4(1.0f, 0.2f, 0.2f, 1.0f), 0.0f, 0.3f}};
+    std::vector<uint64_t> m_pipelineVariants;   // PipelineKey hashes in first-use order
+    
+    // Depth prepass: one depth-only pipeline per cull mode, reading the
+    // geometry pool's position stream. m_prepassThisFrame is latched when the
+    // frame is recorded, so a toggle never splits a frame.
+    bool m_depthPrepass = false;
+    bool m_prepassThisFrame = false;
+    VkRenderPass m_depthRenderPass = VK_NULL_HANDLE;   // Pipeline compatibility; the render graph begins the real pass
+    VkPipeline m_prepassPipelines[2] = {};             // Indexed by PipelineKey::doubleSided
+    DepthPrepassStats m_prepassStats;
+    
+    // GPU-driven scene objects
+    GpuScene m_scene;
+    CullMode m_cullMode = CullMode::Gpu;
+    bool m_supportsIndirectCount = false;
+    std::vector<uint32_t> m_cpuVisible;  // Scratch for the CPU culling path
+    std::vector<uint8_t> m_cpuLods;      // Level of detail per m_cpuVisible entry
+    // Occlusion culling; m_occlusionThisFrame is latched like m_prepassThisFrame
+    DepthPyramid m_depthPyramid;
+    bool m_occlusionCulling = false;
+    bool m_occlusionThisFrame = false;
+    bool m_supportsStorageImageIndexing = false;
     
-    // Instance buffer for GPU instancing
-    VkBuffer m_instanceBuffer = VK_NULL_HANDLE;
-    VkDeviceMemory m_instanceMemory = VK_NULL_HANDLE;
+    // Per-frame passes, barriers and transient attachments (depth)
+    RenderGraph m_renderGraph;
+    
+    // Instance data for GPU instancing, suballocated from a per-frame ring
+    InstanceRing m_instanceRing;
+    InstanceRange m_instanceRange;
     uint32_t m_instanceCount = 0;
+    uint64_t m_frameNumber = 0;        // Advances with m_currentFrame; frame N signals N + 1 on m_frameTimeline
+    bool m_frameSlotReady = false;     // m_currentFrame's previous frame already waited this frame
+    float m_slotWaitMs = 0.0f;         // Timeline wait not yet attributed to a frame phase
 
-    // Uniform buffer for MVP matrix
-    VkBuffer m_uniformBuffer = VK_NULL_HANDLE;
-    VkDeviceMemory m_uniformMemory = VK_NULL_HANDLE;
-    void* m_uniformMapped = nullptr;
+    // Per-frame uniforms: written once per frame from CPU-side state (never
+    // read back) and bound with a dynamic offset. Further blocks, e.g. per-draw
+    // constants that do not fit in push constants, can share the frame's slice.
+    UniformRing m_uniformRing;
+    uint32_t m_frameUniformOffset = 0;  // This frame's UniformBufferObject
     
-    // Light buffer
-    VkBuffer m_lightBuffer = VK_NULL_HANDLE;
-    VkDeviceMemory m_lightMemory = VK_NULL_HANDLE;
-    void* m_lightMapped = nullptr;
-    uint32_t m_lightCount = 0;
-    std::vector<glm::vec4> m_lightPositions;
-    std::vector<glm::vec4> m_lightColors;
-
-    // Depth buffer
-    VkImage m_depthImage = VK_NULL_HANDLE;
-    VkDeviceMemory m_depthImageMemory = VK_NULL_HANDLE;
-    VkImageView m_depthImageView = VK_NULL_HANDLE;
+    // Lights and their per-frame cluster binning
+    LightClusters m_lightClusters;
 
     // ImGui
     bool          m_imguiReady = false;
@@ -172,9 +392,57 @@ private:
     double        m_fps = 60.0;
     int           m_frameCount = 0;
     double        m_fpsUpdateTime = 0.0;
+    FrameStats    m_frameStats;
+    FramePhaseTimes m_framePhases;     // Accumulates during the current frame
+    uint64_t      m_statsFrameIndex = 0;
+    
+    // GPU pass timings
+    GpuProfiler   m_gpuProfiler;
+    
+    // Device memory suballocator shared with ShadowSystem
+    GpuAllocator  m_allocator;
+    
+    // Disk-backed VkPipelineCache and shader modules, shared with GpuScene and ShadowSystem
+    PipelineCache m_pipelineCache;
+    std::string   m_pipelineCachePath = "pipeline_cache.bin";
+    std::string   m_preferredDevice;
+    VertexLayout  m_vertexLayout = VertexLayout::Standard;
+    
+    // Staging ring + transfer queue for buffer uploads
+    UploadManager m_uploads;
+    struct RetiredBuffer {
+        VkBuffer buffer;
+        GpuAllocation allocation;
+        uint64_t frameNumber;
+    };
+    std::vector<RetiredBuffer> m_retiredBuffers;
+    // Replaced swapchains and their views, destroyed once the frames that may
+    // still render to or present their images have completed
+    struct RetiredSwapchain {
+        VkSwapchainKHR swapchain;
+        std::vector<VkImageView> views;
+        uint64_t frameNumber;
+    };
+    std::vector<RetiredSwapchain> m_retiredSwapchains;
+    uint32_t m_swapchainRecreations = 0;
+    float m_lastSwapchainRecreateMs = 0.0f;
+    
+    // Headless mode: m_swapchainImages/Views hold the offscreen targets, so
+    // recording is the same as with a window
+    bool m_headless = false;
+    std::vector<GpuAllocation> m_offscreenAllocs;
+    ReadbackRing m_readback;
+    bool m_readbackRequested = false;
+    
+    // Work counters: m_counters accumulates, m_lastCounters is the last completed frame
+    RenderCounters m_counters;
+    RenderCounters m_lastCounters;
     
-    // Current MVP matrix for light updates
+    // Current MVP matrix, copied into the frame's uniforms when it is recorded
     glm::mat4     m_currentMVP = glm::mat4(1.0f);
+    // Set by IRenderer::BeginFrame until its EndFrame has rendered
+    glm::mat4     m_frameViewProj = glm::mat4(1.0f);
+    bool          m_hasFrameViewProj = false;
 
     // Shadow system
     ShadowSystem m_shadowSystem;
@@ -184,14 +452,12 @@ private:
     void CreateInstance();
     void CreateDevice();
     void CreateSwapchain();
+    void CreateOffscreenTargets();
     void CreateRenderPass();
-    void CreateFramebuffers();
-    void CreateDepthResources();
     void CreatePipeline();
+    void CreateDepthPrepassPipelines();
     void CreateVertexBuffer();
-    void CreateInstanceBuffer();
     void CreateUniformBuffer();
-    void CreateLightBuffer();
     void CreateCommandPool();
     void CreateSyncObjects();
     void CreateDescriptorPool();
@@ -205,11 +471,35 @@ private:
     void RenderShadowMaps(VkCommandBuffer cmd, int lightIndex);
     glm::mat4 CalculateLightSpaceMatrix(const glm::vec3& lightPos);
     glm::mat4 CalculateLightSpaceMatrixForFace(const glm::vec3& lightPos, int face);
-    void RecordCommandBuffer(VkCommandBuffer cmd, VkFramebuffer framebuffer, class Camera* camera = nullptr);
+    void RecordCommandBuffer(VkCommandBuffer cmd, uint32_t imageIndex, class Camera* camera = nullptr);
+    // Sorts m_frameDraws into m_drawItems, writing single objects' instance data
+    void BuildDrawItems(const glm::mat4& viewProjection);
+    // Any thread; `thread` selects the command pool
+    VkCommandBuffer BeginMainPassSecondary(uint32_t thread);
+    // Fills m_materialPipelines for the materials m_drawItems use
+    void ResolveMaterialPipelines();
+    void RecordDraws(VkCommandBuffer cmd, const DrawItem* items, size_t count, const glm::mat4& viewProjection,
+                     RenderCounters& counters);
+    // Opaque draws of m_drawItems into the depth prepass
+    void RecordDepthPrepass(VkCommandBuffer cmd, const glm::mat4& viewProjection);
+    // Vertex and index streams of the geometry pool for the main pass
+    void BindGeometry(VkCommandBuffer cmd, RenderCounters& counters);
+    // Scene objects the occlusion pass found visible and the main pass did not draw
+    void RecordLateDraws(VkCommandBuffer cmd, const glm::mat4& viewProjection, RenderCounters& counters);
+    // The UI overlay, last in whichever pass ends the frame
+    void RecordImGui(VkCommandBuffer cmd);
+    // Main-pass pipeline key for `slot` this frame
+    PipelineKey MainPassKey(const MaterialSlot& slot) const;
+    // Folds the GPU timings just read back into m_prepassStats
+    void UpdateDepthPrepassStats();
     void RenderUI(class Camera* camera = nullptr, class LightingManager* lightingManager = nullptr);
     
     // Utility functions
-    uint32_t FindMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
+    void LatchFrameCounters();
+    VkResult WaitForFrameSlot();
+    void RetireBuffer(VkBuffer& buffer, GpuAllocation& allocation);
+    void DestroyRetiredBuffers(bool all = false);
+    void DestroyRetiredSwapchains(bool all = false);
     VkCommandBuffer BeginSingleTimeCommands();
     void EndSingleTimeCommands(VkCommandBuffer commandBuffer);
 };
@@ -5,9 +5,59 @@ extern "C" {
 }
 #include "LuaVM.h"
 #include "engine/core/Log.h"
+#include "engine/core/MemoryTracker.h"
+#include <cstdio>
+#include <cstring>
 
 namespace nova {
-bool LuaVM::Init(){ L = luaL_newstate(); luaL_openlibs(L); return L!=nullptr; }
+#ifdef NOVA_MEMORY_TRACKING
+// lua_newstate installs no panic or warning function; these mirror the ones
+// luaL_newstate sets up (lauxlib.c), so an unprotected error still says why
+// before Lua aborts, and warn() still honours "@on"/"@off" (off at start)
+static int LuaPanic(lua_State* L){
+    const char* msg = (lua_type(L,-1) == LUA_TSTRING) ? lua_tostring(L,-1) : "error object is not a string";
+    lua_writestringerror("PANIC: unprotected error in call to Lua API (%s)\n", msg);
+    return 0;
+}
+static void LuaWarnOff(void* ud, const char* msg, int tocont);
+static void LuaWarnOn(void* ud, const char* msg, int tocont);
+static bool LuaWarnControl(lua_State* L, const char* msg, int tocont){
+    if (tocont || *(msg++) != '@') return false;
+    if (std::strcmp(msg, "off") == 0) lua_setwarnf(L, LuaWarnOff, L);
+    else if (std::strcmp(msg, "on") == 0) lua_setwarnf(L, LuaWarnOn, L);
+    return true;
+}
+static void LuaWarnOff(void* ud, const char* msg, int tocont){
+    LuaWarnControl(static_cast<lua_State*>(ud), msg, tocont);
+}
+// Rest of a warning split across several lua_warning calls
+static void LuaWarnCont(void* ud, const char* msg, int tocont){
+    lua_State* L = static_cast<lua_State*>(ud);
+    lua_writestringerror("%s", msg);
+    if (tocont) lua_setwarnf(L, LuaWarnCont, L);
+    else { lua_writestringerror("%s", "\n"); lua_setwarnf(L, LuaWarnOn, L); }
+}
+static void LuaWarnOn(void* ud, const char* msg, int tocont){
+    if (LuaWarnControl(static_cast<lua_State*>(ud), msg, tocont)) return;
+    lua_writestringerror("%s", "Lua warning: ");
+    LuaWarnCont(ud, msg, tocont);
+}
+#endif
+
+bool LuaVM::Init(){
+#ifdef NOVA_MEMORY_TRACKING
+    L = lua_newstate(&MemoryTracker::LuaAlloc, nullptr);
+    if (L){
+        lua_atpanic(L, &LuaPanic);
+        lua_setwarnf(L, LuaWarnOff, L);
+    }
+#else
+    L = luaL_newstate();
+#endif
+    if (!L) return false;
+    luaL_openlibs(L);
+    return true;
+}
 void LuaVM::Shutdown(){ if(L){ lua_close(L); L=nullptr; } }
 bool LuaVM::RunFile(const std::string& p){
     if (luaL_dofile(L, p.c_str()) != LUA_OK){